@@ -0,0 +1,342 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+#
+# See file LICENSE for terms.
+#
+# This script runs a matrix of ucx_perftest benchmarks on a single machine and
+# checks the results for performance regressions.
+# Method:
+#    - Read the benchmark matrix from a ucx_perftest batch file, by default
+#      contrib/ucx_perftest_config/test_types_regression.
+#    - Run every entry in loopback mode over every transport several times,
+#      using ucx_perftest JSON output.
+#    - Save the results together with the environment metadata (CPU model,
+#      UCX version and build flags, UCX_ environment variables).
+#    - If a baseline results file is given, compare every benchmark to it with
+#      Welch's t-test, and fail if the slowdown is both larger than the
+#      threshold and statistically significant.
+#
+# Example usage:
+#    $ ./contrib/perf_regression.py --perftest ./install/bin/ucx_perftest \
+#          --output rc1.json --baseline rc0.json
+#    $ ./contrib/perf_regression.py --results rc1.json --baseline rc0.json
+#
+# Exit status: 0 - no regressions, 1 - regression found, 2 - failure.
+#
+from optparse import OptionParser
+import subprocess
+import platform
+import shlex
+import math
+import json
+import time
+import sys
+import os
+
+
+class Benchmark(object):
+    def __init__(self, name, args):
+        self.name = name
+        self.args = args
+        if name.endswith("_lat"):
+            self.metric = ("latency_usec", "overall")
+            self.higher_is_better = False
+        elif name.endswith("_mr"):
+            self.metric = ("msgrate", "overall")
+            self.higher_is_better = True
+        else:
+            self.metric = ("bandwidth_mbs", "overall")
+            self.higher_is_better = True
+
+    def metric_name(self):
+        return ".".join(self.metric)
+
+
+def read_batch_file(filename):
+    benchmarks = []
+    with open(filename) as f:
+        for line in f:
+            words = shlex.split(line, comments=True)
+            if words:
+                benchmarks.append(Benchmark(words[0], words[1:]))
+    return benchmarks
+
+
+def incomplete_beta_cf(a, b, x):
+    # Continued fraction for the incomplete beta function, by modified Lentz's
+    # method
+    tiny = 1e-300
+    c = 1.0
+    d = 1.0 - (a + b) * x / (a + 1.0)
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    h = d
+    for m in range(1, 300):
+        for aa in (m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m)),
+                   -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1))):
+            d = 1.0 + aa * d
+            d = 1.0 / (d if abs(d) > tiny else tiny)
+            c = 1.0 + aa / c
+            c = c if abs(c) > tiny else tiny
+            h *= d * c
+        if abs(d * c - 1.0) < 1e-12:
+            break
+    return h
+
+
+def incomplete_beta(a, b, x):
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    bt = math.exp(math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) +
+                  a * math.log(x) + b * math.log(1.0 - x))
+    if x < (a + 1.0) / (a + b + 2.0):
+        return bt * incomplete_beta_cf(a, b, x) / a
+    return 1.0 - bt * incomplete_beta_cf(b, a, 1.0 - x) / b
+
+
+def mean(values):
+    return sum(values) / len(values)
+
+
+def variance(values):
+    m = mean(values)
+    return sum((v - m) ** 2 for v in values) / (len(values) - 1)
+
+
+def welch_pvalue(x, y):
+    # Two-sided p-value of Welch's t-test for equal means, or None if there are
+    # not enough samples
+    if len(x) < 2 or len(y) < 2:
+        return None
+    vx = variance(x) / len(x)
+    vy = variance(y) / len(y)
+    if vx + vy == 0.0:
+        return 1.0 if mean(x) == mean(y) else 0.0
+    t = (mean(x) - mean(y)) / math.sqrt(vx + vy)
+    df = (vx + vy) ** 2 / (vx ** 2 / (len(x) - 1) + vy ** 2 / (len(y) - 1))
+    return incomplete_beta(df / 2.0, 0.5, df / (df + t * t))
+
+
+class RegressionSuite(object):
+    def __init__(self):
+        # Other fields are set by parse_args()
+        self.verbose = False
+
+    def parse_args(self, argv):
+        default_config = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                      "ucx_perftest_config",
+                                      "test_types_regression")
+        parser = OptionParser()
+        parser.add_option("-p", "--perftest", dest="perftest",
+                          default="ucx_perftest",
+                          help="ucx_perftest executable [default: %default]")
+        parser.add_option("-b", "--batch", dest="batch", default=default_config,
+                          help="benchmark matrix in ucx_perftest batch file " +
+                               "format [default: %default]")
+        parser.add_option("-t", "--transports", dest="transports",
+                          default="self,shm,tcp",
+                          help="comma-separated list of UCX_TLS values to " +
+                               "run every benchmark with [default: %default]")
+        parser.add_option("-n", "--repeat", dest="repeat", type="int",
+                          default=5,
+                          help="number of times to run every benchmark " +
+                               "[default: %default]")
+        parser.add_option("-o", "--output", dest="output",
+                          help="file to save the results to")
+        parser.add_option("-r", "--results", dest="results",
+                          help="compare existing results file instead of " +
+                               "running the benchmarks")
+        parser.add_option("-B", "--baseline", dest="baseline",
+                          help="baseline results file to compare to")
+        parser.add_option("-T", "--threshold", dest="threshold", type="float",
+                          default=5.0,
+                          help="minimal slowdown, in percent, which is " +
+                               "considered a regression [default: %default]")
+        parser.add_option("-a", "--alpha", dest="alpha", type="float",
+                          default=0.01,
+                          help="significance level of the comparison " +
+                               "[default: %default]")
+        parser.add_option("-v", "--verbose", dest="verbose",
+                          action="store_true", default=False,
+                          help="print ucx_perftest command lines")
+        (options, args) = parser.parse_args(argv)
+        if options.repeat < 1:
+            parser.error("repeat count must be at least 1")
+        self.__dict__.update(options.__dict__)
+
+    def run_command(self, cmd, env=None):
+        if self.verbose:
+            print("running %s" % " ".join(cmd))
+        proc = subprocess.run(cmd, env=env, stdout=subprocess.PIPE,
+                              stderr=subprocess.STDOUT,
+                              universal_newlines=True)
+        return proc.returncode, proc.stdout
+
+    def get_environment(self):
+        env = {
+            "date": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+            "hostname": platform.node(),
+            "kernel": platform.release(),
+            "machine": platform.machine(),
+            "cpu_count": os.cpu_count(),
+            "cpu_model": platform.processor(),
+            "ucx_env": dict((k, v) for (k, v) in os.environ.items()
+                            if k.startswith("UCX_")),
+            "perftest": self.perftest,
+            "batch": os.path.basename(self.batch),
+            "transports": self.transports.split(","),
+            "repeat": self.repeat
+        }
+
+        try:
+            with open("/proc/cpuinfo") as f:
+                for line in f:
+                    if line.startswith("model name"):
+                        env["cpu_model"] = line.split(":", 1)[1].strip()
+                        break
+        except IOError:
+            pass
+
+        # ucx_info is installed next to ucx_perftest, and reports the library
+        # version, source revision and configure flags
+        ucx_info = os.path.join(os.path.dirname(self.perftest), "ucx_info")
+        for cmd in [ucx_info, "ucx_info"]:
+            try:
+                status, output = self.run_command([cmd, "-v"])
+            except OSError:
+                continue
+            if status == 0:
+                env["ucx_info"] = [line.lstrip("# ")
+                                   for line in output.splitlines()]
+                break
+
+        return env
+
+    def run_benchmark(self, benchmark, transport):
+        env = dict(os.environ)
+        env["UCX_TLS"] = transport
+        cmd = [self.perftest, "-l", "-f", "-j"] + benchmark.args
+        status, output = self.run_command(cmd, env)
+        if status != 0:
+            return None, output.strip().splitlines()[-1:]
+
+        for line in output.splitlines():
+            if line.startswith("{"):
+                result = json.loads(line)
+                if result.get("final"):
+                    return result, None
+        return None, ["no final result in ucx_perftest output"]
+
+    def run(self):
+        benchmarks = read_batch_file(self.batch)
+        results = {}
+        errors = {}
+
+        # Interleave the repetitions, so a slow drift of the machine state
+        # affects all the benchmarks in the same way
+        for i in range(self.repeat):
+            for transport in self.transports.split(","):
+                for benchmark in benchmarks:
+                    key = "%s/%s" % (transport, benchmark.name)
+                    if key in errors:
+                        continue
+
+                    print("[%d/%d] %s" % (i + 1, self.repeat, key))
+                    sys.stdout.flush()
+                    result, error = self.run_benchmark(benchmark, transport)
+                    if result is None:
+                        errors[key] = error
+                        results.pop(key, None)
+                        continue
+
+                    entry = results.setdefault(key, {
+                        "metric": benchmark.metric_name(),
+                        "higher_is_better": benchmark.higher_is_better,
+                        "args": benchmark.args,
+                        "samples": [],
+                        "runs": []
+                    })
+                    value = result[benchmark.metric[0]][benchmark.metric[1]]
+                    entry["samples"].append(value)
+                    entry["runs"].append(result)
+
+        return {
+            "environment": self.get_environment(),
+            "results": results,
+            "errors": errors
+        }
+
+    def compare(self, current, baseline):
+        regressions = 0
+        fmt = "%-32s %-22s %14s %14s %9s %8s  %s"
+        print(fmt % ("benchmark", "metric", "baseline", "current", "change",
+                     "p-value", "status"))
+        for key in sorted(current["results"]):
+            entry = current["results"][key]
+            base = baseline["results"].get(key)
+            if base is None or base["metric"] != entry["metric"]:
+                print(fmt % (key, entry["metric"], "-",
+                             "%.3f" % mean(entry["samples"]), "-", "-",
+                             "new"))
+                continue
+
+            cur_mean = mean(entry["samples"])
+            base_mean = mean(base["samples"])
+            change = ((cur_mean - base_mean) / base_mean * 100.0
+                      if base_mean != 0.0 else 0.0)
+            slowdown = -change if entry["higher_is_better"] else change
+            pvalue = welch_pvalue(entry["samples"], base["samples"])
+            significant = (pvalue is None) or (pvalue < self.alpha)
+
+            if slowdown > self.threshold and significant:
+                status = "REGRESSION"
+                regressions += 1
+            elif -slowdown > self.threshold and significant:
+                status = "improved"
+            else:
+                status = "ok"
+
+            print(fmt % (key, entry["metric"], "%.3f" % base_mean,
+                         "%.3f" % cur_mean, "%+.1f%%" % change,
+                         "-" if pvalue is None else "%.4f" % pvalue, status))
+
+        for key in sorted(set(baseline["results"]) - set(current["results"])):
+            print(fmt % (key, baseline["results"][key]["metric"], "-", "-",
+                         "-", "-", "missing"))
+            regressions += 1
+
+        return regressions
+
+    def main(self, argv):
+        self.parse_args(argv)
+
+        if self.results:
+            with open(self.results) as f:
+                current = json.load(f)
+        else:
+            current = self.run()
+            if self.output:
+                with open(self.output, "w") as f:
+                    json.dump(current, f, indent=2, sort_keys=True)
+
+        for key in sorted(current["errors"]):
+            print("%s failed: %s" % (key, " ".join(current["errors"][key])))
+
+        if not self.baseline:
+            return 2 if current["errors"] else 0
+
+        with open(self.baseline) as f:
+            baseline = json.load(f)
+
+        regressions = self.compare(current, baseline)
+        if regressions > 0:
+            print("found %d regressions" % regressions)
+            return 1
+
+        return 2 if current["errors"] else 0
+
+
+if __name__ == "__main__":
+    sys.exit(RegressionSuite().main(sys.argv[1:]))
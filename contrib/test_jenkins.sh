@@ -655,6 +655,9 @@ test_profiling() {
 	$UCX_READ_PROFILE -r ucx_jenkins.prof | grep "printf" -C 20
 	$UCX_READ_PROFILE -r ucx_jenkins.prof | grep -q "calc_pi"
 	$UCX_READ_PROFILE -r ucx_jenkins.prof | grep -q "print_pi"
+	$UCX_READ_PROFILE -c ucx_jenkins.prof > ucx_jenkins.json
+	python3 -m json.tool ucx_jenkins.json > /dev/null
+	grep -q "calc_pi" ucx_jenkins.json
 }
 
 test_ucs_load() {
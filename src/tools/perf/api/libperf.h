@@ -89,7 +89,8 @@ enum ucx_perf_test_flags {
     UCX_PERF_TEST_FLAG_ERR_HANDLING     = UCS_BIT(11), /* Create UCP eps with error handling support */
     UCX_PERF_TEST_FLAG_LOOPBACK         = UCS_BIT(12), /* Use loopback connection */
     UCX_PERF_TEST_FLAG_PREREG           = UCS_BIT(13), /* Pass pre-registered memory handle */
-    UCX_PERF_TEST_FLAG_AM_RECV_COPY     = UCS_BIT(14)  /* Do additional memcopy during AM receive */
+    UCX_PERF_TEST_FLAG_AM_RECV_COPY     = UCS_BIT(14), /* Do additional memcopy during AM receive */
+    UCX_PERF_TEST_FLAG_POISSON_RATE     = UCS_BIT(15)  /* Open-loop send times form a Poisson process */
 };
 
 
@@ -170,6 +171,14 @@ typedef enum {
 typedef uint64_t ucx_perf_counter_t;
 
 
+/* Number of latency percentiles reported from the latency histogram */
+#define UCX_PERF_LAT_PERCENTILES_NUM 5
+
+
+/* Ranks of the latency percentiles reported in ucx_perf_result_t */
+extern const double ucx_perf_lat_percentile_ranks[UCX_PERF_LAT_PERCENTILES_NUM];
+
+
 /*
  * Performance test result.
  *
@@ -186,6 +195,13 @@ typedef struct ucx_perf_result {
         double              total_average;  /* Average of the whole test */
     }
     latency, bandwidth, msgrate;
+    struct {
+        /* Latency at ucx_perf_lat_percentile_ranks, since the test start */
+        double              percentiles[UCX_PERF_LAT_PERCENTILES_NUM];
+        double              max;            /* Maximal latency */
+    } latency_dist;
+    double                  cpu_utilization; /* Process CPU time divided by
+                                                elapsed time */
 } ucx_perf_result_t;
 
 
@@ -275,6 +291,10 @@ typedef struct ucx_perf_params {
     double                 report_interval; /* Interval at which to call the report callback */
     double                 percentile_rank; /* The percentile rank of the percentile reported
                                                in latency tests */
+    double                 send_rate;       /* Open-loop send rate, in messages per
+                                               second. Latency is measured from the
+                                               intended send time, so queueing delay
+                                               is not hidden. 0 - closed-loop test */
 
     void                   *rte_group;      /* Opaque RTE group handle */
     ucx_perf_rte_t         *rte;            /* RTE functions used to exchange data */
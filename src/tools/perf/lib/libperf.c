@@ -20,8 +20,10 @@
 #include <ucs/type/serialize.h>
 #include <tools/perf/lib/libperf_int.h>
 
+#include <math.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/resource.h>
 
 #if _OPENMP
 #   include <omp.h>
@@ -123,6 +125,10 @@ static const char *perf_atomic_fop[] = {
      [UCT_ATOMIC_OP_CSWAP] = "cswap"
 };
 
+const double ucx_perf_lat_percentile_ranks[UCX_PERF_LAT_PERCENTILES_NUM] = {
+    50.0, 90.0, 99.0, 99.9, 99.99
+};
+
 /*
  *  This Quickselect routine is based on the algorithm described in
  *  "Numerical recipes in C", Second Edition,
@@ -186,11 +192,129 @@ static ucs_time_t __find_percentile_quick_select(ucs_time_t arr[], int n, double
     }
 }
 
+/* Middle of the range of values which are counted in the bucket */
+static ucs_time_t ucx_perf_histogram_value(unsigned index)
+{
+    unsigned shift;
+
+    if (index < (2 * UCX_PERF_HIST_SUB_COUNT)) {
+        return index;
+    }
+
+    shift = (index / UCX_PERF_HIST_SUB_COUNT) - 1;
+    return ((ucs_time_t)(index - (shift * UCX_PERF_HIST_SUB_COUNT)) << shift) +
+           (UCS_BIT(shift) / 2);
+}
+
+static unsigned ucx_perf_histogram_index(ucs_time_t value)
+{
+    unsigned shift;
+
+    if (value < (2 * UCX_PERF_HIST_SUB_COUNT)) {
+        return value;
+    }
+
+    shift = ucs_ilog2(value) - UCX_PERF_HIST_SUB_BITS;
+    return (shift * UCX_PERF_HIST_SUB_COUNT) + (value >> shift);
+}
+
+/* Add the samples recorded since the previous update to the histogram. The
+ * samples are bucketed here rather than in ucx_perf_update(), to keep the
+ * measurement loop short. */
+void ucx_perf_histogram_update(ucx_perf_context_t *perf)
+{
+    ucx_perf_histogram_t *hist = &perf->timing_hist;
+    ucs_time_t value;
+    unsigned i;
+
+    for (i = perf->timing_hist_head; i < perf->timing_queue_head; ++i) {
+        value = perf->timing_queue[i];
+        ++hist->buckets[ucx_perf_histogram_index(value)];
+        hist->sum += value;
+        hist->max  = ucs_max(hist->max, value);
+    }
+
+    hist->count           += perf->timing_queue_head - perf->timing_hist_head;
+    perf->timing_hist_head = perf->timing_queue_head;
+}
+
+void ucx_perf_histogram_merge(ucx_perf_histogram_t *dst,
+                              const ucx_perf_histogram_t *src)
+{
+    unsigned i;
+
+    for (i = 0; i < UCX_PERF_HIST_SIZE; ++i) {
+        dst->buckets[i] += src->buckets[i];
+    }
+
+    dst->count += src->count;
+    dst->sum   += src->sum;
+    dst->max    = ucs_max(dst->max, src->max);
+}
+
+static double ucx_perf_latency_factor(const ucx_perf_params_t *params)
+{
+    /* Open-loop latency is the round trip time of every message */
+    if (params->send_rate != 0.0) {
+        return 1.0;
+    }
+
+    if ((params->test_type == UCX_PERF_TEST_TYPE_PINGPONG) ||
+        (params->test_type == UCX_PERF_TEST_TYPE_PINGPONG_WAIT_MEM)) {
+        return 2.0;
+    }
+
+    return 1.0;
+}
+
+void ucx_perf_calc_latency_dist(const ucx_perf_context_t *perf,
+                                const ucx_perf_histogram_t *hist,
+                                ucx_perf_result_t *result)
+{
+    double factor             = ucx_perf_latency_factor(&perf->params);
+    ucx_perf_counter_t count  = 0;
+    unsigned bucket           = 0;
+    ucx_perf_counter_t target;
+    unsigned i;
+
+    /* Percentiles are sorted, so scan the buckets only once */
+    for (i = 0; i < UCX_PERF_LAT_PERCENTILES_NUM; ++i) {
+        target = ucs_max(1, (ucx_perf_counter_t)ceil(
+                                 hist->count *
+                                 ucx_perf_lat_percentile_ranks[i] / 100.0));
+        while ((count < target) && (bucket < UCX_PERF_HIST_SIZE)) {
+            count += hist->buckets[bucket++];
+        }
+
+        /* Bucket middle could exceed the maximal recorded value */
+        result->latency_dist.percentiles[i] =
+                (hist->count == 0) ? 0.0 :
+                ucs_time_to_sec(ucs_min(ucx_perf_histogram_value(bucket - 1),
+                                        hist->max)) / factor;
+    }
+
+    result->latency_dist.max = ucs_time_to_sec(hist->max) / factor;
+}
+
+/* User and system CPU time consumed by the process, in seconds */
+static double ucx_perf_get_cpu_time()
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0.0;
+    }
+
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           ((usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6);
+}
+
 void ucx_perf_test_start_clock(ucx_perf_context_t *perf)
 {
     ucs_time_t start_time = ucs_get_time();
 
     perf->start_time_acc   = ucs_get_accurate_time();
+    perf->start_cpu_time   = ucx_perf_get_cpu_time();
     perf->end_time         = (perf->params.max_time == 0.0) ? UINT64_MAX :
                               ucs_time_from_sec(perf->params.max_time) + start_time;
     perf->prev_time        = start_time;
@@ -205,56 +329,72 @@ void ucx_perf_test_prepare_new_run(ucx_perf_context_t *perf,
 {
     unsigned i;
 
-    perf->max_iter          = (perf->params.max_iter == 0) ? UINT64_MAX :
-                               perf->params.max_iter;
-    perf->report_interval   = ucs_time_from_sec(perf->params.report_interval);
-    perf->current.time      = 0;
-    perf->current.msgs      = 0;
-    perf->current.bytes     = 0;
-    perf->current.iters     = 0;
-    perf->prev.msgs         = 0;
-    perf->prev.bytes        = 0;
-    perf->prev.iters        = 0;
-    perf->timing_queue_head = 0;
-    perf->extra_info[0]     = '\0';
+    perf->max_iter            = (perf->params.max_iter == 0) ? UINT64_MAX :
+                                 perf->params.max_iter;
+    perf->report_interval     = ucs_time_from_sec(perf->params.report_interval);
+    perf->current.time        = 0;
+    perf->current.msgs        = 0;
+    perf->current.bytes       = 0;
+    perf->current.latency_sum = 0;
+    perf->current.iters       = 0;
+    perf->prev.msgs           = 0;
+    perf->prev.bytes          = 0;
+    perf->prev.iters          = 0;
+    perf->prev.latency_sum    = 0;
+    perf->timing_queue_head   = 0;
+    perf->timing_hist_head    = 0;
+    perf->extra_info[0]       = '\0';
 
     for (i = 0; i < TIMING_QUEUE_SIZE; ++i) {
         perf->timing_queue[i] = 0;
     }
+    memset(&perf->timing_hist, 0, sizeof(perf->timing_hist));
     ucx_perf_test_start_clock(perf);
 }
 
 void ucx_perf_calc_result(ucx_perf_context_t *perf, ucx_perf_result_t *result)
 {
+    double factor = ucx_perf_latency_factor(&perf->params);
     ucs_time_t percentile;
-    double factor;
-
-    if ((perf->params.test_type == UCX_PERF_TEST_TYPE_PINGPONG) ||
-        (perf->params.test_type == UCX_PERF_TEST_TYPE_PINGPONG_WAIT_MEM)) {
-        factor = 2.0;
-    } else {
-        factor = 1.0;
-    }
 
     result->iters = perf->current.iters;
     result->bytes = perf->current.bytes;
     result->elapsed_time = perf->current.time_acc - perf->start_time_acc;
 
+    /* Must be done before the timing queue is reordered */
+    ucx_perf_histogram_update(perf);
+
     /* Latency */
     percentile = __find_percentile_quick_select(perf->timing_queue,
                                                 ucs_min(TIMING_QUEUE_SIZE, perf->current.iters),
                                                 perf->params.percentile_rank);
     result->latency.percentile = ucs_time_to_sec(percentile) / factor;
 
-    result->latency.moment_average =
-        (perf->current.time_acc - perf->prev.time_acc)
-        / (perf->current.iters - perf->prev.iters)
-        / factor;
+    perf->current.latency_sum = perf->timing_hist.sum;
+    if (perf->params.send_rate != 0.0) {
+        /* Messages overlap in open-loop mode, so the average latency is
+         * calculated from the latencies of the messages, rather than from the
+         * elapsed time */
+        result->latency.moment_average =
+            ucs_time_to_sec(perf->current.latency_sum - perf->prev.latency_sum)
+            / (perf->current.msgs - perf->prev.msgs);
+
+        result->latency.total_average =
+            ucs_time_to_sec(perf->current.latency_sum)
+            / perf->current.msgs;
+    } else {
+        result->latency.moment_average =
+            (perf->current.time_acc - perf->prev.time_acc)
+            / (perf->current.iters - perf->prev.iters)
+            / factor;
+
+        result->latency.total_average =
+            (perf->current.time_acc - perf->start_time_acc)
+            / perf->current.iters
+            / factor;
+    }
 
-    result->latency.total_average =
-        (perf->current.time_acc - perf->start_time_acc)
-        / perf->current.iters
-        / factor;
+    ucx_perf_calc_latency_dist(perf, &perf->timing_hist, result);
 
 
     /* Bandwidth */
@@ -282,6 +422,11 @@ void ucx_perf_calc_result(ucx_perf_context_t *perf, ucx_perf_result_t *result)
         perf->current.msgs /
         (perf->current.time_acc - perf->start_time_acc) * factor;
 
+    /* CPU utilization */
+
+    result->cpu_utilization =
+        (ucx_perf_get_cpu_time() - perf->start_cpu_time) /
+        (perf->current.time_acc - perf->start_time_acc);
 }
 
 static ucs_status_t ucx_perf_test_check_params(ucx_perf_params_t *params)
@@ -326,6 +471,20 @@ static ucs_status_t ucx_perf_test_check_params(ucx_perf_params_t *params)
         }
     }
 
+    if ((params->send_rate != 0.0) &&
+        ((params->send_rate < 0.0) || (params->api != UCX_PERF_API_UCP) ||
+         (params->test_type != UCX_PERF_TEST_TYPE_PINGPONG) ||
+         ((params->command != UCX_PERF_CMD_TAG) &&
+          (params->command != UCX_PERF_CMD_TAG_SYNC) &&
+          (params->command != UCX_PERF_CMD_AM)) ||
+         params->ucp.is_daemon_mode)) {
+        if (params->flags & UCX_PERF_TEST_FLAG_VERBOSE) {
+            ucs_error("Open-loop send rate is supported only by UCP tag and "
+                      "active message ping-pong tests");
+        }
+        return UCS_ERR_INVALID_PARAM;
+    }
+
     if (params->send_mem_type == UCS_MEMORY_TYPE_RDMA) {
         ucs_error(
                 "Memory type 'rdma' is not supported as a sending memory type, "
@@ -26,6 +26,13 @@ BEGIN_C_DECLS
 
 
 #define TIMING_QUEUE_SIZE    2048
+
+/* Latency histogram has linear sub-buckets within every power of 2, so the
+ * relative error of a recorded value is at most 1/2^UCX_PERF_HIST_SUB_BITS */
+#define UCX_PERF_HIST_SUB_BITS   5
+#define UCX_PERF_HIST_SUB_COUNT  UCS_BIT(UCX_PERF_HIST_SUB_BITS)
+#define UCX_PERF_HIST_SIZE       ((65 - UCX_PERF_HIST_SUB_BITS) * \
+                                  UCX_PERF_HIST_SUB_COUNT)
 #define UCT_PERF_TEST_AM_ID  5
 #define ADDR_BUF_SIZE        4096
 #define EXTRA_INFO_SIZE      256
@@ -74,6 +81,14 @@ typedef struct {
     size_t length;
 } ucx_perf_exported_mem_t;
 
+/* Log-linear histogram of iteration times, in ucs_time_t units */
+typedef struct {
+    ucx_perf_counter_t count;
+    ucs_time_t         sum;
+    ucs_time_t         max;
+    ucx_perf_counter_t buckets[UCX_PERF_HIST_SIZE];
+} ucx_perf_histogram_t;
+
 struct ucx_perf_context {
     ucx_perf_params_t            params;
 
@@ -83,6 +98,7 @@ struct ucx_perf_context {
 
     /* Measurements */
     double                       start_time_acc;  /* accurate start time */
+    double                       start_cpu_time;  /* process CPU time at start */
     ucs_time_t                   end_time;        /* inaccurate end time (upper bound) */
     ucs_time_t                   prev_time;       /* time of previous iteration */
     ucs_time_t                   report_interval; /* interval of showing report */
@@ -95,10 +111,14 @@ struct ucx_perf_context {
         ucx_perf_counter_t       iters;   /* number of iterations */
         ucs_time_t               time;    /* inaccurate time (for median and report interval) */
         double                   time_acc; /* accurate time (for avg latency/bw/msgrate) */
+        ucs_time_t               latency_sum; /* sum of recorded latencies (for open-loop avg latency) */
     } current, prev;
 
     ucs_time_t                   timing_queue[TIMING_QUEUE_SIZE];
     unsigned                     timing_queue_head;
+    unsigned                     timing_hist_head; /* timing_queue entries before
+                                                      it are in timing_hist */
+    ucx_perf_histogram_t         timing_hist;
 
     const ucx_perf_allocator_t   *send_allocator;
     const ucx_perf_allocator_t   *recv_allocator;
@@ -196,6 +216,15 @@ size_t ucx_perf_get_message_size(const ucx_perf_params_t *params);
 
 void ucx_perf_report(ucx_perf_context_t *perf);
 
+void ucx_perf_histogram_update(ucx_perf_context_t *perf);
+
+void ucx_perf_histogram_merge(ucx_perf_histogram_t *dst,
+                              const ucx_perf_histogram_t *src);
+
+void ucx_perf_calc_latency_dist(const ucx_perf_context_t *perf,
+                                const ucx_perf_histogram_t *hist,
+                                ucx_perf_result_t *result);
+
 ucs_status_t ucx_perf_allocators_init_thread(ucx_perf_context_t *perf);
 
 static UCS_F_ALWAYS_INLINE int ucx_perf_context_done(ucx_perf_context_t *perf)
@@ -218,20 +247,22 @@ static inline void ucx_perf_omp_barrier(ucx_perf_context_t *perf)
 #endif
 }
 
-static UCS_F_ALWAYS_INLINE void ucx_perf_update(ucx_perf_context_t *perf,
-                                                ucx_perf_counter_t iters,
-                                                size_t bytes)
+static UCS_F_ALWAYS_INLINE void
+ucx_perf_update_common(ucx_perf_context_t *perf, ucx_perf_counter_t iters,
+                       size_t bytes, ucs_time_t time, ucs_time_t latency)
 {
-    perf->current.time   = ucs_get_time();
+    perf->current.time   = time;
     perf->current.iters += iters;
     perf->current.bytes += bytes;
     perf->current.msgs  += 1;
 
-    perf->timing_queue[perf->timing_queue_head] =
-                    perf->current.time - perf->prev_time;
+    perf->timing_queue[perf->timing_queue_head] = latency;
     ++perf->timing_queue_head;
     if (perf->timing_queue_head == TIMING_QUEUE_SIZE) {
+        /* Add the samples to the histogram before they are overwritten */
+        ucx_perf_histogram_update(perf);
         perf->timing_queue_head = 0;
+        perf->timing_hist_head  = 0;
     }
 
     perf->prev_time = perf->current.time;
@@ -242,6 +273,27 @@ static UCS_F_ALWAYS_INLINE void ucx_perf_update(ucx_perf_context_t *perf,
     }
 }
 
+static UCS_F_ALWAYS_INLINE void ucx_perf_update(ucx_perf_context_t *perf,
+                                                ucx_perf_counter_t iters,
+                                                size_t bytes)
+{
+    ucs_time_t time = ucs_get_time();
+
+    ucx_perf_update_common(perf, iters, bytes, time, time - perf->prev_time);
+}
+
+/* Same as ucx_perf_update(), but the latency is measured from the given start
+ * time instead of from the previous iteration, as done by open-loop tests */
+static UCS_F_ALWAYS_INLINE void
+ucx_perf_update_latency(ucx_perf_context_t *perf, ucx_perf_counter_t iters,
+                        size_t bytes, ucs_time_t start_time)
+{
+    ucs_time_t time = ucs_get_time();
+
+    ucx_perf_update_common(perf, iters, bytes, time,
+                           (time > start_time) ? (time - start_time) : 0);
+}
+
 END_C_DECLS
 
 #endif
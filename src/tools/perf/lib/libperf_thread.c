@@ -59,12 +59,16 @@ static void ucx_perf_thread_report_aggregated_results(ucx_perf_context_t *perf)
     ucx_perf_thread_context_t* tctx = perf->ucp.tctx;  /* all the thread contexts on perf */
     unsigned i, thread_count        = perf->params.thread_count;
     double lat_sum_total_avegare    = 0.0;
+    ucx_perf_histogram_t *agg_hist;
     ucx_perf_result_t agg_result;
 
     agg_result.iters        = tctx[0].result.iters;
     agg_result.bytes        = tctx[0].result.bytes;
     agg_result.elapsed_time = tctx[0].result.elapsed_time;
 
+    /* CPU utilization is measured for the whole process by every thread */
+    agg_result.cpu_utilization = tctx[0].result.cpu_utilization;
+
     agg_result.bandwidth.total_average  = 0.0;
     agg_result.bandwidth.percentile     = 0.0; /* Undefined since used only for latency calculations */
     agg_result.latency.total_average    = 0.0;
@@ -93,6 +97,19 @@ static void ucx_perf_thread_report_aggregated_results(ucx_perf_context_t *perf)
 
     agg_result.latency.total_average = lat_sum_total_avegare / thread_count;
 
+    /* Latency distribution is calculated from the histograms of all threads */
+    agg_hist = calloc(1, sizeof(*agg_hist));
+    if (agg_hist != NULL) {
+        for (i = 0; i < thread_count; i++) {
+            ucx_perf_histogram_merge(agg_hist, &tctx[i].perf.timing_hist);
+        }
+
+        ucx_perf_calc_latency_dist(perf, agg_hist, &agg_result);
+        free(agg_hist);
+    } else {
+        memset(&agg_result.latency_dist, 0, sizeof(agg_result.latency_dist));
+    }
+
     perf->params.report_func(perf->params.rte_group, &agg_result,
                              perf->params.report_arg, "", 1, 1);
 }
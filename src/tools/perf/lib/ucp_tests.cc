@@ -16,6 +16,7 @@
 #include <ucs/sys/preprocessor.h>
 #include <ucs/sys/string.h>
 #include <limits>
+#include <math.h>
 
 
 template <ucx_perf_cmd_t CMD, ucx_perf_test_type_t TYPE, unsigned FLAGS>
@@ -45,6 +46,12 @@ public:
         memset(&m_send_get_info_params, 0, sizeof(m_send_get_info_params));
         memset(&m_recv_params, 0, sizeof(m_recv_params));
 
+        m_open_loop.enabled    = false;
+        m_open_loop.send_times = NULL;
+        m_open_loop.completed  = 0;
+        m_open_loop.length     = 0;
+        m_open_loop.rand_seed  = ucs_generate_uuid(0);
+
         ucs_assert_always(m_max_outstanding > 0);
 
         set_am_handler(AM_ID, am_data_handler, this, UCP_AM_FLAG_WHOLE_MSG);
@@ -381,6 +388,20 @@ public:
     void UCS_F_ALWAYS_INLINE recv_completed()
     {
         --m_recvs_outstanding;
+        if (ucs_unlikely(m_open_loop.enabled)) {
+            reply_completed();
+        }
+    }
+
+    /* Replies arrive in the order of the requests, so the oldest intended
+     * send time belongs to the completed reply */
+    void reply_completed()
+    {
+        ucs_time_t send_time = m_open_loop.send_times[m_open_loop.completed %
+                                                      m_max_outstanding];
+
+        ++m_open_loop.completed;
+        ucx_perf_update_latency(&m_perf, 1, m_open_loop.length, send_time);
     }
 
     void UCS_F_ALWAYS_INLINE wait_send_window(unsigned n)
@@ -818,6 +839,134 @@ public:
         return UCS_OK;
     }
 
+    /* Time until the next open-loop send, with either a constant rate or
+     * exponentially distributed intervals of a Poisson process */
+    ucs_time_t open_loop_interval()
+    {
+        double interval = 1.0 / m_perf.params.send_rate;
+
+        if (m_perf.params.flags & UCX_PERF_TEST_FLAG_POISSON_RATE) {
+            interval *= -log((rand_r(&m_open_loop.rand_seed) + 1.0) /
+                                  (RAND_MAX + 1.0));
+        }
+
+        return ucs_time_from_sec(interval);
+    }
+
+    void post_reply_recv(ucp_worker_h worker, void *buffer, unsigned length)
+    {
+        void *request;
+
+        if (CMD == UCX_PERF_CMD_AM) {
+            recv_started();
+            return;
+        }
+
+        /* Unlike recv(), never block on probing for the reply */
+        request = ucp_tag_recv_nbx(worker, buffer, length, TAG, TAG_MASK,
+                                   &m_recv_params);
+        if (UCS_PTR_IS_PTR(request)) {
+            recv_started();
+        } else {
+            reply_completed();
+        }
+    }
+
+    /*
+     * Open-loop ping-pong: the requester sends at the configured rate without
+     * waiting for the replies, up to the window of outstanding messages. The
+     * latency of a message is measured from its intended send time rather
+     * than from the actual one, so time spent waiting for the window is
+     * accounted as well, and the results are free of coordinated omission.
+     */
+    ucs_status_t run_open_loop()
+    {
+        unsigned my_index;
+        ucp_worker_h worker;
+        ucp_ep_h ep;
+        void *send_buffer, *recv_buffer;
+        ucp_datatype_t send_datatype, recv_datatype;
+        uint64_t remote_addr;
+        ucp_rkey_h rkey;
+        size_t length, send_length, recv_length;
+        ucx_perf_counter_t sent;
+        ucs_time_t send_time;
+        psn_t sn;
+
+        send_buffer = m_perf.send_buffer;
+        recv_buffer = m_perf.recv_buffer;
+        worker      = m_perf.ucp.worker;
+        ep          = m_perf.ucp.ep;
+        remote_addr = m_perf.ucp.remote_addr;
+        rkey        = m_perf.ucp.rkey;
+        sn          = 0;
+
+        ucp_perf_init_common_params(&length, &send_length, &send_datatype,
+                                    &send_buffer, &recv_length, &recv_datatype,
+                                    &recv_buffer);
+
+        ucp_perf_barrier(&m_perf);
+
+        my_index = rte_call(&m_perf, group_index);
+
+        ucx_perf_test_start_clock(&m_perf);
+
+        ucx_perf_omp_barrier(&m_perf);
+
+        if (my_index == 0) {
+            m_open_loop.send_times = (ucs_time_t*)calloc(
+                    m_max_outstanding, sizeof(*m_open_loop.send_times));
+            if (m_open_loop.send_times == NULL) {
+                ucs_error("failed to allocate open-loop send times");
+                return UCS_ERR_NO_MEMORY;
+            }
+
+            m_open_loop.length    = length;
+            m_open_loop.completed = 0;
+            m_open_loop.enabled   = true;
+
+            send_time = ucs_get_time();
+            for (sent = 0; (sent < m_perf.max_iter) &&
+                           (m_perf.current.time <= m_perf.end_time); ++sent) {
+                send_time += open_loop_interval();
+                while (ucs_get_time() < send_time) {
+                    ucp_worker_progress(worker);
+                }
+
+                wait_recv_window(1);
+                m_open_loop.send_times[sent % m_max_outstanding] = send_time;
+                post_reply_recv(worker, recv_buffer, recv_length);
+                send(ep, send_buffer, send_length, send_datatype, sn,
+                     remote_addr, rkey);
+                ++sn;
+            }
+
+            wait_recv_window(m_max_outstanding);
+            m_open_loop.enabled = false;
+            free(m_open_loop.send_times);
+            m_open_loop.send_times = NULL;
+        } else if (my_index == 1) {
+            UCX_PERF_TEST_FOREACH(&m_perf) {
+                recv(worker, ep, recv_buffer, recv_length, recv_datatype, sn);
+                wait_recv_window(m_max_outstanding);
+                send(ep, send_buffer, send_length, send_datatype, sn,
+                     remote_addr, rkey, m_perf.current.iters == 0);
+                ucx_perf_update(&m_perf, 1, length);
+                ++sn;
+            }
+        }
+
+        wait_recv_window(m_max_outstanding);
+        wait_send_window(m_max_outstanding);
+        flush();
+
+        ucx_perf_omp_barrier(&m_perf);
+
+        ucx_perf_get_time(&m_perf);
+        ucp_perf_barrier(&m_perf);
+        return UCS_OK;
+    }
+
     ucs_status_t run_stream_uni()
     {
         unsigned my_index;
@@ -898,6 +1047,10 @@ public:
         /* coverity[switch_selector_expr_is_constant] */
         switch (TYPE) {
         case UCX_PERF_TEST_TYPE_PINGPONG:
+            if (m_perf.params.send_rate != 0.0) {
+                return run_open_loop();
+            }
+            return run_pingpong();
         case UCX_PERF_TEST_TYPE_PINGPONG_WAIT_MEM:
             return run_pingpong();
         case UCX_PERF_TEST_TYPE_STREAM_UNI:
@@ -990,6 +1143,16 @@ private:
     ucp_request_param_t m_send_get_info_params;
     ucp_request_param_t m_recv_params;
     ucp_atomic_op_t     m_atomic_op;
+
+    /* Requester state of the open-loop test */
+    struct {
+        bool               enabled;
+        ucs_time_t         *send_times; /* Intended send times of the
+                                           outstanding messages */
+        ucx_perf_counter_t completed;   /* Number of received replies */
+        size_t             length;
+        unsigned           rand_seed;
+    } m_open_loop;
 };
 
 
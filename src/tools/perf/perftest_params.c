@@ -104,6 +104,8 @@ static void usage(const struct perftest_context *ctx, const char *program)
     printf("     -f             print only final numbers\n");
     printf("     -v             print CSV-formatted output\n");
     printf("     -I             print extra information about the operation\n");
+    printf("     -L             print latency percentiles and maximum\n");
+    printf("     -j             print JSON-formatted output, one object per line\n");
     printf("     -q             do not print error messages\n");
     printf("\n");
     printf("  UCT only:\n");
@@ -146,6 +148,13 @@ static void usage(const struct perftest_context *ctx, const char *program)
     printf("                        sleep      : go to sleep after posting requests\n");
     printf("     -H <size>      active message header size (%zu), not included in message size\n",
                                 ctx->params.super.ucp.am_hdr_size);
+    printf("     -F <rate>[,<dist>]\n");
+    printf("                    open-loop mode for tag and am ping-pong tests: send <rate>\n");
+    printf("                    messages per second without waiting for replies, up to\n");
+    printf("                    the window of -O outstanding messages, and measure latency\n");
+    printf("                    from the intended send time (off)\n");
+    printf("                        const      : constant interval between sends (default)\n");
+    printf("                        poisson    : exponentially distributed intervals\n");
     printf("     -y             do additional memcopy to the user memory in active message receive handler\n");
     printf("     -z             pass pre-registered memory handle\n");
     printf("     -g <IP>[:<port>], --daemon-local <IP>[:<port>]\n");
@@ -267,6 +276,36 @@ static ucs_status_t parse_ucp_datatype_params(const char *opt_arg,
     return UCS_OK;
 }
 
+static ucs_status_t parse_send_rate_params(const char *opt_arg,
+                                           ucx_perf_params_t *params)
+{
+    const char *dist;
+    char *endptr;
+
+    params->send_rate = strtod(opt_arg, &endptr);
+    if ((endptr == opt_arg) || (params->send_rate <= 0.0)) {
+        ucs_error("Invalid send rate for -F: \"%s\"", opt_arg);
+        return UCS_ERR_INVALID_PARAM;
+    }
+
+    if (*endptr == '\0') {
+        params->flags &= ~UCX_PERF_TEST_FLAG_POISSON_RATE;
+        return UCS_OK;
+    }
+
+    dist = endptr + 1;
+    if ((*endptr == ',') && !strcmp(dist, "const")) {
+        params->flags &= ~UCX_PERF_TEST_FLAG_POISSON_RATE;
+    } else if ((*endptr == ',') && !strcmp(dist, "poisson")) {
+        params->flags |= UCX_PERF_TEST_FLAG_POISSON_RATE;
+    } else {
+        ucs_error("Invalid send rate distribution for -F: \"%s\"", opt_arg);
+        return UCS_ERR_INVALID_PARAM;
+    }
+
+    return UCS_OK;
+}
+
 static ucs_status_t verify_daemon_params(ucx_perf_params_t *params)
 {
     struct sockaddr_storage *local_addr  = &params->ucp.dmn_local_addr;
@@ -483,6 +522,8 @@ ucs_status_t parse_test_params(perftest_params_t *params, char opt,
             return UCS_ERR_INVALID_PARAM;
         }
         return UCS_OK;
+    case 'F':
+        return parse_send_rate_params(opt_arg, &params->super);
     case 'y':
         params->super.flags |= UCX_PERF_TEST_FLAG_AM_RECV_COPY;
         return UCS_OK;
@@ -626,7 +667,7 @@ ucs_status_t parse_opts(struct perftest_context *ctx, int mpi_initialized,
     ctx->mad_port        = NULL;
 
     optind = 1;
-    while ((c = getopt_long(argc, argv, "p:b:6NfvIc:P:hK:" TEST_PARAMS_ARGS,
+    while ((c = getopt_long(argc, argv, "p:b:6NfvILjc:P:hK:" TEST_PARAMS_ARGS,
                             TEST_PARAMS_ARGS_LONG, NULL)) != -1) {
         switch (c) {
         case 'p':
@@ -655,6 +696,12 @@ ucs_status_t parse_opts(struct perftest_context *ctx, int mpi_initialized,
         case 'I':
             ctx->flags |= TEST_FLAG_PRINT_EXTRA_INFO;
             break;
+        case 'L':
+            ctx->flags |= TEST_FLAG_PRINT_LAT_DIST;
+            break;
+        case 'j':
+            ctx->flags |= TEST_FLAG_PRINT_JSON;
+            break;
         case 'c':
             ctx->flags |= TEST_FLAG_SET_AFFINITY;
             status = parse_cpus(optarg, ctx);
@@ -20,6 +20,112 @@
 #include <locale.h>
 
 
+static void print_test_names(struct perftest_context *ctx,
+                             ucs_string_buffer_t *strb)
+{
+    unsigned i;
+
+    for (i = 0; i < ctx->num_batch_files; ++i) {
+        ucs_string_buffer_appendf(strb, "%s/", ctx->test_names[i]);
+    }
+    ucs_string_buffer_rtrim(strb, "/");
+}
+
+static void print_lat_dist(struct perftest_context *ctx,
+                           const ucx_perf_result_t *result,
+                           ucs_string_buffer_t *strb)
+{
+    unsigned i;
+
+    for (i = 0; i < UCX_PERF_LAT_PERCENTILES_NUM; ++i) {
+        if (!(ctx->flags & TEST_FLAG_PRINT_CSV)) {
+            ucs_string_buffer_appendf(strb, "  p%g:",
+                                      ucx_perf_lat_percentile_ranks[i]);
+        }
+        ucs_string_buffer_appendf(strb,
+                                  (ctx->flags & TEST_FLAG_PRINT_CSV) ? ",%.3f" :
+                                                                       " %.3f",
+                                  result->latency_dist.percentiles[i] *
+                                  1000000.0);
+    }
+
+    ucs_string_buffer_appendf(strb,
+                              (ctx->flags & TEST_FLAG_PRINT_CSV) ? ",%.3f" :
+                                                                   "  max: %.3f",
+                              result->latency_dist.max * 1000000.0);
+}
+
+/* Append a string as a quoted JSON string value */
+static void print_json_string(ucs_string_buffer_t *strb, const char *str)
+{
+    ucs_string_buffer_appendf(strb, "\"");
+    for (; *str != '\0'; ++str) {
+        if ((*str == '"') || (*str == '\\')) {
+            ucs_string_buffer_appendf(strb, "\\%c", *str);
+        } else if ((unsigned char)*str < 0x20) {
+            ucs_string_buffer_appendf(strb, "\\u%04x", (unsigned char)*str);
+        } else {
+            ucs_string_buffer_appendc(strb, *str, 1);
+        }
+    }
+    ucs_string_buffer_appendf(strb, "\"");
+}
+
+static void print_progress_json(struct perftest_context *ctx,
+                                const ucx_perf_result_t *result,
+                                const char *extra_info, int final)
+{
+    UCS_STRING_BUFFER_ONSTACK(strb, 1024);
+    UCS_STRING_BUFFER_ONSTACK(test_name, 128);
+    unsigned i;
+
+    if (ctx->num_batch_files > 0) {
+        print_test_names(ctx, &test_name);
+    } else if (ctx->params.test_id != TEST_ID_UNDEFINED) {
+        ucs_string_buffer_appendf(&test_name, "%s",
+                                  tests[ctx->params.test_id].name);
+    }
+
+    ucs_string_buffer_appendf(&strb, "{\"test\": ");
+    print_json_string(&strb, ucs_string_buffer_cstr(&test_name));
+    ucs_string_buffer_appendf(&strb,
+                              ", \"final\": %s, \"iterations\": %" PRIu64
+                              ", \"latency_usec\": {\"percentile\": %.3f, "
+                              "\"average\": %.3f, \"overall\": %.3f",
+                              final ? "true" : "false", result->iters,
+                              result->latency.percentile * 1000000.0,
+                              result->latency.moment_average * 1000000.0,
+                              result->latency.total_average * 1000000.0);
+    for (i = 0; i < UCX_PERF_LAT_PERCENTILES_NUM; ++i) {
+        ucs_string_buffer_appendf(&strb, ", \"p%g\": %.3f",
+                                  ucx_perf_lat_percentile_ranks[i],
+                                  result->latency_dist.percentiles[i] *
+                                  1000000.0);
+    }
+
+    ucs_string_buffer_appendf(&strb,
+                              ", \"max\": %.3f}, \"bandwidth_mbs\": "
+                              "{\"average\": %.2f, \"overall\": %.2f}, "
+                              "\"msgrate\": {\"average\": %.0f, "
+                              "\"overall\": %.0f}, \"cpu\": %.2f",
+                              result->latency_dist.max * 1000000.0,
+                              result->bandwidth.moment_average /
+                              (1024.0 * 1024.0),
+                              result->bandwidth.total_average /
+                              (1024.0 * 1024.0),
+                              result->msgrate.moment_average,
+                              result->msgrate.total_average,
+                              result->cpu_utilization);
+
+    if ((ctx->flags & TEST_FLAG_PRINT_EXTRA_INFO) && (extra_info[0] != '\0')) {
+        ucs_string_buffer_appendf(&strb, ", \"extra_info\": ");
+        print_json_string(&strb, extra_info);
+    }
+
+    fprintf(stdout, "%s}\n", ucs_string_buffer_cstr(&strb));
+    fflush(stdout);
+}
+
 void print_progress(void *UCS_V_UNUSED rte_group,
                     const ucx_perf_result_t *result, void *arg,
                     const char *extra_info, int final, int is_multi_thread)
@@ -39,6 +145,11 @@ void print_progress(void *UCS_V_UNUSED rte_group,
         return;
     }
 
+    if (ctx->flags & TEST_FLAG_PRINT_JSON) {
+        print_progress_json(ctx, result, extra_info, final);
+        return;
+    }
+
     if (ctx->flags & TEST_FLAG_PRINT_CSV) {
         for (i = 0; i < ctx->num_batch_files; ++i) {
             ucs_string_buffer_appendf(&strb, "%s,", ctx->test_names[i]);
@@ -53,11 +164,7 @@ void print_progress(void *UCS_V_UNUSED rte_group,
                !(ctx->flags & TEST_FLAG_PRINT_CSV)) {
         if (ctx->flags & TEST_FLAG_PRINT_FINAL) {
             /* Print test name in the final and only output line */
-            for (i = 0; i < ctx->num_batch_files; ++i) {
-                ucs_string_buffer_appendf(&test_name, "%s/",
-                                          ctx->test_names[i]);
-            }
-            ucs_string_buffer_rtrim(&test_name, "/");
+            print_test_names(ctx, &test_name);
             ucs_string_buffer_appendf(&strb, "%10s",
                                       ucs_string_buffer_cstr(&test_name));
         } else {
@@ -98,8 +205,16 @@ void print_progress(void *UCS_V_UNUSED rte_group,
                 result->msgrate.moment_average, result->msgrate.total_average);
     }
 
+    if (ctx->flags & TEST_FLAG_PRINT_LAT_DIST) {
+        print_lat_dist(ctx, result, &strb);
+    }
+
     if ((ctx->flags & TEST_FLAG_PRINT_EXTRA_INFO) &&
         !(ctx->flags & TEST_FLAG_PRINT_CSV)) {
+        if (final) {
+            ucs_string_buffer_appendf(&strb, "  cpu: %.0f%%",
+                                      result->cpu_utilization * 100.0);
+        }
         ucs_string_buffer_appendf(&strb, "  %s", extra_info);
     }
 
@@ -112,12 +227,17 @@ static void print_header(struct perftest_context *ctx)
     const char *overhead_lat_str;
     const char *test_data_str;
     const char *test_api_str;
+    char send_rate_str[64];
     test_type_t *test;
     unsigned i;
 
     test = (ctx->params.test_id == TEST_ID_UNDEFINED) ? NULL :
            &tests[ctx->params.test_id];
 
+    if (ctx->flags & TEST_FLAG_PRINT_JSON) {
+        return;
+    }
+
     if ((ctx->flags & TEST_FLAG_PRINT_TEST) && (test != NULL)) {
         if (test->api == UCX_PERF_API_UCT) {
             test_api_str = "transport layer";
@@ -154,6 +274,16 @@ static void print_header(struct perftest_context *ctx)
         printf("| Message size: %-60zu                               |\n", ucx_perf_get_message_size(&ctx->params.super));
         printf("| Window size:  %-60u                               |\n", ctx->params.super.max_outstanding);
 
+        if (ctx->params.super.send_rate != 0.0) {
+            ucs_snprintf_safe(send_rate_str, sizeof(send_rate_str),
+                              "%.0f msg/s, %s", ctx->params.super.send_rate,
+                              (ctx->params.super.flags &
+                               UCX_PERF_TEST_FLAG_POISSON_RATE) ?
+                              "poisson" : "const");
+            printf("| Send rate:    %-60s                               |\n",
+                   send_rate_str);
+        }
+
         if ((test->api == UCX_PERF_API_UCP) &&
             (test->command == UCX_PERF_CMD_AM)) {
             printf("| AM header size: %-60zu                             |\n",
@@ -166,7 +296,15 @@ static void print_header(struct perftest_context *ctx)
             for (i = 0; i < ctx->num_batch_files; ++i) {
                 printf("%s,", ucs_basename(ctx->batch_files[i]));
             }
-            printf("iterations,%.1f_percentile_lat,avg_lat,overall_lat,avg_bw,overall_bw,avg_mr,overall_mr\n", ctx->params.super.percentile_rank);
+            printf("iterations,%.1f_percentile_lat,avg_lat,overall_lat,avg_bw,overall_bw,avg_mr,overall_mr",
+                   ctx->params.super.percentile_rank);
+            if (ctx->flags & TEST_FLAG_PRINT_LAT_DIST) {
+                for (i = 0; i < UCX_PERF_LAT_PERCENTILES_NUM; ++i) {
+                    printf(",p%g_lat", ucx_perf_lat_percentile_ranks[i]);
+                }
+                printf(",max_lat");
+            }
+            printf("\n");
         }
     } else {
         if (ctx->flags & TEST_FLAG_PRINT_RESULTS) {
@@ -190,7 +328,8 @@ static void print_test_name(struct perftest_context *ctx)
     char buf[200];
     unsigned i, pos;
 
-    if (!(ctx->flags & (TEST_FLAG_PRINT_CSV | TEST_FLAG_PRINT_FINAL)) &&
+    if (!(ctx->flags & (TEST_FLAG_PRINT_CSV | TEST_FLAG_PRINT_FINAL |
+                        TEST_FLAG_PRINT_JSON)) &&
         (ctx->num_batch_files > 0)) {
         strcpy(buf, "+--------------+--------------+----------+---------+---------+----------+----------+-----------+-----------+");
 
@@ -9,7 +9,9 @@
 #endif
 
 #include <ucs/profile/profile.h>
+#include <ucs/arch/cpu.h>
 #include <ucs/datastruct/khash.h>
+#include <ucs/sys/math.h>
 #include <ucs/sys/string.h>
 
 #include <sys/signal.h>
@@ -18,6 +20,7 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
@@ -31,6 +34,8 @@
 #define PAGER_LESS_CMD     PAGER_LESS " -R"
 #define FUNC_NAME_MAX_LEN  35
 #define MAX_THREADS        256
+#define FOLLOW_INTERVAL_US 100000
+#define FOLLOW_MAX_WAITS   10
 
 #define TERM_COLOR_CLEAR   "\x1B[0m"
 #define TERM_COLOR_RED     "\x1B[31m"
@@ -65,6 +70,8 @@ typedef enum {
 typedef struct options {
     const char                   *filename;
     int                          raw;
+    int                          chrome_trace;
+    int                          follow;
     time_units_t                 time_units;
     int                          thread_list[MAX_THREADS + 1];
 } options_t;
@@ -74,6 +81,7 @@ typedef struct {
     const ucs_profile_thread_header_t   *header;
     const ucs_profile_thread_location_t *locations;
     const ucs_profile_record_t          *records;
+    size_t                              max_records; /* Streaming file only */
 } profile_thread_data_t;
 
 
@@ -86,6 +94,7 @@ typedef struct {
     char                         *env_variables;
     uint32_t                     num_locations;
     unsigned                     num_threads;
+    const ucs_profile_stream_header_t *stream; /* Set for streaming file */
 } profile_data_t;
 
 
@@ -96,6 +105,26 @@ typedef struct {
 } profile_sorted_location_t;
 
 
+typedef struct {
+    size_t                       reqid;        /* Sequential request id */
+    unsigned                     location;     /* Location of REQUEST_NEW */
+    int                          flow_pending; /* Flow arrow not finished yet */
+} request_span_t;
+
+
+typedef struct {
+    const ucs_profile_record_t   *rec;
+    int                          tid;
+} request_record_t;
+
+
+typedef struct {
+    profile_data_t               *data;
+    uint64_t                     base_time;
+    size_t                       num_events;
+} chrome_trace_t;
+
+
 /* Used to redirect output to a "less" command */
 static int output_pipefds[2] = {-1, -1};
 
@@ -134,7 +163,7 @@ static int read_profile_data(const char *file_name, profile_data_t *data)
     }
 
     data->length = stt.st_size;
-    data->mem    = mmap(NULL, stt.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    data->mem    = mmap(NULL, stt.st_size, PROT_READ, MAP_SHARED, fd, 0);
     if (data->mem == MAP_FAILED) {
         print_error("mmap(%s, length=%zd) failed: %m", file_name,
                     data->length);
@@ -142,6 +171,15 @@ static int read_profile_data(const char *file_name, profile_data_t *data)
         goto out_close;
     }
 
+    /* Streaming file is parsed separately, since it may be still written */
+    if ((data->length >= sizeof(ucs_profile_stream_header_t)) &&
+        !memcmp(data->mem, UCS_PROFILE_STREAM_MAGIC,
+                sizeof(data->stream->magic))) {
+        data->stream = data->mem;
+        ret          = 0;
+        goto out_close;
+    }
+
     ptr          = data->mem;
     data->header = ptr;
 
@@ -212,8 +250,248 @@ err_munmap:
     goto out_close;
 }
 
+static int check_profile_stream(const profile_data_t *data)
+{
+    const ucs_profile_stream_header_t *stream = data->stream;
+
+    if (stream->version > UCS_PROFILE_STREAM_VERSION) {
+        print_error("unsupported stream version, expected: %u or less, "
+                    "actual: %u", UCS_PROFILE_STREAM_VERSION, stream->version);
+        return -EINVAL;
+    }
+
+    if ((stream->record_size != sizeof(ucs_profile_record_t)) ||
+        (stream->location_size != sizeof(ucs_profile_location_t)) ||
+        (stream->num_chunks == 0) ||
+        (stream->chunk_size < (sizeof(ucs_profile_stream_chunk_t) +
+                               (stream->chunk_records *
+                                sizeof(ucs_profile_record_t)))) ||
+        ((stream->locations_offset +
+          (stream->max_locations * sizeof(ucs_profile_location_t))) >
+         data->length) ||
+        ((stream->chunks_offset + (stream->num_chunks * stream->chunk_size)) >
+         data->length)) {
+        print_error("invalid stream layout");
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/*
+ * Copy the chunk with the given sequence number from the ring.
+ * Return 1 if it was copied, 0 if it is not complete yet, and -1 if it was
+ * overwritten by a newer chunk.
+ */
+static int read_stream_chunk(const ucs_profile_stream_header_t *stream,
+                             uint64_t seq, ucs_profile_stream_chunk_t *chunk,
+                             ucs_profile_record_t *records)
+{
+    const ucs_profile_stream_chunk_t *slot = ucs_profile_stream_chunk(stream,
+                                                                      seq);
+    uint64_t slot_seq;
+
+    slot_seq = slot->seq;
+    if (slot_seq != (seq + 1)) {
+        return (slot_seq > (seq + 1)) ? -1 : 0;
+    }
+
+    ucs_memory_cpu_load_fence();
+    *chunk             = *slot;
+    chunk->num_records = ucs_min(chunk->num_records, stream->chunk_records);
+    memcpy(records, slot + 1, chunk->num_records * sizeof(*records));
+    ucs_memory_cpu_load_fence();
+
+    /* The writer could have started overwriting the slot while copying it */
+    return (slot->seq == (seq + 1)) ? 1 : -1;
+}
+
+static profile_thread_data_t *
+stream_thread(profile_data_t *data, uint32_t tid)
+{
+    ucs_profile_thread_header_t *header;
+    profile_thread_data_t *thread;
+
+    for (thread = data->threads; thread < data->threads + data->num_threads;
+         ++thread) {
+        if (thread->header->tid == tid) {
+            return thread;
+        }
+    }
+
+    if (data->num_threads >= MAX_THREADS) {
+        return NULL;
+    }
+
+    header = calloc(1, sizeof(*header));
+    if (header == NULL) {
+        return NULL;
+    }
+
+    header->tid    = tid;
+    thread         = &data->threads[data->num_threads++];
+    thread->header = header;
+    return thread;
+}
+
+static int stream_add_records(profile_data_t *data,
+                              const ucs_profile_stream_chunk_t *chunk,
+                              const ucs_profile_record_t *records)
+{
+    ucs_profile_thread_header_t *header;
+    ucs_profile_record_t *thread_records;
+    profile_thread_data_t *thread;
+    size_t max_records;
+
+    thread = stream_thread(data, chunk->tid);
+    if (thread == NULL) {
+        print_error("failed to add thread %u", chunk->tid);
+        return -ENOMEM;
+    }
+
+    header = (ucs_profile_thread_header_t*)thread->header;
+    if ((header->num_records + chunk->num_records) > thread->max_records) {
+        max_records    = ucs_max(thread->max_records * 2,
+                                 header->num_records + chunk->num_records);
+        thread_records = realloc((void*)thread->records,
+                                 max_records * sizeof(*thread_records));
+        if (thread_records == NULL) {
+            print_error("failed to allocate records of thread %u", chunk->tid);
+            return -ENOMEM;
+        }
+
+        thread->records     = thread_records;
+        thread->max_records = max_records;
+    }
+
+    memcpy((ucs_profile_record_t*)thread->records + header->num_records,
+           records, chunk->num_records * sizeof(*records));
+    header->num_records += chunk->num_records;
+    return 0;
+}
+
+/* Remove records whose location was not published when they were read */
+static void stream_filter_records(profile_data_t *data)
+{
+    ucs_profile_thread_header_t *header;
+    ucs_profile_record_t *records;
+    profile_thread_data_t *thread;
+    uint64_t i, num_records;
+
+    for (thread = data->threads; thread < data->threads + data->num_threads;
+         ++thread) {
+        header      = (ucs_profile_thread_header_t*)thread->header;
+        records     = (ucs_profile_record_t*)thread->records;
+        num_records = 0;
+        for (i = 0; i < header->num_records; ++i) {
+            if (records[i].location < data->num_locations) {
+                records[num_records++] = records[i];
+            }
+        }
+
+        header->num_records = num_records;
+        if (num_records > 0) {
+            header->start_time = records[0].timestamp;
+            header->end_time   = records[num_records - 1].timestamp;
+        }
+    }
+}
+
+/*
+ * Read all chunks which are currently in the ring of a streaming file, and
+ * convert them to the in-memory layout of a regular profile file.
+ */
+static int read_profile_stream(profile_data_t *data)
+{
+    const ucs_profile_stream_header_t *stream = data->stream;
+    ucs_profile_record_t *records = NULL;
+    size_t num_lost               = 0;
+    ucs_profile_stream_chunk_t chunk;
+    ucs_profile_header_t *header;
+    uint64_t seq, head;
+    int ret;
+
+    ret = check_profile_stream(data);
+    if (ret < 0) {
+        return ret;
+    }
+
+    header = calloc(1, sizeof(*header));
+    if (header == NULL) {
+        print_error("failed to allocate profile header");
+        return -ENOMEM;
+    }
+
+    header->version    = stream->version;
+    header->pid        = stream->pid;
+    header->mode       = UCS_BIT(UCS_PROFILE_MODE_LOG);
+    header->one_second = stream->one_second;
+    ucs_strncpy_safe(header->ucs_path, stream->ucs_path,
+                     sizeof(header->ucs_path));
+    ucs_strncpy_safe(header->cmdline, stream->cmdline, sizeof(header->cmdline));
+    ucs_strncpy_safe(header->hostname, stream->hostname,
+                     sizeof(header->hostname));
+    data->header    = header;
+    data->locations = UCS_PTR_BYTE_OFFSET(stream, stream->locations_offset);
+
+    data->threads = calloc(MAX_THREADS, sizeof(*data->threads));
+    records       = malloc(stream->chunk_records * sizeof(*records));
+    if ((data->threads == NULL) || (records == NULL)) {
+        print_error("failed to allocate stream buffers");
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    head = stream->head;
+    seq  = (head > stream->num_chunks) ? (head - stream->num_chunks) : 0;
+    for (; seq < head; ++seq) {
+        if (read_stream_chunk(stream, seq, &chunk, records) != 1) {
+            ++num_lost;
+            continue;
+        }
+
+        ret = stream_add_records(data, &chunk, records);
+        if (ret < 0) {
+            goto out;
+        }
+    }
+
+    /* Locations are published before the records which use them */
+    ucs_memory_cpu_load_fence();
+    data->num_locations     = ucs_min(stream->num_locations,
+                                      stream->max_locations);
+    header->locations.size  = data->num_locations *
+                              sizeof(ucs_profile_location_t);
+    stream_filter_records(data);
+
+    if (num_lost > 0) {
+        fprintf(stderr, "%zu of %" PRIu64 " chunks were not complete\n",
+                num_lost, head);
+    }
+
+    ret = 0;
+
+out:
+    free(records);
+    return ret;
+}
+
 static void release_profile_data(profile_data_t *data)
 {
+    profile_thread_data_t *thread;
+
+    if ((data->stream != NULL) && (data->threads != NULL)) {
+        for (thread = data->threads;
+             thread < data->threads + data->num_threads; ++thread) {
+            free((void*)thread->records);
+            free((void*)thread->header);
+        }
+    }
+
+    if (data->stream != NULL) {
+        free((void*)data->header);
+    }
+
     free(data->threads);
     free(data->env_variables);
     munmap(data->mem, data->length);
@@ -321,6 +599,123 @@ static double time_to_units(profile_data_t *data, options_t *opts, uint64_t time
     return time * time_units_val[opts->time_units] / data->header->one_second;
 }
 
+static const char *stream_record_str(const ucs_profile_location_t *loc,
+                                     const ucs_profile_record_t *rec,
+                                     char *buf, size_t max)
+{
+    switch (loc->type) {
+    case UCS_PROFILE_TYPE_SCOPE_BEGIN:
+        return "{";
+    case UCS_PROFILE_TYPE_SCOPE_END:
+        snprintf(buf, max, "} %s", loc->name);
+        return buf;
+    case UCS_PROFILE_TYPE_REQUEST_NEW:
+    case UCS_PROFILE_TYPE_REQUEST_EVENT:
+    case UCS_PROFILE_TYPE_REQUEST_FREE:
+        snprintf(buf, max, "%s%s 0x%" PRIx64,
+                 (loc->type == UCS_PROFILE_TYPE_REQUEST_NEW)  ? "NEW " :
+                 (loc->type == UCS_PROFILE_TYPE_REQUEST_FREE) ? "FREE " : "",
+                 loc->name, rec->param64);
+        return buf;
+    default:
+        return loc->name;
+    }
+}
+
+/*
+ * Print the records of a streaming file as they are written, until the writer
+ * closes it. Only one chunk is kept in memory.
+ */
+static int follow_profile_stream(profile_data_t *data, options_t *opts)
+{
+    const ucs_profile_stream_header_t *stream = data->stream;
+    uint64_t base_time                        = 0;
+    unsigned num_waits                        = 0;
+    const ucs_profile_location_t *locations;
+    const ucs_profile_location_t *loc;
+    ucs_profile_stream_chunk_t chunk;
+    ucs_profile_record_t *records;
+    ucs_profile_header_t header;
+    uint64_t seq, head;
+    char buf[256];
+    uint32_t i;
+    int ret;
+
+    ret = check_profile_stream(data);
+    if (ret < 0) {
+        return ret;
+    }
+
+    records = malloc(stream->chunk_records * sizeof(*records));
+    if (records == NULL) {
+        print_error("failed to allocate stream buffer");
+        return -ENOMEM;
+    }
+
+    /* time_to_units() takes the time scale from the header */
+    memset(&header, 0, sizeof(header));
+    header.one_second = stream->one_second;
+    data->header      = &header;
+    locations         = UCS_PTR_BYTE_OFFSET(stream, stream->locations_offset);
+
+    head = stream->head;
+    seq  = (head > stream->num_chunks) ? (head - stream->num_chunks) : 0;
+    for (;;) {
+        head = stream->head;
+        if ((head - seq) > stream->num_chunks) {
+            printf("... %" PRIu64 " chunks lost\n",
+                   head - stream->num_chunks - seq);
+            seq = head - stream->num_chunks;
+        }
+
+        for (; seq < head; ++seq) {
+            ret = read_stream_chunk(stream, seq, &chunk, records);
+            if ((ret == 0) && (++num_waits < FOLLOW_MAX_WAITS)) {
+                /* The chunk is being written, retry it in the next round */
+                break;
+            }
+
+            num_waits = 0;
+            if (ret != 1) {
+                printf("... 1 chunk lost\n");
+                continue;
+            }
+
+            ucs_memory_cpu_load_fence();
+            for (i = 0; i < chunk.num_records; ++i) {
+                if (records[i].location >= stream->num_locations) {
+                    continue;
+                }
+
+                if (base_time == 0) {
+                    base_time = records[i].timestamp;
+                }
+
+                loc = &locations[records[i].location];
+                printf("%s%14.3f%s %7u  %s%-40s%s %s%15s:%-4d %s()%s\n",
+                       TS_COLOR,
+                       time_to_units(data, opts,
+                                     records[i].timestamp - base_time),
+                       CLEAR_COLOR, chunk.tid, NAME_COLOR,
+                       stream_record_str(loc, &records[i], buf, sizeof(buf)),
+                       CLEAR_COLOR, LOC_COLOR, ucs_basename(loc->file),
+                       loc->line, loc->function, CLEAR_COLOR);
+            }
+        }
+
+        fflush(stdout);
+        if ((seq == stream->head) && stream->closed) {
+            break;
+        }
+
+        usleep(FOLLOW_INTERVAL_US);
+    }
+
+    data->header = NULL;
+    free(records);
+    return 0;
+}
+
 static int compare_locations(const void *l1, const void *l2)
 {
     const ucs_profile_thread_location_t *loc1 = l1;
@@ -629,6 +1024,318 @@ static void show_profile_data_log(profile_data_t *data, options_t *opts,
     free(scope_ends);
 }
 
+KHASH_MAP_INIT_INT64(request_spans, request_span_t)
+
+static void chrome_trace_print_string(const char *str)
+{
+    const char *p;
+
+    putchar('"');
+    for (p = str; *p != '\0'; ++p) {
+        if ((*p == '"') || (*p == '\\')) {
+            printf("\\%c", *p);
+        } else if ((unsigned char)*p < 0x20) {
+            printf("\\u%04x", (unsigned char)*p);
+        } else {
+            putchar(*p);
+        }
+    }
+    putchar('"');
+}
+
+/* Start a trace event object, the caller adds more fields and closes it */
+static void chrome_trace_event_start(chrome_trace_t *trace, const char *name,
+                                     const char *cat, const char *ph, int tid,
+                                     uint64_t timestamp)
+{
+    printf("%s\n{\"name\":", (trace->num_events++ > 0) ? "," : "");
+    chrome_trace_print_string(name);
+    printf(",\"cat\":\"%s\",\"ph\":\"%s\",\"pid\":%u,\"tid\":%d", cat, ph,
+           trace->data->header->pid, tid);
+    if (timestamp >= trace->base_time) {
+        /* Chrome trace timestamps are in microseconds */
+        printf(",\"ts\":%.3f", (timestamp - trace->base_time) * 1e6 /
+                               trace->data->header->one_second);
+    }
+}
+
+static void chrome_trace_location_args(const ucs_profile_location_t *loc,
+                                       const ucs_profile_record_t *rec)
+{
+    printf(",\"args\":{\"location\":\"%s:%d\",\"function\":",
+           ucs_basename(loc->file), loc->line);
+    chrome_trace_print_string(loc->function);
+    if (rec != NULL) {
+        printf(",\"param32\":%u,\"param64\":%" PRIu64, rec->param32,
+               (uint64_t)rec->param64);
+    }
+    printf("}");
+}
+
+static void chrome_trace_metadata(chrome_trace_t *trace, const char *name,
+                                  int tid, const char *value)
+{
+    chrome_trace_event_start(trace, name, "__metadata", "M", tid, 0);
+    printf(",\"args\":{\"name\":");
+    chrome_trace_print_string(value);
+    printf("}}");
+}
+
+/* Export scopes and samples of a thread */
+static void chrome_trace_thread(chrome_trace_t *trace, int thread_idx)
+{
+    profile_thread_data_t *thread = &trace->data->threads[thread_idx];
+    size_t num_records            = thread->header->num_records;
+    int tid                       = thread->header->tid;
+    const ucs_profile_record_t *stack[UCS_PROFILE_STACK_MAX];
+    const ucs_profile_location_t *loc, *begin_loc;
+    const ucs_profile_record_t *rec;
+    char thread_name[64];
+    int nesting;
+
+    snprintf(thread_name, sizeof(thread_name), "thread %d%s", thread_idx + 1,
+             (tid == trace->data->header->pid) ? " (main)" : "");
+    chrome_trace_metadata(trace, "thread_name", tid, thread_name);
+
+    /* Scopes are exported as complete events, when the scope end is found.
+     * Scopes which began before the first record, or did not end before the
+     * last record, are omitted. */
+    nesting = 0;
+    for (rec = thread->records; rec < thread->records + num_records; ++rec) {
+        loc = &trace->data->locations[rec->location];
+        switch (loc->type) {
+        case UCS_PROFILE_TYPE_SCOPE_BEGIN:
+            if (nesting < UCS_PROFILE_STACK_MAX) {
+                stack[nesting] = rec;
+            }
+            ++nesting;
+            break;
+        case UCS_PROFILE_TYPE_SCOPE_END:
+            if (nesting == 0) {
+                break;
+            }
+
+            --nesting;
+            if (nesting >= UCS_PROFILE_STACK_MAX) {
+                break;
+            }
+
+            begin_loc = &trace->data->locations[stack[nesting]->location];
+            chrome_trace_event_start(trace, loc->name, "scope", "X", tid,
+                                     stack[nesting]->timestamp);
+            printf(",\"dur\":%.3f", (rec->timestamp - stack[nesting]->timestamp) *
+                                    1e6 / trace->data->header->one_second);
+            chrome_trace_location_args(begin_loc, NULL);
+            printf("}");
+            break;
+        case UCS_PROFILE_TYPE_SAMPLE:
+            chrome_trace_event_start(trace, loc->name, "sample", "i", tid,
+                                     rec->timestamp);
+            printf(",\"s\":\"t\"");
+            chrome_trace_location_args(loc, rec);
+            printf("}");
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static int compare_request_records(const void *r1, const void *r2)
+{
+    const request_record_t *req_rec1 = r1;
+    const request_record_t *req_rec2 = r2;
+    return (req_rec1->rec->timestamp < req_rec2->rec->timestamp) ? -1 :
+           (req_rec1->rec->timestamp > req_rec2->rec->timestamp) ? +1 :
+           0;
+}
+
+static void chrome_trace_request_event(chrome_trace_t *trace,
+                                       const request_record_t *req_rec,
+                                       const char *name, const char *ph)
+{
+    const ucs_profile_record_t *rec = req_rec->rec;
+
+    chrome_trace_event_start(trace, name, "request", ph, req_rec->tid,
+                             rec->timestamp);
+    printf(",\"id\":\"0x%" PRIx64 "\"", (uint64_t)rec->param64);
+}
+
+static void chrome_trace_request_flow(chrome_trace_t *trace,
+                                      const request_record_t *req_rec,
+                                      const request_span_t *span,
+                                      const char *ph)
+{
+    chrome_trace_event_start(trace, "request", "request_flow", ph,
+                             req_rec->tid, req_rec->rec->timestamp);
+    printf(",\"id\":%zu%s}", span->reqid, (*ph == 'f') ? ",\"bp\":\"e\"" : "");
+}
+
+/*
+ * Export request lifetimes as async spans keyed by the request pointer, and
+ * draw a flow arrow from the request creation to its completion. Requests may
+ * be completed on a different thread, so the records of all threads are merged
+ * by time.
+ */
+static int chrome_trace_requests(chrome_trace_t *trace, const int *thread_list)
+{
+    profile_data_t *data         = trace->data;
+    request_record_t *req_recs   = NULL;
+    size_t num_req_recs          = 0;
+    size_t reqid_ctr             = 1;
+    const ucs_profile_location_t *loc;
+    const ucs_profile_record_t *rec;
+    const profile_thread_data_t *thread;
+    request_record_t *req_rec;
+    khash_t(request_spans) spans;
+    request_span_t *span;
+    khiter_t hash_it;
+    int hash_extra_status;
+    size_t max_req_recs;
+    const int *t;
+
+    max_req_recs = 0;
+    for (t = thread_list; *t != -1; ++t) {
+        max_req_recs += data->threads[*t - 1].header->num_records;
+    }
+
+    req_recs = calloc(max_req_recs + 1, sizeof(*req_recs));
+    if (req_recs == NULL) {
+        print_error("failed to allocate request records");
+        return -ENOMEM;
+    }
+
+    for (t = thread_list; *t != -1; ++t) {
+        thread = &data->threads[*t - 1];
+        for (rec = thread->records;
+             rec < thread->records + thread->header->num_records; ++rec) {
+            loc = &data->locations[rec->location];
+            if ((loc->type == UCS_PROFILE_TYPE_REQUEST_NEW) ||
+                (loc->type == UCS_PROFILE_TYPE_REQUEST_EVENT) ||
+                (loc->type == UCS_PROFILE_TYPE_REQUEST_FREE)) {
+                req_recs[num_req_recs].rec   = rec;
+                req_recs[num_req_recs++].tid = thread->header->tid;
+            }
+        }
+    }
+
+    qsort(req_recs, num_req_recs, sizeof(*req_recs), compare_request_records);
+
+    kh_init_inplace(request_spans, &spans);
+
+    for (req_rec = req_recs; req_rec < req_recs + num_req_recs; ++req_rec) {
+        rec     = req_rec->rec;
+        loc     = &data->locations[rec->location];
+        hash_it = kh_get(request_spans, &spans, rec->param64);
+        span    = (hash_it == kh_end(&spans)) ? NULL :
+                                                &kh_value(&spans, hash_it);
+
+        switch (loc->type) {
+        case UCS_PROFILE_TYPE_REQUEST_NEW:
+            if (span != NULL) {
+                /* old request was not released, end its span */
+                chrome_trace_request_event(trace, req_rec,
+                                           data->locations[span->location].name,
+                                           "e");
+                printf("}");
+            } else {
+                hash_it = kh_put(request_spans, &spans, rec->param64,
+                                 &hash_extra_status);
+                if (hash_it == kh_end(&spans)) {
+                    break; /* error inserting to hash */
+                }
+                span = &kh_value(&spans, hash_it);
+            }
+
+            span->reqid        = reqid_ctr++;
+            span->location     = rec->location;
+            span->flow_pending = 1;
+            chrome_trace_request_event(trace, req_rec, loc->name, "b");
+            chrome_trace_location_args(loc, rec);
+            printf("}");
+            chrome_trace_request_flow(trace, req_rec, span, "s");
+            break;
+        case UCS_PROFILE_TYPE_REQUEST_EVENT:
+            if (span == NULL) {
+                /* request creation is not in the log */
+                chrome_trace_event_start(trace, loc->name, "request", "i",
+                                         req_rec->tid, rec->timestamp);
+                printf(",\"s\":\"t\"");
+                chrome_trace_location_args(loc, rec);
+                printf("}");
+                break;
+            }
+
+            chrome_trace_request_event(trace, req_rec, loc->name, "n");
+            chrome_trace_location_args(loc, rec);
+            printf("}");
+            if (span->flow_pending && !strncmp(loc->name, "complete", 8)) {
+                chrome_trace_request_flow(trace, req_rec, span, "f");
+                span->flow_pending = 0;
+            }
+            break;
+        case UCS_PROFILE_TYPE_REQUEST_FREE:
+            if (span == NULL) {
+                break;
+            }
+
+            if (span->flow_pending) {
+                chrome_trace_request_flow(trace, req_rec, span, "f");
+            }
+
+            chrome_trace_request_event(trace, req_rec,
+                                       data->locations[span->location].name,
+                                       "e");
+            printf("}");
+            kh_del(request_spans, &spans, hash_it);
+            break;
+        default:
+            break;
+        }
+    }
+
+    kh_destroy_inplace(request_spans, &spans);
+    free(req_recs);
+    return 0;
+}
+
+/*
+ * Export log records in Chrome trace-event JSON format, which can be loaded by
+ * chrome://tracing or https://ui.perfetto.dev
+ */
+static int show_profile_data_chrome(profile_data_t *data, options_t *opts)
+{
+    chrome_trace_t trace;
+    const int *t;
+    int ret;
+
+    if (!(data->header->mode & UCS_BIT(UCS_PROFILE_MODE_LOG))) {
+        print_error("the profile does not contain log records, use "
+                    "UCX_PROFILE_MODE=log");
+        return -EINVAL;
+    }
+
+    trace.data       = data;
+    trace.base_time  = UINT64_MAX;
+    trace.num_events = 0;
+    for (t = opts->thread_list; *t != -1; ++t) {
+        trace.base_time = ucs_min(trace.base_time,
+                                  data->threads[*t - 1].header->start_time);
+    }
+
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    chrome_trace_metadata(&trace, "process_name", data->header->pid,
+                          data->header->cmdline);
+
+    for (t = opts->thread_list; *t != -1; ++t) {
+        chrome_trace_thread(&trace, *t - 1);
+    }
+
+    ret = chrome_trace_requests(&trace, opts->thread_list);
+    printf("\n]}\n");
+    return ret;
+}
+
 static void close_pipes()
 {
     close(output_pipefds[0]);
@@ -798,6 +1505,10 @@ static int show_profile_data(profile_data_t *data, options_t *opts)
         }
     }
 
+    if (opts->chrome_trace) {
+        return show_profile_data_chrome(data, opts);
+    }
+
     /* redirect output if needed */
     if (!opts->raw) {
         ret = redirect_output(data, opts);
@@ -828,6 +1539,13 @@ static void usage()
     printf("Usage: ucx_read_profile [options] [profile-file]\n");
     printf("Options are:\n");
     printf("  -r              Show raw output\n");
+    printf("  -c              Export log records in Chrome trace-event JSON "
+           "format,\n");
+    printf("                  which chrome://tracing and Perfetto UI can "
+           "load\n");
+    printf("  -f              Print new records of a streaming profile file as "
+           "they\n");
+    printf("                  are written (UCX_PROFILE_MODE=stream)\n");
     printf("  -T <threads>    Comma-separated list of threads to show, "
            "e.g. \"1,2,3\", or \"all\" to show all threads\n");
     printf("  -t <units>      Select time units to use:\n");
@@ -842,18 +1560,26 @@ static int parse_args(int argc, char **argv, options_t *opts)
 {
     int ret, c;
 
-    opts->raw         = !isatty(fileno(stdout));
-    opts->time_units  = TIME_UNITS_USEC;
+    opts->raw          = !isatty(fileno(stdout));
+    opts->chrome_trace = 0;
+    opts->follow       = 0;
+    opts->time_units   = TIME_UNITS_USEC;
     ret = parse_thread_list(opts->thread_list, "all");
     if (ret < 0) {
         return ret;
     }
 
-    while ( (c = getopt(argc, argv, "rT:t:h")) != -1 ) {
+    while ( (c = getopt(argc, argv, "rcfT:t:h")) != -1 ) {
         switch (c) {
         case 'r':
             opts->raw = 1;
             break;
+        case 'c':
+            opts->chrome_trace = 1;
+            break;
+        case 'f':
+            opts->follow = 1;
+            break;
         case 'T':
             ret = parse_thread_list(opts->thread_list, optarg);
             if (ret < 0) {
@@ -911,7 +1637,25 @@ int main(int argc, char **argv)
         return ret;
     }
 
+    if (data.stream != NULL) {
+        if (opts.follow) {
+            ret = follow_profile_stream(&data, &opts);
+            goto out;
+        }
+
+        ret = read_profile_stream(&data);
+        if (ret < 0) {
+            goto out;
+        }
+    } else if (opts.follow) {
+        print_error("only streaming profile files can be followed");
+        ret = -EINVAL;
+        goto out;
+    }
+
     ret = show_profile_data(&data, &opts);
+
+out:
     release_profile_data(&data);
     return ret;
 }
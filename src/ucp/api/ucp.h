@@ -451,8 +451,10 @@ enum ucp_worker_attr_field {
     UCP_WORKER_ATTR_FIELD_MAX_AM_HEADER   = UCS_BIT(3), /**< Maximum header size
                                                              used by UCP AM API */
     UCP_WORKER_ATTR_FIELD_NAME            = UCS_BIT(4), /**< UCP worker name */
-    UCP_WORKER_ATTR_FIELD_MAX_INFO_STRING = UCS_BIT(5)  /**< Maximum size of
+    UCP_WORKER_ATTR_FIELD_MAX_INFO_STRING = UCS_BIT(5), /**< Maximum size of
                                                              info string */
+    UCP_WORKER_ATTR_FIELD_MEMORY_USAGE    = UCS_BIT(6)  /**< Memory held by
+                                                             memory pools */
 };
 
 
@@ -1262,6 +1264,13 @@ typedef struct ucp_worker_attr {
      * Maximum debug string size that can be filled with @ref ucp_request_query.
      */
     size_t                max_debug_string;
+
+    /**
+     * Total size in bytes of the memory pool chunks currently held by the
+     * worker and its transport interfaces. It is limited by the
+     * UCX_WORKER_MEMORY_BUDGET configuration parameter.
+     */
+    size_t                memory_usage;
 } ucp_worker_attr_t;
 
 
@@ -2379,6 +2388,10 @@ ucs_status_t ucp_worker_get_efd(ucp_worker_h worker, int *fd);
  * notification and may not progress some of the requests as it would when
  * calling @ref ucp_worker_progress (which is not invoked in that duration).
  *
+ * @note If UCX_WAKEUP_SPIN_TIME configuration is set, this routine first calls
+ * @ref ucp_worker_progress for an adaptively tuned period of time, and returns
+ * without sleeping if any progress was made.
+ *
  * @note UCP @ref ucp_feature "features" have to be triggered
  *   with @ref UCP_FEATURE_WAKEUP to select proper transport
  *
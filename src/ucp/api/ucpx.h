@@ -20,6 +20,167 @@
 BEGIN_C_DECLS
 
 
+/**
+ * @ingroup UCP_WORKER
+ * @brief Node-local address book handle.
+ *
+ * An address book is a shared memory object which holds the packed worker
+ * addresses of a job, so the processes on a node can share a single read-only
+ * copy of them instead of each holding its own. One process publishes the
+ * addresses, and the other processes map the book read-only and pass the
+ * addresses from the mapping to @ref ucp_ep_create without copying them.
+ */
+typedef struct ucp_address_book *ucp_address_book_h;
+
+
+/**
+ * @ingroup UCP_WORKER
+ * @brief UCP address book parameters field mask.
+ *
+ * The enumeration allows specifying which fields in
+ * @ref ucp_address_book_params_t are present. It is used to enable backward
+ * compatibility support.
+ */
+enum ucp_address_book_params_field {
+    UCP_ADDRESS_BOOK_PARAM_FIELD_NAME               = UCS_BIT(0), /**< name */
+    UCP_ADDRESS_BOOK_PARAM_FIELD_FLAGS              = UCS_BIT(1), /**< flags */
+    UCP_ADDRESS_BOOK_PARAM_FIELD_NUM_ADDRESSES      = UCS_BIT(2), /**< num_addresses */
+    UCP_ADDRESS_BOOK_PARAM_FIELD_MAX_ADDRESS_LENGTH = UCS_BIT(3)  /**< max_address_length */
+};
+
+
+/**
+ * @ingroup UCP_WORKER
+ * @brief UCP address book flags.
+ */
+enum ucp_address_book_flags {
+    /**
+     * Create the address book and open it for publishing. Otherwise, an
+     * address book created by another process is opened read-only.
+     */
+    UCP_ADDRESS_BOOK_FLAG_PUBLISH = UCS_BIT(0)
+};
+
+
+/**
+ * @ingroup UCP_WORKER
+ * @brief UCP address book parameters.
+ */
+typedef struct ucp_address_book_params {
+    /**
+     * Mask of valid fields in this structure, using bits from
+     * @ref ucp_address_book_params_field.
+     * Fields not specified in this mask will be ignored.
+     * Provides ABI compatibility with respect to adding new fields.
+     */
+    uint64_t   field_mask;
+
+    /**
+     * Name of the address book, which must be the same in the process that
+     * publishes the addresses and in the processes that use them. The name
+     * must not contain '/'. This field is mandatory.
+     */
+    const char *name;
+
+    /**
+     * Flags from @ref ucp_address_book_flags. Default: 0.
+     */
+    unsigned   flags;
+
+    /**
+     * Number of addresses in the book, indexed from 0. Mandatory when
+     * @ref UCP_ADDRESS_BOOK_FLAG_PUBLISH is set, and ignored otherwise.
+     */
+    unsigned   num_addresses;
+
+    /**
+     * Maximal length of an address in the book. Mandatory when
+     * @ref UCP_ADDRESS_BOOK_FLAG_PUBLISH is set, and ignored otherwise.
+     */
+    size_t     max_address_length;
+} ucp_address_book_params_t;
+
+
+/**
+ * @ingroup UCP_WORKER
+ * @brief Create or open a node-local address book.
+ *
+ * With @ref UCP_ADDRESS_BOOK_FLAG_PUBLISH, creates a new address book, which
+ * is filled by @ref ucp_address_book_publish. Otherwise, maps an address book
+ * created by another process on the same node as read-only. The other
+ * processes can open the book after it was created, also while addresses are
+ * still being published.
+ *
+ * @param [in]  params      Address book parameters.
+ * @param [out] book_p      Filled with the address book handle.
+ *
+ * @return UCS_ERR_ALREADY_EXISTS  An address book with this name is already
+ *                                 published.
+ * @return UCS_ERR_NO_ELEM         The address book was not created yet.
+ * @return Error code as defined by @ref ucs_status_t
+ */
+ucs_status_t ucp_address_book_open(const ucp_address_book_params_t *params,
+                                   ucp_address_book_h *book_p);
+
+
+/**
+ * @ingroup UCP_WORKER
+ * @brief Close an address book.
+ *
+ * Unmaps the address book. If the book was created by this process, it is
+ * also removed, so it cannot be opened anymore, but the processes that already
+ * opened it can still use it. Endpoints created from addresses in the book
+ * remain valid after it is closed.
+ *
+ * @param [in]  book        Address book to close.
+ */
+void ucp_address_book_close(ucp_address_book_h book);
+
+
+/**
+ * @ingroup UCP_WORKER
+ * @brief Publish an address in the address book.
+ *
+ * Copies a packed worker address, as returned by @ref ucp_worker_get_address
+ * or @ref ucp_worker_query, to the address book. Every address can be
+ * published once, and becomes visible to the other processes when this
+ * function returns.
+ *
+ * @param [in]  book        Address book opened with
+ *                          @ref UCP_ADDRESS_BOOK_FLAG_PUBLISH.
+ * @param [in]  index       Index of the address in the book.
+ * @param [in]  address     Worker address to publish.
+ * @param [in]  length      Length of the worker address.
+ *
+ * @return UCS_ERR_ALREADY_EXISTS  The address was already published.
+ * @return Error code as defined by @ref ucs_status_t
+ */
+ucs_status_t ucp_address_book_publish(ucp_address_book_h book, unsigned index,
+                                      const ucp_address_t *address,
+                                      size_t length);
+
+
+/**
+ * @ingroup UCP_WORKER
+ * @brief Get an address from the address book.
+ *
+ * Returns a pointer to the address in the shared mapping of the book, which
+ * can be passed to @ref ucp_ep_create as @ref ucp_ep_params_t::address. The
+ * address is valid until the book is closed by this process.
+ *
+ * @param [in]  book        Address book.
+ * @param [in]  index       Index of the address in the book.
+ * @param [out] address_p   Filled with the worker address.
+ * @param [out] length_p    Filled with the length of the worker address. Can
+ *                          be NULL.
+ *
+ * @return UCS_ERR_NO_ELEM  The address was not published yet.
+ * @return Error code as defined by @ref ucs_status_t
+ */
+ucs_status_t ucp_address_book_get(ucp_address_book_h book, unsigned index,
+                                  const ucp_address_t **address_p,
+                                  size_t *length_p);
+
 
 END_C_DECLS
 
@@ -0,0 +1,360 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "ucp_context.h"
+
+#include <ucp/api/ucpx.h>
+#include <ucs/arch/cpu.h>
+#include <ucs/debug/log.h>
+#include <ucs/debug/memtrack_int.h>
+#include <ucs/sys/ptr_arith.h>
+#include <ucs/sys/string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+
+#define UCP_ADDRESS_BOOK_MAGIC      "UCPADDRB"
+#define UCP_ADDRESS_BOOK_VERSION    1u
+#define UCP_ADDRESS_BOOK_SHM_PREFIX "/ucx_address_book_"
+#define UCP_ADDRESS_BOOK_SHM_MODE   (S_IRUSR | S_IWUSR)
+
+
+/*
+ * Address book layout:
+ *
+ *   ucp_address_book_header_t   (aligned to cache line)
+ *   ucp_address_book_slot_t     (address 0)
+ *     address data[max_address_length]
+ *   ucp_address_book_slot_t     (address 1)
+ *     address data[max_address_length]
+ *   ...
+ *
+ * Every slot starts on a cache line. The publisher sets the magic of the header
+ * after the rest of the header is written, and the length of a slot after its
+ * address data is written, so the other processes never see partial contents.
+ */
+typedef struct {
+    char              magic[8];           /* UCP_ADDRESS_BOOK_MAGIC */
+    uint32_t          version;            /* UCP_ADDRESS_BOOK_VERSION */
+    uint32_t          num_addresses;      /* Number of slots */
+    uint64_t          max_address_length; /* Maximal length of an address */
+    uint64_t          slot_size;          /* Size of a slot, with its data */
+    uint64_t          size;               /* Total size of the book */
+} ucp_address_book_header_t;
+
+
+typedef struct {
+    volatile uint64_t length;             /* Address length, 0 if empty */
+} ucp_address_book_slot_t;
+
+
+struct ucp_address_book {
+    ucp_address_book_header_t *header;    /* Mapped address book */
+    int                       publish;    /* Whether this process created it */
+    char                      shm_name[NAME_MAX];
+};
+
+
+static size_t ucp_address_book_header_size()
+{
+    return ucs_align_up_pow2(sizeof(ucp_address_book_header_t),
+                             UCS_SYS_CACHE_LINE_SIZE);
+}
+
+static ucp_address_book_slot_t *
+ucp_address_book_slot(const ucp_address_book_h book, unsigned index)
+{
+    return UCS_PTR_BYTE_OFFSET(book->header, ucp_address_book_header_size() +
+                                             (index * book->header->slot_size));
+}
+
+static int ucp_address_book_is_valid(const ucp_address_book_header_t *header,
+                                     size_t size)
+{
+    if (memcmp(header->magic, UCP_ADDRESS_BOOK_MAGIC, sizeof(header->magic))) {
+        return 0;
+    }
+
+    /* Read the rest of the header only after the magic */
+    ucs_memory_cpu_load_fence();
+
+    return (header->version == UCP_ADDRESS_BOOK_VERSION) &&
+           (header->size == size) &&
+           (header->slot_size >= (sizeof(ucp_address_book_slot_t) +
+                                  header->max_address_length)) &&
+           (header->size == (ucp_address_book_header_size() +
+                             (header->num_addresses * header->slot_size)));
+}
+
+static ucs_status_t
+ucp_address_book_create(ucp_address_book_h book,
+                        const ucp_address_book_params_t *params)
+{
+    ucp_address_book_header_t *header;
+    size_t slot_size, size;
+    ucs_status_t status;
+    int fd;
+
+    if (!(params->field_mask &
+          UCP_ADDRESS_BOOK_PARAM_FIELD_NUM_ADDRESSES) ||
+        !(params->field_mask &
+          UCP_ADDRESS_BOOK_PARAM_FIELD_MAX_ADDRESS_LENGTH) ||
+        (params->max_address_length == 0)) {
+        ucs_error("address book '%s': number of addresses and maximal "
+                  "address length must be set", params->name);
+        return UCS_ERR_INVALID_PARAM;
+    }
+
+    slot_size = ucs_align_up_pow2(sizeof(ucp_address_book_slot_t) +
+                                  params->max_address_length,
+                                  UCS_SYS_CACHE_LINE_SIZE);
+    if (params->num_addresses > ((SIZE_MAX - ucp_address_book_header_size()) /
+                                 slot_size)) {
+        ucs_error("address book '%s': %u addresses of %zu bytes are too large",
+                  params->name, params->num_addresses,
+                  params->max_address_length);
+        return UCS_ERR_INVALID_PARAM;
+    }
+
+    size = ucp_address_book_header_size() + (params->num_addresses * slot_size);
+
+    fd = shm_open(book->shm_name, O_CREAT | O_EXCL | O_RDWR,
+                  UCP_ADDRESS_BOOK_SHM_MODE);
+    if (fd < 0) {
+        if (errno == EEXIST) {
+            ucs_debug("address book %s already exists", book->shm_name);
+            return UCS_ERR_ALREADY_EXISTS;
+        }
+
+        ucs_error("shm_open(%s) failed: %m", book->shm_name);
+        return UCS_ERR_IO_ERROR;
+    }
+
+    if (ftruncate(fd, size) < 0) {
+        ucs_error("failed to resize address book %s to %zu bytes: %m",
+                  book->shm_name, size);
+        status = UCS_ERR_NO_MEMORY;
+        goto err_unlink;
+    }
+
+    header = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED) {
+        ucs_error("failed to map address book %s: %m", book->shm_name);
+        status = UCS_ERR_NO_MEMORY;
+        goto err_unlink;
+    }
+
+    /* The slots are zeroed by ftruncate(), so all of them are empty */
+    header->version            = UCP_ADDRESS_BOOK_VERSION;
+    header->num_addresses      = params->num_addresses;
+    header->max_address_length = params->max_address_length;
+    header->slot_size          = slot_size;
+    header->size               = size;
+    ucs_memory_cpu_store_fence();
+    memcpy(header->magic, UCP_ADDRESS_BOOK_MAGIC, sizeof(header->magic));
+
+    close(fd);
+    book->header = header;
+    return UCS_OK;
+
+err_unlink:
+    shm_unlink(book->shm_name);
+    close(fd);
+    return status;
+}
+
+static ucs_status_t ucp_address_book_map(ucp_address_book_h book)
+{
+    ucs_status_t status;
+    struct stat st;
+    void *ptr;
+    int fd;
+
+    fd = shm_open(book->shm_name, O_RDONLY, 0);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            ucs_debug("address book %s does not exist", book->shm_name);
+            return UCS_ERR_NO_ELEM;
+        }
+
+        ucs_error("shm_open(%s) failed: %m", book->shm_name);
+        return UCS_ERR_IO_ERROR;
+    }
+
+    if (fstat(fd, &st) < 0) {
+        ucs_error("failed to stat address book %s: %m", book->shm_name);
+        status = UCS_ERR_IO_ERROR;
+        goto out_close;
+    }
+
+    /* Do not use addresses published by a different user */
+    if (st.st_uid != getuid()) {
+        ucs_error("address book %s is owned by uid %d", book->shm_name,
+                  st.st_uid);
+        status = UCS_ERR_REJECTED;
+        goto out_close;
+    }
+
+    /* The publisher may not have resized it yet */
+    if (st.st_size < ucp_address_book_header_size()) {
+        ucs_debug("address book %s is not ready", book->shm_name);
+        status = UCS_ERR_NO_ELEM;
+        goto out_close;
+    }
+
+    ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        ucs_error("failed to map address book %s: %m", book->shm_name);
+        status = UCS_ERR_NO_MEMORY;
+        goto out_close;
+    }
+
+    if (!ucp_address_book_is_valid(ptr, st.st_size)) {
+        ucs_debug("address book %s is not ready or invalid", book->shm_name);
+        munmap(ptr, st.st_size);
+        status = UCS_ERR_NO_ELEM;
+        goto out_close;
+    }
+
+    book->header = ptr;
+    status       = UCS_OK;
+
+out_close:
+    close(fd);
+    return status;
+}
+
+ucs_status_t ucp_address_book_open(const ucp_address_book_params_t *params,
+                                   ucp_address_book_h *book_p)
+{
+    ucp_address_book_h book;
+    ucs_status_t status;
+    unsigned flags;
+
+    if (!(params->field_mask & UCP_ADDRESS_BOOK_PARAM_FIELD_NAME) ||
+        (params->name == NULL) || ucs_string_is_empty(params->name) ||
+        (strchr(params->name, '/') != NULL) ||
+        ((strlen(UCP_ADDRESS_BOOK_SHM_PREFIX) + strlen(params->name)) >=
+         NAME_MAX)) {
+        ucs_error("invalid address book name");
+        return UCS_ERR_INVALID_PARAM;
+    }
+
+    book = ucs_malloc(sizeof(*book), "ucp_address_book");
+    if (book == NULL) {
+        ucs_error("failed to allocate address book");
+        return UCS_ERR_NO_MEMORY;
+    }
+
+    flags         = UCP_PARAM_VALUE(ADDRESS_BOOK, params, flags, FLAGS, 0);
+    book->publish = !!(flags & UCP_ADDRESS_BOOK_FLAG_PUBLISH);
+    ucs_snprintf_safe(book->shm_name, sizeof(book->shm_name), "%s%s",
+                      UCP_ADDRESS_BOOK_SHM_PREFIX, params->name);
+
+    if (book->publish) {
+        status = ucp_address_book_create(book, params);
+    } else {
+        status = ucp_address_book_map(book);
+    }
+    if (status != UCS_OK) {
+        ucs_free(book);
+        return status;
+    }
+
+    ucs_debug("%s address book %s with %u addresses of up to %" PRIu64
+              " bytes", book->publish ? "created" : "opened", book->shm_name,
+              book->header->num_addresses,
+              book->header->max_address_length);
+    *book_p = book;
+    return UCS_OK;
+}
+
+void ucp_address_book_close(ucp_address_book_h book)
+{
+    if (book->publish) {
+        shm_unlink(book->shm_name);
+    }
+
+    munmap(book->header, book->header->size);
+    ucs_free(book);
+}
+
+ucs_status_t ucp_address_book_publish(ucp_address_book_h book, unsigned index,
+                                      const ucp_address_t *address,
+                                      size_t length)
+{
+    ucp_address_book_slot_t *slot;
+
+    if (!book->publish) {
+        ucs_error("address book %s is not opened for publishing",
+                  book->shm_name);
+        return UCS_ERR_INVALID_PARAM;
+    }
+
+    if ((index >= book->header->num_addresses) || (length == 0) ||
+        (length > book->header->max_address_length)) {
+        ucs_error("address book %s: invalid address %u of length %zu "
+                  "(number of addresses %u, maximal length %" PRIu64 ")",
+                  book->shm_name, index, length, book->header->num_addresses,
+                  book->header->max_address_length);
+        return UCS_ERR_INVALID_PARAM;
+    }
+
+    slot = ucp_address_book_slot(book, index);
+    if (slot->length != 0) {
+        return UCS_ERR_ALREADY_EXISTS;
+    }
+
+    memcpy(slot + 1, address, length);
+    ucs_memory_cpu_store_fence();
+    slot->length = length;
+    return UCS_OK;
+}
+
+ucs_status_t ucp_address_book_get(ucp_address_book_h book, unsigned index,
+                                  const ucp_address_t **address_p,
+                                  size_t *length_p)
+{
+    const ucp_address_book_slot_t *slot;
+    uint64_t length;
+
+    if (index >= book->header->num_addresses) {
+        ucs_error("address book %s: invalid address %u (number of addresses "
+                  "%u)", book->shm_name, index, book->header->num_addresses);
+        return UCS_ERR_INVALID_PARAM;
+    }
+
+    slot   = ucp_address_book_slot(book, index);
+    length = slot->length;
+    if (length == 0) {
+        return UCS_ERR_NO_ELEM;
+    }
+
+    /* The slot is writable by other processes, so do not trust its length */
+    if (length > book->header->max_address_length) {
+        ucs_error("address book %s: address %u has invalid length %" PRIu64
+                  " (maximal length %" PRIu64 ")", book->shm_name, index,
+                  length, book->header->max_address_length);
+        return UCS_ERR_INVALID_PARAM;
+    }
+
+    /* Read the address data only after its length */
+    ucs_memory_cpu_load_fence();
+
+    *address_p = (const ucp_address_t*)(slot + 1);
+    if (length_p != NULL) {
+        *length_p = length;
+    }
+
+    return UCS_OK;
+}
@@ -22,13 +22,45 @@
 #include <ucp/dt/dt.inl>
 
 
+static ucs_mpool_ops_t ucp_am_batch_mpool_ops = {
+    .chunk_alloc   = ucs_mpool_chunk_malloc,
+    .chunk_release = ucs_mpool_chunk_free,
+    .obj_init      = NULL,
+    .obj_cleanup   = NULL,
+    .obj_str       = NULL
+};
+
 ucs_status_t ucp_am_init(ucp_worker_h worker)
 {
+    size_t thresh = worker->context->config.ext.am_aggregate_thresh;
+    ucs_mpool_params_t mp_params;
+    ucs_status_t status;
+
     if (!(worker->context->config.features & UCP_FEATURE_AM)) {
         return UCS_OK;
     }
 
     ucs_array_init_dynamic(&worker->am.cbs);
+
+    worker->am.batch_max_length = ucs_min(thresh, UCP_AM_BATCH_MAX_LENGTH);
+    if (worker->am.batch_max_length == 0) {
+        return UCS_OK;
+    }
+
+    /* Batch buffers are taken only when there are messages to coalesce, and
+     * returned as soon as they are sent */
+    ucs_mpool_params_reset(&mp_params);
+    mp_params.elem_size       = sizeof(ucp_am_batch_t) +
+                                worker->am.batch_max_length;
+    mp_params.elems_per_chunk = 8;
+    mp_params.ops             = &ucp_am_batch_mpool_ops;
+    mp_params.name            = "ucp_am_batch";
+    status = ucs_mpool_init(&mp_params, &worker->am.batch_mp);
+    if (status != UCS_OK) {
+        ucs_array_cleanup_dynamic(&worker->am.cbs);
+        return status;
+    }
+
     return UCS_OK;
 }
 
@@ -38,13 +70,41 @@ void ucp_am_cleanup(ucp_worker_h worker)
         return;
     }
 
+    if (worker->am.batch_max_length != 0) {
+        ucs_mpool_cleanup(&worker->am.batch_mp, 1);
+    }
+
     ucs_array_cleanup_dynamic(&worker->am.cbs);
 }
 
+static unsigned ucp_am_batch_progress_cb(void *arg);
+
+/* Complete the requests of the coalesced messages and release the buffer */
+static void ucp_am_batch_complete(ucp_am_batch_t *batch, ucs_status_t status)
+{
+    ucp_request_t *req;
+
+    ucs_queue_for_each_extract(req, &batch->reqs, send.am_batch.queue, 1) {
+        ucp_request_complete_send(req, status);
+    }
+
+    ucs_mpool_put_inline(batch);
+}
+
+static int ucp_am_batch_remove_filter(const ucs_callbackq_elem_t *elem,
+                                      void *arg)
+{
+    return (elem->cb == ucp_am_batch_progress_cb) && (elem->arg == arg);
+}
+
 void ucp_am_ep_init(ucp_ep_h ep)
 {
     ucp_ep_ext_t *ep_ext = ep->ext;
 
+    /* Initialized regardless of the AM feature, since the endpoint flush
+     * checks for coalesced messages */
+    ep_ext->am.batch = NULL;
+
     if (ep->worker->context->config.features & UCP_FEATURE_AM) {
         ucs_list_head_init(&ep_ext->am.started_ams);
         ucs_queue_head_init(&ep_ext->am.mid_rdesc_q);
@@ -58,6 +118,16 @@ void ucp_am_ep_cleanup(ucp_ep_h ep)
     ucs_queue_iter_t iter;
     size_t count;
 
+    if (ep_ext->am.batch != NULL) {
+        ucs_callbackq_remove_oneshot(&ep->worker->uct->progress_q, ep,
+                                     ucp_am_batch_remove_filter, ep);
+        ucs_trace_data("worker %p: %zu bytes of coalesced AMs have been"
+                       " dropped on ep %p", ep->worker,
+                       ep_ext->am.batch->length, ep);
+        ucp_am_batch_complete(ep_ext->am.batch, UCS_ERR_CANCELED);
+        ep_ext->am.batch = NULL;
+    }
+
     if (!(ep->worker->context->config.features & UCP_FEATURE_AM)) {
         return;
     }
@@ -504,6 +574,198 @@ ucp_am_send_short(ucp_ep_h ep, uint16_t id, uint16_t flags, const void *header,
     return uct_ep_am_short_iov(ucp_ep_get_am_uct_ep(ep), am_id, iov, iov_cnt);
 }
 
+static size_t ucp_am_batch_pack(void *dest, void *arg)
+{
+    ucp_am_batch_t *batch = arg;
+
+    memcpy(dest, batch + 1, batch->length);
+    return batch->length;
+}
+
+static ucs_status_t ucp_am_batch_send(ucp_ep_h ep, ucp_am_batch_t *batch)
+{
+    ssize_t packed_len;
+
+    ucs_assertv(batch->length <= ucp_ep_get_max_bcopy(ep,
+                                                      ucp_ep_get_am_lane(ep)),
+                "ep %p: length=%zu", ep, batch->length);
+
+    packed_len = uct_ep_am_bcopy(ucp_ep_get_am_uct_ep(ep), UCP_AM_ID_AM_BATCH,
+                                 ucp_am_batch_pack, batch, 0);
+    if (ucs_unlikely(packed_len < 0)) {
+        return (ucs_status_t)packed_len;
+    }
+
+    ++ep->worker->counters.am_batches;
+    return UCS_OK;
+}
+
+void ucp_am_batch_request_complete(ucp_request_t *req, ucs_status_t status)
+{
+    ucp_worker_flush_ops_count_add(req->send.ep->worker, -1);
+    ucp_am_batch_complete(req->send.buffer, status);
+    ucp_request_put(req);
+}
+
+ucs_status_t ucp_am_batch_progress(uct_pending_req_t *self)
+{
+    ucp_request_t *req = ucs_container_of(self, ucp_request_t, send.uct);
+    ucs_status_t status;
+
+    status = ucp_am_batch_send(req->send.ep, req->send.buffer);
+    if (ucs_unlikely(status == UCS_ERR_NO_RESOURCE)) {
+        return UCS_ERR_NO_RESOURCE;
+    }
+
+    ucp_am_batch_request_complete(req, status);
+    return UCS_OK;
+}
+
+void ucp_am_batch_flush(ucp_ep_h ep)
+{
+    ucp_ep_ext_t *ep_ext  = ep->ext;
+    ucp_am_batch_t *batch = ep_ext->am.batch;
+    ucp_request_t *req;
+    ucs_status_t status;
+
+    if (ucs_likely(batch == NULL)) {
+        return;
+    }
+
+    ucs_callbackq_remove_oneshot(&ep->worker->uct->progress_q, ep,
+                                 ucp_am_batch_remove_filter, ep);
+    ep_ext->am.batch = NULL;
+
+    status = ucp_am_batch_send(ep, batch);
+    if (ucs_likely(status != UCS_ERR_NO_RESOURCE)) {
+        ucp_am_batch_complete(batch, status);
+        return;
+    }
+
+    req = ucp_request_get(ep->worker);
+    if (ucs_unlikely(req == NULL)) {
+        ucs_error("ep %p: failed to allocate request for coalesced AMs", ep);
+        ucp_am_batch_complete(batch, UCS_ERR_NO_MEMORY);
+        return;
+    }
+
+    /* Pass the batch to the request, which is scheduled on the pending queue
+     * of AM lane, so any message sent later is ordered after it */
+    req->flags         = 0;
+    req->send.ep       = ep;
+    req->send.buffer   = batch;
+    req->send.lane     = ucp_ep_get_am_lane(ep);
+    req->send.uct.func = ucp_am_batch_progress;
+
+    ucp_worker_flush_ops_count_add(ep->worker, +1);
+    ucp_request_send(req);
+}
+
+void ucp_am_batch_flush_worker(ucp_worker_h worker)
+{
+    ucp_ep_ext_t *ep_ext;
+
+    if (ucs_likely(worker->context->config.ext.am_aggregate_thresh == 0)) {
+        return;
+    }
+
+    ucs_list_for_each(ep_ext, &worker->all_eps, ep_list) {
+        ucp_am_batch_flush(ep_ext->ep);
+    }
+}
+
+static unsigned ucp_am_batch_progress_cb(void *arg)
+{
+    ucp_ep_h ep = arg;
+
+    ucp_am_batch_flush(ep);
+    return 1;
+}
+
+static UCS_F_ALWAYS_INLINE int
+ucp_am_batch_is_host_mem(ucp_context_h context, const void *buffer,
+                         size_t length, const ucp_request_param_t *param)
+{
+    return ucp_request_get_memory_type(context, buffer, 1,
+                                       ucp_dt_make_contig(1), length,
+                                       param) == UCS_MEMORY_TYPE_HOST;
+}
+
+/* Coalesce the message into the endpoint batch, or send the batch if the
+ * message can't be coalesced. The returned request is completed when the
+ * batch is sent. Returns UCS_ERR_NO_RESOURCE if the message has to be sent by
+ * the regular protocols. */
+static ucs_status_ptr_t
+ucp_am_batch_add(ucp_ep_h ep, uint16_t id, uint32_t flags, const void *header,
+                 size_t header_length, const void *buffer, size_t count,
+                 uint32_t attr_mask, const ucp_request_param_t *param)
+{
+    ucp_worker_h worker  = ep->worker;
+    ucp_ep_ext_t *ep_ext = ep->ext;
+    size_t length        = count;
+    size_t max_length, msg_length;
+    ucp_am_batch_hdr_t *batch_hdr;
+    ucp_am_batch_t *batch;
+    ucp_request_t *req;
+
+    if ((attr_mask == UCP_OP_ATTR_FIELD_DATATYPE) &&
+        UCP_DT_IS_CONTIG(param->datatype)) {
+        length    = ucp_contig_dt_length(param->datatype, count);
+        attr_mask = 0;
+    }
+
+    msg_length = sizeof(*batch_hdr) + length + header_length;
+    max_length = ucs_min(worker->am.batch_max_length,
+                         ucp_ep_get_max_bcopy(ep, ucp_ep_get_am_lane(ep)));
+    if ((attr_mask != 0) ||
+        (flags & (UCP_AM_SEND_FLAG_REPLY | UCP_AM_SEND_FLAG_RNDV)) ||
+        (param->op_attr_mask & (UCP_OP_ATTR_FIELD_MEMH |
+                                UCP_OP_ATTR_FLAG_FORCE_IMM_CMPL)) ||
+        !ucp_am_batch_is_host_mem(worker->context, buffer, length, param) ||
+        (msg_length > max_length)) {
+        /* Keep the order of messages */
+        ucp_am_batch_flush(ep);
+        return UCS_STATUS_PTR(UCS_ERR_NO_RESOURCE);
+    }
+
+    if ((ep_ext->am.batch != NULL) &&
+        ((ep_ext->am.batch->length + msg_length) > max_length)) {
+        ucp_am_batch_flush(ep);
+    }
+
+    req = ucp_request_get_param(worker, param,
+                                {return UCS_STATUS_PTR(UCS_ERR_NO_MEMORY);});
+
+    batch = ep_ext->am.batch;
+    if (batch == NULL) {
+        batch = ucs_mpool_get_inline(&worker->am.batch_mp);
+        if (ucs_unlikely(batch == NULL)) {
+            ucp_request_put_param(param, req);
+            return UCS_STATUS_PTR(UCS_ERR_NO_RESOURCE);
+        }
+
+        ucs_queue_head_init(&batch->reqs);
+        batch->length    = 0;
+        ep_ext->am.batch = batch;
+        ucs_callbackq_add_oneshot(&worker->uct->progress_q, ep,
+                                  ucp_am_batch_progress_cb, ep);
+    }
+
+    batch_hdr                = UCS_PTR_BYTE_OFFSET(batch + 1, batch->length);
+    batch_hdr->am_id         = id;
+    batch_hdr->header_length = header_length;
+    batch_hdr->length        = length;
+    memcpy(batch_hdr + 1, buffer, length);
+    memcpy(UCS_PTR_BYTE_OFFSET(batch_hdr + 1, length), header, header_length);
+    batch->length += msg_length;
+
+    req->flags   = 0;
+    req->send.ep = ep;
+    ucp_request_set_send_callback_param(param, req, send);
+    ucs_queue_push(&batch->reqs, &req->send.am_batch.queue);
+    return req + 1;
+}
+
 static ucs_status_t ucp_am_contig_short(uct_pending_req_t *self)
 {
     ucp_request_t *req = ucs_container_of(self, ucp_request_t, send.uct);
@@ -926,11 +1188,10 @@ ucp_am_send_nbx_check_header_length(ucp_worker_h worker, size_t header_length)
     return UCS_OK;
 }
 
-UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_am_send_nbx,
-                 (ep, id, header, header_length, buffer, count, param),
-                 ucp_ep_h ep, unsigned id, const void *header,
-                 size_t header_length, const void *buffer, size_t count,
-                 const ucp_request_param_t *param)
+static UCS_F_ALWAYS_INLINE ucs_status_ptr_t
+ucp_am_send_nbx_common(ucp_ep_h ep, unsigned id, const void *header,
+                       size_t header_length, const void *buffer, size_t count,
+                       const ucp_request_param_t *param, int thread_multi)
 {
     ucp_worker_h worker = ep->worker;
     ucs_status_t status;
@@ -948,7 +1209,7 @@ UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_am_send_nbx,
                                     return UCS_STATUS_PTR(UCS_ERR_INVALID_PARAM));
     UCP_REQUEST_CHECK_PARAM(param);
 
-    UCP_WORKER_THREAD_CS_ENTER_CONDITIONAL(worker);
+    UCP_WORKER_THREAD_CS_ENTER_MODE(worker, thread_multi);
 
     status = ucp_am_send_nbx_check_header_length(worker, header_length);
     if (status != UCS_OK) {
@@ -960,6 +1221,14 @@ UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_am_send_nbx,
     attr_mask = param->op_attr_mask &
                 (UCP_OP_ATTR_FIELD_DATATYPE | UCP_OP_ATTR_FLAG_NO_IMM_CMPL);
 
+    if (ucs_unlikely(worker->context->config.ext.am_aggregate_thresh != 0)) {
+        ret = ucp_am_batch_add(ep, id, flags, header, header_length, buffer,
+                               count, attr_mask, param);
+        if (UCS_PTR_STATUS(ret) != UCS_ERR_NO_RESOURCE) {
+            goto out;
+        }
+    }
+
     if (flags & UCP_AM_SEND_FLAG_REPLY) {
         max_short = &ucp_ep_config(ep)->am_u.max_reply_eager_short;
         proto     = ucp_ep_config(ep)->am_u.reply_proto;
@@ -1038,10 +1307,21 @@ UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_am_send_nbx,
     }
 
 out:
-    UCP_WORKER_THREAD_CS_EXIT_CONDITIONAL(worker);
+    UCP_WORKER_THREAD_CS_EXIT_MODE(worker, thread_multi);
     return ret;
 }
 
+UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_am_send_nbx,
+                 (ep, id, header, header_length, buffer, count, param),
+                 ucp_ep_h ep, unsigned id, const void *header,
+                 size_t header_length, const void *buffer, size_t count,
+                 const ucp_request_param_t *param)
+{
+    return UCP_WORKER_THREAD_MODE_DISPATCH(ep->worker, ucp_am_send_nbx_common,
+                                           ep, id, header, header_length,
+                                           buffer, count, param);
+}
+
 ucs_status_ptr_t ucp_am_send_nb(ucp_ep_h ep, uint16_t id, const void *payload,
                                 size_t count, ucp_datatype_t datatype,
                                 ucp_send_callback_t cb, unsigned flags)
@@ -1220,24 +1500,17 @@ ucp_am_invoke_cb(ucp_worker_h worker, uint16_t am_id, void *user_hdr,
     return am_cb->cb_old(am_cb->context, data, data_length, reply_ep, flags);
 }
 
-static UCS_F_ALWAYS_INLINE ucs_status_t ucp_am_handler_common(
-        ucp_worker_h worker, ucp_am_hdr_t *am_hdr, size_t total_length,
-        ucp_ep_h reply_ep, unsigned am_flags, uint64_t recv_flags,
-        const char *name)
+static UCS_F_ALWAYS_INLINE ucs_status_t
+ucp_am_handler_invoke(ucp_worker_h worker, uint16_t am_id, void *user_hdr,
+                      uint32_t user_hdr_size, void *data, size_t data_length,
+                      ucp_ep_h reply_ep, unsigned am_flags, uint64_t recv_flags,
+                      const char *name)
 {
-    ucp_recv_desc_t *desc    = NULL;
-    uint16_t am_id           = am_hdr->am_id;
-    uint32_t user_hdr_size   = am_hdr->header_length;
     ucp_am_entry_t *am_cb    = &ucs_array_elem(&worker->am.cbs, am_id);
-    void *data               = am_hdr + 1;
-    size_t data_length       = total_length -
-                               (sizeof(*am_hdr) + am_hdr->header_length);
-    void *user_hdr           = UCS_PTR_BYTE_OFFSET(data, data_length);
+    ucp_recv_desc_t *desc    = NULL;
     ucs_status_t desc_status = UCS_OK;
     ucs_status_t status;
 
-    ucs_assert(total_length >= am_hdr->header_length + sizeof(*am_hdr));
-
     /* Initialize desc in advance, so the user could invoke ucp_am_recv_data_nbx
      * from the AM callback directly. The only exception is inline data when
      * AM callback is registered without UCP_AM_FLAG_PERSISTENT_DATA flag.
@@ -1260,7 +1533,7 @@ static UCS_F_ALWAYS_INLINE ucs_status_t ucp_am_handler_common(
          */
         desc_status = ucp_recv_desc_init(worker, data, data_length, 0, am_flags,
                                          0, UCP_RECV_DESC_FLAG_AM_CB_INPROGRESS,
-                                         -(int)sizeof(*am_hdr),
+                                         -(int)sizeof(ucp_am_hdr_t),
                                          worker->am.alignment, name, &desc);
         if (ucs_unlikely(UCS_STATUS_IS_ERR(desc_status))) {
             ucs_error("worker %p could not allocate descriptor for active"
@@ -1296,6 +1569,23 @@ static UCS_F_ALWAYS_INLINE ucs_status_t ucp_am_handler_common(
     return UCS_OK;
 }
 
+static UCS_F_ALWAYS_INLINE ucs_status_t ucp_am_handler_common(
+        ucp_worker_h worker, ucp_am_hdr_t *am_hdr, size_t total_length,
+        ucp_ep_h reply_ep, unsigned am_flags, uint64_t recv_flags,
+        const char *name)
+{
+    void *data         = am_hdr + 1;
+    size_t data_length = total_length -
+                         (sizeof(*am_hdr) + am_hdr->header_length);
+
+    ucs_assert(total_length >= am_hdr->header_length + sizeof(*am_hdr));
+
+    return ucp_am_handler_invoke(worker, am_hdr->am_id,
+                                 UCS_PTR_BYTE_OFFSET(data, data_length),
+                                 am_hdr->header_length, data, data_length,
+                                 reply_ep, am_flags, recv_flags, name);
+}
+
 UCS_PROFILE_FUNC(ucs_status_t, ucp_am_handler_reply,
                  (am_arg, am_data, am_length, am_flags),
                  void *am_arg, void *am_data, size_t am_length,
@@ -1327,6 +1617,42 @@ UCS_PROFILE_FUNC(ucs_status_t, ucp_am_handler,
                                  "am_handler");
 }
 
+UCS_PROFILE_FUNC(ucs_status_t, ucp_am_batch_handler,
+                 (am_arg, am_data, am_length, am_flags),
+                 void *am_arg, void *am_data, size_t am_length,
+                 unsigned am_flags)
+{
+    ucp_worker_h worker           = am_arg;
+    ucp_am_batch_hdr_t *batch_hdr = am_data;
+    size_t remaining              = am_length;
+    size_t msg_length;
+    void *data;
+
+    /* The coalesced messages share one UCT descriptor, so they are passed to
+     * the user as inline data, which is copied if the user wants to keep it */
+    while (remaining > 0) {
+        if ((remaining < sizeof(*batch_hdr)) ||
+            ((msg_length = sizeof(*batch_hdr) + batch_hdr->header_length +
+                           batch_hdr->length) > remaining)) {
+            ucs_error("worker %p: dropping invalid coalesced active message "
+                      "at offset %zu of %zu bytes", worker,
+                      am_length - remaining, am_length);
+            break;
+        }
+
+        data = batch_hdr + 1;
+        ucp_am_handler_invoke(worker, batch_hdr->am_id,
+                              UCS_PTR_BYTE_OFFSET(data, batch_hdr->length),
+                              batch_hdr->header_length, data,
+                              batch_hdr->length, NULL, 0, 0ul,
+                              "am_batch_handler");
+        batch_hdr  = UCS_PTR_BYTE_OFFSET(batch_hdr, msg_length);
+        remaining -= msg_length;
+    }
+
+    return UCS_OK;
+}
+
 static UCS_F_ALWAYS_INLINE ucp_recv_desc_t *
 ucp_am_find_first_rdesc(ucp_worker_h worker, ucp_ep_ext_t *ep_ext,
                         uint64_t msg_id)
@@ -1708,6 +2034,8 @@ UCP_DEFINE_AM_WITH_PROXY(UCP_FEATURE_AM, UCP_AM_ID_AM_MIDDLE,
                          ucp_am_long_middle_handler, NULL, 0);
 UCP_DEFINE_AM_WITH_PROXY(UCP_FEATURE_AM, UCP_AM_ID_AM_SINGLE_REPLY,
                          ucp_am_handler_reply, NULL, 0);
+UCP_DEFINE_AM_WITH_PROXY(UCP_FEATURE_AM, UCP_AM_ID_AM_BATCH,
+                         ucp_am_batch_handler, NULL, 0);
 
 const ucp_request_send_proto_t ucp_am_proto = {
     .contig_short           = ucp_am_contig_short,
@@ -10,6 +10,8 @@
 
 
 #include <ucs/datastruct/array.h>
+#include <ucs/datastruct/mpool.h>
+#include <ucs/datastruct/queue_types.h>
 #include <ucp/rndv/rndv.h>
 
 
@@ -45,6 +47,11 @@ typedef struct ucp_am_entry {
 typedef struct ucp_am_info {
     size_t                                alignment;
     ucs_array_s(unsigned, ucp_am_entry_t) cbs;
+    size_t                                batch_max_length; /* Maximal length
+                                                               of coalesced
+                                                               messages */
+    ucs_mpool_t                           batch_mp; /* Buffers of coalesced
+                                                       messages */
 } ucp_am_info_t;
 
 
@@ -73,6 +80,11 @@ typedef struct ucp_am_info {
  *  +------------------+---------+------------------+
  *  | ucp_am_mid_hdr_t | payload | ucp_am_mid_ftr_t |
  *  +------------------+---------+------------------+
+ *
+ * Coalesced single fragment messages:
+ *  +--------------------+---------+----------+--------------------+-----
+ *  | ucp_am_batch_hdr_t | payload | user hdr | ucp_am_batch_hdr_t | ...
+ *  +--------------------+---------+----------+--------------------+-----
  */
 
 
@@ -93,6 +105,24 @@ typedef struct {
 } UCS_S_PACKED ucp_am_mid_hdr_t;
 
 
+typedef struct {
+    uint16_t                 am_id;         /* index into callback array */
+    uint16_t                 header_length; /* user header length */
+    uint16_t                 length;        /* payload length */
+} UCS_S_PACKED ucp_am_batch_hdr_t;
+
+
+/* Maximal length of coalesced messages, limited by ucp_am_batch_hdr_t */
+#define UCP_AM_BATCH_MAX_LENGTH UINT16_MAX
+
+
+struct ucp_am_batch {
+    ucs_queue_head_t         reqs;   /* Requests of the coalesced messages */
+    size_t                   length; /* Length of the coalesced messages */
+    /* coalesced messages follow */
+};
+
+
 typedef struct {
     uint64_t                 ep_id; /* ep which can be used for reply */
 } UCS_S_PACKED ucp_am_reply_ftr_t;
@@ -132,6 +162,14 @@ void ucp_am_ep_init(ucp_ep_h ep);
 
 void ucp_am_ep_cleanup(ucp_ep_h ep);
 
+void ucp_am_batch_flush(ucp_ep_h ep);
+
+void ucp_am_batch_flush_worker(ucp_worker_h worker);
+
+ucs_status_t ucp_am_batch_progress(uct_pending_req_t *self);
+
+void ucp_am_batch_request_complete(ucp_request_t *req, ucs_status_t status);
+
 ucs_status_t ucp_proto_progress_am_rndv_rts(uct_pending_req_t *self);
 
 ucs_status_t ucp_am_rndv_process_rts(void *arg, void *data, size_t length,
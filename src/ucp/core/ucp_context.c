@@ -12,6 +12,7 @@
 
 #include "ucp_context.h"
 #include "ucp_request.h"
+#include "ucp_rsc_cache.h"
 
 #include <ucs/config/parser.h>
 #include <ucs/algorithm/crc.h>
@@ -55,7 +56,8 @@
     _macro(UCP_AM_ID_AM_SINGLE) \
     _macro(UCP_AM_ID_AM_FIRST) \
     _macro(UCP_AM_ID_AM_MIDDLE) \
-    _macro(UCP_AM_ID_AM_SINGLE_REPLY)
+    _macro(UCP_AM_ID_AM_SINGLE_REPLY) \
+    _macro(UCP_AM_ID_AM_BATCH)
 
 #define UCP_AM_HANDLER_DECL(_id) extern ucp_am_handler_t ucp_am_handler_##_id;
 
@@ -259,6 +261,20 @@ static ucs_config_field_t ucp_context_config_table[] = {
    "Threshold for switching from buffer copy to zero copy protocol",
    ucs_offsetof(ucp_context_config_t, zcopy_thresh), UCS_CONFIG_TYPE_MEMUNITS},
 
+  {"AM_AGGREGATE_THRESH", "0",
+   "Maximal total size of small active messages to the same endpoint which are\n"
+   "coalesced into a single network message. A message is coalesced only if it\n"
+   "is sent as a contiguous host buffer without a reply endpoint or rendezvous\n"
+   "flag. The coalesced messages are sent when the threshold is reached, from\n"
+   "ucp_worker_progress(), and before flushing the endpoint or the worker or\n"
+   "sending an active message which could not be coalesced. Coalesced messages\n"
+   "are delivered to the receive callback without UCP_AM_RECV_ATTR_FLAG_DATA.\n"
+   "The send request of a coalesced message is completed when the coalesced\n"
+   "network message is sent. The threshold is limited to 64KB, and 0 disables\n"
+   "coalescing.",
+   ucs_offsetof(ucp_context_config_t, am_aggregate_thresh),
+   UCS_CONFIG_TYPE_MEMUNITS},
+
   {"BCOPY_BW", "auto",
    "Estimation of buffer copy bandwidth",
    ucs_offsetof(ucp_context_config_t, bcopy_bw), UCS_CONFIG_TYPE_BW},
@@ -408,6 +424,14 @@ static ucs_config_field_t ucp_context_config_table[] = {
    ucs_offsetof(ucp_context_config_t, keepalive_interval),
    UCS_CONFIG_TYPE_TIME_UNITS},
 
+  {"WAKEUP_SPIN_TIME", "0s",
+   "Maximal time to progress the worker in ucp_worker_wait() before arming it\n"
+   "and waiting for events. The actual time is adjusted according to the\n"
+   "observed time between events, so a worker which gets events frequently\n"
+   "avoids the arm and wakeup overhead, while an idle worker goes to sleep\n"
+   "immediately. 0 disables spinning.",
+   ucs_offsetof(ucp_context_config_t, wakeup_spin_time), UCS_CONFIG_TYPE_TIME},
+
   {"KEEPALIVE_NUM_EPS", "128",
    "Maximal number of endpoints to check on every keepalive round\n"
    "(inf - check all endpoints on every round, must be greater than 0)",
@@ -470,6 +494,61 @@ static ucs_config_field_t ucp_context_config_table[] = {
    "directory.",
    ucs_offsetof(ucp_context_config_t, proto_info_dir), UCS_CONFIG_TYPE_STRING},
 
+  {"RESOURCE_CACHE_DIR", "",
+   "If non-empty, cache the transport resources discovered on this host in a\n"
+   "file in this directory, and use it to speed up the initialization of the\n"
+   "next UCP contexts. The cache is per-user, and is automatically invalidated\n"
+   "when the host is rebooted, or UCX version or configuration is changed.\n"
+   "It should not be used if devices or ports can change while the host is up.",
+   ucs_offsetof(ucp_context_config_t, rsc_cache_dir), UCS_CONFIG_TYPE_STRING},
+
+  {"PROTO_SELECT_CACHE_DIR", "",
+   "If non-empty, save the protocols selected by each worker to a file in this\n"
+   "directory, and initialize only these protocols in the next workers with the\n"
+   "same configuration, instead of evaluating all of them. The cache is per-user,\n"
+   "and is automatically invalidated when the host is rebooted, or UCX version,\n"
+   "configuration, or transport resources are changed.",
+   ucs_offsetof(ucp_context_config_t, proto_select_cache_dir),
+   UCS_CONFIG_TYPE_STRING},
+
+  {"PROTO_TUNE", "n",
+   "Tune the thresholds between protocols at runtime, according to the measured\n"
+   "completion times of send requests. Messages close to a threshold are sent\n"
+   "using either of the adjacent protocols, and the threshold is moved towards\n"
+   "the protocol which was slower. The learned thresholds are shown by the\n"
+   "\"proto_tune\" VFS file of the worker. Requires UCX to be configured with\n"
+   "--enable-proto-tune.",
+   ucs_offsetof(ucp_context_config_t, proto_tune), UCS_CONFIG_TYPE_BOOL},
+
+  {"PROTO_TUNE_RANGE", "4",
+   "Maximal factor by which a tuned protocol threshold can differ from the\n"
+   "threshold selected by the performance estimation.",
+   ucs_offsetof(ucp_context_config_t, proto_tune_range), UCS_CONFIG_TYPE_UINT},
+
+  {"PROTO_TUNE_SAMPLES", "128",
+   "Minimal number of completed requests of each protocol around a threshold\n"
+   "before their performance is compared.",
+   ucs_offsetof(ucp_context_config_t, proto_tune_samples),
+   UCS_CONFIG_TYPE_UINT},
+
+  {"WORKER_MEMORY_BUDGET", "inf",
+   "Maximal total size of the memory pool chunks held by a worker, including\n"
+   "the memory pools of its transport interfaces. When a memory pool cannot\n"
+   "grow because of this limit, the allocation fails and the unused chunks of\n"
+   "all the worker memory pools are released on the next worker progress.\n"
+   "Setting it too low may prevent transports from being used.",
+   ucs_offsetof(ucp_context_config_t, worker_mem_budget),
+   UCS_CONFIG_TYPE_MEMUNITS},
+
+  {"WORKER_MEMORY_IDLE_TIME", "inf",
+   "Release the memory pool chunks of a worker which were not used for this\n"
+   "time. The memory pools are sampled a few times during this period, and a\n"
+   "memory pool which grew during it keeps its chunks, to avoid releasing\n"
+   "memory which would be allocated again. Chunks are released during worker\n"
+   "progress. \"inf\" disables releasing idle chunks.",
+   ucs_offsetof(ucp_context_config_t, worker_mem_idle_time),
+   UCS_CONFIG_TYPE_TIME_UNITS},
+
   {"REG_NONBLOCK_MEM_TYPES", "",
    "Perform only non-blocking memory registration for these memory types.\n"
    "Non-blocking registration means that the page registration may be\n"
@@ -566,6 +645,26 @@ static ucs_config_field_t ucp_config_table[] = {
    "name, or a wildcard - '*' - which is equivalent to all UCT components.",
    ucs_offsetof(ucp_config_t, alloc_prio), UCS_CONFIG_TYPE_STRING_ARRAY},
 
+  {"PROTO_WARMUP", "",
+   "Comma-separated list of operations to select protocols for when a new\n"
+   "endpoint or remote key configuration is created, instead of when the\n"
+   "operation is first sent. Each item is <op>[:<datatype>[:<memory type>]],\n"
+   "where <op> is one of tag_send, tag_send_sync, am_send, am_send_reply, put,\n"
+   "get; <datatype> is contiguous (default), iov (with a single entry) or\n"
+   "generic; and <memory type> is host (default) or another memory type.\n"
+   "For example: tag_send,tag_send:iov,put:contiguous:cuda",
+   ucs_offsetof(ucp_config_t, proto_warmup), UCS_CONFIG_TYPE_STRING_ARRAY},
+
+  {"PROTO_TUNE_THRESH", "",
+   "Comma-separated list of thresholds between pairs of protocols, which replace\n"
+   "the thresholds selected by the performance estimation, for example as\n"
+   "learned by UCX_PROTO_TUNE=y in a previous run. Each item is\n"
+   "<op>:<memory type>:<lower protocol>:<upper protocol>:<size>, where <size> is\n"
+   "the first message length to send with the upper protocol. The threshold is\n"
+   "limited by UCX_PROTO_TUNE_RANGE. For example:\n"
+   "tag_send:host:egr/multi/zcopy:tag/rndv:96k",
+   ucs_offsetof(ucp_config_t, proto_tune_thresh), UCS_CONFIG_TYPE_STRING_ARRAY},
+
   {"RNDV_FRAG_SIZE", "host:512K,cuda:4M",
    "Comma-separated list of memory types and associated fragment sizes.\n"
    "The memory types in the list is used for rendezvous bounce buffers.",
@@ -1137,7 +1236,7 @@ ucp_add_tl_resources(ucp_context_h context, ucp_md_index_t md_index,
                      const ucs_string_set_t *aux_tls, unsigned *num_resources_p,
                      ucs_string_set_t avail_devices[],
                      ucs_string_set_t *avail_tls, uint64_t dev_cfg_masks[],
-                     uint64_t *tl_cfg_mask)
+                     uint64_t *tl_cfg_mask, ucp_rsc_cache_t *rsc_cache)
 {
     ucp_tl_md_t *md = &context->tl_mds[md_index];
     uct_tl_resource_desc_t *tl_resources;
@@ -1149,7 +1248,9 @@ ucp_add_tl_resources(ucp_context_h context, ucp_md_index_t md_index,
     *num_resources_p = 0;
 
     /* check what are the available uct resources */
-    status = uct_md_query_tl_resources(md->md, &tl_resources, &num_tl_resources);
+    status = ucp_rsc_cache_query_tl_resources(
+            rsc_cache, context->tl_cmpts[md->cmpt_index].attr.name, md->md,
+            md->rsc.md_name, &tl_resources, &num_tl_resources);
     if (status != UCS_OK) {
         ucs_error("Failed to query resources: %s", ucs_status_string(status));
         goto out;
@@ -1511,7 +1612,8 @@ ucp_add_component_resources(ucp_context_h context, ucp_rsc_index_t cmpt_index,
                             ucs_string_set_t *avail_tls,
                             uint64_t dev_cfg_masks[], uint64_t *tl_cfg_mask,
                             const ucp_config_t *config,
-                            const ucs_string_set_t *aux_tls)
+                            const ucs_string_set_t *aux_tls,
+                            ucp_rsc_cache_t *rsc_cache)
 {
     const ucp_tl_cmpt_t *tl_cmpt = &context->tl_cmpts[cmpt_index];
     uct_component_attr_t uct_component_attr;
@@ -1550,7 +1652,8 @@ ucp_add_component_resources(ucp_context_h context, ucp_rsc_index_t cmpt_index,
         /* Add communication resources of each MD */
         status = ucp_add_tl_resources(context, md_index, config, aux_tls,
                                       &num_tl_resources, avail_devices,
-                                      avail_tls, dev_cfg_masks, tl_cfg_mask);
+                                      avail_tls, dev_cfg_masks, tl_cfg_mask,
+                                      rsc_cache);
         if (status != UCS_OK) {
             uct_md_close(context->tl_mds[md_index].md);
             goto out;
@@ -1692,6 +1795,7 @@ static ucs_status_t ucp_fill_resources(ucp_context_h context,
     ucs_status_t status;
     unsigned max_mds;
     ucs_string_set_t aux_tls;
+    ucp_rsc_cache_t rsc_cache;
 
     context->tl_cmpts                 = NULL;
     context->num_cmpts                = 0;
@@ -1780,14 +1884,18 @@ static ucs_status_t ucp_fill_resources(ucp_context_h context,
     }
 
     /* Collect resources of each component */
+    ucp_rsc_cache_init(&rsc_cache, config);
     for (i = 0; i < context->num_cmpts; ++i) {
         status = ucp_add_component_resources(context, i, avail_devices,
                                              &avail_tls, dev_cfg_masks,
-                                             &tl_cfg_mask, config, &aux_tls);
+                                             &tl_cfg_mask, config, &aux_tls,
+                                             &rsc_cache);
         if (status != UCS_OK) {
+            ucp_rsc_cache_cleanup(&rsc_cache, 0);
             goto err_free_resources;
         }
     }
+    ucp_rsc_cache_cleanup(&rsc_cache, 1);
 
     ucp_fill_resources_reg_md_map_update(context);
 
@@ -1923,6 +2031,193 @@ ucp_fill_rndv_frag_config(const ucp_context_config_names_t *config,
     return UCS_OK;
 }
 
+static ucs_status_t
+ucp_fill_proto_warmup_config(ucp_context_h context,
+                             const ucp_context_config_names_t *config)
+{
+    static const ucp_operation_id_t op_ids[] = {
+        UCP_OP_ID_TAG_SEND, UCP_OP_ID_TAG_SEND_SYNC, UCP_OP_ID_AM_SEND,
+        UCP_OP_ID_AM_SEND_REPLY, UCP_OP_ID_PUT, UCP_OP_ID_GET
+    };
+    static const ucp_dt_class_t dt_classes[] = {
+        UCP_DATATYPE_CONTIG, UCP_DATATYPE_IOV, UCP_DATATYPE_GENERIC
+    };
+    const char *op_name, *dt_name, *mem_type_name;
+    char config_str[128];
+    ssize_t mem_type;
+    unsigned i, j;
+
+    context->config.proto_warmup.count = 0;
+    context->config.proto_warmup.elems = NULL;
+    if (config->count == 0) {
+        return UCS_OK;
+    }
+
+    context->config.proto_warmup.elems =
+            ucs_calloc(config->count,
+                       sizeof(*context->config.proto_warmup.elems),
+                       "ucp_proto_warmup");
+    if (context->config.proto_warmup.elems == NULL) {
+        return UCS_ERR_NO_MEMORY;
+    }
+
+    for (i = 0; i < config->count; ++i) {
+        ucs_strncpy_safe(config_str, config->names[i], sizeof(config_str));
+        ucs_string_split(config_str, ":", 3, &op_name, &dt_name,
+                         &mem_type_name);
+
+        for (j = 0; j < ucs_static_array_size(op_ids); ++j) {
+            if (!strcmp(op_name, ucp_operation_names[op_ids[j]])) {
+                break;
+            }
+        }
+        if (j == ucs_static_array_size(op_ids)) {
+            ucs_error("invalid protocol warm-up operation: '%s'", op_name);
+            goto err;
+        }
+        context->config.proto_warmup.elems[i].op_id = op_ids[j];
+
+        if (dt_name == NULL) {
+            j = 0;
+        } else {
+            for (j = 0; j < ucs_static_array_size(dt_classes); ++j) {
+                if (!strcmp(dt_name, ucp_datatype_class_names[dt_classes[j]])) {
+                    break;
+                }
+            }
+            if (j == ucs_static_array_size(dt_classes)) {
+                ucs_error("invalid protocol warm-up datatype: '%s'", dt_name);
+                goto err;
+            }
+        }
+        context->config.proto_warmup.elems[i].dt_class = dt_classes[j];
+
+        if (mem_type_name == NULL) {
+            mem_type = UCS_MEMORY_TYPE_HOST;
+        } else {
+            mem_type = ucs_string_find_in_list(mem_type_name,
+                                               ucs_memory_type_names, 0);
+            if ((mem_type < 0) || (mem_type >= UCS_MEMORY_TYPE_UNKNOWN)) {
+                ucs_error("invalid protocol warm-up memory type: '%s'",
+                          mem_type_name);
+                goto err;
+            }
+        }
+        context->config.proto_warmup.elems[i].mem_type = mem_type;
+    }
+
+    context->config.proto_warmup.count = config->count;
+    return UCS_OK;
+
+err:
+    ucs_free(context->config.proto_warmup.elems);
+    context->config.proto_warmup.elems = NULL;
+    return UCS_ERR_INVALID_PARAM;
+}
+
+static ucs_status_t ucp_fill_proto_tune_thresh_proto(const char *proto_name,
+                                                     uint8_t *proto_id_p)
+{
+    ucp_proto_id_t proto_id;
+
+    for (proto_id = 0; proto_id < ucp_protocols_count(); ++proto_id) {
+        if (!strcmp(proto_name, ucp_proto_id_field(proto_id, name))) {
+            *proto_id_p = proto_id;
+            return UCS_OK;
+        }
+    }
+
+    ucs_error("invalid protocol in tuned threshold: '%s'", proto_name);
+    return UCS_ERR_INVALID_PARAM;
+}
+
+static ucs_status_t
+ucp_fill_proto_tune_thresh_config(ucp_context_h context,
+                                  const ucp_context_config_names_t *config)
+{
+    const char *op_name, *mem_type_name, *lower_name, *upper_name, *size_str;
+    char config_str[256];
+    ssize_t mem_type, op_id;
+    ucs_status_t status;
+    unsigned i;
+
+    context->config.proto_tune_thresh.count = 0;
+    context->config.proto_tune_thresh.elems = NULL;
+    if (config->count == 0) {
+        return UCS_OK;
+    }
+
+    context->config.proto_tune_thresh.elems =
+            ucs_calloc(config->count,
+                       sizeof(*context->config.proto_tune_thresh.elems),
+                       "ucp_proto_tune_thresh");
+    if (context->config.proto_tune_thresh.elems == NULL) {
+        return UCS_ERR_NO_MEMORY;
+    }
+
+    for (i = 0; i < config->count; ++i) {
+        ucs_strncpy_safe(config_str, config->names[i], sizeof(config_str));
+        ucs_string_split(config_str, ":", 5, &op_name, &mem_type_name,
+                         &lower_name, &upper_name, &size_str);
+        if (size_str == NULL) {
+            ucs_error("invalid tuned threshold: '%s'", config->names[i]);
+            status = UCS_ERR_INVALID_PARAM;
+            goto err;
+        }
+
+        op_id = ucs_string_find_in_list(op_name, ucp_operation_names, 0);
+        if (op_id < 0) {
+            ucs_error("invalid operation in tuned threshold: '%s'", op_name);
+            status = UCS_ERR_INVALID_PARAM;
+            goto err;
+        }
+        context->config.proto_tune_thresh.elems[i].op_id = op_id;
+
+        mem_type = ucs_string_find_in_list(mem_type_name,
+                                           ucs_memory_type_names, 0);
+        if ((mem_type < 0) || (mem_type >= UCS_MEMORY_TYPE_LAST)) {
+            ucs_error("invalid memory type in tuned threshold: '%s'",
+                      mem_type_name);
+            status = UCS_ERR_INVALID_PARAM;
+            goto err;
+        }
+        context->config.proto_tune_thresh.elems[i].mem_type = mem_type;
+
+        status = ucp_fill_proto_tune_thresh_proto(
+                lower_name,
+                &context->config.proto_tune_thresh.elems[i].lower_proto);
+        if (status != UCS_OK) {
+            goto err;
+        }
+
+        status = ucp_fill_proto_tune_thresh_proto(
+                upper_name,
+                &context->config.proto_tune_thresh.elems[i].upper_proto);
+        if (status != UCS_OK) {
+            goto err;
+        }
+
+        status = ucs_str_to_memunits(
+                size_str, &context->config.proto_tune_thresh.elems[i].thresh);
+        if ((status != UCS_OK) ||
+            (context->config.proto_tune_thresh.elems[i].thresh == 0) ||
+            (context->config.proto_tune_thresh.elems[i].thresh ==
+             UCS_MEMUNITS_INF)) {
+            ucs_error("invalid size in tuned threshold: '%s'", size_str);
+            status = UCS_ERR_INVALID_PARAM;
+            goto err;
+        }
+    }
+
+    context->config.proto_tune_thresh.count = config->count;
+    return UCS_OK;
+
+err:
+    ucs_free(context->config.proto_tune_thresh.elems);
+    context->config.proto_tune_thresh.elems = NULL;
+    return status;
+}
+
 static double ucp_context_get_memcpy_bw()
 {
     return ucp_context_est_bcopy_bw[ucs_arch_get_cpu_vendor()];
@@ -1963,8 +2258,10 @@ static ucs_status_t ucp_fill_config(ucp_context_h context,
     ucs_debug("estimated number of endpoints per node is %d",
               context->config.est_num_ppn);
 
-    if (UCS_CONFIG_DBL_IS_AUTO(context->config.ext.bcopy_bw)) {
-        /* bcopy_bw wasn't set via the env variable. Calculate the value */
+    if (UCS_CONFIG_DBL_IS_AUTO(context->config.ext.bcopy_bw) &&
+        (ucs_topo_get_memcpy_bw(&context->config.ext.bcopy_bw) != UCS_OK)) {
+        /* bcopy_bw wasn't set via the env variable, and was not measured by
+         * the topology provider. Calculate the value */
         if (context->config.ext.proto_enable) {
             context->config.ext.bcopy_bw = ucs_cpu_get_memcpy_bw();
         } else {
@@ -1973,6 +2270,14 @@ static ucs_status_t ucp_fill_config(ucp_context_h context,
     }
     ucs_debug("estimated bcopy bandwidth is %f", context->config.ext.bcopy_bw);
 
+#if !ENABLE_PROTO_TUNE
+    if (context->config.ext.proto_tune) {
+        ucs_warn("UCX_PROTO_TUNE is ignored, since UCX was configured without "
+                 "--enable-proto-tune");
+        context->config.ext.proto_tune = 0;
+    }
+#endif
+
     if (config->protos.mode == UCS_CONFIG_ALLOW_LIST_ALLOW_ALL) {
         context->proto_bitmap = UCS_MASK(ucp_protocols_count());
     } else {
@@ -2118,6 +2423,17 @@ static ucs_status_t ucp_fill_config(ucp_context_h context,
     memcpy(context->config.am_mpools.sizes, config->mpool_sizes.memunits,
            config->mpool_sizes.count * sizeof(size_t));
 
+    status = ucp_fill_proto_warmup_config(context, &config->proto_warmup);
+    if (status != UCS_OK) {
+        goto err_free_am_mpools;
+    }
+
+    status = ucp_fill_proto_tune_thresh_config(context,
+                                               &config->proto_tune_thresh);
+    if (status != UCS_OK) {
+        goto err_free_proto_warmup;
+    }
+
     context->config.worker_strong_fence =
             (context->config.ext.fence_mode == UCP_FENCE_MODE_STRONG) ||
             ((context->config.ext.fence_mode == UCP_FENCE_MODE_AUTO) &&
@@ -2126,6 +2442,10 @@ static ucs_status_t ucp_fill_config(ucp_context_h context,
 
     return UCS_OK;
 
+err_free_proto_warmup:
+    ucs_free(context->config.proto_warmup.elems);
+err_free_am_mpools:
+    ucs_free(context->config.am_mpools.sizes);
 err_free_key_list:
     ucp_cached_key_list_release(&context->cached_key_list);
 err_free_alloc_methods:
@@ -2141,6 +2461,8 @@ err:
 
 static void ucp_free_config(ucp_context_h context)
 {
+    ucs_free(context->config.proto_tune_thresh.elems);
+    ucs_free(context->config.proto_warmup.elems);
     ucs_free(context->config.am_mpools.sizes);
     ucp_cached_key_list_release(&context->cached_key_list);
     ucs_free(context->config.alloc_methods);
@@ -2337,6 +2659,31 @@ void ucp_context_uct_atomic_iface_flags(ucp_context_h context,
     }
 }
 
+uint32_t ucp_context_config_checksum(ucp_context_h context)
+{
+    uint32_t checksum;
+    size_t size;
+    FILE *stream;
+    char *buf;
+
+    /* Covers values set by the environment, configuration files and
+     * ucp_config_modify() */
+    stream = open_memstream(&buf, &size);
+    if (stream == NULL) {
+        return 0;
+    }
+
+    ucs_config_parser_print_opts(stream, "", &context->config.ext,
+                                 ucp_context_config_table, NULL,
+                                 UCS_DEFAULT_ENV_PREFIX,
+                                 UCS_CONFIG_PRINT_CONFIG);
+    fclose(stream);
+
+    checksum = ucs_crc32(0, buf, size);
+    free(buf);
+    return checksum;
+}
+
 ucs_status_t ucp_lib_query(ucp_lib_attr_t *attr)
 {
     if (attr->field_mask & UCP_LIB_ATTR_FIELD_MAX_THREAD_LEVEL) {
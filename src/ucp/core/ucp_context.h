@@ -66,6 +66,8 @@ typedef struct ucp_context_config {
     double                                 multi_path_ratio;
     /** Threshold for switching UCP to zero copy protocol */
     size_t                                 zcopy_thresh;
+    /** Maximal size of coalesced small active messages, 0 - disabled */
+    size_t                                 am_aggregate_thresh;
     /** Communication scheme in RNDV protocol */
     ucp_rndv_mode_t                        rndv_mode;
     /** RKEY PTR segment size */
@@ -134,6 +136,9 @@ typedef struct ucp_context_config {
     int                                    proto_request_reset;
     /** Time period between keepalive rounds */
     ucs_time_t                             keepalive_interval;
+    /** Maximal time to progress the worker in ucp_worker_wait() before
+     *  arming it and going to sleep */
+    double                                 wakeup_spin_time;
     /** Maximal number of endpoints to check on every keepalive round
      * (0 - disabled, inf - check all endpoints on every round) */
     unsigned                               keepalive_num_eps;
@@ -163,6 +168,20 @@ typedef struct ucp_context_config {
     char                                   *select_distance_md;
     /** Directory to write protocol selection information */
     char                                   *proto_info_dir;
+    /** Directory of the resource discovery cache */
+    char                                   *rsc_cache_dir;
+    /** Directory of the protocol selection cache */
+    char                                   *proto_select_cache_dir;
+    /** Tune protocol thresholds by measured request completion times */
+    int                                    proto_tune;
+    /** Maximal factor between tuned and estimated protocol thresholds */
+    unsigned                               proto_tune_range;
+    /** Number of requests of each protocol to compare before tuning */
+    unsigned                               proto_tune_samples;
+    /** Maximal size of memory pool chunks held by a worker */
+    size_t                                 worker_mem_budget;
+    /** Time after which unused memory pool chunks of a worker are released */
+    ucs_time_t                             worker_mem_idle_time;
     /** Memory types that perform non-blocking registration by default */
     uint64_t                               reg_nb_mem_types;
     /** Prefer native RMA transports for RMA/AMO protocols */
@@ -193,6 +212,10 @@ struct ucp_config {
     ucs_config_allow_list_t                protos;
     /** Array of memory allocation methods */
     UCS_CONFIG_STRING_ARRAY_FIELD(methods) alloc_prio;
+    /** Array of operations to select protocols for in advance */
+    ucp_context_config_names_t             proto_warmup;
+    /** Array of initial tuned protocol thresholds */
+    ucp_context_config_names_t             proto_tune_thresh;
     /** Array of rendezvous fragment sizes */
     ucp_context_config_names_t             rndv_frag_sizes;
     /** Array of rendezvous fragment elems per allocation */
@@ -392,6 +415,31 @@ typedef struct ucp_context {
            unsigned               count;
            size_t                 *sizes;
         } am_mpools;
+
+        /* Operations to select protocols for when creating endpoint and
+         * remote key configurations */
+        struct {
+            unsigned              count;
+            struct {
+                uint8_t           op_id;    /* ucp_operation_id_t */
+                uint8_t           dt_class; /* ucp_dt_class_t */
+                uint8_t           mem_type; /* ucs_memory_type_t */
+            } *elems;
+        } proto_warmup;
+
+        /* Initial thresholds between pairs of protocols, applied when the
+         * protocols are selected for an operation */
+        struct {
+            unsigned              count;
+            struct {
+                uint8_t           op_id;       /* ucp_operation_id_t */
+                uint8_t           mem_type;    /* ucs_memory_type_t */
+                uint8_t           lower_proto; /* ucp_proto_id_t */
+                uint8_t           upper_proto; /* ucp_proto_id_t */
+                size_t            thresh;      /* First message length of
+                                                  the upper protocol */
+            } *elems;
+        } proto_tune_thresh;
     } config;
 
     /* Configuration of multi-threading support */
@@ -551,6 +599,8 @@ void ucp_context_tag_offload_enable(ucp_context_h context);
 void ucp_context_uct_atomic_iface_flags(ucp_context_h context,
                                         ucp_tl_iface_atomic_flags_t *atomic);
 
+uint32_t ucp_context_config_checksum(ucp_context_h context);
+
 const char * ucp_find_tl_name_by_csum(ucp_context_t *context, uint16_t tl_name_csum);
 
 const char *ucp_tl_bitmap_str(ucp_context_h context,
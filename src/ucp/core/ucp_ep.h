@@ -532,6 +532,8 @@ typedef struct ucp_ep_ext {
         ucs_list_link_t           started_ams;
         ucs_queue_head_t          mid_rdesc_q;    /* Queue of middle fragments, which
                                                      arrived before the first one */
+        ucp_am_batch_t            *batch;         /* Coalesced small messages,
+                                                     or NULL */
     } am;
 
     /**
@@ -234,22 +234,47 @@ static int ucp_is_md_selected_by_config(ucp_context_h context,
            !strncmp(cfg_cmpt_name, cmpt_name, UCT_COMPONENT_NAME_MAX);
 }
 
+static int ucp_mem_mpool_has_allowed_method(ucp_context_h context)
+{
+    unsigned method_index;
+
+    for (method_index = 0; method_index < context->config.num_alloc_methods;
+         ++method_index) {
+        if (uct_mem_mpool_alloc_method_allowed(
+                    context->config.alloc_methods[method_index].method)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 static ucs_status_t
 ucp_mem_do_alloc(ucp_context_h context, void *address, size_t length,
                  unsigned uct_flags, ucs_memory_type_t mem_type,
-                 const char *name, uct_allocated_memory_t *mem)
+                 int mpool_chunk, const char *name,
+                 uct_allocated_memory_t *mem)
 {
     uct_alloc_method_t method;
     uct_mem_alloc_params_t params;
     unsigned method_index, md_index, num_mds;
     ucs_status_t status;
     uct_md_h mds[UCP_MAX_MDS];
+    int filter_methods;
+
+    /* Memory pool chunks use only the allowed huge pages, unless the
+     * configuration does not leave any other method */
+    filter_methods = mpool_chunk && ucp_mem_mpool_has_allowed_method(context);
 
     for (method_index = 0; method_index < context->config.num_alloc_methods;
                     ++method_index)
     {
         method = context->config.alloc_methods[method_index].method;
 
+        if (filter_methods && !uct_mem_mpool_alloc_method_allowed(method)) {
+            continue;
+        }
+
         /* If we are trying MD method, gather all MDs which match the component
          * name specified in the configuration.
          */
@@ -890,7 +915,7 @@ err_free_memh:
 
 static ucs_status_t
 ucp_memh_alloc(ucp_context_h context, void *address, size_t length,
-               ucs_memory_type_t mem_type, unsigned uct_flags,
+               ucs_memory_type_t mem_type, unsigned uct_flags, int mpool_chunk,
                const char *alloc_name, ucp_mem_h *memh_p)
 {
     uct_allocated_memory_t mem;
@@ -898,7 +923,7 @@ ucp_memh_alloc(ucp_context_h context, void *address, size_t length,
     ucp_mem_h memh;
 
     status = ucp_mem_do_alloc(context, address, length, uct_flags, mem_type,
-                              alloc_name, &mem);
+                              mpool_chunk, alloc_name, &mem);
     if (status != UCS_OK) {
         goto out;
     }
@@ -1027,7 +1052,7 @@ ucs_status_t ucp_mem_map(ucp_context_h context, const ucp_mem_map_params_t *para
         status = ucp_memh_import(context, exported_memh_buffer, &memh);
     } else if (flags & UCP_MEM_MAP_ALLOCATE) {
         status = ucp_memh_alloc(context, address, length, mem_type, uct_flags,
-                                alloc_name, &memh);
+                                0, alloc_name, &memh);
     } else {
         status = ucp_memh_create(context, address, length, mem_type,
                                  UCT_ALLOC_METHOD_LAST, 0, uct_flags, &memh);
@@ -1239,7 +1264,8 @@ ucp_mpool_malloc(ucp_worker_h worker, ucs_mpool_t *mp, size_t *size_p, void **ch
 
     status = ucp_memh_alloc(worker->context, NULL,
                             *size_p + sizeof(*chunk_hdr), UCS_MEMORY_TYPE_HOST,
-                            UCT_MD_MEM_ACCESS_RMA, ucs_mpool_name(mp), &memh);
+                            UCT_MD_MEM_ACCESS_RMA, 1, ucs_mpool_name(mp),
+                            &memh);
     if (status != UCS_OK) {
         goto out;
     }
@@ -1290,7 +1316,7 @@ ucp_rndv_frag_malloc_mpools(ucs_mpool_t *mp, size_t *size_p, void **chunk_p)
 
     /* payload; need to get default flags from ucp_mem_map_params2uct_flags() */
     status = ucp_memh_alloc(context, NULL, frag_size * num_elems, mem_type,
-                            UCT_MD_MEM_ACCESS_RMA | UCT_MD_MEM_FLAG_LOCK,
+                            UCT_MD_MEM_ACCESS_RMA | UCT_MD_MEM_FLAG_LOCK, 1,
                             ucs_mpool_name(mp), &chunk_hdr->memh);
     if (status != UCS_OK) {
         return status;
@@ -1603,7 +1629,7 @@ ucp_mm_get_alloc_md_index(ucp_context_h context, ucp_md_index_t *md_idx,
         status = ucp_mem_do_alloc(context, NULL, 1,
                                   UCT_MD_MEM_ACCESS_RMA |
                                           UCT_MD_MEM_FLAG_HIDE_ERRORS,
-                                  alloc_mem_type, "get_alloc_md_id",
+                                  alloc_mem_type, 0, "get_alloc_md_id",
                                   &mem);
         if (status != UCS_OK) {
             return status;
@@ -214,6 +214,11 @@ struct ucp_request {
                     ucp_rkey_h rkey; /* Remote memory key */
                 } rma;
 
+                struct {
+                    /* Element in the queue of coalesced AM requests */
+                    ucs_queue_elem_t queue;
+                } am_batch;
+
                 struct {
                     /* Remote request ID received from a peer */
                     ucs_ptr_map_key_t      remote_req_id;
@@ -383,6 +388,24 @@ struct ucp_request {
             ucp_lane_index_t      lane;            /* Lane on which this request is being sent */
             uint8_t               proto_stage;     /* Protocol current stage */
             uct_pending_req_t     uct;             /* UCT pending request */
+
+#if ENABLE_PROTO_TUNE
+            /* Measurement for online protocol tuning (UCX_PROTO_TUNE) */
+            struct {
+                struct ucp_proto_tune_bound *bound; /* Tuned threshold, or
+                                                       NULL */
+                ucs_time_t        start;       /* Protocol selection */
+            } tune;
+#endif
+
+#if ENABLE_REQ_LATENCY
+            /* Timestamps for request latency breakdown */
+            struct {
+                ucs_time_t        start;       /* Request initialization */
+                ucs_time_t        stage_start; /* Current protocol stage start */
+                ucs_time_t        wait_start;  /* Rendezvous RTS was sent */
+            } lat;
+#endif
         } send;
 
         /* "receive" part - used for tag_recv, am_recv and stream_recv operations */
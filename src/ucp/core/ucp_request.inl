@@ -13,6 +13,8 @@
 #include "ucp_mm.inl"
 
 #include <ucp/dt/dt.h>
+#include <ucp/proto/proto_latency.inl>
+#include <ucp/proto/proto_tune.inl>
 #include <ucs/profile/profile.h>
 #include <ucs/datastruct/mpool.inl>
 #include <ucs/datastruct/mpool_set.inl>
@@ -243,6 +245,13 @@ ucp_request_put(ucp_request_t *req)
 static UCS_F_ALWAYS_INLINE void
 ucp_request_complete_send(ucp_request_t *req, ucs_status_t status)
 {
+#if ENABLE_REQ_LATENCY
+    ucp_proto_lat_complete_ctx_t lat_ctx;
+
+    ucp_proto_lat_request_complete_begin(req, &lat_ctx);
+#endif
+    ucp_proto_tune_request_complete(req, status);
+
     ucs_trace_req("completing send request %p (%p) " UCP_REQUEST_FLAGS_FMT
                   " %s",
                   req, req + 1, UCP_REQUEST_FLAGS_ARG(req->flags),
@@ -253,6 +262,9 @@ ucp_request_complete_send(ucp_request_t *req, ucs_status_t status)
      */
     /* coverity[offset_free] */
     ucp_request_complete(req, send.cb, status, req->user_data);
+#if ENABLE_REQ_LATENCY
+    ucp_proto_lat_request_complete_end(&lat_ctx);
+#endif
 }
 
 static UCS_F_ALWAYS_INLINE void
@@ -0,0 +1,283 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "ucp_rsc_cache.h"
+
+#include <ucs/config/parser.h>
+#include <ucs/debug/log.h>
+#include <ucs/sys/cache_file.h>
+#include <ucs/sys/ptr_arith.h>
+#include <ucs/sys/string.h>
+
+
+static const ucp_rsc_cache_md_t *
+ucp_rsc_cache_md_next(const ucp_rsc_cache_md_t *entry)
+{
+    return UCS_PTR_BYTE_OFFSET(entry + 1, entry->num_resources *
+                                          sizeof(ucp_rsc_cache_tl_t));
+}
+
+static int ucp_rsc_cache_is_valid(const ucp_rsc_cache_md_t *entries,
+                                  size_t length)
+{
+    const void *end                 = UCS_PTR_BYTE_OFFSET(entries, length);
+    const ucp_rsc_cache_md_t *entry = entries;
+    const ucp_rsc_cache_tl_t *tl;
+    unsigned i;
+
+    while (entry != end) {
+        if ((UCS_PTR_BYTE_DIFF(entry, end) < sizeof(*entry)) ||
+            (UCS_PTR_BYTE_DIFF(entry + 1, end) <
+             (entry->num_resources * sizeof(*tl)))) {
+            return 0;
+        }
+
+        tl = (const ucp_rsc_cache_tl_t*)(entry + 1);
+        for (i = 0; i < entry->num_resources; ++i) {
+            if (tl[i].dev_type >= UCT_DEVICE_TYPE_LAST) {
+                return 0;
+            }
+        }
+
+        entry = ucp_rsc_cache_md_next(entry);
+    }
+
+    return 1;
+}
+
+static void ucp_rsc_cache_map(ucp_rsc_cache_t *cache)
+{
+    const void *entries;
+    size_t length;
+
+    entries = ucs_cache_file_map(cache->path, UCP_RSC_CACHE_MAGIC,
+                                 UCP_RSC_CACHE_VERSION, cache->key, &length);
+    if (entries == NULL) {
+        return;
+    }
+
+    if (!ucp_rsc_cache_is_valid(entries, length)) {
+        ucs_debug("resource cache %s is invalid", cache->path);
+        ucs_cache_file_unmap(entries, length);
+        return;
+    }
+
+    cache->entries = entries;
+    cache->length  = length;
+    ucs_debug("mapped resource cache %s", cache->path);
+}
+
+void ucp_rsc_cache_init(ucp_rsc_cache_t *cache, const ucp_config_t *config)
+{
+    uint32_t config_crc;
+    ucs_status_t status;
+
+    cache->path[0]    = '\0';
+    cache->key        = 0;
+    cache->entries    = NULL;
+    cache->length     = 0;
+    cache->num_mds    = 0;
+    cache->num_hits   = 0;
+    cache->num_misses = 0;
+    ucs_array_init_dynamic(&cache->buffer);
+
+    if (ucs_string_is_empty(config->ctx.rsc_cache_dir)) {
+        return;
+    }
+
+    /* Memory domains are configured from the environment, configuration
+     * files, and values set by ucp_config_modify() */
+    config_crc = ucs_config_parser_checksum(UCS_DEFAULT_ENV_PREFIX,
+                                            &config->cached_key_list);
+    status     = ucs_cache_file_key(config_crc, &cache->key);
+    if (status != UCS_OK) {
+        ucs_debug("resource cache is disabled: failed to get boot id");
+        return;
+    }
+
+    ucs_cache_file_path(cache->path, sizeof(cache->path),
+                        config->ctx.rsc_cache_dir, UCP_RSC_CACHE_NAME,
+                        cache->key);
+    ucp_rsc_cache_map(cache);
+}
+
+static const ucp_rsc_cache_md_t *
+ucp_rsc_cache_find(const ucp_rsc_cache_t *cache, const char *cmpt_name,
+                   const char *md_name)
+{
+    const void *end;
+    const ucp_rsc_cache_md_t *entry;
+
+    if (cache->entries == NULL) {
+        return NULL;
+    }
+
+    end = UCS_PTR_BYTE_OFFSET(cache->entries, cache->length);
+    for (entry = cache->entries; entry != end;
+         entry = ucp_rsc_cache_md_next(entry)) {
+        if (!strncmp(entry->cmpt_name, cmpt_name, sizeof(entry->cmpt_name)) &&
+            !strncmp(entry->md_name, md_name, sizeof(entry->md_name))) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static ucs_status_t
+ucp_rsc_cache_unpack(const ucp_rsc_cache_md_t *entry,
+                     uct_tl_resource_desc_t **resources_p,
+                     unsigned *num_resources_p)
+{
+    const ucp_rsc_cache_tl_t *tl = (const ucp_rsc_cache_tl_t*)(entry + 1);
+    uct_tl_resource_desc_t *resources;
+    ucs_status_t status;
+    unsigned i;
+
+    if (entry->num_resources == 0) {
+        resources = NULL;
+        goto out;
+    }
+
+    resources = ucs_calloc(entry->num_resources, sizeof(*resources),
+                           "cached tl resources");
+    if (resources == NULL) {
+        return UCS_ERR_NO_MEMORY;
+    }
+
+    for (i = 0; i < entry->num_resources; ++i) {
+        ucs_strncpy_zero(resources[i].tl_name, tl[i].tl_name,
+                         sizeof(resources[i].tl_name));
+        ucs_strncpy_zero(resources[i].dev_name, tl[i].dev_name,
+                         sizeof(resources[i].dev_name));
+        resources[i].dev_type   = (uct_device_type_t)tl[i].dev_type;
+        resources[i].sys_device = UCS_SYS_DEVICE_ID_UNKNOWN;
+        if (tl[i].has_bus_id) {
+            status = ucs_topo_find_device_by_bus_id(&tl[i].bus_id,
+                                                    &resources[i].sys_device);
+            if (status != UCS_OK) {
+                resources[i].sys_device = UCS_SYS_DEVICE_ID_UNKNOWN;
+            }
+        }
+    }
+
+out:
+    *resources_p     = resources;
+    *num_resources_p = entry->num_resources;
+    return UCS_OK;
+}
+
+static void ucp_rsc_cache_pack(ucp_rsc_cache_t *cache, const char *cmpt_name,
+                               const char *md_name,
+                               const uct_tl_resource_desc_t *resources,
+                               unsigned num_resources)
+{
+    size_t offset = ucs_array_length(&cache->buffer);
+    size_t size   = sizeof(ucp_rsc_cache_md_t) +
+                    (num_resources * sizeof(ucp_rsc_cache_tl_t));
+    ucp_rsc_cache_md_t *entry;
+    ucp_rsc_cache_tl_t *tl;
+    ucs_status_t status;
+    unsigned i;
+
+    status = ucs_array_reserve(&cache->buffer, offset + size);
+    if (status != UCS_OK) {
+        ucs_debug("failed to add %s to resource cache", md_name);
+        return;
+    }
+
+    /* Zero padding bytes as well, since they are covered by the checksum */
+    entry = UCS_PTR_BYTE_OFFSET(ucs_array_begin(&cache->buffer), offset);
+    memset(entry, 0, size);
+    ucs_strncpy_zero(entry->cmpt_name, cmpt_name, sizeof(entry->cmpt_name));
+    ucs_strncpy_zero(entry->md_name, md_name, sizeof(entry->md_name));
+    entry->num_resources = num_resources;
+
+    tl = (ucp_rsc_cache_tl_t*)(entry + 1);
+    for (i = 0; i < num_resources; ++i) {
+        ucs_strncpy_zero(tl[i].tl_name, resources[i].tl_name,
+                         sizeof(tl[i].tl_name));
+        ucs_strncpy_zero(tl[i].dev_name, resources[i].dev_name,
+                         sizeof(tl[i].dev_name));
+        tl[i].dev_type   = resources[i].dev_type;
+        tl[i].has_bus_id = (resources[i].sys_device !=
+                            UCS_SYS_DEVICE_ID_UNKNOWN) &&
+                           (ucs_topo_get_device_bus_id(resources[i].sys_device,
+                                                       &tl[i].bus_id) ==
+                            UCS_OK);
+    }
+
+    ucs_array_set_length(&cache->buffer, offset + size);
+    ++cache->num_mds;
+}
+
+ucs_status_t ucp_rsc_cache_query_tl_resources(ucp_rsc_cache_t *cache,
+                                              const char *cmpt_name,
+                                              uct_md_h md, const char *md_name,
+                                              uct_tl_resource_desc_t **resources_p,
+                                              unsigned *num_resources_p)
+{
+    const ucp_rsc_cache_md_t *entry;
+    ucs_status_t status;
+
+    if (ucs_string_is_empty(cache->path)) {
+        return uct_md_query_tl_resources(md, resources_p, num_resources_p);
+    }
+
+    entry = ucp_rsc_cache_find(cache, cmpt_name, md_name);
+    if (entry != NULL) {
+        status = ucp_rsc_cache_unpack(entry, resources_p, num_resources_p);
+        ++cache->num_hits;
+    } else {
+        status = uct_md_query_tl_resources(md, resources_p, num_resources_p);
+        ++cache->num_misses;
+    }
+
+    if (status != UCS_OK) {
+        return status;
+    }
+
+    ucp_rsc_cache_pack(cache, cmpt_name, md_name, *resources_p,
+                       *num_resources_p);
+    return UCS_OK;
+}
+
+static void ucp_rsc_cache_save(ucp_rsc_cache_t *cache)
+{
+    struct iovec iov;
+    ucs_status_t status;
+
+    iov.iov_base = ucs_array_begin(&cache->buffer);
+    iov.iov_len  = ucs_array_length(&cache->buffer);
+    status       = ucs_cache_file_save(cache->path, UCP_RSC_CACHE_MAGIC,
+                                       UCP_RSC_CACHE_VERSION, cache->key, &iov,
+                                       1);
+    if (status == UCS_OK) {
+        ucs_debug("saved resource cache %s with %u memory domains",
+                  cache->path, cache->num_mds);
+    }
+}
+
+void ucp_rsc_cache_cleanup(ucp_rsc_cache_t *cache, int save)
+{
+    if (!ucs_string_is_empty(cache->path)) {
+        ucs_debug("resource cache %s: %u hits, %u misses", cache->path,
+                  cache->num_hits, cache->num_misses);
+        if (save && (cache->num_misses > 0)) {
+            ucp_rsc_cache_save(cache);
+        }
+    }
+
+    if (cache->entries != NULL) {
+        ucs_cache_file_unmap(cache->entries, cache->length);
+    }
+
+    ucs_array_cleanup_dynamic(&cache->buffer);
+}
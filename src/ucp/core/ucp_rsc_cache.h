@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifndef UCP_RSC_CACHE_H_
+#define UCP_RSC_CACHE_H_
+
+#include "ucp_context.h"
+
+#include <ucs/datastruct/array.h>
+#include <limits.h>
+
+
+#define UCP_RSC_CACHE_NAME    "ucp_rsc"
+#define UCP_RSC_CACHE_MAGIC   "UCPRSCC"
+#define UCP_RSC_CACHE_VERSION 2u
+
+
+/*
+ * Resource discovery cache
+ *
+ * When UCX_RESOURCE_CACHE_DIR is set, the transport resources reported by each
+ * memory domain are saved to a per-user cache file (see ucs/sys/cache_file.h)
+ * in that directory, and the next processes on the same host read them from
+ * the file instead of querying the transports again. The file key depends on
+ * the UCX configuration (environment variables and values set by
+ * ucp_config_modify), so any change of it selects a different file. The file
+ * is mapped read-only and shared by all processes using it, and is replaced
+ * atomically when a memory domain is missing from it.
+ *
+ * File data layout:
+ *
+ *   ucp_rsc_cache_md_t          (md 0)
+ *     ucp_rsc_cache_tl_t[num_resources]
+ *   ucp_rsc_cache_md_t          (md 1)
+ *     ucp_rsc_cache_tl_t[num_resources]
+ *   ...
+ */
+typedef struct {
+    char             cmpt_name[UCT_COMPONENT_NAME_MAX];
+    char             md_name[UCT_MD_NAME_MAX];
+    uint32_t         num_resources;
+    uint32_t         reserved;
+} ucp_rsc_cache_md_t;
+
+
+typedef struct {
+    char             tl_name[UCT_TL_NAME_MAX];
+    char             dev_name[UCT_DEVICE_NAME_MAX];
+    uint32_t         dev_type;      /* uct_device_type_t */
+    uint32_t         has_bus_id;    /* Whether bus_id is valid */
+    ucs_sys_bus_id_t bus_id;        /* Bus id of the system device */
+} ucp_rsc_cache_tl_t;
+
+
+UCS_ARRAY_DECLARE_TYPE(ucp_rsc_cache_buffer_t, size_t, uint8_t);
+
+
+/*
+ * Resource discovery cache state, used while filling context resources.
+ */
+typedef struct {
+    /* Cache file path, or empty string if the cache is disabled */
+    char                         path[PATH_MAX];
+    /* Key of the current host and configuration */
+    uint64_t                     key;
+    /* Mapped cache file data, or NULL if it does not exist or is invalid */
+    const ucp_rsc_cache_md_t     *entries;
+    /* Length of the mapped data */
+    size_t                       length;
+    /* Memory domain entries to save, collected during discovery */
+    ucp_rsc_cache_buffer_t       buffer;
+    /* Number of memory domain entries in @a buffer */
+    unsigned                     num_mds;
+    /* Number of memory domains whose resources were found in the file */
+    unsigned                     num_hits;
+    /* Number of memory domains whose resources were queried */
+    unsigned                     num_misses;
+} ucp_rsc_cache_t;
+
+
+/**
+ * Initialize the resource cache and map the existing cache file, if any.
+ *
+ * @param [out] cache   Resource cache to initialize.
+ * @param [in]  config  UCP configuration.
+ */
+void ucp_rsc_cache_init(ucp_rsc_cache_t *cache, const ucp_config_t *config);
+
+
+/**
+ * Get the transport resources of a memory domain from the cache, or query them
+ * from the memory domain and add them to the cache.
+ *
+ * @param [in]  cache            Resource cache.
+ * @param [in]  cmpt_name        Name of the memory domain component.
+ * @param [in]  md               Memory domain to query on a cache miss.
+ * @param [in]  md_name          Name of the memory domain.
+ * @param [out] resources_p      Filled with the transport resources array,
+ *                               which must be released by
+ *                               @ref uct_release_tl_resource_list.
+ * @param [out] num_resources_p  Filled with the number of resources.
+ *
+ * @return Error code as defined by @ref ucs_status_t.
+ */
+ucs_status_t ucp_rsc_cache_query_tl_resources(ucp_rsc_cache_t *cache,
+                                              const char *cmpt_name,
+                                              uct_md_h md, const char *md_name,
+                                              uct_tl_resource_desc_t **resources_p,
+                                              unsigned *num_resources_p);
+
+
+/**
+ * Save the cache file if some memory domains were not found in it, and release
+ * the resource cache.
+ *
+ * @param [in]  cache   Resource cache to clean up.
+ * @param [in]  save    Whether to save the collected entries.
+ */
+void ucp_rsc_cache_cleanup(ucp_rsc_cache_t *cache, int save);
+
+#endif
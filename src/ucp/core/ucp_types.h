@@ -73,6 +73,7 @@ typedef struct ucp_worker_iface       ucp_worker_iface_t;
 typedef struct ucp_worker_cm          ucp_worker_cm_t;
 typedef struct ucp_rma_proto          ucp_rma_proto_t;
 typedef struct ucp_amo_proto          ucp_amo_proto_t;
+typedef struct ucp_am_batch           ucp_am_batch_t;
 typedef struct ucp_ep_config          ucp_ep_config_t;
 typedef struct ucp_ep_config_key      ucp_ep_config_key_t;
 typedef struct ucp_rkey_config_key    ucp_rkey_config_key_t;
@@ -201,6 +202,8 @@ typedef enum {
                                           defined AM */
     UCP_AM_ID_AM_SINGLE_REPLY   =  26, /* Single fragment user defined AM
                                           carrying remote ep for reply */
+    UCP_AM_ID_AM_BATCH          =  27, /* Several coalesced single fragment
+                                          user defined AMs */
     UCP_AM_ID_LAST
 } ucp_am_id_t;
 
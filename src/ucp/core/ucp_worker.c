@@ -43,6 +43,16 @@
 
 #define UCP_WORKER_MAX_DEBUG_STRING_SIZE 200
 
+/* Spin time in ucp_worker_wait() is this factor times the average time
+ * until an event arrives, as long as it does not exceed the maximum */
+#define UCP_WORKER_WAIT_SPIN_FACTOR 2
+
+/* Weight of the history in the average time until an event arrives */
+#define UCP_WORKER_WAIT_SPIN_AVG_WEIGHT 7
+
+/* Number of times memory pools are sampled during the memory idle time */
+#define UCP_WORKER_MEM_RECLAIM_SAMPLES 4
+
 
 #define UCP_WIFACE_FMT "iface %p (" UCT_TL_RESOURCE_DESC_FMT ")"
 #define UCP_WIFACE_ARG(_wiface) \
@@ -91,7 +101,9 @@ static ucs_stats_class_t ucp_worker_stats_class = {
         [UCP_WORKER_STAT_RNDV_PUT_ZCOPY]           = "rndv_put_zcopy",
         [UCP_WORKER_STAT_RNDV_GET_ZCOPY]           = "rndv_get_zcopy",
         [UCP_WORKER_STAT_RNDV_RTR]                 = "rndv_rtr",
-        [UCP_WORKER_STAT_RNDV_RKEY_PTR]            = "rndv_rkey_ptr"
+        [UCP_WORKER_STAT_RNDV_RKEY_PTR]            = "rndv_rkey_ptr",
+        [UCP_WORKER_STAT_WAIT_SPIN_HIT]            = "wait_spin_hit",
+        [UCP_WORKER_STAT_WAIT_SLEEP]               = "wait_sleep"
     }
 };
 #endif
@@ -1247,6 +1259,7 @@ ucp_worker_iface_get_memory_distance(const ucp_worker_iface_t *wiface,
 {
     const ucs_sys_device_t sys_dev  = ucp_worker_iface_get_sys_device(wiface);
     const uct_md_attr_v2_t *md_attr = &ucp_worker_iface_get_md(wiface)->attr;
+    double cache_latency;
 
     if ((md_attr->access_mem_types | md_attr->reg_mem_types) &
         UCS_BIT(UCS_MEMORY_TYPE_HOST)) {
@@ -1254,6 +1267,13 @@ ucp_worker_iface_get_memory_distance(const ucp_worker_iface_t *wiface,
     } else {
         *distance = ucs_topo_default_distance;
     }
+
+    /* Shared memory transports pass data through the caches of the cores */
+    if ((ucp_worker_iface_get_tl_resource(wiface)->tl_rsc.dev_type ==
+         UCT_DEVICE_TYPE_SHM) &&
+        (ucs_topo_get_cache_latency(&cache_latency) == UCS_OK)) {
+        distance->latency += cache_latency;
+    }
 }
 
 void ucp_worker_iface_add_bandwidth(uct_ppn_bandwidth_t *ppn_bandwidth,
@@ -1308,6 +1328,7 @@ ucs_status_t ucp_worker_iface_open(ucp_worker_h worker, ucp_rsc_index_t tl_id,
     uct_iface_config_t *iface_config;
     ucp_worker_iface_t *wiface;
     ucs_sys_dev_distance_t distance;
+    ucs_mpool_acct_t *prev_acct;
     ucs_status_t status;
 
     wiface = ucs_calloc(1, sizeof(*wiface), "ucp_iface");
@@ -1392,9 +1413,11 @@ ucs_status_t ucp_worker_iface_open(ucp_worker_h worker, ucp_rsc_index_t tl_id,
     iface_params.field_mask |= UCT_IFACE_PARAM_FIELD_FEATURES;
     iface_params.features    = ucp_worker_get_uct_features(context);
 
-    /* Open UCT interface */
-    status = uct_iface_open(md, worker->uct, &iface_params, iface_config,
-                            &wiface->iface);
+    /* Open UCT interface, its memory pools are accounted to the worker */
+    prev_acct = ucs_mpool_acct_set_current(&worker->mem.acct);
+    status    = uct_iface_open(md, worker->uct, &iface_params, iface_config,
+                               &wiface->iface);
+    ucs_mpool_acct_set_current(prev_acct);
     uct_config_release(iface_config);
 
     if (status != UCS_OK) {
@@ -2165,6 +2188,9 @@ ucs_status_t ucp_worker_get_ep_config(ucp_worker_h worker,
                                         UCP_FEATURE_AM, UCP_OP_ID_AM_SEND_REPLY,
                                         UCP_PROTO_FLAG_AM_SHORT, key->am_lane,
                                         &ep_config->am_u.max_reply_eager_short);
+
+        ucp_proto_select_warmup(worker, &ep_config->proto_select, ep_cfg_index,
+                                UCP_WORKER_CFG_INDEX_NULL);
     }
 
     ucp_worker_print_used_tls(worker, ep_cfg_index);
@@ -2250,6 +2276,8 @@ ucp_worker_add_rkey_config(ucp_worker_h worker,
         ucp_proto_select_short_disable(&rkey_config->put_short);
     }
 
+    ucp_proto_select_warmup(worker, &rkey_config->proto_select,
+                            key->ep_cfg_index, rkey_cfg_index);
     return UCS_OK;
 
 err_kh_del:
@@ -2333,6 +2361,43 @@ ucp_worker_vfs_show_primitive(void *obj, ucs_string_buffer_t *strb,
     UCS_ASYNC_UNBLOCK(&worker->async);
 }
 
+#if ENABLE_REQ_LATENCY
+static void
+ucp_worker_vfs_show_proto_lat(void *obj, ucs_string_buffer_t *strb,
+                              void *arg_ptr, uint64_t arg_u64)
+{
+    ucp_worker_h worker = obj;
+
+    ucp_proto_lat_dump(&worker->proto_lat, strb);
+}
+#endif
+
+static void
+ucp_worker_vfs_show_proto_tune(void *obj, ucs_string_buffer_t *strb,
+                               void *arg_ptr, uint64_t arg_u64)
+{
+    ucp_worker_h worker = obj;
+
+    UCS_ASYNC_BLOCK(&worker->async);
+    ucp_proto_tune_dump(worker, strb);
+    UCS_ASYNC_UNBLOCK(&worker->async);
+}
+
+static void
+ucp_worker_vfs_show_mpools(void *obj, ucs_string_buffer_t *strb,
+                           void *arg_ptr, uint64_t arg_u64)
+{
+    ucp_worker_h worker = obj;
+    ucs_mpool_data_t *data;
+
+    UCS_ASYNC_BLOCK(&worker->async);
+    ucs_list_for_each(data, &worker->mem.acct.mpools, acct_list) {
+        ucs_string_buffer_appendf(strb, "%s %zu\n", data->name,
+                                  data->chunks_size);
+    }
+    UCS_ASYNC_UNBLOCK(&worker->async);
+}
+
 void ucp_worker_create_vfs(ucp_context_h context, ucp_worker_h worker)
 {
     ucs_thread_mode_t thread_mode;
@@ -2371,6 +2436,38 @@ void ucp_worker_create_vfs(ucp_context_h context, ucp_worker_h worker)
     ucs_vfs_obj_add_ro_file(worker, ucp_worker_vfs_show_primitive,
                             &worker->counters.ep_failures, UCS_VFS_TYPE_ULONG,
                             "counters/ep_failures");
+    ucs_vfs_obj_add_ro_file(worker, ucp_worker_vfs_show_primitive,
+                            &worker->counters.wait_spin_hits, UCS_VFS_TYPE_ULONG,
+                            "counters/wait_spin_hits");
+    ucs_vfs_obj_add_ro_file(worker, ucp_worker_vfs_show_primitive,
+                            &worker->counters.wait_sleeps, UCS_VFS_TYPE_ULONG,
+                            "counters/wait_sleeps");
+    ucs_vfs_obj_add_ro_file(worker, ucp_worker_vfs_show_primitive,
+                            &worker->counters.am_batches, UCS_VFS_TYPE_ULONG,
+                            "counters/am_batches");
+    ucs_vfs_obj_add_ro_file(worker, ucp_worker_vfs_show_primitive,
+                            &worker->mem.acct.total, UCS_VFS_TYPE_SIZET,
+                            "memory/usage");
+    ucs_vfs_obj_add_ro_file(worker, ucp_worker_vfs_show_primitive,
+                            &worker->mem.acct.peak, UCS_VFS_TYPE_SIZET,
+                            "memory/peak");
+    ucs_vfs_obj_add_ro_file(worker, ucp_worker_vfs_show_primitive,
+                            &worker->mem.acct.limit, UCS_VFS_TYPE_SIZET,
+                            "memory/budget");
+    ucs_vfs_obj_add_ro_file(worker, ucp_worker_vfs_show_primitive,
+                            &worker->mem.acct.num_denied, UCS_VFS_TYPE_ULONG,
+                            "memory/denied");
+    ucs_vfs_obj_add_ro_file(worker, ucp_worker_vfs_show_primitive,
+                            &worker->mem.reclaimed, UCS_VFS_TYPE_SIZET,
+                            "memory/reclaimed");
+    ucs_vfs_obj_add_ro_file(worker, ucp_worker_vfs_show_mpools, NULL, 0,
+                            "memory/mpools");
+    ucs_vfs_obj_add_ro_file(worker, ucp_worker_vfs_show_proto_tune, NULL, 0,
+                            "proto_tune");
+#if ENABLE_REQ_LATENCY
+    ucs_vfs_obj_add_ro_file(worker, ucp_worker_vfs_show_proto_lat, NULL, 0,
+                            "request_latency");
+#endif
 }
 
 static void ucp_worker_set_max_am_header(ucp_worker_h worker)
@@ -2419,11 +2516,121 @@ static void ucp_worker_set_max_am_header(ucp_worker_h worker)
                             ucs_min(max_am_header, UINT32_MAX) : 0ul;
 }
 
+static unsigned ucp_worker_mem_reclaim_progress(void *arg)
+{
+    ucp_worker_h worker = arg;
+    size_t released_size;
+    ucs_time_t idle_time;
+
+    /* Async handlers (e.g UD and TCP) get elements from the memory pools, and
+     * the reclaim timer updates the idle time, so the whole release is done
+     * while async events are blocked */
+    UCS_ASYNC_BLOCK(&worker->async);
+    idle_time                     = worker->mem.reclaim_idle_time;
+    worker->mem.reclaim_idle_time = UCS_TIME_INFINITY;
+    worker->mem.reclaim_pending   = 0;
+
+    released_size          = ucs_mpool_acct_reclaim(&worker->mem.acct,
+                                                    idle_time);
+    worker->mem.reclaimed += released_size;
+
+    if (released_size > 0) {
+        ucs_debug("worker %p: released %zu bytes of memory pool chunks, usage"
+                  " %zu budget %zu", worker, released_size,
+                  worker->mem.acct.total, worker->mem.acct.limit);
+    }
+    UCS_ASYNC_UNBLOCK(&worker->async);
+
+    return 0;
+}
+
+static int
+ucp_worker_mem_reclaim_filter(const ucs_callbackq_elem_t *elem, void *arg)
+{
+    return elem->cb == ucp_worker_mem_reclaim_progress;
+}
+
+/* Release the memory pool chunks which were unused for at least idle_time,
+ * from the progress context. Memory pools must not be modified from other
+ * contexts, because some of them may be in use at that time, and the async
+ * context is blocked during the release */
+static void
+ucp_worker_mem_reclaim_schedule(ucp_worker_h worker, ucs_time_t idle_time)
+{
+    UCS_ASYNC_BLOCK(&worker->async);
+    worker->mem.reclaim_idle_time = ucs_min(worker->mem.reclaim_idle_time,
+                                            idle_time);
+    if (!worker->mem.reclaim_pending) {
+        worker->mem.reclaim_pending = 1;
+        ucs_callbackq_add_oneshot(&worker->uct->progress_q, worker,
+                                  ucp_worker_mem_reclaim_progress, worker);
+    }
+    UCS_ASYNC_UNBLOCK(&worker->async);
+}
+
+static void ucp_worker_mem_limit_cb(ucs_mpool_acct_t *acct, void *arg)
+{
+    ucp_worker_mem_reclaim_schedule((ucp_worker_h)arg, 0);
+}
+
+static void ucp_worker_mem_reclaim_timer(int timer_id,
+                                         ucs_event_set_types_t events,
+                                         void *arg)
+{
+    ucp_worker_h worker = arg;
+
+    ucp_worker_mem_reclaim_schedule(
+            worker, worker->context->config.ext.worker_mem_idle_time);
+}
+
+static ucs_status_t ucp_worker_mem_init(ucp_worker_h worker)
+{
+    ucp_context_h context = worker->context;
+    ucs_time_t idle_time  = context->config.ext.worker_mem_idle_time;
+    ucs_status_t status;
+
+    ucs_mpool_acct_init(&worker->mem.acct, context->config.ext.worker_mem_budget,
+                        ucp_worker_mem_limit_cb, worker);
+    worker->mem.reclaim_idle_time = UCS_TIME_INFINITY;
+
+    if (idle_time == UCS_TIME_INFINITY) {
+        return UCS_OK;
+    }
+
+    /* Sample the memory pools several times during the idle time */
+    status = ucs_async_add_timer(worker->async.mode,
+                                 ucs_max(idle_time /
+                                         UCP_WORKER_MEM_RECLAIM_SAMPLES,
+                                         ucs_time_from_msec(1)),
+                                 ucp_worker_mem_reclaim_timer, worker,
+                                 &worker->async, &worker->mem.timer_id);
+    if (status != UCS_OK) {
+        ucs_error("worker %p: failed to add memory reclaim timer: %s", worker,
+                  ucs_status_string(status));
+        ucs_mpool_acct_cleanup(&worker->mem.acct);
+        return status;
+    }
+
+    return UCS_OK;
+}
+
+static void ucp_worker_mem_cleanup(ucp_worker_h worker)
+{
+    if (worker->mem.timer_id != 0) {
+        ucs_async_remove_handler(worker->mem.timer_id, 1);
+        worker->mem.timer_id = 0;
+    }
+
+    ucs_callbackq_remove_oneshot(&worker->uct->progress_q, worker,
+                                 ucp_worker_mem_reclaim_filter, NULL);
+}
+
 ucs_status_t ucp_worker_create(ucp_context_h context,
                                const ucp_worker_params_t *params,
                                ucp_worker_h *worker_p)
 {
     ucs_thread_mode_t thread_mode, uct_thread_mode;
+    ucs_mpool_acct_t *prev_acct;
     unsigned name_length;
     ucp_worker_h worker;
     ucs_status_t status;
@@ -2451,10 +2658,18 @@ ucs_status_t ucp_worker_create(ucp_context_h context,
     ucs_list_head_init(&worker->internal_eps);
     kh_init_inplace(ucp_worker_rkey_config, &worker->rkey_config_hash);
     kh_init_inplace(ucp_worker_discard_uct_ep_hash, &worker->discard_uct_ep_hash);
+    ucp_proto_select_store_init(&worker->proto_select_store, context);
     worker->counters.ep_creations         = 0;
     worker->counters.ep_creation_failures = 0;
     worker->counters.ep_closures          = 0;
     worker->counters.ep_failures          = 0;
+    worker->counters.wait_spin_hits       = 0;
+    worker->counters.wait_sleeps          = 0;
+    worker->counters.am_batches           = 0;
+    worker->wait_spin.max_time            =
+            ucs_time_from_sec(context->config.ext.wakeup_spin_time);
+    worker->wait_spin.avg_interval        = worker->wait_spin.max_time /
+                                            UCP_WORKER_WAIT_SPIN_FACTOR;
 
     /* Copy user flags, and mask-out unsupported flags for compatibility */
     worker->flags = UCP_PARAM_VALUE(WORKER, params, flags, FLAGS, 0) &
@@ -2540,12 +2755,20 @@ ucs_status_t ucp_worker_create(ucp_context_h context,
         goto err_free_stats;
     }
 
+#if ENABLE_REQ_LATENCY
+    status = ucp_proto_lat_init(&worker->proto_lat
+                                UCS_STATS_ARG(worker->stats));
+    if (status != UCS_OK) {
+        goto err_free_tm_offload_stats;
+    }
+#endif
+
     status = ucs_async_context_init(&worker->async,
                                     context->config.ext.use_mt_mutex ?
                                     UCS_ASYNC_MODE_THREAD_MUTEX :
                                     UCS_ASYNC_THREAD_LOCK_TYPE);
     if (status != UCS_OK) {
-        goto err_free_tm_offload_stats;
+        goto err_cleanup_proto_lat;
     }
 
     /* Create the underlying UCT worker */
@@ -2570,10 +2793,16 @@ ucs_status_t ucp_worker_create(ucp_context_h context,
     ucs_conn_match_init(&worker->conn_match_ctx, sizeof(uint64_t),
                         UCP_EP_MATCH_CONN_SN_MAX, &ucp_ep_match_ops);
 
+    /* Initialize memory accounting, before memory pools are created */
+    status = ucp_worker_mem_init(worker);
+    if (status != UCS_OK) {
+        goto err_conn_match_cleanup;
+    }
+
     /* Open all resources as interfaces on this worker */
     status = ucp_worker_add_resource_ifaces(worker);
     if (status != UCS_OK) {
-        goto err_conn_match_cleanup;
+        goto err_mem_cleanup;
     }
 
     /* Open all resources as connection managers on this worker */
@@ -2589,7 +2818,9 @@ ucs_status_t ucp_worker_create(ucp_context_h context,
     }
 
     /* Initialize memory pools, should be done after resources are added */
-    status = ucp_worker_init_mpools(worker);
+    prev_acct = ucs_mpool_acct_set_current(&worker->mem.acct);
+    status    = ucp_worker_init_mpools(worker);
+    ucs_mpool_acct_set_current(prev_acct);
     if (status != UCS_OK) {
         goto err_destroy_memtype_eps;
     }
@@ -2634,6 +2865,9 @@ err_close_cms:
     ucp_worker_close_cms(worker);
 err_close_ifaces:
     ucp_worker_close_ifaces(worker);
+err_mem_cleanup:
+    ucp_worker_mem_cleanup(worker);
+    ucs_mpool_acct_cleanup(&worker->mem.acct);
 err_conn_match_cleanup:
     ucs_conn_match_cleanup(&worker->conn_match_ctx);
     ucp_worker_wakeup_cleanup(worker);
@@ -2641,6 +2875,10 @@ err_destroy_uct_worker:
     uct_worker_destroy(worker->uct);
 err_destroy_async:
     ucs_async_context_cleanup(&worker->async);
+err_cleanup_proto_lat:
+#if ENABLE_REQ_LATENCY
+    ucp_proto_lat_cleanup(&worker->proto_lat);
+#endif
 err_free_tm_offload_stats:
     UCS_STATS_NODE_FREE(worker->tm_offload_stats);
 err_free_stats:
@@ -2654,6 +2892,7 @@ err_free:
     kh_destroy_inplace(ucp_worker_discard_uct_ep_hash,
                        &worker->discard_uct_ep_hash);
     kh_destroy_inplace(ucp_worker_rkey_config, &worker->rkey_config_hash);
+    ucp_proto_select_store_cleanup(&worker->proto_select_store, 0);
     ucp_worker_destroy_configs(worker);
     ucs_free(worker);
     return status;
@@ -2885,16 +3124,21 @@ void ucp_worker_destroy(ucp_worker_h worker)
 
     ucs_callbackq_remove_oneshot(&worker->uct->progress_q, worker,
                                  ucp_worker_ep_config_filter, NULL);
+    ucp_worker_mem_cleanup(worker);
 
     ucs_vfs_obj_remove(worker);
     ucp_tag_match_cleanup(&worker->tm);
     ucp_worker_destroy_mpools(worker);
     ucp_worker_close_cms(worker);
     ucp_worker_close_ifaces(worker);
+    ucs_mpool_acct_cleanup(&worker->mem.acct);
     ucs_conn_match_cleanup(&worker->conn_match_ctx);
     ucp_worker_wakeup_cleanup(worker);
     uct_worker_destroy(worker->uct);
     ucs_async_context_cleanup(&worker->async);
+#if ENABLE_REQ_LATENCY
+    ucp_proto_lat_cleanup(&worker->proto_lat);
+#endif
     UCS_STATS_NODE_FREE(worker->tm_offload_stats);
     UCS_STATS_NODE_FREE(worker->stats);
     UCS_PTR_MAP_DESTROY(request, &worker->request_map);
@@ -2903,6 +3147,7 @@ void ucp_worker_destroy(ucp_worker_h worker)
     kh_destroy_inplace(ucp_worker_discard_uct_ep_hash,
                        &worker->discard_uct_ep_hash);
     kh_destroy_inplace(ucp_worker_rkey_config, &worker->rkey_config_hash);
+    ucp_proto_select_store_cleanup(&worker->proto_select_store, 1);
     ucp_worker_destroy_configs(worker);
     ucs_free(worker);
 }
@@ -2969,6 +3214,12 @@ ucs_status_t ucp_worker_query(ucp_worker_h worker,
         attr->max_debug_string = UCP_WORKER_MAX_DEBUG_STRING_SIZE;
     }
 
+    if (attr->field_mask & UCP_WORKER_ATTR_FIELD_MEMORY_USAGE) {
+        UCS_ASYNC_BLOCK(&worker->async);
+        attr->memory_usage = worker->mem.acct.total;
+        UCS_ASYNC_UNBLOCK(&worker->async);
+    }
+
     return status;
 }
 
@@ -2982,16 +3233,17 @@ ucs_status_t ucp_worker_address_query(ucp_address_t *address,
     return UCS_OK;
 }
 
-unsigned ucp_worker_progress(ucp_worker_h worker)
+static UCS_F_ALWAYS_INLINE unsigned
+ucp_worker_progress_common(ucp_worker_h worker, int thread_multi)
 {
     unsigned count;
 
-    /* worker->inprogress is used only for assertion check.
+    UCP_WORKER_THREAD_CS_ENTER_MODE(worker, thread_multi);
+
+    /* check that ucp_worker_progress is not called from within ucp_worker_progress
+     * worker->inprogress is used only for assertion check.
      * coverity[assert_side_effect]
      */
-    UCP_WORKER_THREAD_CS_ENTER_CONDITIONAL(worker);
-
-    /* check that ucp_worker_progress is not called from within ucp_worker_progress */
     ucs_assert(worker->inprogress++ == 0);
     count = uct_worker_progress(worker->uct);
     ucs_async_check_miss(&worker->async);
@@ -2999,11 +3251,16 @@ unsigned ucp_worker_progress(ucp_worker_h worker)
     /* coverity[assert_side_effect] */
     ucs_assert(--worker->inprogress == 0);
 
-    UCP_WORKER_THREAD_CS_EXIT_CONDITIONAL(worker);
-
+    UCP_WORKER_THREAD_CS_EXIT_MODE(worker, thread_multi);
     return count;
 }
 
+unsigned ucp_worker_progress(ucp_worker_h worker)
+{
+    return UCP_WORKER_THREAD_MODE_DISPATCH(worker, ucp_worker_progress_common,
+                                           worker);
+}
+
 ssize_t ucp_stream_worker_poll(ucp_worker_h worker,
                                ucp_stream_poll_ep_t *poll_eps,
                                size_t max_eps, unsigned flags)
@@ -3140,11 +3397,47 @@ void ucp_worker_wait_mem(ucp_worker_h worker, void *address)
     ucs_arch_wait_mem(address);
 }
 
+static void
+ucp_worker_wait_spin_update(ucp_worker_h worker, ucs_time_t interval)
+{
+    worker->wait_spin.avg_interval =
+            ((worker->wait_spin.avg_interval * UCP_WORKER_WAIT_SPIN_AVG_WEIGHT) +
+             interval) / (UCP_WORKER_WAIT_SPIN_AVG_WEIGHT + 1);
+}
+
+/* Progress the worker for a time which is adjusted according to the observed
+ * time between events. Returns nonzero if any progress was made. */
+static int ucp_worker_wait_spin(ucp_worker_h worker, ucs_time_t start_time)
+{
+    ucs_time_t spin_time;
+
+    if (worker->wait_spin.avg_interval > worker->wait_spin.max_time) {
+        /* Events are rare, spinning would just waste CPU */
+        return 0;
+    }
+
+    spin_time = ucs_min(worker->wait_spin.avg_interval *
+                        UCP_WORKER_WAIT_SPIN_FACTOR,
+                        worker->wait_spin.max_time);
+    do {
+        if (ucp_worker_progress(worker) != 0) {
+            ucp_worker_wait_spin_update(worker, ucs_get_time() - start_time);
+            ++worker->counters.wait_spin_hits;
+            UCS_STATS_UPDATE_COUNTER(worker->stats,
+                                     UCP_WORKER_STAT_WAIT_SPIN_HIT, 1);
+            return 1;
+        }
+    } while ((ucs_get_time() - start_time) < spin_time);
+
+    return 0;
+}
+
 ucs_status_t ucp_worker_wait(ucp_worker_h worker)
 {
     ucp_worker_iface_t *wiface;
     struct pollfd *pfd;
     ucs_status_t status;
+    ucs_time_t start_time;
     nfds_t nfds;
     int ret;
 
@@ -3153,6 +3446,15 @@ ucs_status_t ucp_worker_wait(ucp_worker_h worker)
     UCP_CONTEXT_CHECK_FEATURE_FLAGS(worker->context, UCP_FEATURE_WAKEUP,
                                     return UCS_ERR_INVALID_PARAM);
 
+    if (worker->wait_spin.max_time != 0) {
+        start_time = ucs_get_time();
+        if (ucp_worker_wait_spin(worker, start_time)) {
+            return UCS_OK;
+        }
+    } else {
+        start_time = 0;
+    }
+
     UCP_WORKER_THREAD_CS_ENTER_CONDITIONAL(worker);
 
     status = ucp_worker_arm(worker);
@@ -3194,6 +3496,13 @@ ucs_status_t ucp_worker_wait(ucp_worker_h worker)
         ret = poll(pfd, nfds, -1);
         if (ret >= 0) {
             ucs_assertv(ret == 1, "ret=%d", ret);
+            if (worker->wait_spin.max_time != 0) {
+                ucp_worker_wait_spin_update(worker,
+                                            ucs_get_time() - start_time);
+                ++worker->counters.wait_sleeps;
+                UCS_STATS_UPDATE_COUNTER(worker->stats,
+                                         UCP_WORKER_STAT_WAIT_SLEEP, 1);
+            }
             status = UCS_OK;
             goto out;
         } else {
@@ -3294,6 +3603,16 @@ void ucp_worker_print_info(ucp_worker_h worker, FILE *stream)
         ucs_string_buffer_cleanup(&strb);
     }
 
+    if (context->config.ext.proto_tune ||
+        (context->config.proto_tune_thresh.count > 0)) {
+        ucs_string_buffer_init(&strb);
+        ucp_proto_tune_dump(worker, &strb);
+        fprintf(stream, "# Tuned protocol thresholds:\n");
+        ucs_string_buffer_dump(&strb, "#   ", stream);
+        ucs_string_buffer_cleanup(&strb);
+        fprintf(stream, "#\n");
+    }
+
     ucp_worker_mem_type_eps_print_info(worker, stream);
 
     UCP_WORKER_THREAD_CS_EXIT_CONDITIONAL(worker);
@@ -14,6 +14,8 @@
 #include "ucp_rkey.h"
 
 #include <ucp/core/ucp_am.h>
+#include <ucp/proto/proto_latency.h>
+#include <ucp/proto/proto_select_store.h>
 #include <ucp/tag/tag_match.h>
 #include <ucs/datastruct/mpool.h>
 #include <ucs/datastruct/mpool_set.h>
@@ -40,6 +42,24 @@
     ucs_assert(ucs_async_is_blocked(&(_worker)->async))
 
 
+/* Enter the critical section of a worker whose thread mode is known */
+#define UCP_WORKER_THREAD_CS_ENTER_MODE(_worker, _thread_multi) \
+    do { \
+        if (_thread_multi) { \
+            UCS_ASYNC_BLOCK(&(_worker)->async); \
+        } \
+    } while (0)
+
+
+/* Exit the critical section entered by UCP_WORKER_THREAD_CS_ENTER_MODE */
+#define UCP_WORKER_THREAD_CS_EXIT_MODE(_worker, _thread_multi) \
+    do { \
+        if (_thread_multi) { \
+            UCS_ASYNC_UNBLOCK(&(_worker)->async); \
+        } \
+    } while (0)
+
+
 #if ENABLE_MT
 
 #define UCP_WORKER_THREAD_CS_ENTER_CONDITIONAL(_worker) \
@@ -65,11 +85,23 @@
         } \
     } while (0)
 
+
+/*
+ * Call an always-inline function whose last argument is the thread mode, with
+ * a constant value. This way, the thread mode is checked once per call, and
+ * each mode has a variant of the function without locking branches.
+ */
+#define UCP_WORKER_THREAD_MODE_DISPATCH(_worker, _func, ...) \
+    (((_worker)->flags & UCP_WORKER_FLAG_THREAD_MULTI) ? \
+             _func(__VA_ARGS__, 1) : _func(__VA_ARGS__, 0))
+
 #else
 
 #define UCP_WORKER_THREAD_CS_ENTER_CONDITIONAL(_worker)
 #define UCP_WORKER_THREAD_CS_EXIT_CONDITIONAL(_worker)
 #define UCP_WORKER_THREAD_CS_CHECK_IS_BLOCKED_CONDITIONAL(_worker)
+#define UCP_WORKER_THREAD_MODE_DISPATCH(_worker, _func, ...) \
+    _func(__VA_ARGS__, 0)
 
 #endif
 
@@ -150,6 +182,11 @@ enum {
     UCP_WORKER_STAT_RNDV_RTR,
     UCP_WORKER_STAT_RNDV_RKEY_PTR,
 
+    /* Number of ucp_worker_wait() calls which found an event while spinning,
+     * and number of calls which had to arm the worker and sleep */
+    UCP_WORKER_STAT_WAIT_SPIN_HIT,
+    UCP_WORKER_STAT_WAIT_SLEEP,
+
     UCP_WORKER_STAT_LAST
 };
 
@@ -326,6 +363,10 @@ typedef struct ucp_worker {
     UCS_STATS_NODE_DECLARE(stats)
     UCS_STATS_NODE_DECLARE(tm_offload_stats)
 
+#if ENABLE_REQ_LATENCY
+    ucp_proto_lat_t                  proto_lat;           /* Request latency histograms */
+#endif
+
     ucs_cpu_set_t                    cpu_mask;            /* Save CPU mask for subsequent calls to
                                                              ucp_worker_listen */
 
@@ -341,6 +382,9 @@ typedef struct ucp_worker {
     unsigned                         rkey_config_count;   /* Current number of rkey configurations */
     ucp_rkey_config_t                rkey_config[UCP_WORKER_MAX_RKEY_CONFIG];
 
+    ucp_proto_select_store_t         proto_select_store; /* Protocols selected
+                                                            by previous processes */
+
     struct {
         int                          timerfd;             /* Timer needed to signal to user's fd when
                                                            * the next keepalive round must be done */
@@ -353,6 +397,23 @@ typedef struct ucp_worker {
         size_t                       round_count;         /* Number of rounds done */
     } keepalive;
 
+    struct {
+        ucs_time_t                   max_time;            /* Maximal time to spin in ucp_worker_wait() */
+        ucs_time_t                   avg_interval;        /* Moving average of the time until an
+                                                           * event was found by ucp_worker_wait() */
+    } wait_spin;
+
+    struct {
+        ucs_mpool_acct_t             acct;                /* Accounting of worker and interface
+                                                           * memory pools */
+        int                          reclaim_pending;     /* Whether releasing unused chunks is
+                                                           * scheduled on progress */
+        ucs_time_t                   reclaim_idle_time;   /* Idle time of the chunks to release
+                                                           * by the scheduled reclaim */
+        int                          timer_id;            /* Timer to sample idle chunks */
+        size_t                       reclaimed;           /* Total size of released chunks */
+    } mem;
+
     struct {
         /* Number of requests to create endpoint */
         uint64_t                     ep_creations;
@@ -362,6 +423,12 @@ typedef struct ucp_worker {
         uint64_t                     ep_closures;
         /* Number of failed endpoints */
         uint64_t                     ep_failures;
+        /* Number of waits which found an event while spinning */
+        uint64_t                     wait_spin_hits;
+        /* Number of waits which armed the worker and slept */
+        uint64_t                     wait_sleeps;
+        /* Number of sent buffers of coalesced active messages */
+        uint64_t                     am_batches;
     } counters;
 } ucp_worker_t;
 
@@ -8,7 +8,9 @@
 #define UCP_PROTO_COMMON_INL_
 
 #include "proto_common.h"
+#include "proto_latency.inl"
 #include "proto_select.inl"
+#include "proto_tune.inl"
 
 #include <ucp/dt/datatype_iter.inl>
 #include <ucp/core/ucp_request.inl>
@@ -75,9 +77,10 @@ ucp_proto_request_zcopy_init(ucp_request_t *req, ucp_md_map_t md_map,
 
     ucp_proto_completion_init(&req->send.state.uct_comp, comp_func);
 
-    return UCS_PROFILE_CALL(ucp_datatype_iter_mem_reg, ep->worker->context,
-                            &req->send.state.dt_iter, md_map, uct_reg_flags,
-                            dt_mask);
+    return UCP_PROTO_LAT_CALL(req, UCP_PROTO_LAT_MEM_REG, UCS_PROFILE_CALL,
+                              ucp_datatype_iter_mem_reg, ep->worker->context,
+                              &req->send.state.dt_iter, md_map, uct_reg_flags,
+                              dt_mask);
 }
 
 static UCS_F_ALWAYS_INLINE void
@@ -171,6 +174,7 @@ ucp_proto_request_set_stage(ucp_request_t *req, uint8_t proto_stage)
 
     ucp_trace_req(req, "set to stage %u, progress function '%s'", proto_stage,
                   ucs_debug_get_symbol_name(proto->progress[proto_stage]));
+    ucp_proto_lat_request_set_stage(req);
     req->send.proto_stage = proto_stage;
 
     /* Set pointer to progress function */
@@ -189,6 +193,9 @@ static void ucp_proto_request_set_proto(ucp_request_t *req,
     ucs_assertv(req->flags & UCP_REQUEST_FLAG_PROTO_SEND, "flags=0x%"PRIx32,
                 req->flags);
 
+    proto_config = ucp_proto_tune_request_select(req, proto_config,
+                                                 msg_length);
+    ucp_proto_lat_request_set_proto(req, proto_config);
     req->send.proto_config = proto_config;
     if (ucs_log_is_enabled(UCS_LOG_LEVEL_TRACE_REQ)) {
         ucp_proto_trace_selected(req, msg_length);
@@ -237,6 +244,8 @@ ucp_proto_request_send_init(ucp_request_t *req, ucp_ep_h ep, uint32_t flags)
 {
     req->flags   = UCP_REQUEST_FLAG_PROTO_SEND | flags;
     req->send.ep = ep;
+    ucp_proto_tune_request_init(req);
+    ucp_proto_lat_request_init(req);
 }
 
 
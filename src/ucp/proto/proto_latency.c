@@ -0,0 +1,245 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "proto_latency.h"
+
+#include <ucs/arch/bitops.h>
+#include <ucs/debug/memtrack_int.h>
+#include <ucs/sys/string.h>
+#include <ucs/time/time.h>
+#include <inttypes.h>
+
+
+#define UCP_PROTO_LAT_STAGE_NAME(_stage) \
+    [UCP_PROTO_LAT_STAGE + (_stage)] = "stage" #_stage
+
+
+static const char *ucp_proto_lat_phase_names[] = {
+    [UCP_PROTO_LAT_SELECT]    = "select",
+    [UCP_PROTO_LAT_MEM_REG]   = "mem_reg",
+    [UCP_PROTO_LAT_RNDV_WAIT] = "rndv_wait",
+    [UCP_PROTO_LAT_CALLBACK]  = "callback",
+    [UCP_PROTO_LAT_TOTAL]     = "total",
+    UCP_PROTO_LAT_STAGE_NAME(0),
+    UCP_PROTO_LAT_STAGE_NAME(1),
+    UCP_PROTO_LAT_STAGE_NAME(2),
+    UCP_PROTO_LAT_STAGE_NAME(3),
+    UCP_PROTO_LAT_STAGE_NAME(4),
+    UCP_PROTO_LAT_STAGE_NAME(5),
+    UCP_PROTO_LAT_STAGE_NAME(6),
+    UCP_PROTO_LAT_STAGE_NAME(7)
+};
+
+
+#ifdef ENABLE_STATS
+#define UCP_PROTO_LAT_STAGE_STAT_NAME(_stage) \
+    [UCP_PROTO_LAT_STAGE + (_stage)] = "stage" #_stage "_ns"
+
+static ucs_stats_class_t ucp_proto_lat_stats_class = {
+    .name           = "proto_lat",
+    .num_counters   = UCP_PROTO_LAT_LAST,
+    .class_id       = UCS_STATS_CLASS_ID_INVALID,
+    .counter_names  = {
+        [UCP_PROTO_LAT_SELECT]    = "select_ns",
+        [UCP_PROTO_LAT_MEM_REG]   = "mem_reg_ns",
+        [UCP_PROTO_LAT_RNDV_WAIT] = "rndv_wait_ns",
+        [UCP_PROTO_LAT_CALLBACK]  = "callback_ns",
+        [UCP_PROTO_LAT_TOTAL]     = "total_ns",
+        UCP_PROTO_LAT_STAGE_STAT_NAME(0),
+        UCP_PROTO_LAT_STAGE_STAT_NAME(1),
+        UCP_PROTO_LAT_STAGE_STAT_NAME(2),
+        UCP_PROTO_LAT_STAGE_STAT_NAME(3),
+        UCP_PROTO_LAT_STAGE_STAT_NAME(4),
+        UCP_PROTO_LAT_STAGE_STAT_NAME(5),
+        UCP_PROTO_LAT_STAGE_STAT_NAME(6),
+        UCP_PROTO_LAT_STAGE_STAT_NAME(7)
+    }
+};
+#endif
+
+
+static UCS_F_ALWAYS_INLINE khint_t
+ucp_proto_lat_hash_func(ucp_proto_lat_key_t key)
+{
+    return kh_int64_hash_func((uintptr_t)key.proto ^ key.size_bucket);
+}
+
+static UCS_F_ALWAYS_INLINE int
+ucp_proto_lat_key_is_equal(ucp_proto_lat_key_t key1, ucp_proto_lat_key_t key2)
+{
+    return (key1.proto == key2.proto) &&
+           (key1.size_bucket == key2.size_bucket);
+}
+
+KHASH_IMPL(ucp_proto_lat_hash, ucp_proto_lat_key_t, ucp_proto_lat_entry_t*, 1,
+           ucp_proto_lat_hash_func, ucp_proto_lat_key_is_equal);
+
+
+ucs_status_t ucp_proto_lat_init(ucp_proto_lat_t *lat
+                                UCS_STATS_ARG(ucs_stats_node_t *stats_parent))
+{
+    ucs_status_t status;
+
+    /* Phase names are defined for every protocol stage */
+    UCS_STATIC_ASSERT(UCP_PROTO_STAGE_LAST == 8);
+
+    status = UCS_STATS_NODE_ALLOC(&lat->stats, &ucp_proto_lat_stats_class,
+                                  stats_parent, "");
+    if (status != UCS_OK) {
+        return status;
+    }
+
+    ucs_spinlock_init(&lat->lock, 0);
+    kh_init_inplace(ucp_proto_lat_hash, &lat->hash);
+    return UCS_OK;
+}
+
+void ucp_proto_lat_cleanup(ucp_proto_lat_t *lat)
+{
+    ucp_proto_lat_entry_t *entry;
+
+    kh_foreach_value(&lat->hash, entry, {
+        ucs_free(entry);
+    })
+    kh_destroy_inplace(ucp_proto_lat_hash, &lat->hash);
+    ucs_spinlock_destroy(&lat->lock);
+    UCS_STATS_NODE_FREE(lat->stats);
+}
+
+static ucp_proto_lat_entry_t *
+ucp_proto_lat_entry_add(ucp_proto_lat_t *lat, ucp_proto_lat_key_t key)
+{
+    ucp_proto_lat_entry_t *entry;
+    ucp_proto_lat_phase_t phase;
+    khiter_t iter;
+    int ret;
+
+    entry = ucs_calloc(1, sizeof(*entry), "ucp_proto_lat_entry");
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    for (phase = 0; phase < UCP_PROTO_LAT_LAST; ++phase) {
+        entry->phases[phase].min = UINT64_MAX;
+    }
+
+    ucs_spin_lock(&lat->lock);
+    iter = kh_put(ucp_proto_lat_hash, &lat->hash, key, &ret);
+    if (ret == UCS_KH_PUT_FAILED) {
+        ucs_spin_unlock(&lat->lock);
+        ucs_free(entry);
+        return NULL;
+    }
+
+    kh_value(&lat->hash, iter) = entry;
+    ucs_spin_unlock(&lat->lock);
+    return entry;
+}
+
+void ucp_proto_lat_update(ucp_proto_lat_t *lat, const ucp_proto_t *proto,
+                          size_t length, ucp_proto_lat_phase_t phase,
+                          ucs_time_t duration)
+{
+    uint64_t nsec = (uint64_t)ucs_time_to_nsec(duration);
+    ucp_proto_lat_entry_t *entry;
+    ucp_proto_lat_hist_t *hist;
+    ucp_proto_lat_key_t key;
+    khiter_t iter;
+    unsigned bin;
+
+    key.proto       = proto;
+    key.size_bucket = (length == 0) ? 0 : (ucs_ilog2(length) + 1);
+
+    /* The hash is modified only by this thread, so lookup does not need lock */
+    iter = kh_get(ucp_proto_lat_hash, &lat->hash, key);
+    if (ucs_likely(iter != kh_end(&lat->hash))) {
+        entry = kh_value(&lat->hash, iter);
+    } else {
+        entry = ucp_proto_lat_entry_add(lat, key);
+        if (entry == NULL) {
+            return;
+        }
+    }
+
+    bin  = (nsec == 0) ? 0 : ucs_min(ucs_ilog2(nsec) + 1,
+                                     UCP_PROTO_LAT_HIST_BINS - 1);
+    hist = &entry->phases[phase];
+    ++hist->count;
+    ++hist->hist[bin];
+    hist->total += nsec;
+    hist->min    = ucs_min(hist->min, nsec);
+    hist->max    = ucs_max(hist->max, nsec);
+
+    UCS_STATS_UPDATE_COUNTER(lat->stats, phase, nsec);
+}
+
+static void ucp_proto_lat_dump_size_range(unsigned size_bucket,
+                                          ucs_string_buffer_t *strb)
+{
+    char min_str[32], max_str[32];
+
+    if (size_bucket == 0) {
+        ucs_string_buffer_appendf(strb, "0");
+        return;
+    }
+
+    ucs_memunits_to_str(UCS_BIT(size_bucket - 1), min_str, sizeof(min_str));
+    ucs_memunits_to_str(UCS_BIT(size_bucket) - 1, max_str, sizeof(max_str));
+    ucs_string_buffer_appendf(strb, "%s..%s", min_str, max_str);
+}
+
+void ucp_proto_lat_dump(ucp_proto_lat_t *lat, ucs_string_buffer_t *strb)
+{
+    const ucp_proto_lat_hist_t *hist;
+    ucp_proto_lat_entry_t *entry;
+    ucp_proto_lat_phase_t phase;
+    ucp_proto_lat_key_t key;
+    unsigned bin;
+
+    ucs_spin_lock(&lat->lock);
+    kh_foreach(&lat->hash, key, entry, {
+        ucs_string_buffer_appendf(strb, "%s ", key.proto->name);
+        ucp_proto_lat_dump_size_range(key.size_bucket, strb);
+        ucs_string_buffer_appendf(strb, "\n");
+
+        for (phase = 0; phase < UCP_PROTO_LAT_LAST; ++phase) {
+            hist = &entry->phases[phase];
+            if (hist->count == 0) {
+                continue;
+            }
+
+            ucs_string_buffer_appendf(strb,
+                                      "    %-10s count %" PRIu64
+                                      " avg %" PRIu64 " min %" PRIu64
+                                      " max %" PRIu64 " ns, histogram:",
+                                      ucp_proto_lat_phase_names[phase],
+                                      hist->count, hist->total / hist->count,
+                                      hist->min, hist->max);
+            for (bin = 0; bin < UCP_PROTO_LAT_HIST_BINS; ++bin) {
+                if (hist->hist[bin] == 0) {
+                    continue;
+                }
+
+                /* Bin label is its exclusive upper bound, in ns, and the last
+                   bin is unbounded */
+                if (bin < (UCP_PROTO_LAT_HIST_BINS - 1)) {
+                    ucs_string_buffer_appendf(strb, " <%lu:%" PRIu64,
+                                              UCS_BIT(bin), hist->hist[bin]);
+                } else {
+                    ucs_string_buffer_appendf(strb, " >=%lu:%" PRIu64,
+                                              UCS_BIT(bin - 1),
+                                              hist->hist[bin]);
+                }
+            }
+            ucs_string_buffer_appendf(strb, "\n");
+        }
+    })
+    ucs_spin_unlock(&lat->lock);
+}
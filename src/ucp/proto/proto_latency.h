@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifndef UCP_PROTO_LATENCY_H_
+#define UCP_PROTO_LATENCY_H_
+
+#include "proto.h"
+
+#include <ucs/datastruct/khash.h>
+#include <ucs/datastruct/string_buffer.h>
+#include <ucs/stats/stats.h>
+#include <ucs/time/time_def.h>
+#include <ucs/type/spinlock.h>
+
+
+/*
+ * Request latency breakdown
+ *
+ * When UCX is configured with --enable-req-latency, every send request which
+ * uses the new protocols framework keeps timestamps of its protocol stage
+ * transitions. The time spent in every phase of the request lifecycle is
+ * aggregated per worker into histograms, keyed by the protocol and by the
+ * message size range [2^(N-1), 2^N). The histograms are shown by the
+ * "request_latency" VFS file of the worker, and the total time of every phase
+ * is reported by the "proto_lat" statistics node.
+ *
+ * The phases are not mutually exclusive: for example, the time spent in the
+ * rendezvous RTS stage includes the time spent waiting for RTR or ATS.
+ */
+
+
+/* Number of histogram bins, bin N counts durations of [2^(N-1), 2^N) ns */
+#define UCP_PROTO_LAT_HIST_BINS 32
+
+
+/**
+ * Request lifecycle phases
+ */
+typedef enum {
+    /* Request initialization until the protocol is selected */
+    UCP_PROTO_LAT_SELECT,
+
+    /* Memory registration by the protocol */
+    UCP_PROTO_LAT_MEM_REG,
+
+    /* Rendezvous RTS sent until RTR or ATS is received */
+    UCP_PROTO_LAT_RNDV_WAIT,
+
+    /* User completion callback */
+    UCP_PROTO_LAT_CALLBACK,
+
+    /* Request initialization until completion */
+    UCP_PROTO_LAT_TOTAL,
+
+    /* Time spent in protocol stage N is counted as phase STAGE + N */
+    UCP_PROTO_LAT_STAGE,
+
+    UCP_PROTO_LAT_LAST = UCP_PROTO_LAT_STAGE + UCP_PROTO_STAGE_LAST
+} ucp_proto_lat_phase_t;
+
+
+/**
+ * Latency histogram of a single phase, in nanoseconds
+ */
+typedef struct {
+    uint64_t count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint64_t hist[UCP_PROTO_LAT_HIST_BINS];
+} ucp_proto_lat_hist_t;
+
+
+/**
+ * Histograms of all phases for a protocol and message size bucket
+ */
+typedef struct {
+    ucp_proto_lat_hist_t phases[UCP_PROTO_LAT_LAST];
+} ucp_proto_lat_entry_t;
+
+
+typedef struct {
+    const ucp_proto_t *proto;       /* Protocol which handled the request */
+    unsigned          size_bucket;  /* N for message size in [2^(N-1), 2^N),
+                                       or 0 for empty message */
+} ucp_proto_lat_key_t;
+
+
+KHASH_TYPE(ucp_proto_lat_hash, ucp_proto_lat_key_t, ucp_proto_lat_entry_t*);
+
+
+/**
+ * Per-worker request latency histograms
+ */
+typedef struct {
+    /* Protects the hash table structure from concurrent VFS read. Entries are
+       updated only by the worker progress thread. */
+    ucs_spinlock_t                  lock;
+    khash_t(ucp_proto_lat_hash)     hash;
+    UCS_STATS_NODE_DECLARE(stats)
+} ucp_proto_lat_t;
+
+
+ucs_status_t ucp_proto_lat_init(ucp_proto_lat_t *lat
+                                UCS_STATS_ARG(ucs_stats_node_t *stats_parent));
+
+
+void ucp_proto_lat_cleanup(ucp_proto_lat_t *lat);
+
+
+/**
+ * Account a phase duration of a request.
+ *
+ * @param [in] lat       Worker latency histograms.
+ * @param [in] proto     Protocol which handled the request.
+ * @param [in] length    Message length of the request.
+ * @param [in] phase     Lifecycle phase.
+ * @param [in] duration  Phase duration.
+ */
+void ucp_proto_lat_update(ucp_proto_lat_t *lat, const ucp_proto_t *proto,
+                          size_t length, ucp_proto_lat_phase_t phase,
+                          ucs_time_t duration);
+
+
+/**
+ * Print all latency histograms.
+ */
+void ucp_proto_lat_dump(ucp_proto_lat_t *lat, ucs_string_buffer_t *strb);
+
+#endif
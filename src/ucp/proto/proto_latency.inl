@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifndef UCP_PROTO_LATENCY_INL_
+#define UCP_PROTO_LATENCY_INL_
+
+#include "proto_latency.h"
+#include "proto_select.h"
+
+#include <ucp/core/ucp_request.h>
+#include <ucp/core/ucp_worker.h>
+#include <ucs/time/time.h>
+
+
+#if ENABLE_REQ_LATENCY
+
+/* Completion context, saved before the user callback may release the request */
+typedef struct {
+    ucp_proto_lat_t   *lat;
+    const ucp_proto_t *proto;
+    size_t            length;
+    ucs_time_t        cb_start;
+} ucp_proto_lat_complete_ctx_t;
+
+
+static UCS_F_ALWAYS_INLINE void
+ucp_proto_lat_request_update(ucp_request_t *req,
+                             const ucp_proto_config_t *proto_config,
+                             ucp_proto_lat_phase_t phase, ucs_time_t duration)
+{
+    ucp_proto_lat_update(&req->send.ep->worker->proto_lat, proto_config->proto,
+                         req->send.state.dt_iter.length, phase, duration);
+}
+
+/* Account the time spent in the current stage of the current protocol */
+static UCS_F_ALWAYS_INLINE void
+ucp_proto_lat_request_stage_end(ucp_request_t *req, ucs_time_t now)
+{
+    ucp_proto_lat_request_update(req, req->send.proto_config,
+                                 (ucp_proto_lat_phase_t)(UCP_PROTO_LAT_STAGE +
+                                                         req->send.proto_stage),
+                                 now - req->send.lat.stage_start);
+}
+
+static UCS_F_ALWAYS_INLINE void ucp_proto_lat_request_init(ucp_request_t *req)
+{
+    req->send.lat.start       = ucs_get_time();
+    req->send.lat.stage_start = 0;
+    req->send.lat.wait_start  = 0;
+}
+
+/* Called before the request switches to a new protocol */
+static UCS_F_ALWAYS_INLINE void
+ucp_proto_lat_request_set_proto(ucp_request_t *req,
+                                const ucp_proto_config_t *proto_config)
+{
+    ucs_time_t now = ucs_get_time();
+
+    if (req->send.lat.stage_start == 0) {
+        ucp_proto_lat_request_update(req, proto_config, UCP_PROTO_LAT_SELECT,
+                                     now - req->send.lat.start);
+    } else {
+        ucp_proto_lat_request_stage_end(req, now);
+    }
+
+    /* The first stage of the new protocol starts now */
+    req->send.lat.stage_start = 0;
+}
+
+/* Called before the request switches to a new stage of its protocol */
+static UCS_F_ALWAYS_INLINE void
+ucp_proto_lat_request_set_stage(ucp_request_t *req)
+{
+    ucs_time_t now = ucs_get_time();
+
+    if (req->send.lat.stage_start != 0) {
+        ucp_proto_lat_request_stage_end(req, now);
+    }
+
+    req->send.lat.stage_start = now;
+}
+
+static UCS_F_ALWAYS_INLINE void
+ucp_proto_lat_request_rndv_sent(ucp_request_t *req)
+{
+    req->send.lat.wait_start = ucs_get_time();
+}
+
+static UCS_F_ALWAYS_INLINE void
+ucp_proto_lat_request_rndv_reply(ucp_request_t *req)
+{
+    if (req->send.lat.wait_start != 0) {
+        ucp_proto_lat_request_update(req, req->send.proto_config,
+                                     UCP_PROTO_LAT_RNDV_WAIT,
+                                     ucs_get_time() - req->send.lat.wait_start);
+        req->send.lat.wait_start = 0;
+    }
+}
+
+static UCS_F_ALWAYS_INLINE void
+ucp_proto_lat_request_complete_begin(ucp_request_t *req,
+                                     ucp_proto_lat_complete_ctx_t *ctx)
+{
+    ucs_time_t now;
+
+    ctx->lat      = NULL;
+    ctx->proto    = NULL;
+    ctx->length   = 0;
+    ctx->cb_start = 0;
+
+    /* Send requests of the old protocols are not tracked */
+    if (!(req->flags & UCP_REQUEST_FLAG_PROTO_SEND) ||
+        (req->send.lat.stage_start == 0)) {
+        return;
+    }
+
+    now = ucs_get_time();
+    ucp_proto_lat_request_stage_end(req, now);
+    ucp_proto_lat_request_update(req, req->send.proto_config,
+                                 UCP_PROTO_LAT_TOTAL,
+                                 now - req->send.lat.start);
+
+    ctx->lat      = &req->send.ep->worker->proto_lat;
+    ctx->proto    = req->send.proto_config->proto;
+    ctx->length   = req->send.state.dt_iter.length;
+    ctx->cb_start = now;
+}
+
+static UCS_F_ALWAYS_INLINE void
+ucp_proto_lat_request_complete_end(const ucp_proto_lat_complete_ctx_t *ctx)
+{
+    if (ctx->lat != NULL) {
+        ucp_proto_lat_update(ctx->lat, ctx->proto, ctx->length,
+                             UCP_PROTO_LAT_CALLBACK,
+                             ucs_get_time() - ctx->cb_start);
+    }
+}
+
+/* Measure the duration of a protocol function call */
+#define UCP_PROTO_LAT_CALL(_req, _phase, _func, ...) \
+    ({ \
+        ucs_time_t _lat_start = ucs_get_time(); \
+        typeof(_func(__VA_ARGS__)) _lat_ret = _func(__VA_ARGS__); \
+        ucp_proto_lat_request_update(_req, (_req)->send.proto_config, _phase, \
+                                     ucs_get_time() - _lat_start); \
+        _lat_ret; \
+    })
+
+#else
+
+#define ucp_proto_lat_request_init(_req)
+#define ucp_proto_lat_request_set_proto(_req, _proto_config)
+#define ucp_proto_lat_request_set_stage(_req)
+#define ucp_proto_lat_request_rndv_sent(_req)
+#define ucp_proto_lat_request_rndv_reply(_req)
+#define UCP_PROTO_LAT_CALL(_req, _phase, _func, ...) _func(__VA_ARGS__)
+
+#endif
+
+#endif
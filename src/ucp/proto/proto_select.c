@@ -11,6 +11,7 @@
 #include "proto_init.h"
 #include "proto_debug.h"
 #include "proto_single.h"
+#include "proto_tune.h"
 #include "proto_select.inl"
 
 #include <ucp/core/ucp_context.h>
@@ -215,6 +216,7 @@ ucp_proto_select_init_protocols(ucp_worker_h worker,
                                 ucp_worker_cfg_index_t ep_cfg_index,
                                 ucp_worker_cfg_index_t rkey_cfg_index,
                                 const ucp_proto_select_param_t *select_param,
+                                ucp_proto_id_mask_t proto_mask,
                                 ucp_proto_select_init_protocols_t *proto_init)
 {
     ucp_proto_caps_t proto_caps = {};
@@ -249,7 +251,7 @@ ucp_proto_select_init_protocols(ucp_worker_h worker,
     ucs_array_init_dynamic(&proto_init->protocols);
     ucs_array_init_dynamic(&proto_init->priv_buf);
 
-    ucs_for_each_bit(init_params.proto_id, worker->context->proto_bitmap) {
+    ucs_for_each_bit(init_params.proto_id, proto_mask) {
         ucs_assert(init_params.proto_id < ucp_protocols_count()); /* coverity */
         init_params.priv       = proto_priv;
         init_params.priv_size  = &priv_size;
@@ -389,6 +391,7 @@ static ucs_status_t ucp_proto_select_elem_add_envelope(
                                            return UCS_ERR_NO_MEMORY);
 
             thresh_elem->max_msg_length  = envelope_elem->max_length;
+            thresh_elem->tune            = NULL;
             proto_config                 = &thresh_elem->proto_config;
             proto_config->proto          = ucp_protocols[proto->proto_id];
             proto_config->priv           = proto_priv;
@@ -432,6 +435,54 @@ static ucs_status_t ucp_proto_select_elem_add_envelope(
     return UCS_OK;
 }
 
+/*
+ * Create the tuned thresholds between the selected protocols, if tuning is
+ * enabled or initial thresholds are configured.
+ */
+static void ucp_proto_select_elem_init_tune(
+        ucp_worker_h worker, ucp_proto_select_elem_t *select_elem,
+        const ucp_proto_select_init_protocols_t *proto_init,
+        const ucp_proto_select_param_t *select_param, unsigned num_thresholds)
+{
+    ucp_proto_threshold_elem_t *thresholds = select_elem->thresholds;
+    ucp_context_h context                  = worker->context;
+    const ucp_proto_init_elem_t *proto;
+    ucp_proto_tune_caps_t *caps;
+    unsigned i, proto_idx;
+
+    select_elem->tune = NULL;
+    if (!context->config.ext.proto_tune &&
+        (context->config.proto_tune_thresh.count == 0)) {
+        return;
+    }
+
+    caps = ucs_alloca(sizeof(*caps) * num_thresholds);
+
+    /* Find the initialized protocol of every range */
+    for (i = 0; i < num_thresholds; ++i) {
+        for (proto_idx = 0;
+             proto_idx < ucs_array_length(&proto_init->protocols);
+             ++proto_idx) {
+            proto = &ucs_array_elem(&proto_init->protocols, proto_idx);
+            if ((ucp_protocols[proto->proto_id] ==
+                 thresholds[i].proto_config.proto) &&
+                (UCS_PTR_BYTE_OFFSET(select_elem->priv_buf,
+                                     proto->priv_offset) ==
+                 thresholds[i].proto_config.priv)) {
+                break;
+            }
+        }
+        ucs_assert(proto_idx < ucs_array_length(&proto_init->protocols));
+
+        caps[i].min_length = proto->caps.min_length;
+        caps[i].max_length =
+                proto->caps.ranges[proto->caps.num_ranges - 1].max_length;
+    }
+
+    select_elem->tune = ucp_proto_tune_create(worker, select_param, thresholds,
+                                              num_thresholds, caps);
+}
+
 static ucs_status_t
 ucp_proto_select_elem_init_thresh(ucp_worker_h worker,
                                   ucp_proto_select_elem_t *select_elem,
@@ -447,6 +498,7 @@ ucp_proto_select_elem_init_thresh(ucp_worker_h worker,
     ucp_proto_perf_list_t perf_list;
     ucs_dynamic_bitmap_t proto_mask;
     size_t msg_length, max_length;
+    unsigned num_thresholds;
     ucs_status_t status;
 
     ucs_dynamic_bitmap_init(&proto_mask);
@@ -497,12 +549,16 @@ ucp_proto_select_elem_init_thresh(ucp_worker_h worker,
     ucs_dynamic_bitmap_cleanup(&proto_mask);
 
     ucs_assert_always(!ucs_array_is_empty(&thresholds));
+    num_thresholds = ucs_array_length(&thresholds);
 
     /* Set pointer to priv buffer (to release it during cleanup) */
     select_elem->priv_buf    = ucs_array_extract_buffer(&proto_init->priv_buf);
     select_elem->perf_ranges = ucs_array_extract_buffer(&perf_ranges);
     select_elem->thresholds  = ucs_array_extract_buffer(&thresholds);
 
+    ucp_proto_select_elem_init_tune(worker, select_elem, proto_init,
+                                    select_param, num_thresholds);
+
     return UCS_OK;
 
 err_cleanup_envelope:
@@ -563,6 +619,53 @@ ucp_proto_select_wiface_activate(ucp_worker_h worker,
     ep_config->proto_lane_map |= lane_map;
 }
 
+/**
+ * Get map of protocols used for any message size.
+ */
+static ucp_proto_id_mask_t
+ucp_proto_select_get_proto_mask(const ucp_proto_select_elem_t *select_elem)
+{
+    const ucp_proto_threshold_elem_t *thresh_elem = select_elem->thresholds;
+    ucp_proto_id_mask_t proto_mask                = 0;
+    ucp_proto_id_t proto_id;
+
+    do {
+        for (proto_id = 0; proto_id < ucp_protocols_count(); ++proto_id) {
+            if (ucp_protocols[proto_id] == thresh_elem->proto_config.proto) {
+                proto_mask |= UCS_BIT(proto_id);
+                break;
+            }
+        }
+    } while ((thresh_elem++)->max_msg_length < SIZE_MAX);
+
+    return proto_mask;
+}
+
+static ucs_status_t
+ucp_proto_select_elem_init_protos(ucp_worker_h worker,
+                                  ucp_worker_cfg_index_t ep_cfg_index,
+                                  ucp_worker_cfg_index_t rkey_cfg_index,
+                                  const ucp_proto_select_param_t *select_param,
+                                  ucp_proto_id_mask_t proto_mask,
+                                  ucp_proto_select_elem_t *select_elem)
+{
+    ucp_proto_select_init_protocols_t proto_init;
+    ucs_status_t status;
+
+    status = ucp_proto_select_init_protocols(worker, ep_cfg_index,
+                                             rkey_cfg_index, select_param,
+                                             proto_mask, &proto_init);
+    if (status != UCS_OK) {
+        return status;
+    }
+
+    status = ucp_proto_select_elem_init_thresh(worker, select_elem, &proto_init,
+                                               ep_cfg_index, rkey_cfg_index,
+                                               select_param);
+    ucp_proto_select_cleanup_protocols(&proto_init);
+    return status;
+}
+
 static ucs_status_t
 ucp_proto_select_elem_init(ucp_worker_h worker, int internal,
                            ucp_worker_cfg_index_t ep_cfg_index,
@@ -572,7 +675,9 @@ ucp_proto_select_elem_init(ucp_worker_h worker, int internal,
 {
     UCS_STRING_BUFFER_ONSTACK(sel_param_strb, UCP_PROTO_SELECT_PARAM_STR_MAX);
     UCS_STRING_BUFFER_ONSTACK(config_name_strb, UCP_PROTO_SELECT_PARAM_STR_MAX);
-    ucp_proto_select_init_protocols_t proto_init;
+    ucp_proto_select_store_t *store = &worker->proto_select_store;
+    ucp_proto_id_mask_t stored_mask = 0;
+    ucp_proto_select_store_entry_t store_entry;
     ucs_status_t status;
 
     ucp_proto_select_info_str(worker, rkey_cfg_index, select_param,
@@ -585,20 +690,43 @@ ucp_proto_select_elem_init(ucp_worker_h worker, int internal,
 
     ucs_log_indent(1);
 
-    status = ucp_proto_select_init_protocols(worker, ep_cfg_index,
-                                             rkey_cfg_index, select_param,
-                                             &proto_init);
+    if (ucp_proto_select_store_is_enabled(store)) {
+        ucp_proto_select_store_entry_init(worker, ep_cfg_index, rkey_cfg_index,
+                                          select_param, &store_entry);
+        stored_mask = ucp_proto_select_store_get(store, &store_entry) &
+                      worker->context->proto_bitmap;
+    }
+
+    if (stored_mask != 0) {
+        /* Initialize only the protocols selected by a previous process */
+        status = ucp_proto_select_elem_init_protos(worker, ep_cfg_index,
+                                                   rkey_cfg_index,
+                                                   select_param, stored_mask,
+                                                   select_elem);
+        if (status == UCS_OK) {
+            goto out_activate;
+        }
+
+        ucs_debug("worker %p: failed to select from stored protocols 0x%" PRIx64
+                  " for %s, trying all protocols", worker, stored_mask,
+                  ucs_string_buffer_cstr(&sel_param_strb));
+    }
+
+    status = ucp_proto_select_elem_init_protos(worker, ep_cfg_index,
+                                               rkey_cfg_index, select_param,
+                                               worker->context->proto_bitmap,
+                                               select_elem);
     if (status != UCS_OK) {
         goto out;
     }
 
-    status = ucp_proto_select_elem_init_thresh(worker, select_elem, &proto_init,
-                                               ep_cfg_index, rkey_cfg_index,
-                                               select_param);
-    if (status != UCS_OK) {
-        goto out_cleanup_proto_init;
+    if (ucp_proto_select_store_is_enabled(store) && (stored_mask == 0)) {
+        ucp_proto_select_store_add(store, &store_entry,
+                                   ucp_proto_select_get_proto_mask(
+                                           select_elem));
     }
 
+out_activate:
     ucp_proto_select_wiface_activate(worker, select_elem, ep_cfg_index);
 
     if (!internal) {
@@ -608,8 +736,6 @@ ucp_proto_select_elem_init(ucp_worker_h worker, int internal,
 
     status = UCS_OK;
 
-out_cleanup_proto_init:
-    ucp_proto_select_cleanup_protocols(&proto_init);
 out:
     ucs_log_indent(-1);
     return status;
@@ -625,7 +751,10 @@ ucp_proto_select_elem_cleanup(ucp_proto_select_elem_t *select_elem)
         ucp_proto_perf_node_deref(&range->node);
     } while ((range++)->max_length < SIZE_MAX);
     ucs_free(select_elem->perf_ranges);
-    ucs_free((void*)select_elem->thresholds);
+    if (select_elem->tune != NULL) {
+        ucp_proto_tune_destroy(select_elem->tune);
+    }
+    ucs_free(select_elem->thresholds);
     ucs_free(select_elem->priv_buf);
 }
 
@@ -869,6 +998,57 @@ out_disable:
     ucp_proto_select_short_disable(proto_short);
 }
 
+void ucp_proto_select_warmup(ucp_worker_h worker,
+                             ucp_proto_select_t *proto_select,
+                             ucp_worker_cfg_index_t ep_cfg_index,
+                             ucp_worker_cfg_index_t rkey_cfg_index)
+{
+    ucp_context_h context = worker->context;
+    ucp_proto_select_param_t select_param;
+    ucp_operation_id_t op_id;
+    ucp_memory_info_t mem_info;
+    uint64_t feature;
+    unsigned i;
+
+    for (i = 0; i < context->config.proto_warmup.count; ++i) {
+        op_id = (ucp_operation_id_t)context->config.proto_warmup.elems[i].op_id;
+        switch (op_id) {
+        case UCP_OP_ID_TAG_SEND:
+        case UCP_OP_ID_TAG_SEND_SYNC:
+            feature = UCP_FEATURE_TAG;
+            break;
+        case UCP_OP_ID_AM_SEND:
+        case UCP_OP_ID_AM_SEND_REPLY:
+            feature = UCP_FEATURE_AM;
+            break;
+        default:
+            feature = UCP_FEATURE_RMA;
+            break;
+        }
+
+        /* RMA operations are selected per remote key configuration */
+        if (!(context->config.features & feature) ||
+            ((feature == UCP_FEATURE_RMA) !=
+             (rkey_cfg_index != UCP_WORKER_CFG_INDEX_NULL))) {
+            continue;
+        }
+
+        mem_info.type    = context->config.proto_warmup.elems[i].mem_type;
+        mem_info.sys_dev = UCS_SYS_DEVICE_ID_UNKNOWN;
+        if (!(context->mem_type_mask & UCS_BIT(mem_info.type))) {
+            continue;
+        }
+
+        ucp_proto_select_param_init(
+                &select_param, op_id, 0, 0,
+                context->config.proto_warmup.elems[i].dt_class, &mem_info,
+                context->config.proto_warmup.elems[i].dt_class ==
+                        UCP_DATATYPE_GENERIC ? 0 : 1);
+        ucp_proto_select_lookup(worker, proto_select, ep_cfg_index,
+                                rkey_cfg_index, &select_param, 0);
+    }
+}
+
 int ucp_proto_select_get_valid_range(
         const ucp_proto_threshold_elem_t *thresholds, size_t *min_length_p,
         size_t *max_length_p)
@@ -41,6 +41,11 @@
 #define UCP_PROTO_SELECT_PARAM_STR_MAX 128
 
 
+/* Online tuning state of protocol thresholds, defined in proto_tune.h */
+typedef struct ucp_proto_tune      ucp_proto_tune_t;
+typedef struct ucp_proto_tune_elem ucp_proto_tune_elem_t;
+
+
 /**
  * Key for looking up protocol configuration by operation parameters
  */
@@ -103,6 +108,8 @@ typedef struct {
 typedef struct {
     ucp_proto_config_t          proto_config;   /* Protocol configuration to use */
     size_t                      max_msg_length; /* Max message length, inclusive */
+    ucp_proto_tune_elem_t       *tune;          /* Tuned thresholds of the range,
+                                                   or NULL */
 } ucp_proto_threshold_elem_t;
 
 
@@ -110,14 +117,18 @@ typedef struct {
  * Protocol selection per a particular buffer type and operation
  */
 typedef struct {
-    /* Array of which protocol to use for different message sizes */
-    const ucp_proto_threshold_elem_t *thresholds;
+    /* Array of which protocol to use for different message sizes. The
+     * thresholds are modified by protocol tuning (UCX_PROTO_TUNE) */
+    ucp_proto_threshold_elem_t       *thresholds;
 
     /* Estimated performance for the selected protocols */
     ucp_proto_perf_range_t           *perf_ranges;
 
     /* Private configuration area for the selected protocols */
     void                             *priv_buf;
+
+    /* Tuned thresholds between the selected protocols, or NULL */
+    ucp_proto_tune_t                 *tune;
 } ucp_proto_select_elem_t;
 
 
@@ -195,6 +206,16 @@ void ucp_proto_select_short_init(ucp_worker_h worker,
                                  ucp_proto_select_short_t *proto_short);
 
 
+/*
+ * Select protocols for the operations configured by UCX_PROTO_WARMUP, so the
+ * first messages would not have to wait for protocol selection.
+ */
+void ucp_proto_select_warmup(ucp_worker_h worker,
+                             ucp_proto_select_t *proto_select,
+                             ucp_worker_cfg_index_t ep_cfg_index,
+                             ucp_worker_cfg_index_t rkey_cfg_index);
+
+
 int ucp_proto_select_get_valid_range(
         const ucp_proto_threshold_elem_t *thresholds, size_t *min_length_p,
         size_t *max_length_p);
@@ -0,0 +1,305 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "proto_select_store.h"
+#include "proto_select.inl"
+
+#include <ucp/core/ucp_context.h>
+#include <ucp/core/ucp_worker.h>
+#include <ucs/algorithm/crc.h>
+#include <ucs/config/parser.h>
+#include <ucs/debug/log.h>
+#include <ucs/sys/cache_file.h>
+#include <ucs/sys/topo/base/topo.h>
+
+
+KHASH_IMPL(ucp_proto_select_store_hash, uint64_t, unsigned, 1,
+           kh_int64_hash_func, kh_int64_hash_equal);
+
+
+static uint64_t
+ucp_proto_select_store_entry_key(const ucp_proto_select_store_entry_t *entry)
+{
+    return ((uint64_t)entry->config_crc << 32) |
+           ucs_crc32(entry->config_crc, &entry->param, sizeof(entry->param));
+}
+
+static uint32_t ucp_proto_select_store_config_crc(ucp_context_h context)
+{
+    ucp_tl_resource_desc_t *rsc;
+    ucp_proto_id_t proto_id;
+    const char *proto_name;
+    uint32_t config_crc;
+
+    /* Transports are configured by the environment and configuration files,
+     * and protocols also by values set by ucp_config_modify() */
+    config_crc  = ucs_config_parser_checksum(UCS_DEFAULT_ENV_PREFIX,
+                                             &context->cached_key_list);
+    config_crc ^= ucp_context_config_checksum(context);
+
+    /* Protocol identifiers are saved in the file */
+    ucs_for_each_bit(proto_id, context->proto_bitmap) {
+        proto_name = ucp_proto_id_field(proto_id, name);
+        config_crc = ucs_crc32(config_crc, &proto_id, sizeof(proto_id));
+        config_crc = ucs_crc32(config_crc, proto_name, strlen(proto_name) + 1);
+    }
+
+    /* Resource indexes are used by endpoint configurations */
+    ucs_carray_for_each(rsc, context->tl_rscs, context->num_tls) {
+        config_crc = ucs_crc32(config_crc, rsc->tl_rsc.tl_name,
+                               strlen(rsc->tl_rsc.tl_name) + 1);
+        config_crc = ucs_crc32(config_crc, rsc->tl_rsc.dev_name,
+                               strlen(rsc->tl_rsc.dev_name) + 1);
+        config_crc = ucs_crc32(config_crc, &rsc->md_index,
+                               sizeof(rsc->md_index));
+    }
+
+    return config_crc;
+}
+
+static void
+ucp_proto_select_store_insert(ucp_proto_select_store_t *store,
+                              const ucp_proto_select_store_entry_t *entry)
+{
+    ucp_proto_select_store_entry_t *new_entry;
+    khiter_t khiter;
+    int khret;
+
+    khiter = kh_put(ucp_proto_select_store_hash, &store->hash,
+                    ucp_proto_select_store_entry_key(entry), &khret);
+    if (khret == UCS_KH_PUT_FAILED) {
+        return;
+    }
+
+    if (khret == UCS_KH_PUT_KEY_PRESENT) {
+        /* Replace the existing entry */
+        ucs_array_elem(&store->entries, kh_value(&store->hash, khiter)) =
+                *entry;
+        return;
+    }
+
+    new_entry = ucs_array_append(&store->entries,
+                                 kh_del(ucp_proto_select_store_hash,
+                                        &store->hash, khiter);
+                                 return);
+    *new_entry                     = *entry;
+    kh_value(&store->hash, khiter) = ucs_array_length(&store->entries) - 1;
+}
+
+static void ucp_proto_select_store_load(ucp_proto_select_store_t *store)
+{
+    const ucp_proto_select_store_entry_t *entries, *entry;
+    size_t length;
+
+    entries = ucs_cache_file_map(store->path, UCP_PROTO_SELECT_STORE_MAGIC,
+                                 UCP_PROTO_SELECT_STORE_VERSION, store->key,
+                                 &length);
+    if (entries == NULL) {
+        return;
+    }
+
+    if ((length % sizeof(*entries)) != 0) {
+        ucs_debug("protocol selection cache %s is invalid", store->path);
+        goto out_unmap;
+    }
+
+    ucs_carray_for_each(entry, entries, length / sizeof(*entries)) {
+        ucp_proto_select_store_insert(store, entry);
+    }
+
+    store->num_loaded = ucs_array_length(&store->entries);
+    ucs_debug("loaded protocol selection cache %s with %u entries",
+              store->path, store->num_loaded);
+
+out_unmap:
+    ucs_cache_file_unmap(entries, length);
+}
+
+void ucp_proto_select_store_init(ucp_proto_select_store_t *store,
+                                 ucp_context_h context)
+{
+    const char *dir = context->config.ext.proto_select_cache_dir;
+    ucs_status_t status;
+
+    store->path[0]    = '\0';
+    store->key        = 0;
+    store->num_loaded = 0;
+    store->num_hits   = 0;
+    store->num_misses = 0;
+    ucs_array_init_dynamic(&store->entries);
+    kh_init_inplace(ucp_proto_select_store_hash, &store->hash);
+
+    if (ucs_string_is_empty(dir) || !context->config.ext.proto_enable) {
+        return;
+    }
+
+    status = ucs_cache_file_key(ucp_proto_select_store_config_crc(context),
+                                &store->key);
+    if (status != UCS_OK) {
+        ucs_debug("protocol selection cache is disabled: failed to get boot "
+                  "id");
+        return;
+    }
+
+    ucs_cache_file_path(store->path, sizeof(store->path), dir,
+                        UCP_PROTO_SELECT_STORE_NAME, store->key);
+    ucp_proto_select_store_load(store);
+}
+
+static void ucp_proto_select_store_save(ucp_proto_select_store_t *store)
+{
+    struct iovec iov;
+    ucs_status_t status;
+
+    iov.iov_base = ucs_array_begin(&store->entries);
+    iov.iov_len  = ucs_array_length(&store->entries) *
+                   sizeof(ucp_proto_select_store_entry_t);
+    status       = ucs_cache_file_save(store->path,
+                                       UCP_PROTO_SELECT_STORE_MAGIC,
+                                       UCP_PROTO_SELECT_STORE_VERSION,
+                                       store->key, &iov, 1);
+    if (status == UCS_OK) {
+        ucs_debug("saved protocol selection cache %s with %u entries",
+                  store->path, ucs_array_length(&store->entries));
+    }
+}
+
+void ucp_proto_select_store_cleanup(ucp_proto_select_store_t *store, int save)
+{
+    if (ucp_proto_select_store_is_enabled(store)) {
+        ucs_debug("protocol selection cache %s: %u hits, %u misses",
+                  store->path, store->num_hits, store->num_misses);
+        if (save && (store->num_misses > 0)) {
+            ucp_proto_select_store_save(store);
+        }
+    }
+
+    kh_destroy_inplace(ucp_proto_select_store_hash, &store->hash);
+    ucs_array_cleanup_dynamic(&store->entries);
+}
+
+static uint32_t ucp_proto_select_store_sys_dev_crc(uint32_t crc,
+                                                   ucs_sys_device_t sys_dev)
+{
+    ucs_sys_bus_id_t bus_id;
+
+    /* System device indexes depend on the discovery order, so use bus id */
+    if ((sys_dev != UCS_SYS_DEVICE_ID_UNKNOWN) &&
+        (ucs_topo_get_device_bus_id(sys_dev, &bus_id) == UCS_OK)) {
+        return ucs_crc32(crc, &bus_id, sizeof(bus_id));
+    }
+
+    return ucs_crc32(crc, &sys_dev, sizeof(sys_dev));
+}
+
+void ucp_proto_select_store_entry_init(
+        ucp_worker_h worker, ucp_worker_cfg_index_t ep_cfg_index,
+        ucp_worker_cfg_index_t rkey_cfg_index,
+        const ucp_proto_select_param_t *select_param,
+        ucp_proto_select_store_entry_t *entry)
+{
+    const ucp_ep_config_key_t *key = &ucs_array_elem(&worker->ep_config,
+                                                     ep_cfg_index).key;
+    const ucp_ep_config_key_lane_t *lane;
+    const ucp_rkey_config_key_t *rkey_key;
+    ucp_proto_select_param_t param;
+    ucp_operation_id_t op_id;
+    uint32_t crc;
+
+    crc = ucs_crc32(0, &key->num_lanes, sizeof(key->num_lanes));
+    ucs_carray_for_each(lane, key->lanes, key->num_lanes) {
+        crc = ucs_crc32(crc, &lane->rsc_index, sizeof(lane->rsc_index));
+        crc = ucs_crc32(crc, &lane->dst_md_index, sizeof(lane->dst_md_index));
+        crc = ucp_proto_select_store_sys_dev_crc(crc, lane->dst_sys_dev);
+        crc = ucs_crc32(crc, &lane->path_index, sizeof(lane->path_index));
+        crc = ucs_crc32(crc, &lane->lane_types, sizeof(lane->lane_types));
+        crc = ucs_crc32(crc, &lane->seg_size, sizeof(lane->seg_size));
+    }
+
+    crc = ucs_crc32(crc, &key->am_lane, sizeof(key->am_lane));
+    crc = ucs_crc32(crc, &key->tag_lane, sizeof(key->tag_lane));
+    crc = ucs_crc32(crc, &key->wireup_msg_lane, sizeof(key->wireup_msg_lane));
+    crc = ucs_crc32(crc, &key->cm_lane, sizeof(key->cm_lane));
+    crc = ucs_crc32(crc, &key->keepalive_lane, sizeof(key->keepalive_lane));
+    crc = ucs_crc32(crc, key->rma_lanes, sizeof(key->rma_lanes));
+    crc = ucs_crc32(crc, key->rma_bw_lanes, sizeof(key->rma_bw_lanes));
+    crc = ucs_crc32(crc, &key->rkey_ptr_lane, sizeof(key->rkey_ptr_lane));
+    crc = ucs_crc32(crc, key->amo_lanes, sizeof(key->amo_lanes));
+    crc = ucs_crc32(crc, key->am_bw_lanes, sizeof(key->am_bw_lanes));
+    crc = ucs_crc32(crc, &key->rma_bw_md_map, sizeof(key->rma_bw_md_map));
+    crc = ucs_crc32(crc, &key->rma_md_map, sizeof(key->rma_md_map));
+    crc = ucs_crc32(crc, &key->reachable_md_map,
+                    sizeof(key->reachable_md_map));
+    crc = ucs_crc32(crc, key->dst_md_cmpts,
+                    ucs_popcount(key->reachable_md_map) *
+                    sizeof(*key->dst_md_cmpts));
+    crc = ucs_crc32(crc, &key->err_mode, sizeof(key->err_mode));
+    crc = ucs_crc32(crc, &key->flags, sizeof(key->flags));
+    crc = ucs_crc32(crc, &key->dst_version, sizeof(key->dst_version));
+
+    if (rkey_cfg_index != UCP_WORKER_CFG_INDEX_NULL) {
+        rkey_key = &worker->rkey_config[rkey_cfg_index].key;
+        crc      = ucs_crc32(crc, &rkey_key->md_map, sizeof(rkey_key->md_map));
+        crc      = ucp_proto_select_store_sys_dev_crc(crc, rkey_key->sys_dev);
+        crc      = ucs_crc32(crc, &rkey_key->mem_type,
+                             sizeof(rkey_key->mem_type));
+        crc      = ucs_crc32(crc, &rkey_key->unreachable_md_map,
+                             sizeof(rkey_key->unreachable_md_map));
+    }
+
+    /* Move system devices from the selection parameters to the checksum */
+    param         = *select_param;
+    crc           = ucp_proto_select_store_sys_dev_crc(crc, param.sys_dev);
+    param.sys_dev = UCS_SYS_DEVICE_ID_UNKNOWN;
+    op_id         = ucp_proto_select_op_id(&param);
+    if ((op_id == UCP_OP_ID_AMO_FETCH) || (op_id == UCP_OP_ID_AMO_CSWAP)) {
+        crc = ucp_proto_select_store_sys_dev_crc(crc, param.op.reply.sys_dev);
+        param.op.reply.sys_dev = UCS_SYS_DEVICE_ID_UNKNOWN;
+    }
+
+    UCS_STATIC_ASSERT(sizeof(param) == sizeof(entry->param));
+    memcpy(&entry->param, &param, sizeof(entry->param));
+    entry->config_crc = crc;
+    entry->reserved   = 0;
+    entry->proto_mask = 0;
+}
+
+ucp_proto_id_mask_t
+ucp_proto_select_store_get(ucp_proto_select_store_t *store,
+                           const ucp_proto_select_store_entry_t *entry)
+{
+    const ucp_proto_select_store_entry_t *found;
+    khiter_t khiter;
+
+    khiter = kh_get(ucp_proto_select_store_hash, &store->hash,
+                    ucp_proto_select_store_entry_key(entry));
+    if (khiter != kh_end(&store->hash)) {
+        found = &ucs_array_elem(&store->entries,
+                                kh_value(&store->hash, khiter));
+        if ((found->param == entry->param) &&
+            (found->config_crc == entry->config_crc)) {
+            ++store->num_hits;
+            return found->proto_mask;
+        }
+    }
+
+    ++store->num_misses;
+    return 0;
+}
+
+void ucp_proto_select_store_add(ucp_proto_select_store_t *store,
+                                const ucp_proto_select_store_entry_t *entry,
+                                ucp_proto_id_mask_t proto_mask)
+{
+    ucp_proto_select_store_entry_t new_entry = *entry;
+
+    new_entry.proto_mask = proto_mask;
+    ucp_proto_select_store_insert(store, &new_entry);
+}
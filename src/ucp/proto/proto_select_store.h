@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifndef UCP_PROTO_SELECT_STORE_H_
+#define UCP_PROTO_SELECT_STORE_H_
+
+#include "proto.h"
+
+#include <ucs/datastruct/array.h>
+#include <ucs/datastruct/khash.h>
+#include <ucs/sys/string.h>
+#include <limits.h>
+
+
+#define UCP_PROTO_SELECT_STORE_NAME    "ucp_proto"
+#define UCP_PROTO_SELECT_STORE_MAGIC   "UCPPSEL"
+#define UCP_PROTO_SELECT_STORE_VERSION 2u
+
+
+/*
+ * Persistent protocol selection store
+ *
+ * When UCX_PROTO_SELECT_CACHE_DIR is set, the protocols selected for every
+ * (endpoint configuration, remote key configuration, selection parameters)
+ * tuple are saved to a per-user cache file (see ucs/sys/cache_file.h) in that
+ * directory when the worker is destroyed. Workers of the next processes with
+ * the same configuration load the file and initialize only the protocols that
+ * were selected before, instead of probing all of them. The performance
+ * estimations and protocol private configuration are still computed by every
+ * process, since they refer to process-local objects.
+ *
+ * The file key depends on the UCX configuration, the list of protocols and the
+ * transport resources of the context. Entries are keyed by a checksum of the
+ * endpoint and remote key configurations, in which system devices are replaced
+ * by their bus id, so they can be matched by other processes.
+ *
+ * File data layout:
+ *
+ *   ucp_proto_select_store_entry_t[num_entries]
+ */
+typedef struct {
+    /* Selection parameters, with system devices set to unknown */
+    uint64_t            param;
+    /* Checksum of endpoint/remote key configurations and system devices */
+    uint32_t            config_crc;
+    uint32_t            reserved;
+    /* Protocols selected for some range of message sizes */
+    ucp_proto_id_mask_t proto_mask;
+} ucp_proto_select_store_entry_t;
+
+
+UCS_ARRAY_DECLARE_TYPE(ucp_proto_select_store_entries_t, unsigned,
+                       ucp_proto_select_store_entry_t);
+
+
+/* Hash of entry key to its index in the entries array */
+KHASH_TYPE(ucp_proto_select_store_hash, uint64_t, unsigned);
+
+
+/*
+ * Protocol selection store of a worker.
+ */
+typedef struct {
+    /* Store file path, or empty string if the store is disabled */
+    char                                 path[PATH_MAX];
+    /* Key of the current host and configuration */
+    uint64_t                             key;
+    /* Loaded and added selection entries */
+    ucp_proto_select_store_entries_t     entries;
+    /* Lookup of selection entries */
+    khash_t(ucp_proto_select_store_hash) hash;
+    /* Number of entries loaded from the file */
+    unsigned                             num_loaded;
+    /* Number of selections which used the protocols from the store */
+    unsigned                             num_hits;
+    /* Number of selections which were not found in the store, and were added
+     * to it */
+    unsigned                             num_misses;
+} ucp_proto_select_store_t;
+
+
+/**
+ * Initialize the protocol selection store and load the existing file, if any.
+ *
+ * @param [out] store    Protocol selection store to initialize.
+ * @param [in]  context  UCP context of the worker.
+ */
+void ucp_proto_select_store_init(ucp_proto_select_store_t *store,
+                                 ucp_context_h context);
+
+
+/**
+ * Save the file if new entries were added, and release the store.
+ *
+ * @param [in]  store    Protocol selection store to clean up.
+ * @param [in]  save     Whether to save the entries.
+ */
+void ucp_proto_select_store_cleanup(ucp_proto_select_store_t *store,
+                                    int save);
+
+
+/**
+ * Build the store entry of a protocol selection.
+ *
+ * @param [in]  worker          UCP worker.
+ * @param [in]  ep_cfg_index    Endpoint configuration index.
+ * @param [in]  rkey_cfg_index  Remote key configuration index, or
+ *                              UCP_WORKER_CFG_INDEX_NULL.
+ * @param [in]  select_param    Protocol selection parameters.
+ * @param [out] entry           Filled with the entry key, and an empty protocol
+ *                              mask.
+ */
+void ucp_proto_select_store_entry_init(
+        ucp_worker_h worker, ucp_worker_cfg_index_t ep_cfg_index,
+        ucp_worker_cfg_index_t rkey_cfg_index,
+        const ucp_proto_select_param_t *select_param,
+        ucp_proto_select_store_entry_t *entry);
+
+
+/**
+ * Find the protocols which were selected for an entry.
+ *
+ * @param [in]  store    Protocol selection store.
+ * @param [in]  entry    Entry to look up, initialized by
+ *                       @ref ucp_proto_select_store_entry_init.
+ *
+ * @return Mask of selected protocols, or 0 if the entry is not found.
+ */
+ucp_proto_id_mask_t
+ucp_proto_select_store_get(ucp_proto_select_store_t *store,
+                           const ucp_proto_select_store_entry_t *entry);
+
+
+/**
+ * Add the protocols selected for an entry.
+ *
+ * @param [in]  store       Protocol selection store.
+ * @param [in]  entry       Entry initialized by
+ *                          @ref ucp_proto_select_store_entry_init.
+ * @param [in]  proto_mask  Mask of selected protocols.
+ */
+void ucp_proto_select_store_add(ucp_proto_select_store_t *store,
+                                const ucp_proto_select_store_entry_t *entry,
+                                ucp_proto_id_mask_t proto_mask);
+
+
+static UCS_F_ALWAYS_INLINE int
+ucp_proto_select_store_is_enabled(const ucp_proto_select_store_t *store)
+{
+    return !ucs_string_is_empty(store->path);
+}
+
+#endif
@@ -0,0 +1,399 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "proto_tune.h"
+#include "proto_debug.h"
+#include "proto_select.inl"
+
+#include <ucp/core/ucp_context.h>
+#include <ucp/core/ucp_ep.h>
+#include <ucp/core/ucp_request.h>
+#include <ucp/core/ucp_worker.h>
+#include <ucs/datastruct/string_set.h>
+#include <ucs/debug/memtrack_int.h>
+#include <ucs/time/time.h>
+
+
+/* Protocols whose thresholds are not tuned */
+#define UCP_PROTO_TUNE_SKIP_FLAGS \
+    (UCP_PROTO_FLAG_AM_SHORT | UCP_PROTO_FLAG_PUT_SHORT | \
+     UCP_PROTO_FLAG_TAG_SHORT | UCP_PROTO_FLAG_INVALID)
+
+
+static size_t ucp_proto_tune_mul_sat(size_t value, size_t factor)
+{
+    return (value > (SIZE_MAX / factor)) ? SIZE_MAX : (value * factor);
+}
+
+/* First message length of the upper protocol */
+static UCS_F_ALWAYS_INLINE size_t
+ucp_proto_tune_thresh(const ucp_proto_tune_bound_t *bound)
+{
+    return bound->lower->max_msg_length + 1;
+}
+
+/* First message length of the lower protocol */
+static size_t ucp_proto_tune_lower_start(const ucp_proto_tune_bound_t *bound)
+{
+    return bound->lower_first ? 0 : ((bound->lower - 1)->max_msg_length + 1);
+}
+
+/*
+ * Move the threshold as close as possible to 'thresh', while keeping it within
+ * its limits and keeping both protocol ranges non-empty.
+ */
+static void
+ucp_proto_tune_set_thresh(ucp_proto_tune_bound_t *bound, size_t thresh)
+{
+    size_t min_thresh = ucs_max(bound->min_thresh,
+                                ucp_proto_tune_lower_start(bound) + 1);
+    size_t max_thresh = ucs_min(bound->max_thresh,
+                                (bound->lower + 1)->max_msg_length);
+
+    if (min_thresh <= max_thresh) {
+        thresh                       = ucs_max(thresh, min_thresh);
+        bound->lower->max_msg_length = ucs_min(thresh, max_thresh) - 1;
+    }
+}
+
+static void
+ucp_proto_tune_apply_config(ucp_context_h context,
+                            const ucp_proto_select_param_t *select_param,
+                            ucp_proto_tune_bound_t *bound)
+{
+    const ucp_proto_t *lower_proto = bound->lower->proto_config.proto;
+    const ucp_proto_t *upper_proto = (bound->lower + 1)->proto_config.proto;
+    unsigned i;
+
+    for (i = 0; i < context->config.proto_tune_thresh.count; ++i) {
+        if ((context->config.proto_tune_thresh.elems[i].op_id ==
+             ucp_proto_select_op_id(select_param)) &&
+            (context->config.proto_tune_thresh.elems[i].mem_type ==
+             select_param->mem_type) &&
+            (ucp_protocols[context->config.proto_tune_thresh.elems[i]
+                                   .lower_proto] == lower_proto) &&
+            (ucp_protocols[context->config.proto_tune_thresh.elems[i]
+                                   .upper_proto] == upper_proto)) {
+            ucp_proto_tune_set_thresh(
+                    bound, context->config.proto_tune_thresh.elems[i].thresh);
+        }
+    }
+}
+
+ucp_proto_tune_t *
+ucp_proto_tune_create(ucp_worker_h worker,
+                      const ucp_proto_select_param_t *select_param,
+                      ucp_proto_threshold_elem_t *thresholds,
+                      unsigned num_thresholds,
+                      const ucp_proto_tune_caps_t *caps)
+{
+    ucp_context_h context = worker->context;
+    size_t range          = ucs_max(context->config.ext.proto_tune_range, 1);
+    ucp_proto_threshold_elem_t *lower, *upper;
+    ucp_proto_tune_bound_t *bound;
+    size_t thresh, min_thresh, max_thresh;
+    ucp_proto_tune_t *tune;
+    unsigned i;
+
+    if (num_thresholds < 2) {
+        return NULL;
+    }
+
+    tune = ucs_calloc(1,
+                      sizeof(*tune) +
+                              (sizeof(*tune->bounds) * (num_thresholds - 1)) +
+                              (sizeof(*tune->elems) * num_thresholds),
+                      "ucp_proto_tune");
+    if (tune == NULL) {
+        ucs_warn("worker %p: failed to allocate protocol tuning state",
+                 worker);
+        return NULL;
+    }
+
+    tune->bounds = (ucp_proto_tune_bound_t*)(tune + 1);
+    tune->elems  = (ucp_proto_tune_elem_t*)(tune->bounds +
+                                            (num_thresholds - 1));
+
+    for (i = 0; i < (num_thresholds - 1); ++i) {
+        lower = &thresholds[i];
+        upper = &thresholds[i + 1];
+        if ((lower->proto_config.proto->flags & UCP_PROTO_TUNE_SKIP_FLAGS) ||
+            (upper->proto_config.proto->flags & UCP_PROTO_TUNE_SKIP_FLAGS) ||
+            (lower->proto_config.cfg_thresh != UCS_MEMUNITS_AUTO) ||
+            (upper->proto_config.cfg_thresh != UCS_MEMUNITS_AUTO)) {
+            continue;
+        }
+
+        thresh     = lower->max_msg_length + 1;
+        min_thresh = ucs_max(thresh / range, 1);
+        max_thresh = (caps[i].max_length == SIZE_MAX) ?
+                             SIZE_MAX : (caps[i].max_length + 1);
+
+        bound                   = &tune->bounds[tune->num_bounds++];
+        bound->lower            = lower;
+        bound->lower_first      = (i == 0);
+        bound->orig_thresh      = thresh;
+        bound->upper_min_length = caps[i + 1].min_length;
+        bound->lower_max_length = caps[i].max_length;
+        bound->min_thresh       = ucs_max(min_thresh, caps[i + 1].min_length);
+        bound->max_thresh       = ucs_min(max_thresh,
+                                          ucp_proto_tune_mul_sat(thresh, range));
+
+        tune->elems[i].above     = bound;
+        tune->elems[i + 1].below = bound;
+        if (context->config.ext.proto_tune) {
+            /* Send requests of the ranges are measured */
+            lower->tune = &tune->elems[i];
+            upper->tune = &tune->elems[i + 1];
+        }
+
+        ucp_proto_tune_apply_config(context, select_param, bound);
+    }
+
+    if (tune->num_bounds == 0) {
+        ucs_free(tune);
+        return NULL;
+    }
+
+    return tune;
+}
+
+void ucp_proto_tune_destroy(ucp_proto_tune_t *tune)
+{
+    ucs_free(tune);
+}
+
+#if ENABLE_PROTO_TUNE
+
+/* First message length in which the upper protocol is also used */
+static size_t ucp_proto_tune_window_start(const ucp_proto_tune_bound_t *bound)
+{
+    size_t start = ucs_max(ucp_proto_tune_thresh(bound) / 2,
+                           ucp_proto_tune_lower_start(bound));
+
+    return ucs_max(start, bound->upper_min_length);
+}
+
+/* Last message length in which the lower protocol is also used */
+static size_t ucp_proto_tune_window_last(const ucp_proto_tune_bound_t *bound)
+{
+    size_t last = ucp_proto_tune_mul_sat(ucp_proto_tune_thresh(bound), 2) - 1;
+
+    last = ucs_min(last, (bound->lower + 1)->max_msg_length);
+    return ucs_min(last, bound->lower_max_length);
+}
+
+const ucp_proto_config_t *
+ucp_proto_tune_select(ucp_request_t *req,
+                      const ucp_proto_threshold_elem_t *thresh_elem,
+                      size_t msg_length)
+{
+    const ucp_proto_threshold_elem_t *explore_elem;
+    ucp_proto_tune_bound_t *bound;
+
+    bound = thresh_elem->tune->above;
+    if ((bound != NULL) && (msg_length >= ucp_proto_tune_window_start(bound))) {
+        explore_elem = bound->lower + 1;
+    } else {
+        bound = thresh_elem->tune->below;
+        if ((bound == NULL) ||
+            (msg_length > ucp_proto_tune_window_last(bound))) {
+            req->send.tune.bound = NULL;
+            return &thresh_elem->proto_config;
+        }
+
+        explore_elem = bound->lower;
+    }
+
+    if ((++bound->num_selected % UCP_PROTO_TUNE_EXPLORE_INTERVAL) == 0) {
+        thresh_elem = explore_elem;
+    }
+
+    req->send.tune.bound = bound;
+    req->send.tune.start = ucs_get_time();
+    return &thresh_elem->proto_config;
+}
+
+static double ucp_proto_tune_time_per_byte(const ucp_proto_tune_stat_t *stat)
+{
+    return (double)stat->time / ucs_max(stat->length, 1);
+}
+
+static void ucp_proto_tune_check(ucp_worker_h worker,
+                                 ucp_proto_tune_bound_t *bound,
+                                 ucp_proto_tune_window_t window)
+{
+    unsigned min_samples          = worker->context->config.ext.proto_tune_samples;
+    ucp_proto_tune_stat_t *stats  = bound->stats[window];
+    size_t thresh                 = ucp_proto_tune_thresh(bound);
+    ucp_proto_tune_arm_t current, other;
+    size_t new_thresh;
+
+    if ((stats[UCP_PROTO_TUNE_ARM_LOWER].count < min_samples) ||
+        (stats[UCP_PROTO_TUNE_ARM_UPPER].count < min_samples)) {
+        return;
+    }
+
+    if (window == UCP_PROTO_TUNE_WINDOW_BELOW) {
+        current    = UCP_PROTO_TUNE_ARM_LOWER;
+        other      = UCP_PROTO_TUNE_ARM_UPPER;
+        new_thresh = ucp_proto_tune_window_start(bound);
+    } else {
+        current    = UCP_PROTO_TUNE_ARM_UPPER;
+        other      = UCP_PROTO_TUNE_ARM_LOWER;
+        new_thresh = ucp_proto_tune_window_last(bound) + 1;
+    }
+
+    if ((ucp_proto_tune_time_per_byte(&stats[other]) *
+         (1.0 + UCP_PROTO_TUNE_MIN_GAIN)) <
+        ucp_proto_tune_time_per_byte(&stats[current])) {
+        ucp_proto_tune_set_thresh(bound, new_thresh);
+    }
+
+    if (ucp_proto_tune_thresh(bound) == thresh) {
+        /* Start a new round for this window */
+        memset(stats, 0, sizeof(bound->stats[window]));
+        return;
+    }
+
+    ucs_debug("worker %p: moved threshold between %s and %s from %zu to %zu",
+              worker, bound->lower->proto_config.proto->name,
+              (bound->lower + 1)->proto_config.proto->name, thresh,
+              ucp_proto_tune_thresh(bound));
+
+    /* Both windows have moved */
+    ++bound->num_moves;
+    memset(bound->stats, 0, sizeof(bound->stats));
+}
+
+void ucp_proto_tune_update(ucp_worker_h worker, ucp_proto_tune_bound_t *bound,
+                           const ucp_proto_config_t *proto_config,
+                           size_t length, ucs_time_t duration)
+{
+    ucp_proto_tune_window_t window;
+    ucp_proto_tune_stat_t *stat;
+    ucp_proto_tune_arm_t arm;
+
+    if (proto_config == &bound->lower->proto_config) {
+        arm = UCP_PROTO_TUNE_ARM_LOWER;
+    } else if (proto_config == &(bound->lower + 1)->proto_config) {
+        arm = UCP_PROTO_TUNE_ARM_UPPER;
+    } else {
+        /* The request has switched to another protocol */
+        return;
+    }
+
+    window = (length < ucp_proto_tune_thresh(bound)) ?
+                     UCP_PROTO_TUNE_WINDOW_BELOW :
+                     UCP_PROTO_TUNE_WINDOW_ABOVE;
+    stat   = &bound->stats[window][arm];
+    ++stat->count;
+    stat->length += length;
+    stat->time   += duration;
+
+    ucp_proto_tune_check(worker, bound, window);
+}
+
+#endif
+
+static void ucp_proto_tune_dump_select(ucp_worker_h worker,
+                                       ucp_proto_select_t *proto_select,
+                                       ucp_worker_cfg_index_t ep_cfg_index,
+                                       ucp_worker_cfg_index_t rkey_cfg_index,
+                                       ucs_string_set_t *export_keys,
+                                       ucs_string_buffer_t *export_strb,
+                                       ucs_string_buffer_t *strb)
+{
+    UCS_STRING_BUFFER_ONSTACK(key_strb, 256);
+    const ucp_proto_tune_bound_t *bound;
+    ucp_proto_select_elem_t select_elem;
+    ucp_proto_select_key_t key;
+    const char *lower_name, *upper_name;
+    unsigned i;
+
+    kh_foreach(proto_select->hash, key.u64, select_elem, {
+        if (select_elem.tune == NULL) {
+            continue;
+        }
+
+        ucp_ep_config_name(worker, ep_cfg_index, strb);
+        ucs_string_buffer_appendf(strb, " ");
+        ucp_proto_select_info_str(worker, rkey_cfg_index, &key.param,
+                                  ucp_operation_names, strb);
+        ucs_string_buffer_appendf(strb, "\n");
+
+        for (i = 0; i < select_elem.tune->num_bounds; ++i) {
+            bound      = &select_elem.tune->bounds[i];
+            lower_name = bound->lower->proto_config.proto->name;
+            upper_name = (bound->lower + 1)->proto_config.proto->name;
+            ucs_string_buffer_appendf(strb,
+                                      "    %s -> %s: %zu (estimated %zu, "
+                                      "limits %zu..%zu, moved %u times)\n",
+                                      lower_name, upper_name,
+                                      ucp_proto_tune_thresh(bound),
+                                      bound->orig_thresh, bound->min_thresh,
+                                      bound->max_thresh, bound->num_moves);
+
+            /* Export the first threshold of every operation and protocols */
+            ucs_string_buffer_reset(&key_strb);
+            ucs_string_buffer_appendf(
+                    &key_strb, "%s:%s:%s:%s",
+                    ucp_operation_names[ucp_proto_select_op_id(&key.param)],
+                    ucs_memory_type_names[key.param.mem_type], lower_name,
+                    upper_name);
+            if (ucs_string_set_contains(export_keys,
+                                        ucs_string_buffer_cstr(&key_strb)) ||
+                (ucs_string_set_add(export_keys,
+                                    ucs_string_buffer_cstr(&key_strb)) !=
+                 UCS_OK)) {
+                continue;
+            }
+
+            ucs_string_buffer_appendf(export_strb, "%s:%zu,",
+                                      ucs_string_buffer_cstr(&key_strb),
+                                      ucp_proto_tune_thresh(bound));
+        }
+    })
+}
+
+void ucp_proto_tune_dump(ucp_worker_h worker, ucs_string_buffer_t *strb)
+{
+    ucs_string_buffer_t export_strb = UCS_STRING_BUFFER_INITIALIZER;
+    ucp_worker_cfg_index_t rkey_cfg_index;
+    ucs_string_set_t export_keys;
+    ucp_ep_config_t *ep_config;
+
+    ucs_string_set_init(&export_keys);
+
+    ucs_array_for_each(ep_config, &worker->ep_config) {
+        ucp_proto_tune_dump_select(worker, &ep_config->proto_select,
+                                   ep_config -
+                                           ucs_array_begin(&worker->ep_config),
+                                   UCP_WORKER_CFG_INDEX_NULL, &export_keys,
+                                   &export_strb, strb);
+    }
+
+    for (rkey_cfg_index = 0; rkey_cfg_index < worker->rkey_config_count;
+         ++rkey_cfg_index) {
+        ucp_proto_tune_dump_select(
+                worker, &worker->rkey_config[rkey_cfg_index].proto_select,
+                worker->rkey_config[rkey_cfg_index].key.ep_cfg_index,
+                rkey_cfg_index, &export_keys, &export_strb, strb);
+    }
+
+    if (ucs_string_buffer_length(&export_strb) > 0) {
+        ucs_string_buffer_rtrim(&export_strb, ",");
+        ucs_string_buffer_appendf(strb, "UCX_PROTO_TUNE_THRESH=%s\n",
+                                  ucs_string_buffer_cstr(&export_strb));
+    }
+
+    ucs_string_buffer_cleanup(&export_strb);
+    ucs_string_set_cleanup(&export_keys);
+}
@@ -0,0 +1,204 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifndef UCP_PROTO_TUNE_H_
+#define UCP_PROTO_TUNE_H_
+
+#include "proto_select.h"
+
+#include <ucs/datastruct/string_buffer.h>
+#include <ucs/time/time_def.h>
+
+
+/*
+ * Online tuning of protocol thresholds
+ *
+ * When UCX is configured with --enable-proto-tune and UCX_PROTO_TUNE is
+ * enabled, every threshold between two adjacent protocols of a selection is
+ * tuned by the measured completion times of send requests. The message lengths
+ * around threshold T are divided to two windows: [T/2, T), which is sent by the
+ * lower protocol, and [T, 2T), which is sent by the upper protocol. Every
+ * UCP_PROTO_TUNE_EXPLORE_INTERVAL-th request in a window is sent by the other
+ * protocol instead. When both protocols completed enough requests in a window,
+ * and the other protocol was faster per byte, the threshold is moved to the end
+ * of the window, so the window is sent by the other protocol.
+ *
+ * The threshold can move up to UCX_PROTO_TUNE_RANGE times away from the
+ * threshold selected by the performance estimation, and only within the
+ * message lengths supported by both protocols. Thresholds of fast-path short
+ * protocols and thresholds configured by the user are not tuned.
+ *
+ * The initial thresholds can be set by UCX_PROTO_TUNE_THRESH, also when tuning
+ * is disabled. The learned thresholds are printed in this format by
+ * @ref ucp_proto_tune_dump.
+ */
+
+
+/* Every N-th request around a threshold is sent by the other protocol */
+#define UCP_PROTO_TUNE_EXPLORE_INTERVAL 8
+
+
+/* Minimal relative improvement to move a threshold */
+#define UCP_PROTO_TUNE_MIN_GAIN         0.1
+
+
+/**
+ * Message length windows around a tuned threshold
+ */
+typedef enum {
+    UCP_PROTO_TUNE_WINDOW_BELOW, /* Sent by the lower protocol */
+    UCP_PROTO_TUNE_WINDOW_ABOVE, /* Sent by the upper protocol */
+    UCP_PROTO_TUNE_WINDOW_LAST
+} ucp_proto_tune_window_t;
+
+
+/**
+ * Protocols of a tuned threshold
+ */
+typedef enum {
+    UCP_PROTO_TUNE_ARM_LOWER,
+    UCP_PROTO_TUNE_ARM_UPPER,
+    UCP_PROTO_TUNE_ARM_LAST
+} ucp_proto_tune_arm_t;
+
+
+/**
+ * Completed requests of a protocol in a window
+ */
+typedef struct {
+    uint64_t   count;  /* Number of requests */
+    uint64_t   length; /* Total message length */
+    ucs_time_t time;   /* Total time from protocol selection to completion */
+} ucp_proto_tune_stat_t;
+
+
+/**
+ * Tuned threshold between a protocol range and the next one
+ */
+typedef struct ucp_proto_tune_bound {
+    /* Range of the lower protocol, followed by the range of the upper one */
+    ucp_proto_threshold_elem_t *lower;
+
+    /* Whether the range of the lower protocol is the first one */
+    int                        lower_first;
+
+    /* Threshold selected by the performance estimation */
+    size_t                     orig_thresh;
+
+    /* Limits of the threshold */
+    size_t                     min_thresh;
+    size_t                     max_thresh;
+
+    /* Message lengths supported by the protocols */
+    size_t                     upper_min_length;
+    size_t                     lower_max_length;
+
+    /* Number of selected requests, used to choose which ones to explore */
+    unsigned                   num_selected;
+
+    /* Number of times the threshold was moved */
+    unsigned                   num_moves;
+
+    /* Completed requests of the current round */
+    ucp_proto_tune_stat_t      stats[UCP_PROTO_TUNE_WINDOW_LAST]
+                                    [UCP_PROTO_TUNE_ARM_LAST];
+} ucp_proto_tune_bound_t;
+
+
+/**
+ * Tuned thresholds at both ends of a protocol range
+ */
+struct ucp_proto_tune_elem {
+    ucp_proto_tune_bound_t *below; /* Threshold at the start, or NULL */
+    ucp_proto_tune_bound_t *above; /* Threshold at the end, or NULL */
+};
+
+
+/**
+ * Tuned thresholds of a protocol selection
+ */
+struct ucp_proto_tune {
+    unsigned               num_bounds;
+    ucp_proto_tune_bound_t *bounds;
+    ucp_proto_tune_elem_t  *elems;  /* Same length as the thresholds array */
+};
+
+
+/**
+ * Message lengths supported by the protocol of a range
+ */
+typedef struct {
+    size_t min_length;
+    size_t max_length;
+} ucp_proto_tune_caps_t;
+
+
+/**
+ * Create the tuned thresholds of a protocol selection, and apply the
+ * thresholds from UCX_PROTO_TUNE_THRESH.
+ *
+ * @param [in]    worker          UCP worker.
+ * @param [in]    select_param    Protocol selection parameters.
+ * @param [inout] thresholds      Thresholds array of the selection.
+ * @param [in]    num_thresholds  Number of elements in the thresholds array.
+ * @param [in]    caps            Message lengths supported by the protocol of
+ *                                every element in the thresholds array.
+ *
+ * @return Tuned thresholds, or NULL if none of the thresholds can be tuned.
+ */
+ucp_proto_tune_t *
+ucp_proto_tune_create(ucp_worker_h worker,
+                      const ucp_proto_select_param_t *select_param,
+                      ucp_proto_threshold_elem_t *thresholds,
+                      unsigned num_thresholds,
+                      const ucp_proto_tune_caps_t *caps);
+
+
+void ucp_proto_tune_destroy(ucp_proto_tune_t *tune);
+
+
+#if ENABLE_PROTO_TUNE
+
+/**
+ * Choose the protocol for a request, which may be the other protocol of a
+ * tuned threshold, and start measuring the request.
+ *
+ * @param [in]  req          Request to send.
+ * @param [in]  thresh_elem  Range selected for the request.
+ * @param [in]  msg_length   Message length of the request.
+ *
+ * @return Protocol configuration to use.
+ */
+const ucp_proto_config_t *
+ucp_proto_tune_select(ucp_request_t *req,
+                      const ucp_proto_threshold_elem_t *thresh_elem,
+                      size_t msg_length);
+
+
+/**
+ * Account the completion of a request, and move the threshold if the other
+ * protocol is faster.
+ *
+ * @param [in]  worker        UCP worker.
+ * @param [in]  bound         Threshold the request was measured for.
+ * @param [in]  proto_config  Protocol which sent the request.
+ * @param [in]  length        Message length.
+ * @param [in]  duration      Time from protocol selection to completion.
+ */
+void ucp_proto_tune_update(ucp_worker_h worker, ucp_proto_tune_bound_t *bound,
+                           const ucp_proto_config_t *proto_config,
+                           size_t length, ucs_time_t duration);
+
+#endif
+
+
+/**
+ * Print the tuned thresholds of all protocol selections of a worker, followed
+ * by a UCX_PROTO_TUNE_THRESH setting with the current thresholds.
+ */
+void ucp_proto_tune_dump(ucp_worker_h worker, ucs_string_buffer_t *strb);
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifndef UCP_PROTO_TUNE_INL_
+#define UCP_PROTO_TUNE_INL_
+
+#include "proto_tune.h"
+
+#include <ucp/core/ucp_request.h>
+#include <ucp/core/ucp_worker.h>
+#include <ucs/time/time.h>
+
+
+#if ENABLE_PROTO_TUNE
+
+static UCS_F_ALWAYS_INLINE void ucp_proto_tune_request_init(ucp_request_t *req)
+{
+    req->send.tune.bound = NULL;
+}
+
+/* Called when a protocol is selected for the request */
+static UCS_F_ALWAYS_INLINE const ucp_proto_config_t *
+ucp_proto_tune_request_select(ucp_request_t *req,
+                              const ucp_proto_config_t *proto_config,
+                              size_t msg_length)
+{
+    const ucp_proto_threshold_elem_t *thresh_elem;
+
+    /* Ranges are linked to tuned thresholds only if UCX_PROTO_TUNE is set */
+    thresh_elem = ucs_container_of(proto_config, ucp_proto_threshold_elem_t,
+                                   proto_config);
+    if (ucs_likely(thresh_elem->tune == NULL)) {
+        req->send.tune.bound = NULL;
+        return proto_config;
+    }
+
+    return ucp_proto_tune_select(req, thresh_elem, msg_length);
+}
+
+/* Called when the request is completed, before the user callback */
+static UCS_F_ALWAYS_INLINE void
+ucp_proto_tune_request_complete(ucp_request_t *req, ucs_status_t status)
+{
+    if (ucs_likely(!(req->flags & UCP_REQUEST_FLAG_PROTO_SEND) ||
+                   (req->send.tune.bound == NULL))) {
+        return;
+    }
+
+    if (status == UCS_OK) {
+        ucp_proto_tune_update(req->send.ep->worker, req->send.tune.bound,
+                              req->send.proto_config,
+                              req->send.state.dt_iter.length,
+                              ucs_get_time() - req->send.tune.start);
+    }
+}
+
+#else
+
+#define ucp_proto_tune_request_init(_req)
+#define ucp_proto_tune_request_select(_req, _proto_config, _msg_length) \
+    (_proto_config)
+#define ucp_proto_tune_request_complete(_req, _status)
+
+#endif
+
+#endif
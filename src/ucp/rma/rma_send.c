@@ -239,9 +239,10 @@ ucp_put_send_short(ucp_ep_h ep, const void *buffer, size_t length,
                             buffer, length, remote_addr, tl_rkey);
 }
 
-ucs_status_ptr_t ucp_put_nbx(ucp_ep_h ep, const void *buffer, size_t count,
-                             uint64_t remote_addr, ucp_rkey_h rkey,
-                             const ucp_request_param_t *param)
+static UCS_F_ALWAYS_INLINE ucs_status_ptr_t
+ucp_put_nbx_common(ucp_ep_h ep, const void *buffer, size_t count,
+                   uint64_t remote_addr, ucp_rkey_h rkey,
+                   const ucp_request_param_t *param, int thread_multi)
 {
     ucp_worker_h worker     = ep->worker;
     size_t contig_length    = 0;
@@ -253,7 +254,7 @@ ucs_status_ptr_t ucp_put_nbx(ucp_ep_h ep, const void *buffer, size_t count,
 
     UCP_REQUEST_CHECK_PARAM(param);
     UCP_RMA_CHECK_PTR(worker->context, buffer, count);
-    UCP_WORKER_THREAD_CS_ENTER_CONDITIONAL(worker);
+    UCP_WORKER_THREAD_CS_ENTER_MODE(worker, thread_multi);
 
     ucs_trace_req("put_nbx buffer %p count %zu remote_addr %" PRIx64
                   " rkey %p to %s cb %p",
@@ -319,10 +320,19 @@ ucs_status_ptr_t ucp_put_nbx(ucp_ep_h ep, const void *buffer, size_t count,
     }
 
 out_unlock:
-    UCP_WORKER_THREAD_CS_EXIT_CONDITIONAL(worker);
+    UCP_WORKER_THREAD_CS_EXIT_MODE(worker, thread_multi);
     return ret;
 }
 
+ucs_status_ptr_t ucp_put_nbx(ucp_ep_h ep, const void *buffer, size_t count,
+                             uint64_t remote_addr, ucp_rkey_h rkey,
+                             const ucp_request_param_t *param)
+{
+    return UCP_WORKER_THREAD_MODE_DISPATCH(ep->worker, ucp_put_nbx_common, ep,
+                                           buffer, count, remote_addr, rkey,
+                                           param);
+}
+
 ucs_status_t ucp_get_nbi(ucp_ep_h ep, void *buffer, size_t length,
                          uint64_t remote_addr, ucp_rkey_h rkey)
 {
@@ -351,9 +361,10 @@ ucs_status_ptr_t ucp_get_nb(ucp_ep_h ep, void *buffer, size_t length,
     return ucp_get_nbx(ep, buffer, length, remote_addr, rkey, &param);
 }
 
-ucs_status_ptr_t ucp_get_nbx(ucp_ep_h ep, void *buffer, size_t count,
-                             uint64_t remote_addr, ucp_rkey_h rkey,
-                             const ucp_request_param_t *param)
+static UCS_F_ALWAYS_INLINE ucs_status_ptr_t
+ucp_get_nbx_common(ucp_ep_h ep, void *buffer, size_t count,
+                   uint64_t remote_addr, ucp_rkey_h rkey,
+                   const ucp_request_param_t *param, int thread_multi)
 {
     ucp_worker_h worker  = ep->worker;
     size_t contig_length = 0;
@@ -369,7 +380,7 @@ ucs_status_ptr_t ucp_get_nbx(ucp_ep_h ep, void *buffer, size_t count,
 
     UCP_REQUEST_CHECK_PARAM(param);
     UCP_RMA_CHECK_PTR(worker->context, buffer, count);
-    UCP_WORKER_THREAD_CS_ENTER_CONDITIONAL(worker);
+    UCP_WORKER_THREAD_CS_ENTER_MODE(worker, thread_multi);
 
     ucs_trace_req("get_nbx buffer %p count %zu remote_addr %" PRIx64
                   " rkey %p from %s cb %p",
@@ -407,10 +418,19 @@ ucs_status_ptr_t ucp_get_nbx(ucp_ep_h ep, void *buffer, size_t count,
     }
 
 out_unlock:
-    UCP_WORKER_THREAD_CS_EXIT_CONDITIONAL(worker);
+    UCP_WORKER_THREAD_CS_EXIT_MODE(worker, thread_multi);
     return ret;
 }
 
+ucs_status_ptr_t ucp_get_nbx(ucp_ep_h ep, void *buffer, size_t count,
+                             uint64_t remote_addr, ucp_rkey_h rkey,
+                             const ucp_request_param_t *param)
+{
+    return UCP_WORKER_THREAD_MODE_DISPATCH(ep->worker, ucp_get_nbx_common, ep,
+                                           buffer, count, remote_addr, rkey,
+                                           param);
+}
+
 UCS_PROFILE_FUNC(ucs_status_t, ucp_put, (ep, buffer, length, remote_addr, rkey),
                  ucp_ep_h ep, const void *buffer, size_t length,
                  uint64_t remote_addr, ucp_rkey_h rkey)
@@ -47,12 +47,12 @@ ucp_proto_rndv_rts_request_init(ucp_request_t *req)
         return status;
     }
 
-    status = ucp_datatype_iter_mem_reg(ep->worker->context,
-                                       &req->send.state.dt_iter,
-                                       rpriv->md_map,
-                                       UCT_MD_MEM_ACCESS_RMA |
-                                       UCT_MD_MEM_FLAG_HIDE_ERRORS,
-                                       UCP_DT_MASK_ALL);
+    status = UCP_PROTO_LAT_CALL(req, UCP_PROTO_LAT_MEM_REG,
+                                ucp_datatype_iter_mem_reg, ep->worker->context,
+                                &req->send.state.dt_iter, rpriv->md_map,
+                                UCT_MD_MEM_ACCESS_RMA |
+                                UCT_MD_MEM_FLAG_HIDE_ERRORS,
+                                UCP_DT_MASK_ALL);
     if (status != UCS_OK) {
         return status;
     }
@@ -75,6 +75,7 @@ ucp_proto_rndv_ats_handler(void *arg, void *data, size_t length, unsigned flags)
 
     UCP_SEND_REQUEST_GET_BY_ID(&req, worker, rephdr->req_id, 0, return UCS_OK,
                                "ATS %p", rephdr);
+    ucp_proto_lat_request_rndv_reply(req);
 
     if (req->flags & UCP_REQUEST_FLAG_OFFLOADED) {
         ucp_tag_offload_cancel_rndv(req);
@@ -106,6 +107,7 @@ static UCS_F_ALWAYS_INLINE size_t ucp_proto_rndv_rts_pack(
     rts->sreq.ep_id  = ucp_send_request_get_ep_remote_id(req);
     rts->size        = req->send.state.dt_iter.length;
     rpriv            = req->send.proto_config->priv;
+    ucp_proto_lat_request_rndv_sent(req);
 
     if ((rts->size == 0) ||
         (req->send.state.dt_iter.dt_class != UCP_DATATYPE_CONTIG)) {
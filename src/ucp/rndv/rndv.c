@@ -1113,6 +1113,7 @@ ucp_rndv_mpool_get(ucp_worker_h worker, ucs_memory_type_t mem_type,
                    ucs_sys_device_t sys_dev)
 {
     ucp_rndv_mpool_priv_t *mpriv;
+    ucs_mpool_acct_t *prev_acct;
     ucp_worker_mpool_key_t key;
     ucs_status_t status;
     unsigned num_frags;
@@ -1147,7 +1148,9 @@ ucp_rndv_mpool_get(ucp_worker_h worker, ucs_memory_type_t mem_type,
     mp_params.elems_per_chunk = num_frags;
     mp_params.ops             = &ucp_frag_mpool_ops;
     mp_params.name            = "ucp_rndv_frags";
-    status = ucs_mpool_init(&mp_params, mpool);
+    prev_acct                 = ucs_mpool_acct_set_current(&worker->mem.acct);
+    status                    = ucs_mpool_init(&mp_params, mpool);
+    ucs_mpool_acct_set_current(prev_acct);
     if (status != UCS_OK) {
         return NULL;
     }
@@ -178,12 +178,14 @@ static ucs_status_t ucp_proto_rndv_rtr_progress(uct_pending_req_t *self)
     ucs_status_t status;
 
     if (!(req->flags & UCP_REQUEST_FLAG_PROTO_INITIALIZED)) {
-        status = ucp_datatype_iter_mem_reg(req->send.ep->worker->context,
-                                           &req->send.state.dt_iter,
-                                           rpriv->super.md_map,
-                                           UCT_MD_MEM_ACCESS_REMOTE_PUT |
-                                           UCT_MD_MEM_FLAG_HIDE_ERRORS,
-                                           UCP_DT_MASK_ALL);
+        status = UCP_PROTO_LAT_CALL(req, UCP_PROTO_LAT_MEM_REG,
+                                    ucp_datatype_iter_mem_reg,
+                                    req->send.ep->worker->context,
+                                    &req->send.state.dt_iter,
+                                    rpriv->super.md_map,
+                                    UCT_MD_MEM_ACCESS_REMOTE_PUT |
+                                    UCT_MD_MEM_FLAG_HIDE_ERRORS,
+                                    UCP_DT_MASK_ALL);
         if (status != UCS_OK) {
             ucp_proto_request_abort(req, status);
             return UCS_OK;
@@ -17,6 +17,7 @@
 #include <ucp/core/ucp_request.inl>
 #include <ucs/datastruct/mpool.inl>
 #include <ucs/datastruct/queue.h>
+#include <ucs/profile/event_trace.h>
 
 
 static void ucp_tag_recv_eager_multi(ucp_worker_h worker, ucp_request_t *req,
@@ -221,11 +222,10 @@ UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_recv_nb,
     return ucp_tag_recv_nbx(worker, buffer, count, tag, tag_mask, &param);
 }
 
-UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_recv_nbx,
-                 (worker, buffer, count, tag, tag_mask, param),
-                 ucp_worker_h worker, void *buffer, size_t count,
-                 ucp_tag_t tag, ucp_tag_t tag_mask,
-                 const ucp_request_param_t *param)
+static UCS_F_ALWAYS_INLINE ucs_status_ptr_t
+ucp_tag_recv_nbx_common(ucp_worker_h worker, void *buffer, size_t count,
+                        ucp_tag_t tag, ucp_tag_t tag_mask,
+                        const ucp_request_param_t *param, int thread_multi)
 {
     ucp_recv_desc_t *rdesc;
     ucs_status_ptr_t ret;
@@ -235,7 +235,8 @@ UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_recv_nbx,
                                     return UCS_STATUS_PTR(UCS_ERR_INVALID_PARAM));
     UCP_REQUEST_CHECK_PARAM(param);
 
-    UCP_WORKER_THREAD_CS_ENTER_CONDITIONAL(worker);
+    UCP_WORKER_THREAD_CS_ENTER_MODE(worker, thread_multi);
+    UCS_EVENT_TRACE("tag_recv_nbx", count, tag);
 
     req = ucp_request_get_param(worker, param, {
         ret = UCS_STATUS_PTR(UCS_ERR_NO_MEMORY);
@@ -247,10 +248,21 @@ UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_recv_nbx,
                                 rdesc, param, "recv_nbx");
 
 out:
-    UCP_WORKER_THREAD_CS_EXIT_CONDITIONAL(worker);
+    UCP_WORKER_THREAD_CS_EXIT_MODE(worker, thread_multi);
     return ret;
 }
 
+UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_recv_nbx,
+                 (worker, buffer, count, tag, tag_mask, param),
+                 ucp_worker_h worker, void *buffer, size_t count,
+                 ucp_tag_t tag, ucp_tag_t tag_mask,
+                 const ucp_request_param_t *param)
+{
+    return UCP_WORKER_THREAD_MODE_DISPATCH(worker, ucp_tag_recv_nbx_common,
+                                           worker, buffer, count, tag, tag_mask,
+                                           param);
+}
+
 ucs_status_ptr_t ucp_tag_msg_recv_nb(ucp_worker_h worker, void *buffer, size_t count,
                                      ucp_datatype_t datatype, ucp_tag_message_h message,
                                      ucp_tag_recv_callback_t cb)
@@ -18,6 +18,7 @@
 #include <ucp/proto/proto_am.inl>
 #include <ucp/proto/proto_common.inl>
 #include <ucs/datastruct/mpool.inl>
+#include <ucs/profile/event_trace.h>
 #include <string.h>
 
 
@@ -228,10 +229,10 @@ UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_send_sync_nb,
     return ucp_tag_send_sync_nbx(ep, buffer, count, tag, &param);
 }
 
-UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_send_nbx,
-                 (ep, buffer, count, tag, param),
-                 ucp_ep_h ep, const void *buffer, size_t count,
-                 ucp_tag_t tag, const ucp_request_param_t *param)
+static UCS_F_ALWAYS_INLINE ucs_status_ptr_t
+ucp_tag_send_nbx_common(ucp_ep_h ep, const void *buffer, size_t count,
+                        ucp_tag_t tag, const ucp_request_param_t *param,
+                        int thread_multi)
 {
     size_t contig_length = 0;
     ucs_status_t status;
@@ -245,10 +246,11 @@ UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_send_nbx,
                                     return UCS_STATUS_PTR(UCS_ERR_INVALID_PARAM));
     UCP_REQUEST_CHECK_PARAM(param);
 
-    UCP_WORKER_THREAD_CS_ENTER_CONDITIONAL(ep->worker);
+    UCP_WORKER_THREAD_CS_ENTER_MODE(ep->worker, thread_multi);
 
     ucs_trace_req("send_nbx buffer %p count %zu tag %"PRIx64" to %s",
                   buffer, count, tag, ucp_ep_peer_name(ep));
+    UCS_EVENT_TRACE("tag_send_nbx", count, tag);
 
     attr_mask = param->op_attr_mask &
                 (UCP_OP_ATTR_FIELD_DATATYPE | UCP_OP_ATTR_FLAG_NO_IMM_CMPL);
@@ -302,14 +304,23 @@ UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_send_nbx,
                                param, ucp_ep_config(ep)->tag.proto);
     }
 out:
-    UCP_WORKER_THREAD_CS_EXIT_CONDITIONAL(ep->worker);
+    UCP_WORKER_THREAD_CS_EXIT_MODE(ep->worker, thread_multi);
     return ret;
 }
 
-UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_send_sync_nbx,
+UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_send_nbx,
                  (ep, buffer, count, tag, param),
                  ucp_ep_h ep, const void *buffer, size_t count,
                  ucp_tag_t tag, const ucp_request_param_t *param)
+{
+    return UCP_WORKER_THREAD_MODE_DISPATCH(ep->worker, ucp_tag_send_nbx_common,
+                                           ep, buffer, count, tag, param);
+}
+
+static UCS_F_ALWAYS_INLINE ucs_status_ptr_t
+ucp_tag_send_sync_nbx_common(ucp_ep_h ep, const void *buffer, size_t count,
+                             ucp_tag_t tag, const ucp_request_param_t *param,
+                             int thread_multi)
 {
     ucp_worker_h worker  = ep->worker;
     size_t contig_length = 0;
@@ -323,7 +334,7 @@ UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_send_sync_nbx,
                                             UCS_ERR_INVALID_PARAM));
     UCP_REQUEST_CHECK_PARAM(param);
 
-    UCP_WORKER_THREAD_CS_ENTER_CONDITIONAL(worker);
+    UCP_WORKER_THREAD_CS_ENTER_MODE(worker, thread_multi);
 
     ucs_trace_req("send_sync_nbx buffer %p count %zu tag %"PRIx64" to %s",
                   buffer, count, tag, ucp_ep_peer_name(ep));
@@ -355,6 +366,16 @@ UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_send_sync_nbx,
     }
 
 out:
-    UCP_WORKER_THREAD_CS_EXIT_CONDITIONAL(worker);
+    UCP_WORKER_THREAD_CS_EXIT_MODE(worker, thread_multi);
     return ret;
 }
+
+UCS_PROFILE_FUNC(ucs_status_ptr_t, ucp_tag_send_sync_nbx,
+                 (ep, buffer, count, tag, param),
+                 ucp_ep_h ep, const void *buffer, size_t count,
+                 ucp_tag_t tag, const ucp_request_param_t *param)
+{
+    return UCP_WORKER_THREAD_MODE_DISPATCH(ep->worker,
+                                           ucp_tag_send_sync_nbx_common, ep,
+                                           buffer, count, tag, param);
+}
@@ -29,6 +29,7 @@ ucs_global_opts_t ucs_global_opts = {
     .log_buffer_size       = 1024,
     .log_data_size         = 0,
     .mpool_fifo            = 0,
+    .mpool_huge_pages      = UCS_MPOOL_HUGE_PAGES_DEFAULT,
     .handle_errors         = UCS_BIT(UCS_HANDLE_ERROR_BACKTRACE),
     .error_signals         = { NULL, 0 },
     .error_mail_to         = "",
@@ -46,9 +47,17 @@ ucs_global_opts_t ucs_global_opts = {
     .stats_trigger         = "exit",
     .profile_mode          = 0,
     .profile_file          = "",
+    .event_trace           = 0,
+    .event_trace_size      = 0,
+    .event_trace_file      = "",
     .stats_filter          = { NULL, 0 },
     .stats_format          = UCS_STATS_FULL,
+    .stats_shards          = 0,
+    .stats_full_interval   = 1,
+    .metrics_dest          = "",
+    .metrics_vfs_count     = { NULL, 0 },
     .topo_prio             = { NULL, 0 },
+    .topo_calib_dir        = "",
     .vfs_enable            = 1,
     .vfs_thread_affinity   = 0,
     .rcache_check_pfn      = 0,
@@ -108,6 +117,24 @@ static ucs_config_field_t ucs_global_opts_table[] = {
   ucs_offsetof(ucs_global_opts_t, mpool_fifo), UCS_CONFIG_TYPE_BOOL},
 #endif
 
+ {"MPOOL_HUGE_PAGES", "default",
+  "Huge pages policy of memory pools which support it, such as UCP request\n"
+  "pools and TCP descriptor pools:\n"
+  " default - keep the allocation of every memory pool: UCP request pools try\n"
+  "           hugetlbfs pages, TCP descriptor pools use regular pages, and\n"
+  "           memory pools of transport interfaces use all allocation methods\n"
+  "           from UCX_<transport>_ALLOC.\n"
+  " none    - use regular pages.\n"
+  " madvise - use transparent huge pages, by aligning large chunks to the huge\n"
+  "           page size and calling madvise(MADV_HUGEPAGE).\n"
+  " hugetlb - use hugetlbfs pages, and fall back to transparent huge pages.\n"
+  "Chunks fall back to regular pages if huge pages are not available, or if\n"
+  "rounding the chunk up to the huge page size would double its size.\n"
+  "Memory pools of transport interfaces also do not use the \"huge\" and \"thp\"\n"
+  "allocation methods from UCX_<transport>_ALLOC which are excluded by this policy.",
+  ucs_offsetof(ucs_global_opts_t, mpool_huge_pages),
+  UCS_CONFIG_TYPE_ENUM(ucs_mpool_huge_pages_names)},
+
  {"HANDLE_ERRORS",
 #if ENABLE_DEBUG_DATA
   "bt,freeze",
@@ -188,9 +215,21 @@ static ucs_config_field_t ucs_global_opts_table[] = {
 
  {"TOPO_PRIO", "sysfs,default",
   "Comma-separated list of providers for detecting system topology.\n"
-  "The list order decides the priority of the providers.",
+  "The list order decides the priority of the providers. The possible values are:\n"
+  " calibrated - measure memory copy bandwidth and memory latency between NUMA\n"
+  "              nodes, and cache line latency between cores, on first use.\n"
+  "              Fall back to sysfs for values which could not be measured.\n"
+  " sysfs      - estimate performance from sysfs hierarchy and NUMA distance.\n"
+  " default    - assume all devices and memory are close.",
   ucs_offsetof(ucs_global_opts_t, topo_prio), UCS_CONFIG_TYPE_STRING_ARRAY},
 
+ {"TOPO_CALIB_DIR", "/tmp",
+  "Directory of the per-user file which keeps the measurements of the\n"
+  "'calibrated' topology provider until the host is rebooted, so they are done\n"
+  "only once. Processes which start at the same time wait for the one which\n"
+  "measures. If empty, every process repeats the measurements.",
+  ucs_offsetof(ucs_global_opts_t, topo_calib_dir), UCS_CONFIG_TYPE_STRING},
+
  {NULL}
 };
 
@@ -267,8 +306,37 @@ static ucs_config_field_t ucs_global_opts_read_only_table[] = {
   "  agg     - like full but there will also be an aggregation between similar counters\n"
   "  summary - all counters will be printed in the same line.",
   ucs_offsetof(ucs_global_opts_t, stats_format), UCS_CONFIG_TYPE_ENUM(ucs_stats_formats_names)},
+
+ {"STATS_SHARDS", "0",
+  "Number of per-thread shards of every statistics node. When nonzero, every\n"
+  "thread updates counters in its own cache line aligned shard, using atomic\n"
+  "operations, and the shards are summed when the statistics are reported.\n"
+  "This avoids false sharing when several threads update the same counters.\n"
+  "The value is rounded up to a power of 2. 0 - disable sharding.",
+  ucs_offsetof(ucs_global_opts_t, stats_shards), UCS_CONFIG_TYPE_UINT},
+
+ {"STATS_FULL_INTERVAL", "1",
+  "When statistics are sent over UDP, send a full report once every this number\n"
+  "of reports, and only the data which changed since the previous report\n"
+  "otherwise. 1 - always send full reports.",
+  ucs_offsetof(ucs_global_opts_t, stats_full_interval), UCS_CONFIG_TYPE_UINT},
 #endif
 
+ {"METRICS_DEST", "",
+  "Serve statistics counters and numeric VFS attributes in OpenMetrics text\n"
+  "format from the async thread. If the value is empty, the exporter is disabled.\n"
+  "Possible values are:\n"
+  "  unix:<path>   - send the metrics to every connection on a unix socket\n"
+  "                  (%h: host, %p: pid, %c: cpu, %t: time, %u: user, %e: exe)\n"
+  "  tcp:<port>    - serve HTTP requests on the loopback interface",
+  ucs_offsetof(ucs_global_opts_t, metrics_dest), UCS_CONFIG_TYPE_STRING},
+
+ {"METRICS_VFS_COUNT", "ep,listener",
+  "Names of VFS directories which are exported as their number of entries\n"
+  "instead of exporting their contents, to bound the metrics output size.",
+  ucs_offsetof(ucs_global_opts_t, metrics_vfs_count),
+  UCS_CONFIG_TYPE_STRING_ARRAY},
+
  {"MEMTRACK_DEST", "",
   "Destination to output memory tracking report to. If the value is empty,\n"
   "results are not reported. Possible values are:\n"
@@ -279,8 +347,11 @@ static ucs_config_field_t ucs_global_opts_read_only_table[] = {
 
  {"PROFILE_MODE", "",
   "Profile collection modes. If none is specified, profiling is disabled.\n"
-  " - log   - Record all timestamps.\n"
-  " - accum - Accumulate measurements per location.",
+  " - log    - Record all timestamps.\n"
+  " - accum  - Accumulate measurements per location.\n"
+  " - stream - Record all timestamps, and write them to a ring in the profiling\n"
+  "            file while the application is running. The file can be read,\n"
+  "            and followed, by ucx_read_profile during the run.",
   ucs_offsetof(ucs_global_opts_t, profile_mode),
   UCS_CONFIG_TYPE_BITMAP(ucs_profile_mode_names)},
 
@@ -290,9 +361,27 @@ static ucs_config_field_t ucs_global_opts_read_only_table[] = {
   ucs_offsetof(ucs_global_opts_t, profile_file), UCS_CONFIG_TYPE_STRING},
 
  {"PROFILE_LOG_SIZE", "4m",
-  "Maximal size of profiling log. New records will replace old records.",
+  "Maximal size of profiling log. New records will replace old records.\n"
+  "In stream mode, this is the size of the records ring in the file.",
   ucs_offsetof(ucs_global_opts_t, profile_log_size), UCS_CONFIG_TYPE_MEMUNITS},
 
+ {"EVENT_TRACE", "n",
+  "Enable the event trace at startup. Unlike profiling, the event trace is\n"
+  "compiled in all builds, and can also be enabled or disabled at runtime by\n"
+  "writing 1 or 0 to the ucs/event_trace/enable VFS file.",
+  ucs_offsetof(ucs_global_opts_t, event_trace), UCS_CONFIG_TYPE_BOOL},
+
+ {"EVENT_TRACE_SIZE", "65536",
+  "Number of events kept in the trace ring buffer of every thread, rounded up\n"
+  "to a power of 2. New events overwrite the oldest ones.",
+  ucs_offsetof(ucs_global_opts_t, event_trace_size), UCS_CONFIG_TYPE_ULONG},
+
+ {"EVENT_TRACE_FILE", "ucx_%h_%p.evtrace",
+  "File name to save event trace snapshots to, in the profiling file format.\n"
+  "A snapshot is taken by writing to the ucs/event_trace/snapshot VFS file.\n"
+  "Substitutions: %h: host, %p: pid, %c: cpu, %t: time, %u: user, %e: exe.",
+  ucs_offsetof(ucs_global_opts_t, event_trace_file), UCS_CONFIG_TYPE_STRING},
+
  {"RCACHE_STAT_MIN", "4k",
   "Registration cache minimum region size, for power-of-2 size distribution "
   "statistics.\nStatistics about smaller regions will be attributed to this "
@@ -52,6 +52,9 @@ typedef struct {
      * debugging because object pointers are not recycled. */
     int                        mpool_fifo;
 
+    /* Huge pages policy of memory pool chunks */
+    ucs_mpool_huge_pages_t     mpool_huge_pages;
+
     /* Handle errors mode */
     unsigned                   handle_errors;
 
@@ -112,15 +115,39 @@ typedef struct {
     /* Limit for profiling log size */
     size_t                     profile_log_size;
 
+    /* Whether event tracing is enabled at startup */
+    int                        event_trace;
+
+    /* Number of event trace records per thread */
+    size_t                     event_trace_size;
+
+    /* Event trace snapshot file name */
+    char                       *event_trace_file;
+
     /* Counters to be included in statistics summary */
     ucs_config_names_array_t   stats_filter;
 
     /* statistics format options */
     ucs_stats_formats_t        stats_format;
 
+    /* Number of per-thread shards of every statistics node, 0 - disabled */
+    unsigned                   stats_shards;
+
+    /* Send a full statistics report every this number of reports */
+    unsigned                   stats_full_interval;
+
+    /* Destination of the OpenMetrics exporter */
+    char                       *metrics_dest;
+
+    /* VFS directories whose entries are counted rather than exported */
+    ucs_config_names_array_t   metrics_vfs_count;
+
     /* Topology detection modules to use */
     ucs_config_names_array_t   topo_prio;
 
+    /* Directory of the topology calibration file */
+    char                       *topo_calib_dir;
+
     /* Enable VFS monitoring */
     int                        vfs_enable;
 
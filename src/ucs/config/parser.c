@@ -9,6 +9,7 @@
 #endif
 #include "parser.h"
 
+#include <ucs/algorithm/crc.h>
 #include <ucs/algorithm/string_distance.h>
 #include <ucs/arch/atomic.h>
 #include <ucs/sys/sys.h>
@@ -49,10 +50,67 @@ KHASH_SET_INIT_STR(ucs_config_env_vars)
 KHASH_MAP_INIT_STR(ucs_config_map, char*)
 
 
+/* Hash and compare environment entries "NAME=value" by the name part */
+#define ucs_config_env_name_hash(_entry) \
+    ucs_config_env_name_hash_func(_entry)
+#define ucs_config_env_name_equal(_entry1, _entry2) \
+    ucs_config_env_name_equal_func(_entry1, _entry2)
+
+
+static UCS_F_ALWAYS_INLINE int ucs_config_env_name_end(char c)
+{
+    return (c == '=') || (c == '\0');
+}
+
+static UCS_F_ALWAYS_INLINE khint_t
+ucs_config_env_name_hash_func(const char *entry)
+{
+    khint_t h = (khint_t)*entry;
+
+    if (!ucs_config_env_name_end(h)) {
+        for (++entry; !ucs_config_env_name_end(*entry); ++entry) {
+            h = (h << 5) - h + (khint_t)*entry;
+        }
+    }
+
+    return h;
+}
+
+static UCS_F_ALWAYS_INLINE int
+ucs_config_env_name_equal_func(const char *entry1, const char *entry2)
+{
+    while (!ucs_config_env_name_end(*entry1) && (*entry1 == *entry2)) {
+        ++entry1;
+        ++entry2;
+    }
+
+    return ucs_config_env_name_end(*entry1) &&
+           ucs_config_env_name_end(*entry2);
+}
+
+KHASH_INIT(ucs_config_env_index, const char*, char, 0,
+           ucs_config_env_name_hash, ucs_config_env_name_equal)
+
+
 /* Process environment variables */
 extern char **environ;
 
 
+/*
+ * Index of the process environment, to avoid a linear getenv() scan for every
+ * configuration field. The index is built on first use, and rebuilt when the
+ * environment was changed since then.
+ */
+static struct {
+    char                          **environ; /* Indexed environment array */
+    char                          **entries; /* Copy of the indexed entries */
+    size_t                        count;     /* Number of indexed entries */
+    khash_t(ucs_config_env_index) hash;      /* Entries hashed by name */
+    unsigned                      builds;    /* How many times it was built */
+} ucs_config_env_index                = {0};
+static pthread_mutex_t ucs_config_env_index_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
 UCS_LIST_HEAD(ucs_config_global_list);
 static khash_t(ucs_config_env_vars) ucs_config_parser_env_vars = {0};
 static khash_t(ucs_config_map) ucs_config_file_vars            = {0};
@@ -68,6 +126,14 @@ const char *ucs_async_mode_names[] = {
     [UCS_ASYNC_MODE_LAST]            = NULL
 };
 
+const char *ucs_mpool_huge_pages_names[] = {
+    [UCS_MPOOL_HUGE_PAGES_DEFAULT] = "default",
+    [UCS_MPOOL_HUGE_PAGES_NONE]    = "none",
+    [UCS_MPOOL_HUGE_PAGES_MADVISE] = "madvise",
+    [UCS_MPOOL_HUGE_PAGES_HUGETLB] = "hugetlb",
+    [UCS_MPOOL_HUGE_PAGES_LAST]    = NULL
+};
+
 UCS_CONFIG_DEFINE_ARRAY(string, sizeof(char*), UCS_CONFIG_TYPE_STRING);
 
 
@@ -1634,6 +1700,94 @@ void ucs_config_parse_config_file(const char *dir_path, const char *file_name,
     fclose(file);
 }
 
+/* Must be called with ucs_config_env_index_lock held */
+static ucs_status_t ucs_config_env_index_update()
+{
+    char **entries;
+    size_t count;
+    int ret;
+
+    /* environ could be NULL after clearenv() */
+    for (count = 0; (environ != NULL) && (environ[count] != NULL); ++count);
+
+    if ((environ == ucs_config_env_index.environ) &&
+        (count == ucs_config_env_index.count) &&
+        ((count == 0) || !memcmp(environ, ucs_config_env_index.entries,
+                count * sizeof(*environ)))) {
+        return UCS_OK;
+    }
+
+    entries = ucs_realloc(ucs_config_env_index.entries,
+                          (count + 1) * sizeof(*entries), "config_env_index");
+    if (entries == NULL) {
+        ucs_error("failed to allocate environment index of %zu entries",
+                  count);
+        return UCS_ERR_NO_MEMORY;
+    }
+
+    if (count > 0) {
+        memcpy(entries, environ, count * sizeof(*entries));
+    }
+    ucs_config_env_index.entries = entries;
+    ucs_config_env_index.environ = NULL;
+    ucs_config_env_index.count   = 0;
+
+    kh_clear(ucs_config_env_index, &ucs_config_env_index.hash);
+    if (kh_resize(ucs_config_env_index, &ucs_config_env_index.hash,
+                  count) < 0) {
+        goto err_nomem;
+    }
+
+    /* Like getenv(), the first entry of a duplicate name takes precedence */
+    for (; ucs_config_env_index.count < count; ++ucs_config_env_index.count) {
+        if (strchr(entries[ucs_config_env_index.count], '=') == NULL) {
+            continue;
+        }
+
+        kh_put(ucs_config_env_index, &ucs_config_env_index.hash,
+               entries[ucs_config_env_index.count], &ret);
+        if (ret == UCS_KH_PUT_FAILED) {
+            goto err_nomem;
+        }
+    }
+
+    ucs_config_env_index.environ = environ;
+    ++ucs_config_env_index.builds;
+    return UCS_OK;
+
+err_nomem:
+    kh_clear(ucs_config_env_index, &ucs_config_env_index.hash);
+    ucs_config_env_index.count = 0;
+    ucs_error("failed to index %zu environment variables", count);
+    return UCS_ERR_NO_MEMORY;
+}
+
+unsigned ucs_config_parser_env_index_builds()
+{
+    unsigned builds;
+
+    pthread_mutex_lock(&ucs_config_env_index_lock);
+    builds = ucs_config_env_index.builds;
+    pthread_mutex_unlock(&ucs_config_env_index_lock);
+
+    return builds;
+}
+
+/* Same as getenv(), using the index of the environment */
+static const char *ucs_config_env_index_get(const char *name)
+{
+    khiter_t iter;
+
+    ucs_assert(ucs_config_env_index.environ == environ);
+
+    iter = kh_get(ucs_config_env_index, &ucs_config_env_index.hash, name);
+    if (iter == kh_end(&ucs_config_env_index.hash)) {
+        return NULL;
+    }
+
+    return kh_key(&ucs_config_env_index.hash, iter) + strlen(name) + 1;
+}
+
 static ucs_status_t
 ucs_config_apply_config_vars(void *opts, ucs_config_field_t *fields,
                              const char *prefix, const char *table_prefix,
@@ -1683,7 +1837,7 @@ ucs_config_apply_config_vars(void *opts, ucs_config_field_t *fields,
             strncpy(buf + prefix_len, field->name, sizeof(buf) - prefix_len - 1);
 
             /* Env variable has precedence over file config */
-            env_value = getenv(buf);
+            env_value = ucs_config_env_index_get(buf);
             if (env_value == NULL) {
                 env_value = ucs_config_get_value_from_config_file(buf);
             }
@@ -1803,12 +1957,19 @@ ucs_config_parser_fill_opts(void *opts, ucs_config_global_list_entry_t *entry,
         ucs_config_parse_config_files();
     }
 
+    pthread_mutex_lock(&ucs_config_env_index_lock);
+
+    status = ucs_config_env_index_update();
+    if (status != UCS_OK) {
+        goto err_unlock;
+    }
+
     /* Apply environment variables */
     if (sub_prefix != NULL) {
         status = ucs_config_apply_config_vars(opts, entry->table, sub_prefix,
                                               entry->prefix, 1, ignore_errors);
         if (status != UCS_OK) {
-            goto err_free;
+            goto err_unlock;
         }
     }
 
@@ -1816,13 +1977,16 @@ ucs_config_parser_fill_opts(void *opts, ucs_config_global_list_entry_t *entry,
     status = ucs_config_apply_config_vars(opts, entry->table, env_prefix,
                                           entry->prefix, 1, ignore_errors);
     if (status != UCS_OK) {
-        goto err_free;
+        goto err_unlock;
     }
 
+    pthread_mutex_unlock(&ucs_config_env_index_lock);
+
     entry->flags |= UCS_CONFIG_TABLE_FLAG_LOADED;
     return UCS_OK;
 
-err_free:
+err_unlock:
+    pthread_mutex_unlock(&ucs_config_env_index_lock);
     ucs_config_parser_release_opts(opts,
                                    entry->table); /* Release default values */
 err:
@@ -2391,6 +2555,41 @@ void ucs_config_parser_get_env_vars(ucs_string_buffer_t *env_strb,
     });
 }
 
+uint32_t ucs_config_parser_checksum(const char *env_prefix,
+                                    const ucs_list_link_t *cached_key_list)
+{
+    static const char *file_tag = "file:";
+    size_t prefix_len           = strlen(env_prefix);
+    uint32_t checksum           = 0;
+    ucs_config_cached_key_t *key_val;
+    const char *key, *value;
+    uint32_t crc;
+    char **envp;
+
+    /* Entries are combined by xor, to not depend on their order. environ
+     * could be NULL after clearenv() */
+    for (envp = environ; (envp != NULL) && (*envp != NULL); ++envp) {
+        if (!strncmp(*envp, env_prefix, prefix_len)) {
+            checksum ^= ucs_crc32(0, *envp, strlen(*envp));
+        }
+    }
+
+    kh_foreach(&ucs_config_file_vars, key, value, {
+        crc       = ucs_crc32(0, file_tag, strlen(file_tag));
+        crc       = ucs_crc32(crc, key, strlen(key) + 1);
+        checksum ^= ucs_crc32(crc, value, strlen(value));
+    })
+
+    if (cached_key_list != NULL) {
+        ucs_list_for_each(key_val, cached_key_list, list) {
+            crc       = ucs_crc32(0, key_val->key, strlen(key_val->key) + 1);
+            checksum ^= ucs_crc32(crc, key_val->value, strlen(key_val->value));
+        }
+    }
+
+    return checksum;
+}
+
 void ucs_config_parser_cleanup()
 {
     const char *key;
@@ -2406,4 +2605,10 @@ void ucs_config_parser_cleanup()
         ucs_free(value);
     })
     kh_destroy_inplace(ucs_config_map, &ucs_config_file_vars);
+
+    kh_destroy_inplace(ucs_config_env_index, &ucs_config_env_index.hash);
+    ucs_free(ucs_config_env_index.entries);
+    ucs_config_env_index.entries = NULL;
+    ucs_config_env_index.environ = NULL;
+    ucs_config_env_index.count   = 0;
 }
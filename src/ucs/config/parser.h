@@ -626,6 +626,32 @@ void ucs_config_parser_get_env_vars(ucs_string_buffer_t *env_strb,
                                     const char *delimiter);
 
 
+/**
+ * Calculate a checksum of the configuration visible to the parser: environment
+ * variables starting with @a env_prefix, the values loaded from configuration
+ * files, and the values in @a cached_key_list. The result does not depend on
+ * the order of variables.
+ *
+ * @param [in]  env_prefix       Environment variables prefix.
+ * @param [in]  cached_key_list  List of @ref ucs_config_cached_key_t set by
+ *                               the user, or NULL.
+ *
+ * @return Configuration checksum.
+ */
+uint32_t ucs_config_parser_checksum(const char *env_prefix,
+                                    const ucs_list_link_t *cached_key_list);
+
+
+/**
+ * Return how many times the index of the process environment was built. The
+ * index is rebuilt when a configuration table is read after the environment
+ * has changed.
+ *
+ * @return Number of index builds.
+ */
+unsigned ucs_config_parser_env_index_builds();
+
+
 /**
  * Global cleanup of the configuration parser.
  */
@@ -82,6 +82,21 @@ typedef enum {
 } ucs_handle_error_t;
 
 
+/**
+ * Huge pages policy of memory pool chunks
+ */
+typedef enum {
+    UCS_MPOOL_HUGE_PAGES_DEFAULT, /* Default allocation of every memory pool */
+    UCS_MPOOL_HUGE_PAGES_NONE,    /* Regular pages */
+    UCS_MPOOL_HUGE_PAGES_MADVISE, /* Transparent huge pages, using madvise() */
+    UCS_MPOOL_HUGE_PAGES_HUGETLB, /* hugetlbfs pages, then transparent huge pages */
+    UCS_MPOOL_HUGE_PAGES_LAST
+} ucs_mpool_huge_pages_t;
+
+
+extern const char *ucs_mpool_huge_pages_names[];
+
+
 /**
  * Configuration printing flags
  */
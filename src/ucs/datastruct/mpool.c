@@ -17,6 +17,11 @@
 #include <ucs/sys/checker.h>
 #include <ucs/sys/sys.h>
 #include <ucs/arch/cpu.h>
+#include <ucs/time/time.h>
+
+
+/* Accounting group which memory pools join when they are initialized */
+static __thread ucs_mpool_acct_t *ucs_mpool_current_acct = NULL;
 
 
 static size_t ucs_mpool_elem_total_size(ucs_mpool_data_t *data)
@@ -115,6 +120,10 @@ ucs_status_t ucs_mpool_init(const ucs_mpool_params_t *params, ucs_mpool_t *mp)
     mp->data->tail            = NULL;
     mp->data->chunks          = NULL;
     mp->data->ops             = params->ops;
+    mp->data->chunks_size     = 0;
+    mp->data->last_grow_time  = 0;
+    mp->data->acct            = NULL;
+    mp->data->mp              = mp;
     mp->data->name            = ucs_strdup(params->name, "mpool_data_name");
 
     if (mp->data->name == NULL) {
@@ -133,9 +142,14 @@ ucs_status_t ucs_mpool_init(const ucs_mpool_params_t *params, ucs_mpool_t *mp)
 
     VALGRIND_CREATE_MEMPOOL(mp, 0, 0);
 
-    ucs_debug("mpool %s: align %zu, maxelems %u, elemsize %zu",
+    if (ucs_mpool_current_acct != NULL) {
+        mp->data->acct = ucs_mpool_current_acct;
+        ucs_list_add_tail(&mp->data->acct->mpools, &mp->data->acct_list);
+    }
+
+    ucs_debug("mpool %s: align %zu, maxelems %u, elemsize %zu acct %p",
               ucs_mpool_name(mp), mp->data->alignment, params->max_elems,
-              mp->data->elem_size);
+              mp->data->elem_size, mp->data->acct);
     return UCS_OK;
 
 err_free_name:
@@ -146,6 +160,20 @@ err_strdup:
     return status;
 }
 
+static void ucs_mpool_chunk_release(ucs_mpool_t *mp, ucs_mpool_chunk_t *chunk)
+{
+    ucs_mpool_data_t *data = mp->data;
+
+    ucs_assert(data->chunks_size >= chunk->size);
+    data->chunks_size -= chunk->size;
+    if (data->acct != NULL) {
+        ucs_assert(data->acct->total >= chunk->size);
+        data->acct->total -= chunk->size;
+    }
+
+    data->ops->chunk_release(mp, chunk);
+}
+
 void ucs_mpool_cleanup(ucs_mpool_t *mp, int leak_check)
 {
     ucs_mpool_chunk_t *chunk, *next_chunk;
@@ -188,7 +216,11 @@ void ucs_mpool_cleanup(ucs_mpool_t *mp, int leak_check)
     while (next_chunk != NULL) {
         chunk      = next_chunk;
         next_chunk = chunk->next;
-        data->ops->chunk_release(mp, chunk);
+        ucs_mpool_chunk_release(mp, chunk);
+    }
+
+    if (data->acct != NULL) {
+        ucs_list_del(&data->acct_list);
     }
 
     ucs_debug("mpool %s destroyed", ucs_mpool_name(mp));
@@ -245,6 +277,28 @@ unsigned ucs_mpool_num_elems_per_chunk(ucs_mpool_t *mp,
     return ucs_min(data->quota, elem_size / ucs_mpool_elem_total_size(data));
 }
 
+static int ucs_mpool_acct_check_limit(ucs_mpool_t *mp, size_t chunk_size)
+{
+    ucs_mpool_acct_t *acct = mp->data->acct;
+
+    if ((acct->total + chunk_size) <= acct->limit) {
+        return 1;
+    }
+
+    ++acct->num_denied;
+    if (!mp->data->malloc_safe) {
+        ucs_debug("mpool %s: chunk of %zu bytes exceeds the limit %zu of "
+                  "accounting group %p (total %zu)", ucs_mpool_name(mp),
+                  chunk_size, acct->limit, acct, acct->total);
+    }
+
+    if (acct->limit_cb != NULL) {
+        acct->limit_cb(acct, acct->limit_arg);
+    }
+
+    return 0;
+}
+
 void ucs_mpool_grow(ucs_mpool_t *mp, unsigned num_elems)
 {
     ucs_mpool_data_t *data = mp->data;
@@ -263,6 +317,10 @@ void ucs_mpool_grow(ucs_mpool_t *mp, unsigned num_elems)
     allocated_num_elems = ucs_min(data->quota, num_elems);
     chunk_size          = ucs_mpool_chunk_size(mp, allocated_num_elems);
     chunk_size          = ucs_min(chunk_size, data->max_chunk_size);
+    if ((data->acct != NULL) && !ucs_mpool_acct_check_limit(mp, chunk_size)) {
+        return;
+    }
+
     status = data->ops->chunk_alloc(mp, &chunk_size, &ptr);
     if (status != UCS_OK) {
         if (!data->malloc_safe) {
@@ -273,9 +331,18 @@ void ucs_mpool_grow(ucs_mpool_t *mp, unsigned num_elems)
     }
 
     /* Calculate padding, and update element count according to allocated size */
-    chunk            = ptr;
-    chunk->elems     = ucs_mpool_chunk_elems(mp, chunk);
-    chunk->num_elems = ucs_mpool_num_elems_per_chunk(mp, chunk, chunk_size);
+    chunk             = ptr;
+    chunk->elems      = ucs_mpool_chunk_elems(mp, chunk);
+    chunk->num_elems  = ucs_mpool_num_elems_per_chunk(mp, chunk, chunk_size);
+    chunk->size       = chunk_size;
+    chunk->idle_since = 0;
+
+    data->chunks_size   += chunk_size;
+    data->last_grow_time = ucs_get_time();
+    if (data->acct != NULL) {
+        data->acct->total += chunk_size;
+        data->acct->peak   = ucs_max(data->acct->peak, data->acct->total);
+    }
 
     if (!data->malloc_safe) {
         ucs_debug("mpool %s: allocated chunk %p of %lu bytes with %u elements",
@@ -323,6 +390,250 @@ void *ucs_mpool_get_grow(ucs_mpool_t *mp)
     return ucs_mpool_get(mp);
 }
 
+/* State of a chunk during a reclaim scan */
+typedef struct {
+    ucs_mpool_chunk_t *chunk;    /* Memory pool chunk */
+    void              *elems;    /* Chunk elements, saved since the chunk may
+                                    be released during the scan */
+    unsigned          num_free;  /* Number of free elements in the chunk */
+    int               release;   /* Whether the chunk should be released */
+} ucs_mpool_chunk_scan_t;
+
+static int ucs_mpool_chunk_scan_compare(const void *elem1, const void *elem2)
+{
+    const ucs_mpool_chunk_scan_t *scan1 = elem1;
+    const ucs_mpool_chunk_scan_t *scan2 = elem2;
+
+    return ((uintptr_t)scan1->elems > (uintptr_t)scan2->elems) -
+           ((uintptr_t)scan1->elems < (uintptr_t)scan2->elems);
+}
+
+/* Find the chunk containing the element, in an array sorted by address */
+static ucs_mpool_chunk_scan_t *
+ucs_mpool_chunk_scan_find(ucs_mpool_chunk_scan_t *scan, unsigned num_chunks,
+                          const void *elem)
+{
+    unsigned low  = 0;
+    unsigned high = num_chunks;
+    unsigned mid;
+
+    while ((high - low) > 1) {
+        mid = (low + high) / 2;
+        if ((uintptr_t)scan[mid].elems <= (uintptr_t)elem) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    return &scan[low];
+}
+
+static void ucs_mpool_chunks_set_busy(ucs_mpool_data_t *data)
+{
+    ucs_mpool_chunk_t *chunk;
+
+    for (chunk = data->chunks; chunk != NULL; chunk = chunk->next) {
+        chunk->idle_since = 0;
+    }
+}
+
+size_t ucs_mpool_reclaim(ucs_mpool_t *mp, ucs_time_t idle_time)
+{
+    ucs_mpool_data_t *data = mp->data;
+    ucs_time_t now         = ucs_get_time();
+    ucs_mpool_chunk_scan_t *scan, *chunk_scan;
+    ucs_mpool_elem_t *elem, *next_elem, *prev_elem;
+    ucs_mpool_chunk_t *chunk, **chunk_p;
+    unsigned num_chunks, num_release, i;
+    size_t released_size;
+    void *obj;
+
+    if (data->malloc_safe || (data->chunks == NULL)) {
+        return 0;
+    }
+
+    /* A pool which grew recently would allocate the released chunks again */
+    if ((mp->freelist == NULL) || ((now - data->last_grow_time) < idle_time)) {
+        ucs_mpool_chunks_set_busy(data);
+        return 0;
+    }
+
+    num_chunks = 0;
+    for (chunk = data->chunks; chunk != NULL; chunk = chunk->next) {
+        ++num_chunks;
+    }
+
+    scan = ucs_malloc(num_chunks * sizeof(*scan), "mpool_reclaim");
+    if (scan == NULL) {
+        return 0;
+    }
+
+    i = 0;
+    for (chunk = data->chunks; chunk != NULL; chunk = chunk->next) {
+        scan[i].chunk    = chunk;
+        scan[i].elems    = chunk->elems;
+        scan[i].num_free = 0;
+        ++i;
+    }
+
+    qsort(scan, num_chunks, sizeof(*scan), ucs_mpool_chunk_scan_compare);
+
+    /* Count the free elements of every chunk */
+    for (elem = mp->freelist; elem != NULL; elem = next_elem) {
+        VALGRIND_MAKE_MEM_DEFINED(elem, sizeof(*elem));
+        next_elem = elem->next;
+        VALGRIND_MAKE_MEM_NOACCESS(elem, sizeof(*elem));
+        ++ucs_mpool_chunk_scan_find(scan, num_chunks, elem)->num_free;
+    }
+
+    /* Release the chunks which were found unused for at least idle_time */
+    num_release = 0;
+    for (i = 0; i < num_chunks; ++i) {
+        chunk = scan[i].chunk;
+        if (scan[i].num_free < chunk->num_elems) {
+            chunk->idle_since = 0;
+            scan[i].release   = 0;
+            continue;
+        }
+
+        if (chunk->idle_since == 0) {
+            chunk->idle_since = now;
+        }
+
+        scan[i].release = (now - chunk->idle_since) >= idle_time;
+        num_release    += scan[i].release;
+    }
+
+    if (num_release == 0) {
+        ucs_free(scan);
+        return 0;
+    }
+
+    /* Remove the elements of released chunks from the freelist */
+    prev_elem = NULL;
+    for (elem = mp->freelist; elem != NULL; elem = next_elem) {
+        VALGRIND_MAKE_MEM_DEFINED(elem, sizeof(*elem));
+        next_elem  = elem->next;
+        chunk_scan = ucs_mpool_chunk_scan_find(scan, num_chunks, elem);
+        if (!chunk_scan->release) {
+            if (prev_elem == NULL) {
+                mp->freelist = elem;
+            } else {
+                VALGRIND_MAKE_MEM_DEFINED(prev_elem, sizeof(*prev_elem));
+                prev_elem->next = elem;
+                VALGRIND_MAKE_MEM_NOACCESS(prev_elem, sizeof(*prev_elem));
+            }
+            VALGRIND_MAKE_MEM_NOACCESS(elem, sizeof(*elem));
+            prev_elem = elem;
+        } else if (data->ops->obj_cleanup != NULL) {
+            obj = elem + 1;
+            VALGRIND_MEMPOOL_ALLOC(mp, obj, data->elem_size - sizeof(*elem));
+            VALGRIND_MAKE_MEM_DEFINED(obj, data->elem_size - sizeof(*elem));
+            data->ops->obj_cleanup(mp, obj);
+            VALGRIND_MEMPOOL_FREE(mp, obj);
+        }
+    }
+
+    if (prev_elem == NULL) {
+        mp->freelist = NULL;
+    } else {
+        VALGRIND_MAKE_MEM_DEFINED(prev_elem, sizeof(*prev_elem));
+        prev_elem->next = NULL;
+        VALGRIND_MAKE_MEM_NOACCESS(prev_elem, sizeof(*prev_elem));
+    }
+    data->tail = prev_elem;
+
+    released_size = 0;
+    chunk_p       = &data->chunks;
+    while (*chunk_p != NULL) {
+        chunk      = *chunk_p;
+        chunk_scan = ucs_mpool_chunk_scan_find(scan, num_chunks, chunk->elems);
+        if (!chunk_scan->release) {
+            chunk_p = &chunk->next;
+            continue;
+        }
+
+        *chunk_p = chunk->next;
+        if (data->quota != UINT_MAX) {
+            data->quota += chunk->num_elems;
+        }
+
+        ucs_debug("mpool %s: releasing chunk %p of %zu bytes with %u elements",
+                  ucs_mpool_name(mp), chunk, chunk->size, chunk->num_elems);
+        released_size += chunk->size;
+        ucs_mpool_chunk_release(mp, chunk);
+    }
+
+    ucs_free(scan);
+    return released_size;
+}
+
+size_t ucs_mpool_shrink(ucs_mpool_t *mp)
+{
+    return ucs_mpool_reclaim(mp, 0);
+}
+
+void ucs_mpool_acct_init(ucs_mpool_acct_t *acct, size_t limit,
+                         ucs_mpool_acct_limit_cb_t limit_cb, void *arg)
+{
+    acct->limit      = limit;
+    acct->total      = 0;
+    acct->peak       = 0;
+    acct->num_denied = 0;
+    acct->limit_cb   = limit_cb;
+    acct->limit_arg  = arg;
+    ucs_list_head_init(&acct->mpools);
+}
+
+void ucs_mpool_acct_cleanup(ucs_mpool_acct_t *acct)
+{
+    ucs_mpool_data_t *data, *tmp;
+
+    ucs_list_for_each_safe(data, tmp, &acct->mpools, acct_list) {
+        ucs_warn("mpool %s is still in accounting group %p", data->name, acct);
+        ucs_list_del(&data->acct_list);
+        data->acct = NULL;
+    }
+
+    if (ucs_mpool_current_acct == acct) {
+        ucs_mpool_current_acct = NULL;
+    }
+}
+
+ucs_mpool_acct_t *ucs_mpool_acct_set_current(ucs_mpool_acct_t *acct)
+{
+    ucs_mpool_acct_t *prev_acct = ucs_mpool_current_acct;
+
+    ucs_mpool_current_acct = acct;
+    return prev_acct;
+}
+
+size_t ucs_mpool_acct_reclaim(ucs_mpool_acct_t *acct, ucs_time_t idle_time)
+{
+    size_t released_size = 0;
+    ucs_mpool_data_t *data;
+
+    ucs_list_for_each(data, &acct->mpools, acct_list) {
+        released_size += ucs_mpool_reclaim(data->mp, idle_time);
+    }
+
+    return released_size;
+}
+
+size_t ucs_mpool_acct_shrink(ucs_mpool_acct_t *acct)
+{
+    return ucs_mpool_acct_reclaim(acct, 0);
+}
+
+int ucs_mpool_huge_pages_allowed(ucs_mpool_huge_pages_t kind)
+{
+    /* The default policy does not restrict memory pools, and every other
+     * policy also allows the kinds of huge pages below it */
+    return (ucs_global_opts.mpool_huge_pages == UCS_MPOOL_HUGE_PAGES_DEFAULT) ||
+           (ucs_global_opts.mpool_huge_pages >= kind);
+}
+
 ucs_status_t ucs_mpool_chunk_malloc(ucs_mpool_t *mp, size_t *size_p, void **chunk_p)
 {
     *chunk_p = ucs_malloc(*size_p, ucs_mpool_name(mp));
@@ -369,6 +680,47 @@ typedef struct ucs_hugetlb_mpool_chunk_hdr {
     int hugetlb;
 } ucs_hugetlb_mpool_chunk_hdr_t;
 
+/* Allocate a chunk backed by transparent huge pages, or return NULL */
+static void *ucs_mpool_thp_malloc(ucs_mpool_t *mp, size_t *size_p)
+{
+#ifdef MADV_HUGEPAGE
+    ssize_t huge_page_size;
+    size_t real_size;
+    void *ptr;
+    int ret;
+
+    huge_page_size = ucs_get_huge_page_size();
+    if ((huge_page_size <= 0) || !ucs_is_thp_enabled()) {
+        return NULL;
+    }
+
+    /* Do not waste more than the chunk size for alignment */
+    real_size = ucs_align_up(*size_p, huge_page_size);
+    if (real_size >= (*size_p * 2)) {
+        return NULL;
+    }
+
+    ret = ucs_posix_memalign(&ptr, huge_page_size, real_size,
+                             ucs_mpool_name(mp));
+    if (ret != 0) {
+        return NULL;
+    }
+
+    ret = madvise(ptr, real_size, MADV_HUGEPAGE);
+    if (ret != 0) {
+        ucs_debug("mpool %s: madvise(%p, %zu, MADV_HUGEPAGE) failed: %m",
+                  ucs_mpool_name(mp), ptr, real_size);
+        ucs_free(ptr);
+        return NULL;
+    }
+
+    *size_p = real_size;
+    return ptr;
+#else
+    return NULL;
+#endif
+}
+
 ucs_status_t ucs_mpool_hugetlb_malloc(ucs_mpool_t *mp, size_t *size_p, void **chunk_p)
 {
     ucs_hugetlb_mpool_chunk_hdr_t *chunk;
@@ -380,19 +732,30 @@ ucs_status_t ucs_mpool_hugetlb_malloc(ucs_mpool_t *mp, size_t *size_p, void **ch
 #endif
 
 #ifdef SHM_HUGETLB
-    ptr = NULL;
-
     /* First, try hugetlb */
-    real_size = *size_p;
-    status = ucs_sysv_alloc(&real_size, real_size * 2, (void**)&ptr, SHM_HUGETLB,
-                            ucs_mpool_name(mp), &shmid);
-    if (status == UCS_OK) {
-        chunk = ptr;
-        chunk->hugetlb = 1;
-        goto out_ok;
+    if (ucs_mpool_huge_pages_allowed(UCS_MPOOL_HUGE_PAGES_HUGETLB)) {
+        ptr       = NULL;
+        real_size = *size_p;
+        status    = ucs_sysv_alloc(&real_size, real_size * 2, (void**)&ptr,
+                                   SHM_HUGETLB, ucs_mpool_name(mp), &shmid);
+        if (status == UCS_OK) {
+            chunk          = ptr;
+            chunk->hugetlb = 1;
+            goto out_ok;
+        }
     }
 #endif
 
+    /* Then, transparent huge pages, only if requested explicitly */
+    if (ucs_global_opts.mpool_huge_pages >= UCS_MPOOL_HUGE_PAGES_MADVISE) {
+        real_size = *size_p;
+        chunk     = ucs_mpool_thp_malloc(mp, &real_size);
+        if (chunk != NULL) {
+            chunk->hugetlb = 0;
+            goto out_ok;
+        }
+    }
+
     /* Fallback to glibc */
     real_size = *size_p;
     chunk = ucs_malloc(real_size, ucs_mpool_name(mp));
@@ -11,6 +11,9 @@
 #include <ucs/type/status.h>
 #include <ucs/sys/compiler_def.h>
 #include <ucs/datastruct/string_buffer.h>
+#include <ucs/datastruct/list.h>
+#include <ucs/config/types.h>
+#include <ucs/time/time_def.h>
 
 
 BEGIN_C_DECLS
@@ -22,6 +25,7 @@ typedef union  ucs_mpool_elem    ucs_mpool_elem_t;
 typedef struct ucs_mpool         ucs_mpool_t;
 typedef struct ucs_mpool_data    ucs_mpool_data_t;
 typedef struct ucs_mpool_ops     ucs_mpool_ops_t;
+typedef struct ucs_mpool_acct    ucs_mpool_acct_t;
 
 
 /**
@@ -57,6 +61,9 @@ struct ucs_mpool_chunk {
     ucs_mpool_chunk_t      *next;      /* Next chunk */
     void                   *elems;     /* Array of elements */
     unsigned               num_elems;  /* How many elements */
+    size_t                 size;       /* Chunk size, as returned by chunk_alloc() */
+    ucs_time_t             idle_since; /* Time since all chunk elements were found
+                                          free by ucs_mpool_reclaim(), or 0 */
 };
 
 
@@ -86,6 +93,41 @@ struct ucs_mpool_data {
     ucs_mpool_chunk_t      *chunks;         /* List of allocated chunks */
     const ucs_mpool_ops_t  *ops;            /* Memory pool operations */
     char                   *name;           /* Name - used for debugging */
+    size_t                 chunks_size;     /* Total size of allocated chunks */
+    ucs_time_t             last_grow_time;  /* Time of the last chunk allocation */
+    ucs_mpool_acct_t       *acct;           /* Accounting group, or NULL */
+    ucs_list_link_t        acct_list;       /* Entry in the accounting group */
+    ucs_mpool_t            *mp;             /* Memory pool of this data, used by
+                                             * the accounting group */
+};
+
+
+/**
+ * Callback which is called when a memory pool of an accounting group cannot
+ * grow because the group limit would be exceeded.
+ *
+ * @param acct         Accounting group.
+ * @param arg          User-defined argument, as passed to ucs_mpool_acct_init().
+ */
+typedef void (*ucs_mpool_acct_limit_cb_t)(ucs_mpool_acct_t *acct, void *arg);
+
+
+/**
+ * Memory accounting group, which sums the size of the chunks allocated by a set
+ * of memory pools and limits their growth.
+ *
+ * A memory pool joins the group which is current on the calling thread when it
+ * is initialized, see @ref ucs_mpool_acct_set_current. All memory pools of a
+ * group must be used from the same serialization context.
+ */
+struct ucs_mpool_acct {
+    size_t                    limit;      /* Maximal total size of chunks */
+    size_t                    total;      /* Current total size of chunks */
+    size_t                    peak;       /* Peak total size of chunks */
+    unsigned long             num_denied; /* Chunk allocations denied by the limit */
+    ucs_list_link_t           mpools;     /* Memory pools in the group */
+    ucs_mpool_acct_limit_cb_t limit_cb;   /* Called when an allocation is denied */
+    void                      *limit_arg; /* Argument for limit_cb */
 };
 
 
@@ -299,6 +341,101 @@ void ucs_mpool_grow(ucs_mpool_t *mp, unsigned num_elems);
 void *ucs_mpool_get_grow(ucs_mpool_t *mp);
 
 
+/**
+ * Release the chunks which were unused for at least the given time.
+ *
+ * Chunk occupancy is sampled by this function: every call scans the freelist,
+ * and marks the time at which a chunk was first found with all its elements
+ * free. A chunk is released when it was found unused by all calls during
+ * @a idle_time. To avoid releasing chunks which would be allocated again soon,
+ * nothing is released if the pool grew during the last @a idle_time.
+ *
+ * This is a slow-path operation, whose cost is proportional to the number of
+ * free elements. It does nothing for memory pools which were created with
+ * malloc_safe flag.
+ *
+ * @param mp               Memory pool structure.
+ * @param idle_time        Minimal time a chunk should be unused to be
+ *                          released, or 0 to release all unused chunks.
+ *
+ * @return Total size of released chunks.
+ */
+size_t ucs_mpool_reclaim(ucs_mpool_t *mp, ucs_time_t idle_time);
+
+
+/**
+ * Release all the chunks whose elements are all in the pool freelist. Same as
+ * @ref ucs_mpool_reclaim with @a idle_time 0.
+ *
+ * @param mp               Memory pool structure.
+ *
+ * @return Total size of released chunks.
+ */
+size_t ucs_mpool_shrink(ucs_mpool_t *mp);
+
+
+/**
+ * Initialize a memory accounting group.
+ *
+ * @param acct             Accounting group to initialize.
+ * @param limit            Maximal total size of the chunks of the group memory
+ *                          pools, or UCS_MEMUNITS_INF for no limit.
+ * @param limit_cb         Called when a memory pool could not grow because of
+ *                          the limit, may be NULL. The callback may be called
+ *                          from the context of ucs_mpool_get(), so it should
+ *                          not release memory pool chunks; it can schedule a
+ *                          call to @ref ucs_mpool_acct_shrink instead.
+ * @param arg              User-defined argument for @a limit_cb.
+ */
+void ucs_mpool_acct_init(ucs_mpool_acct_t *acct, size_t limit,
+                         ucs_mpool_acct_limit_cb_t limit_cb, void *arg);
+
+
+/**
+ * Cleanup a memory accounting group. Memory pools which are still in the group
+ * are detached from it.
+ *
+ * @param acct             Accounting group to clean up.
+ */
+void ucs_mpool_acct_cleanup(ucs_mpool_acct_t *acct);
+
+
+/**
+ * Set the accounting group which memory pools initialized by the calling thread
+ * join. This allows accounting for memory pools created by lower layers, such
+ * as transport interfaces.
+ *
+ * @param acct             Accounting group, or NULL to stop accounting.
+ *
+ * @return The previous accounting group of the calling thread, which should be
+ *         restored after the memory pools are initialized.
+ */
+ucs_mpool_acct_t *ucs_mpool_acct_set_current(ucs_mpool_acct_t *acct);
+
+
+/**
+ * Release the idle chunks of all memory pools in the group, see
+ * @ref ucs_mpool_reclaim.
+ *
+ * @param acct             Accounting group.
+ * @param idle_time        Minimal time a chunk should be unused to be released.
+ *
+ * @return Total size of released chunks.
+ */
+size_t ucs_mpool_acct_reclaim(ucs_mpool_acct_t *acct, ucs_time_t idle_time);
+
+
+/**
+ * Release the unused chunks of all memory pools in the group, see
+ * @ref ucs_mpool_shrink.
+ *
+ * @param acct             Accounting group.
+ *
+ * @return Total size of released chunks.
+ */
+size_t ucs_mpool_acct_shrink(ucs_mpool_acct_t *acct);
+
+
 /**
  * Return the number of elements in the chunk.
  * @param mp               Memory pool structure.
@@ -310,6 +447,18 @@ unsigned ucs_mpool_num_elems_per_chunk(ucs_mpool_t *mp,
                                        ucs_mpool_chunk_t *chunk,
                                        size_t chunk_size);
 
+/**
+ * Check whether memory pool chunks may use the given kind of huge pages,
+ * according to the UCX_MPOOL_HUGE_PAGES policy. The default policy allows all
+ * kinds of huge pages.
+ *
+ * @param kind             Kind of huge pages.
+ *
+ * @return Nonzero if the kind of huge pages is allowed.
+ */
+int ucs_mpool_huge_pages_allowed(ucs_mpool_huge_pages_t kind);
+
+
 /**
  * heap-based chunk allocator.
  */
@@ -325,7 +474,9 @@ void ucs_mpool_chunk_munmap(ucs_mpool_t *mp, void *chunk);
 
 
 /**
- * hugetlb chunk allocator.
+ * Huge pages chunk allocator. The kind of huge pages is selected by the
+ * UCX_MPOOL_HUGE_PAGES policy, with fallback to regular pages from the heap.
+ * The default policy uses hugetlbfs pages, without transparent huge pages.
  */
 ucs_status_t ucs_mpool_hugetlb_malloc(ucs_mpool_t *mp, size_t *size_p, void **chunk_p);
 void ucs_mpool_hugetlb_free(ucs_mpool_t *mp, void *chunk);
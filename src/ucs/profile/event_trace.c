@@ -0,0 +1,624 @@
+/**
+* Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+*
+* See file LICENSE for terms.
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "event_trace.h"
+
+#include <ucs/arch/atomic.h>
+#include <ucs/config/parser.h>
+#include <ucs/datastruct/list.h>
+#include <ucs/datastruct/string_buffer.h>
+#include <ucs/debug/log.h>
+#include <ucs/debug/memtrack_int.h>
+#include <ucs/sys/lib.h>
+#include <ucs/sys/math.h>
+#include <ucs/sys/ptr_arith.h>
+#include <ucs/sys/string.h>
+#include <ucs/sys/sys.h>
+#include <ucs/time/time.h>
+#include <ucs/vfs/base/vfs_obj.h>
+#include <pthread.h>
+#include <fcntl.h>
+
+
+/* Event trace location, with a back-pointer to the call site */
+typedef struct ucs_event_trace_location {
+    ucs_profile_location_t        super;
+    ucs_event_trace_loc_t         *trace_loc;
+} ucs_event_trace_location_t;
+
+
+/* Per-thread event ring */
+typedef struct ucs_event_trace_thread {
+    ucs_list_link_t               list;         /**< Entry in thread list */
+    int                           tid;          /**< System thread id */
+    int                           is_completed; /**< Set to 1 when thread exits */
+    ucs_time_t                    start_time;   /**< Ring creation time */
+    ucs_time_t                    end_time;     /**< Thread exit time */
+    uint64_t                      mask;         /**< Ring size minus 1 */
+    volatile uint64_t             head;         /**< Number of recorded events */
+    ucs_profile_record_t          *records;     /**< Ring of events */
+} ucs_event_trace_thread_t;
+
+
+typedef struct ucs_event_trace_context {
+    pthread_mutex_t               mutex;         /**< Protects the fields below */
+    pthread_key_t                 tls_key;       /**< Detects thread exit */
+    ucs_event_trace_location_t    *locations;    /**< Array of all locations */
+    unsigned                      num_locations; /**< Number of valid locations */
+    unsigned                      max_locations; /**< Size of locations array */
+    ucs_list_link_t               thread_list;   /**< List of thread rings */
+    char                          last_snapshot[PATH_MAX]; /**< Last snapshot file */
+} ucs_event_trace_context_t;
+
+
+volatile int ucs_event_trace_enabled = 0;
+
+static ucs_event_trace_context_t ucs_event_trace_context = {
+    .mutex         = PTHREAD_MUTEX_INITIALIZER,
+    .locations     = NULL,
+    .num_locations = 0,
+    .max_locations = 0,
+    .thread_list   = UCS_LIST_INITIALIZER(&ucs_event_trace_context.thread_list,
+                                          &ucs_event_trace_context.thread_list),
+    .last_snapshot = ""
+};
+
+/* Used by threads which failed to allocate a ring, to avoid retrying */
+static ucs_profile_record_t ucs_event_trace_null_record;
+static ucs_event_trace_thread_t ucs_event_trace_null_thread = {
+    .mask    = 0,
+    .records = &ucs_event_trace_null_record
+};
+
+/* Initial-exec model avoids a call to __tls_get_addr() on every event */
+static __thread ucs_event_trace_thread_t *ucs_event_trace_thread_ctx
+        __attribute__((tls_model("initial-exec"))) = NULL;
+
+
+static UCS_F_NOINLINE ucs_profile_loc_id_t
+ucs_event_trace_get_location(ucs_event_trace_loc_t *trace_loc)
+{
+    ucs_event_trace_context_t *ctx = &ucs_event_trace_context;
+    ucs_event_trace_location_t *loc, *new_locations;
+    ucs_profile_loc_id_t loc_id;
+    unsigned max_locations;
+
+    pthread_mutex_lock(&ctx->mutex);
+
+    /* Check, with lock held, that the location is not already initialized */
+    if (trace_loc->id != UCS_PROFILE_LOC_ID_UNKNOWN) {
+        loc_id = trace_loc->id;
+        goto out_unlock;
+    }
+
+    for (loc = ctx->locations; loc < ctx->locations + ctx->num_locations;
+         ++loc) {
+        if ((trace_loc->type == loc->super.type) &&
+            (trace_loc->line == loc->super.line) &&
+            !strcmp(loc->super.name, trace_loc->name) &&
+            !strcmp(loc->super.file, ucs_basename(trace_loc->file)) &&
+            !strcmp(loc->super.function, trace_loc->function)) {
+            goto out_found;
+        }
+    }
+
+    /* Location ID is a short integer, and 0 is reserved */
+    if (ctx->num_locations >= INT16_MAX) {
+        ucs_debug("too many event trace locations, disabling %s:%d",
+                  ucs_basename(trace_loc->file), trace_loc->line);
+        trace_loc->id = loc_id = UCS_PROFILE_LOC_ID_DISABLED;
+        goto out_unlock;
+    }
+
+    if (ctx->num_locations == ctx->max_locations) {
+        max_locations = ucs_max(16, 2 * ctx->max_locations);
+        new_locations = ucs_realloc(ctx->locations,
+                                    sizeof(*ctx->locations) * max_locations,
+                                    "event_trace_locations");
+        if (new_locations == NULL) {
+            ucs_warn("failed to expand event trace locations array");
+            trace_loc->id = loc_id = UCS_PROFILE_LOC_ID_DISABLED;
+            goto out_unlock;
+        }
+
+        ctx->locations     = new_locations;
+        ctx->max_locations = max_locations;
+    }
+
+    loc = &ctx->locations[ctx->num_locations++];
+    memset(&loc->super, 0, sizeof(loc->super));
+    ucs_strncpy_zero(loc->super.file, ucs_basename(trace_loc->file),
+                     sizeof(loc->super.file));
+    ucs_strncpy_zero(loc->super.function, trace_loc->function,
+                     sizeof(loc->super.function));
+    ucs_strncpy_zero(loc->super.name, trace_loc->name,
+                     sizeof(loc->super.name));
+    loc->super.line = trace_loc->line;
+    loc->super.type = trace_loc->type;
+    loc->trace_loc  = trace_loc;
+
+out_found:
+    trace_loc->id = loc_id = (loc - ctx->locations) + 1;
+out_unlock:
+    pthread_mutex_unlock(&ctx->mutex);
+    return loc_id;
+}
+
+static UCS_F_NOINLINE ucs_event_trace_thread_t *ucs_event_trace_thread_init()
+{
+    ucs_event_trace_context_t *ctx = &ucs_event_trace_context;
+    size_t num_records = ucs_roundup_pow2(
+            ucs_max(ucs_global_opts.event_trace_size, 1));
+    ucs_event_trace_thread_t *thread;
+
+    thread = ucs_malloc(sizeof(*thread), "event_trace_thread");
+    if (thread == NULL) {
+        goto err;
+    }
+
+    thread->records = ucs_calloc(num_records, sizeof(*thread->records),
+                                 "event_trace_records");
+    if (thread->records == NULL) {
+        goto err_free;
+    }
+
+    thread->tid          = ucs_get_tid();
+    thread->is_completed = 0;
+    thread->start_time   = ucs_get_time();
+    thread->end_time     = 0;
+    thread->mask         = num_records - 1;
+    thread->head         = 0;
+
+    ucs_debug("event trace: thread %d ring of %zu records", thread->tid,
+              num_records);
+
+    pthread_mutex_lock(&ctx->mutex);
+    ucs_list_add_tail(&ctx->thread_list, &thread->list);
+    pthread_mutex_unlock(&ctx->mutex);
+
+    pthread_setspecific(ctx->tls_key, thread);
+    return thread;
+
+err_free:
+    ucs_free(thread);
+err:
+    ucs_warn("failed to allocate event trace ring of %zu records",
+             num_records);
+    return &ucs_event_trace_null_thread;
+}
+
+/* Only the owner thread updates the ring, a snapshot reader uses the head
+ * counter to detect records which were overwritten while it was copying */
+static UCS_F_ALWAYS_INLINE void
+ucs_event_trace_thread_push(ucs_event_trace_thread_t *thread,
+                            ucs_profile_loc_id_t loc_id, uint32_t param32,
+                            uint64_t param64)
+{
+    uint64_t head             = thread->head;
+    ucs_profile_record_t *rec = &thread->records[head & thread->mask];
+
+    rec->timestamp = ucs_get_time();
+    rec->param64   = param64;
+    rec->param32   = param32;
+    rec->location  = loc_id - 1;
+    ucs_memory_cpu_store_fence();
+    thread->head   = head + 1;
+}
+
+/* First event of a trace point or of a thread */
+static UCS_F_NOINLINE void
+ucs_event_trace_record_slow(ucs_event_trace_loc_t *trace_loc, uint32_t param32,
+                            uint64_t param64)
+{
+    ucs_event_trace_thread_t *thread = ucs_event_trace_thread_ctx;
+    ucs_profile_loc_id_t loc_id      = trace_loc->id;
+
+    if (loc_id <= 0) {
+        if (loc_id == UCS_PROFILE_LOC_ID_DISABLED) {
+            return;
+        }
+
+        loc_id = ucs_event_trace_get_location(trace_loc);
+        if (loc_id == UCS_PROFILE_LOC_ID_DISABLED) {
+            return;
+        }
+    }
+
+    if (thread == NULL) {
+        thread                     = ucs_event_trace_thread_init();
+        ucs_event_trace_thread_ctx = thread;
+    }
+
+    ucs_event_trace_thread_push(thread, loc_id, param32, param64);
+}
+
+void ucs_event_trace_record(ucs_event_trace_loc_t *trace_loc, uint32_t param32,
+                            uint64_t param64)
+{
+    ucs_event_trace_thread_t *thread = ucs_event_trace_thread_ctx;
+    ucs_profile_loc_id_t loc_id      = trace_loc->id;
+
+    if (ucs_unlikely((loc_id <= 0) || (thread == NULL))) {
+        ucs_event_trace_record_slow(trace_loc, param32, param64);
+        return;
+    }
+
+    ucs_event_trace_thread_push(thread, loc_id, param32, param64);
+}
+
+void ucs_event_trace_enable(int enable)
+{
+    ucs_debug("event trace %s", enable ? "enabled" : "disabled");
+    ucs_event_trace_enabled = !!enable;
+}
+
+static ucs_status_t
+ucs_event_trace_write_data(int fd, const void *data, size_t size)
+{
+    ssize_t written;
+
+    if (size == 0) {
+        return UCS_OK;
+    }
+
+    written = write(fd, data, size);
+    if (written < 0) {
+        ucs_error("failed to write %zu bytes to event trace file: %m", size);
+        return UCS_ERR_IO_ERROR;
+    } else if (written != size) {
+        ucs_error("wrote only %zd of %zu bytes to event trace file", written,
+                  size);
+        return UCS_ERR_IO_ERROR;
+    }
+
+    return UCS_OK;
+}
+
+/*
+ * Copy the ring of a thread to a buffer, and return the index of the first and
+ * the last+1 valid record. If the thread may be recording concurrently, records
+ * which it overwrote during the copy are excluded.
+ */
+static void
+ucs_event_trace_thread_copy(ucs_event_trace_thread_t *thread,
+                            ucs_profile_record_t *buffer, uint64_t *first_p,
+                            uint64_t *last_p)
+{
+    uint64_t size = thread->mask + 1;
+    uint64_t head_before, head_after, overwritten;
+    int is_quiescent;
+
+    is_quiescent = thread->is_completed ||
+                   (thread == ucs_event_trace_thread_ctx);
+    head_before  = thread->head;
+    ucs_memory_cpu_load_fence();
+    memcpy(buffer, thread->records, size * sizeof(*buffer));
+    ucs_memory_cpu_load_fence();
+    head_after   = thread->head;
+
+    /* The record with index 'head_after' could be in the middle of a write,
+     * and it replaces the record with index 'head_after - size' */
+    overwritten = is_quiescent ? head_after : (head_after + 1);
+    *last_p     = head_before;
+    *first_p    = ucs_max((head_before > size) ? (head_before - size) : 0,
+                          (overwritten > size) ? (overwritten - size) : 0);
+    if (*first_p > *last_p) {
+        *first_p = *last_p;
+    }
+}
+
+/* Global lock must be held */
+static ucs_status_t
+ucs_event_trace_write_thread(int fd, ucs_event_trace_thread_t *thread,
+                             ucs_time_t snapshot_time, size_t *size_p,
+                             size_t *num_events_p)
+{
+    ucs_event_trace_context_t *ctx = &ucs_event_trace_context;
+    ucs_profile_thread_location_t empty_location = {0};
+    ucs_profile_thread_header_t thread_hdr;
+    ucs_profile_record_t *buffer;
+    uint64_t first, last, first_slot, count;
+    ucs_status_t status;
+    unsigned i;
+
+    buffer = ucs_malloc((thread->mask + 1) * sizeof(*buffer),
+                        "event_trace_snapshot");
+    if (buffer == NULL) {
+        ucs_error("failed to allocate event trace snapshot buffer");
+        return UCS_ERR_NO_MEMORY;
+    }
+
+    ucs_event_trace_thread_copy(thread, buffer, &first, &last);
+    count      = last - first;
+    first_slot = first & thread->mask;
+
+    thread_hdr.tid         = thread->tid;
+    thread_hdr.start_time  = thread->start_time;
+    thread_hdr.end_time    = thread->is_completed ? thread->end_time :
+                                                    snapshot_time;
+    thread_hdr.num_records = count;
+
+    status = ucs_event_trace_write_data(fd, &thread_hdr, sizeof(thread_hdr));
+    if (status != UCS_OK) {
+        goto out;
+    }
+
+    /* The event trace does not accumulate per-location statistics */
+    for (i = 0; i < ctx->num_locations; ++i) {
+        status = ucs_event_trace_write_data(fd, &empty_location,
+                                            sizeof(empty_location));
+        if (status != UCS_OK) {
+            goto out;
+        }
+    }
+
+    /* Write the valid part of the ring, from the oldest record */
+    status = ucs_event_trace_write_data(
+            fd, buffer + first_slot,
+            ucs_min(count, thread->mask + 1 - first_slot) * sizeof(*buffer));
+    if (status != UCS_OK) {
+        goto out;
+    }
+
+    if (first_slot + count > thread->mask + 1) {
+        status = ucs_event_trace_write_data(
+                fd, buffer,
+                (first_slot + count - thread->mask - 1) * sizeof(*buffer));
+        if (status != UCS_OK) {
+            goto out;
+        }
+    }
+
+    *size_p       += sizeof(thread_hdr) +
+                     (ctx->num_locations * sizeof(empty_location)) +
+                     (count * sizeof(*buffer));
+    *num_events_p += count;
+
+out:
+    ucs_free(buffer);
+    return status;
+}
+
+/* Global lock must be held */
+static void ucs_event_trace_cleanup_completed_threads()
+{
+    ucs_event_trace_thread_t *thread, *tmp;
+
+    ucs_list_for_each_safe(thread, tmp, &ucs_event_trace_context.thread_list,
+                           list) {
+        if (thread->is_completed) {
+            ucs_list_del(&thread->list);
+            ucs_free(thread->records);
+            ucs_free(thread);
+        }
+    }
+}
+
+ucs_status_t ucs_event_trace_snapshot(const char *file_name, size_t *num_events)
+{
+    ucs_event_trace_context_t *ctx = &ucs_event_trace_context;
+    ucs_event_trace_location_t *loc;
+    ucs_event_trace_thread_t *thread;
+    ucs_string_buffer_t env_strb;
+    char fullpath[PATH_MAX];
+    char filename[PATH_MAX];
+    ucs_profile_header_t header;
+    size_t threads_size, total_events;
+    ucs_time_t snapshot_time;
+    ucs_status_t status;
+    ssize_t written;
+    int fd;
+
+    ucs_string_buffer_init(&env_strb);
+    ucs_config_parser_get_env_vars(&env_strb, " ");
+
+    pthread_mutex_lock(&ctx->mutex);
+
+    snapshot_time = ucs_get_time();
+
+    ucs_fill_filename_template((file_name != NULL) ? file_name :
+                                       ucs_global_opts.event_trace_file,
+                               filename, sizeof(filename));
+    ucs_expand_path(filename, fullpath, sizeof(fullpath) - 1);
+
+    fd = open(fullpath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        ucs_error("failed to open event trace file '%s': %m", fullpath);
+        status = UCS_ERR_IO_ERROR;
+        goto out_unlock;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.version = UCS_PROFILE_FILE_VERSION;
+    ucs_strncpy_safe(header.ucs_path, ucs_sys_get_lib_path(),
+                     sizeof(header.ucs_path));
+    ucs_strncpy_safe(header.cmdline, ucs_get_process_cmdline(),
+                     sizeof(header.cmdline));
+    ucs_strncpy_safe(header.hostname, ucs_get_host_name(),
+                     sizeof(header.hostname));
+    header.pid              = getpid();
+    header.mode             = UCS_BIT(UCS_PROFILE_MODE_LOG);
+    header.one_second       = ucs_time_from_sec(1.0);
+    header.env_vars.offset  = sizeof(header);
+    header.env_vars.size    = ucs_string_buffer_length(&env_strb);
+    header.locations.offset = header.env_vars.offset + header.env_vars.size;
+    header.locations.size   = ctx->num_locations * sizeof(loc->super);
+    header.threads.offset   = header.locations.offset + header.locations.size;
+
+    /* The header is written last, when the size of the threads is known */
+    if (lseek(fd, sizeof(header), SEEK_SET) < 0) {
+        ucs_error("failed to seek in event trace file '%s': %m", fullpath);
+        status = UCS_ERR_IO_ERROR;
+        goto out_close;
+    }
+
+    status = ucs_event_trace_write_data(fd, ucs_string_buffer_cstr(&env_strb),
+                                        header.env_vars.size);
+    if (status != UCS_OK) {
+        goto out_close;
+    }
+
+    for (loc = ctx->locations; loc < ctx->locations + ctx->num_locations;
+         ++loc) {
+        status = ucs_event_trace_write_data(fd, &loc->super,
+                                            sizeof(loc->super));
+        if (status != UCS_OK) {
+            goto out_close;
+        }
+    }
+
+    threads_size = 0;
+    total_events = 0;
+    ucs_list_for_each(thread, &ctx->thread_list, list) {
+        status = ucs_event_trace_write_thread(fd, thread, snapshot_time,
+                                              &threads_size, &total_events);
+        if (status != UCS_OK) {
+            goto out_close;
+        }
+    }
+
+    header.threads.size = threads_size;
+
+    written = pwrite(fd, &header, sizeof(header), 0);
+    if (written != sizeof(header)) {
+        ucs_error("failed to write event trace file header: %m");
+        status = UCS_ERR_IO_ERROR;
+        goto out_close;
+    }
+
+    /* Rings of exited threads are not needed after they were saved */
+    ucs_event_trace_cleanup_completed_threads();
+
+    ucs_strncpy_safe(ctx->last_snapshot, fullpath, sizeof(ctx->last_snapshot));
+    ucs_debug("saved %zu events to event trace file '%s'", total_events,
+              fullpath);
+    if (num_events != NULL) {
+        *num_events = total_events;
+    }
+
+out_close:
+    close(fd);
+out_unlock:
+    pthread_mutex_unlock(&ctx->mutex);
+    ucs_string_buffer_cleanup(&env_strb);
+    return status;
+}
+
+static void ucs_event_trace_thread_key_destr(void *data)
+{
+    ucs_event_trace_thread_t *thread = data;
+
+    /* The ring may be released by a snapshot once it is completed, so events
+     * recorded by later destructors of this thread are discarded */
+    pthread_mutex_lock(&ucs_event_trace_context.mutex);
+    ucs_event_trace_thread_ctx = &ucs_event_trace_null_thread;
+    thread->end_time           = ucs_get_time();
+    thread->is_completed       = 1;
+    pthread_mutex_unlock(&ucs_event_trace_context.mutex);
+}
+
+static void ucs_event_trace_vfs_read_enable(void *obj, ucs_string_buffer_t *strb,
+                                            void *arg_ptr, uint64_t arg_u64)
+{
+    ucs_string_buffer_appendf(strb, "%d\n", ucs_event_trace_enabled);
+}
+
+static ucs_status_t
+ucs_event_trace_vfs_write_enable(void *obj, const char *buffer, size_t size,
+                                 void *arg_ptr, uint64_t arg_u64)
+{
+    UCS_STRING_BUFFER_ONSTACK(strb, 32);
+    int enable;
+
+    ucs_string_buffer_appendf(&strb, "%s", buffer);
+    ucs_string_buffer_rtrim(&strb, "\n");
+    if (!ucs_config_sscanf_bool(ucs_string_buffer_cstr(&strb), &enable,
+                                NULL)) {
+        return UCS_ERR_INVALID_PARAM;
+    }
+
+    ucs_event_trace_enable(enable);
+    return UCS_OK;
+}
+
+static void
+ucs_event_trace_vfs_read_snapshot(void *obj, ucs_string_buffer_t *strb,
+                                  void *arg_ptr, uint64_t arg_u64)
+{
+    pthread_mutex_lock(&ucs_event_trace_context.mutex);
+    ucs_string_buffer_appendf(strb, "%s\n",
+                              ucs_event_trace_context.last_snapshot);
+    pthread_mutex_unlock(&ucs_event_trace_context.mutex);
+}
+
+static ucs_status_t
+ucs_event_trace_vfs_write_snapshot(void *obj, const char *buffer, size_t size,
+                                   void *arg_ptr, uint64_t arg_u64)
+{
+    return ucs_event_trace_snapshot(NULL, NULL);
+}
+
+void ucs_event_trace_init()
+{
+    ucs_event_trace_context_t *ctx = &ucs_event_trace_context;
+    int ret;
+
+    ret = pthread_key_create(&ctx->tls_key, ucs_event_trace_thread_key_destr);
+    if (ret != 0) {
+        ucs_error("failed to create event trace pthread key: %s",
+                  strerror(ret));
+        return;
+    }
+
+    ucs_vfs_obj_add_dir(NULL, ctx, "ucs/event_trace");
+    ucs_vfs_obj_add_rw_file(ctx, ucs_event_trace_vfs_read_enable,
+                            ucs_event_trace_vfs_write_enable, NULL, 0,
+                            "enable");
+    ucs_vfs_obj_add_rw_file(ctx, ucs_event_trace_vfs_read_snapshot,
+                            ucs_event_trace_vfs_write_snapshot, NULL, 0,
+                            "snapshot");
+
+    ucs_event_trace_enable(ucs_global_opts.event_trace);
+}
+
+void ucs_event_trace_cleanup()
+{
+    ucs_event_trace_context_t *ctx = &ucs_event_trace_context;
+    ucs_event_trace_location_t *loc;
+    ucs_event_trace_thread_t *thread;
+
+    ucs_event_trace_enable(0);
+    ucs_vfs_obj_remove(ctx);
+
+    pthread_mutex_lock(&ctx->mutex);
+
+    /* Rings of other running threads are still referenced by their thread
+     * local pointers, so only the ring of the calling thread is released */
+    thread = ucs_event_trace_thread_ctx;
+    if ((thread != NULL) && (thread != &ucs_event_trace_null_thread)) {
+        thread->is_completed = 1;
+    }
+    ucs_event_trace_thread_ctx = NULL;
+    ucs_event_trace_cleanup_completed_threads();
+
+    for (loc = ctx->locations; loc < ctx->locations + ctx->num_locations;
+         ++loc) {
+        loc->trace_loc->id = UCS_PROFILE_LOC_ID_UNKNOWN;
+    }
+
+    ucs_free(ctx->locations);
+    ctx->locations     = NULL;
+    ctx->num_locations = 0;
+    ctx->max_locations = 0;
+
+    pthread_mutex_unlock(&ctx->mutex);
+
+    pthread_key_delete(ctx->tls_key);
+}
@@ -0,0 +1,143 @@
+/**
+* Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+*
+* See file LICENSE for terms.
+*/
+
+#ifndef UCS_EVENT_TRACE_H_
+#define UCS_EVENT_TRACE_H_
+
+#include <ucs/profile/profile_defs.h>
+#include <ucs/sys/compiler_def.h>
+#include <ucs/type/status.h>
+
+BEGIN_C_DECLS
+
+/*
+ * Event trace
+ *
+ * Lightweight tracing which is compiled into all builds, as opposed to the
+ * UCS_PROFILE_ macros which are enabled only by --enable-profiling. Every
+ * thread records fixed-size events, with a TSC timestamp, into its own ring
+ * buffer of UCX_EVENT_TRACE_SIZE entries. When the ring is full, the oldest
+ * events are overwritten.
+ *
+ * The trace is turned on and off at runtime by ucs/event_trace/enable VFS file,
+ * or UCX_EVENT_TRACE at startup. Writing to ucs/event_trace/snapshot VFS file
+ * saves the current contents of all rings to UCX_EVENT_TRACE_FILE, in the
+ * profiling file format (which ucx_read_profile can parse), without stopping
+ * the traced threads.
+ *
+ * Overhead budget: a disabled trace point costs a load and a not-taken branch,
+ * about 1ns. An enabled trace point costs a function call, a TSC read and a
+ * 22-byte store to a thread-local ring - a few nanoseconds on top of the TSC
+ * read itself. It can be checked by comparing "ucx_perftest -t tag_lat" with
+ * UCX_EVENT_TRACE=n and UCX_EVENT_TRACE=y, since tag send and receive record
+ * an event each.
+ */
+
+
+/**
+ * Whether event tracing is currently enabled
+ */
+extern volatile int ucs_event_trace_enabled;
+
+
+/**
+ * Event trace point, defined statically at every call site.
+ */
+typedef struct ucs_event_trace_loc {
+    volatile ucs_profile_loc_id_t id;        /**< Location ID, set on first use */
+    ucs_profile_type_t            type;      /**< Event type */
+    int                           line;      /**< Source line number */
+    const char                    *name;     /**< Event name */
+    const char                    *file;     /**< Source file name */
+    const char                    *function; /**< Calling function name */
+} ucs_event_trace_loc_t;
+
+
+/**
+ * Record an event to the ring buffer of the calling thread.
+ * SHOULD NOT be used directly - use UCS_EVENT_TRACE macros instead.
+ *
+ * @param [inout] loc      Trace point of the event.
+ * @param [in]    param32  Custom 32-bit parameter.
+ * @param [in]    param64  Custom 64-bit parameter.
+ */
+void ucs_event_trace_record(ucs_event_trace_loc_t *loc, uint32_t param32,
+                            uint64_t param64);
+
+
+/**
+ * Enable or disable event tracing at runtime.
+ *
+ * @param [in] enable  Whether to enable event tracing.
+ */
+void ucs_event_trace_enable(int enable);
+
+
+/**
+ * Save the current contents of all event trace rings to a file. The traced
+ * threads are not stopped, so events which are overwritten while the snapshot
+ * is taken are dropped from it.
+ *
+ * @param [in]  file_name   File name template, or NULL to use
+ *                          UCX_EVENT_TRACE_FILE.
+ * @param [out] num_events  Filled with the number of saved events, if not NULL.
+ *
+ * @return Error code as defined by @ref ucs_status_t.
+ */
+ucs_status_t ucs_event_trace_snapshot(const char *file_name, size_t *num_events);
+
+
+void ucs_event_trace_init();
+
+
+void ucs_event_trace_cleanup();
+
+
+/**
+ * Record an event trace event.
+ *
+ * @param _type     Event type.
+ * @param _name     Event name, must be a string literal.
+ * @param _param32  Custom 32-bit parameter.
+ * @param _param64  Custom 64-bit parameter.
+ */
+#define UCS_EVENT_TRACE_RECORD(_type, _name, _param32, _param64) \
+    { \
+        static ucs_event_trace_loc_t loc = { \
+            UCS_PROFILE_LOC_ID_UNKNOWN, _type, __LINE__, _name, __FILE__, \
+            __FUNCTION__ \
+        }; \
+        if (ucs_unlikely(ucs_event_trace_enabled)) { \
+            ucs_event_trace_record(&loc, _param32, _param64); \
+        } \
+    }
+
+
+/**
+ * Record an event trace sample.
+ *
+ * @param _name     Event name.
+ * @param _param32  Custom 32-bit parameter.
+ * @param _param64  Custom 64-bit parameter.
+ */
+#define UCS_EVENT_TRACE(_name, _param32, _param64) \
+    UCS_EVENT_TRACE_RECORD(UCS_PROFILE_TYPE_SAMPLE, _name, _param32, _param64)
+
+
+/**
+ * Record a request progress event in the event trace.
+ *
+ * @param _req      Request pointer.
+ * @param _name     Event name.
+ * @param _param32  Custom 32-bit parameter.
+ */
+#define UCS_EVENT_TRACE_REQUEST(_req, _name, _param32) \
+    UCS_EVENT_TRACE_RECORD(UCS_PROFILE_TYPE_REQUEST_EVENT, _name, _param32, \
+                           (uintptr_t)(_req))
+
+END_C_DECLS
+
+#endif
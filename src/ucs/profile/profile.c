@@ -10,13 +10,16 @@
 
 #include "profile.h"
 
+#include <ucs/arch/atomic.h>
 #include <ucs/datastruct/list.h>
 #include <ucs/debug/debug_int.h>
 #include <ucs/debug/log.h>
 #include <ucs/sys/lib.h>
+#include <ucs/sys/ptr_arith.h>
 #include <ucs/sys/string.h>
 #include <ucs/sys/sys.h>
 #include <ucs/time/time.h>
+#include <sys/mman.h>
 #include <pthread.h>
 
 
@@ -28,6 +31,7 @@ typedef struct ucs_profile_global_location {
 
 /* Profiling per-thread context */
 typedef struct ucs_profile_thread_context {
+    ucs_profile_context_t             *ctx;          /**< Global profile context */
     pthread_t                         pthread_id;    /**< POSIX thread id */
     int                               tid;           /**< System thread id */
     ucs_time_t                        start_time;    /**< Thread context init time */
@@ -36,7 +40,8 @@ typedef struct ucs_profile_thread_context {
     int                               is_completed;  /**< Set to 1 when thread exits */
 
     struct {
-        ucs_profile_record_t          *start;        /**< Circular log buffer start */
+        ucs_profile_record_t          *start;        /**< Circular log buffer start,
+                                                          or stream chunk start */
         ucs_profile_record_t          *end;          /**< Circular log buffer end */
         ucs_profile_record_t          *current;      /**< Current log pointer */
         int                           wraparound;    /**< Whether log was rotated */
@@ -64,6 +69,12 @@ struct ucs_profile_context  {
     pthread_mutex_t               mutex;            /**< Protects updating the locations array */
     pthread_key_t                 tls_key;          /**< TLS key for per-thread context */
     ucs_list_link_t               thread_list;      /**< List of all thread contexts */
+
+    struct {
+        int                         fd;             /**< Streaming file */
+        ucs_profile_stream_header_t *header;        /**< Mapped streaming file */
+        size_t                      length;         /**< Mapped file size */
+    } stream;
 };
 
 
@@ -75,9 +86,10 @@ struct ucs_profile_context  {
 
 
 const char *ucs_profile_mode_names[] = {
-    [UCS_PROFILE_MODE_ACCUM] = "accum",
-    [UCS_PROFILE_MODE_LOG]   = "log",
-    [UCS_PROFILE_MODE_LAST]  = NULL
+    [UCS_PROFILE_MODE_ACCUM]  = "accum",
+    [UCS_PROFILE_MODE_LOG]    = "log",
+    [UCS_PROFILE_MODE_STREAM] = "stream",
+    [UCS_PROFILE_MODE_LAST]   = NULL
 };
 
 /**
@@ -355,6 +367,148 @@ out_free_env:
     ucs_string_buffer_cleanup(&env_strb);
 }
 
+static ucs_status_t ucs_profile_stream_open(ucs_profile_context_t *ctx)
+{
+    char fullpath[1024] = {0};
+    char filename[1024] = {0};
+    ucs_profile_stream_header_t *header;
+    size_t chunk_size, num_chunks;
+    size_t locations_offset, chunks_offset, length;
+    void *ptr;
+    int fd;
+
+    chunk_size       = sizeof(ucs_profile_stream_chunk_t) +
+                       (UCS_PROFILE_STREAM_CHUNK_RECORDS *
+                        sizeof(ucs_profile_record_t));
+    num_chunks       = ucs_max(ctx->max_file_size / chunk_size,
+                               UCS_PROFILE_STREAM_MIN_CHUNKS);
+    locations_offset = ucs_align_up_pow2(sizeof(*header),
+                                         UCS_SYS_CACHE_LINE_SIZE);
+    chunks_offset    = ucs_align_up_pow2(locations_offset +
+                                         (UCS_PROFILE_STREAM_MAX_LOCATIONS *
+                                          sizeof(ucs_profile_location_t)),
+                                         UCS_SYS_CACHE_LINE_SIZE);
+    length           = chunks_offset + (num_chunks * chunk_size);
+
+    ucs_fill_filename_template(ctx->file_name, filename, sizeof(filename));
+    ucs_expand_path(filename, fullpath, sizeof(fullpath) - 1);
+
+    fd = open(fullpath, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        ucs_error("failed to open profiling file '%s': %m", fullpath);
+        return UCS_ERR_IO_ERROR;
+    }
+
+    if (ftruncate(fd, length) < 0) {
+        ucs_error("failed to resize profiling file '%s' to %zu: %m", fullpath,
+                  length);
+        goto err_close;
+    }
+
+    ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        ucs_error("failed to map profiling file '%s': %m", fullpath);
+        goto err_close;
+    }
+
+    /* The file is zero-filled, so all ring slots are initially empty */
+    header                   = ptr;
+    header->version          = UCS_PROFILE_STREAM_VERSION;
+    header->header_size      = sizeof(*header);
+    header->location_size    = sizeof(ucs_profile_location_t);
+    header->record_size      = sizeof(ucs_profile_record_t);
+    header->chunk_size       = chunk_size;
+    header->chunk_records    = UCS_PROFILE_STREAM_CHUNK_RECORDS;
+    header->max_locations    = UCS_PROFILE_STREAM_MAX_LOCATIONS;
+    header->num_locations    = 0;
+    header->locations_offset = locations_offset;
+    header->chunks_offset    = chunks_offset;
+    header->num_chunks       = num_chunks;
+    header->head             = 0;
+    header->closed           = 0;
+    header->pid              = getpid();
+    header->one_second       = ucs_time_from_sec(1.0);
+    ucs_strncpy_safe(header->hostname, ucs_get_host_name(),
+                     sizeof(header->hostname));
+    ucs_strncpy_safe(header->cmdline, ucs_get_process_cmdline(),
+                     sizeof(header->cmdline));
+    ucs_strncpy_safe(header->ucs_path, ucs_sys_get_lib_path(),
+                     sizeof(header->ucs_path));
+
+    /* Readers identify the file by its magic, so set it last */
+    ucs_memory_cpu_store_fence();
+    memcpy(header->magic, UCS_PROFILE_STREAM_MAGIC, sizeof(header->magic));
+
+    ctx->stream.fd     = fd;
+    ctx->stream.header = header;
+    ctx->stream.length = length;
+    ucs_debug("streaming profiling records to '%s', %zu chunks of %zu bytes",
+              fullpath, num_chunks, chunk_size);
+    return UCS_OK;
+
+err_close:
+    close(fd);
+    return UCS_ERR_IO_ERROR;
+}
+
+static void ucs_profile_stream_close(ucs_profile_context_t *ctx)
+{
+    if (ctx->stream.header == NULL) {
+        return;
+    }
+
+    ctx->stream.header->closed = 1;
+    munmap(ctx->stream.header, ctx->stream.length);
+    close(ctx->stream.fd);
+    ctx->stream.header = NULL;
+    ctx->stream.fd     = -1;
+}
+
+/* Global lock must be held */
+static void
+ucs_profile_stream_add_location(ucs_profile_context_t *ctx,
+                                const ucs_profile_global_location_t *loc)
+{
+    ucs_profile_stream_header_t *header = ctx->stream.header;
+    ucs_profile_location_t *locations;
+
+    locations = UCS_PTR_BYTE_OFFSET(header, header->locations_offset);
+    locations[ctx->num_locations - 1] = loc->super;
+
+    /* Publish the location before any record which refers to it */
+    ucs_memory_cpu_store_fence();
+    header->num_locations = ctx->num_locations;
+}
+
+/* Copy the collected records of the current thread to the file ring */
+static void
+ucs_profile_stream_flush(ucs_profile_context_t *ctx,
+                         ucs_profile_thread_context_t *thread_ctx)
+{
+    ucs_profile_stream_header_t *header = ctx->stream.header;
+    size_t num_records = thread_ctx->log.current - thread_ctx->log.start;
+    ucs_profile_stream_chunk_t *chunk;
+    uint64_t seq;
+
+    if (num_records == 0) {
+        return;
+    }
+
+    seq        = ucs_atomic_fadd64(&header->head, 1);
+    chunk      = ucs_profile_stream_chunk(header, seq);
+    chunk->seq = 0;
+    ucs_memory_cpu_store_fence();
+
+    chunk->tid         = thread_ctx->tid;
+    chunk->num_records = num_records;
+    memcpy(chunk + 1, thread_ctx->log.start,
+           num_records * sizeof(ucs_profile_record_t));
+    ucs_memory_cpu_store_fence();
+
+    chunk->seq              = seq + 1;
+    thread_ctx->log.current = thread_ctx->log.start;
+}
+
 static UCS_F_NOINLINE ucs_profile_thread_context_t*
 ucs_profile_thread_init(ucs_profile_context_t *ctx)
 {
@@ -369,6 +523,7 @@ ucs_profile_thread_init(ucs_profile_context_t *ctx)
         return NULL;
     }
 
+    thread_ctx->ctx        = ctx;
     thread_ctx->tid        = ucs_get_tid();
     thread_ctx->start_time = ucs_get_time();
     thread_ctx->end_time   = 0;
@@ -380,7 +535,11 @@ ucs_profile_thread_init(ucs_profile_context_t *ctx)
 
     /* Initialize log mode */
     if (ctx->profile_mode & UCS_BIT(UCS_PROFILE_MODE_LOG)) {
-        num_records = ctx->max_file_size / sizeof(ucs_profile_record_t);
+        if (ctx->profile_mode & UCS_BIT(UCS_PROFILE_MODE_STREAM)) {
+            num_records = UCS_PROFILE_STREAM_CHUNK_RECORDS;
+        } else {
+            num_records = ctx->max_file_size / sizeof(ucs_profile_record_t);
+        }
         thread_ctx->log.start = ucs_calloc(num_records,
                                            sizeof(ucs_profile_record_t),
                                            "profile_log");
@@ -430,6 +589,10 @@ static void ucs_profile_thread_finalize(ucs_profile_thread_context_t *ctx)
 {
     ucs_debug("profiling context %p: completed", ctx);
 
+    if (ctx->ctx->profile_mode & UCS_BIT(UCS_PROFILE_MODE_STREAM)) {
+        ucs_profile_stream_flush(ctx->ctx, ctx);
+    }
+
     ctx->end_time     = ucs_get_time();
     ctx->is_completed = 1;
 }
@@ -504,6 +667,13 @@ ucs_profile_get_location(ucs_profile_context_t *ctx, ucs_profile_type_t type,
         }
     }
 
+    if ((ctx->stream.header != NULL) &&
+        (ctx->num_locations >= ctx->stream.header->max_locations)) {
+        ucs_warn("too many profiling locations, disabling %s:%d", file, line);
+        *loc_id_p = loc_id = UCS_PROFILE_LOC_ID_DISABLED;
+        goto out_unlock;
+    }
+
     ++(ctx->num_locations);
 
     /* Reallocate array if needed */
@@ -530,6 +700,10 @@ ucs_profile_get_location(ucs_profile_context_t *ctx, ucs_profile_type_t type,
     loc->super.type = type;
     loc->loc_id_p   = loc_id_p;
 
+    if (ctx->stream.header != NULL) {
+        ucs_profile_stream_add_location(ctx, loc);
+    }
+
 out_found:
     *loc_id_p = loc_id = ucs_profile_location_id(ctx, loc);
     ucs_memory_cpu_store_fence();
@@ -627,8 +801,12 @@ void ucs_profile_record(ucs_profile_context_t *ctx, ucs_profile_type_t type,
         rec->param32     = param32;
         rec->location    = loc_id - 1;
         if (++thread_ctx->log.current >= thread_ctx->log.end) {
-            thread_ctx->log.current    = thread_ctx->log.start;
-            thread_ctx->log.wraparound = 1;
+            if (ctx->profile_mode & UCS_BIT(UCS_PROFILE_MODE_STREAM)) {
+                ucs_profile_stream_flush(ctx, thread_ctx);
+            } else {
+                thread_ctx->log.current    = thread_ctx->log.start;
+                thread_ctx->log.wraparound = 1;
+            }
         }
     }
 }
@@ -695,8 +873,11 @@ void ucs_profile_dump(ucs_profile_context_t *ctx)
         pthread_setspecific(ctx->tls_key, NULL);
     }
 
-    /* write and cleanup all completed threads (including the current thread) */
-    ucs_profile_write(ctx);
+    /* write and cleanup all completed threads (including the current thread).
+     * In stream mode, their records were already flushed to the file. */
+    if (!(ctx->profile_mode & UCS_BIT(UCS_PROFILE_MODE_STREAM))) {
+        ucs_profile_write(ctx);
+    }
     ucs_profile_cleanup_completed_threads(ctx);
 }
 
@@ -743,12 +924,30 @@ ucs_status_t ucs_profile_init(unsigned profile_mode, const char *file_name,
     ctx->num_locations    = 0;
     ctx->locations        = NULL;
     ctx->max_locations    = 0;
+    ctx->stream.fd        = -1;
+    ctx->stream.header    = NULL;
+    ctx->stream.length    = 0;
 
     if (profile_mode && !strlen(file_name)) {
         // TODO make sure profiling file is writeable
         ucs_warn("profiling file not specified");
     }
 
+    if (profile_mode & UCS_BIT(UCS_PROFILE_MODE_STREAM)) {
+        if (profile_mode != UCS_BIT(UCS_PROFILE_MODE_STREAM)) {
+            ucs_warn("profiling stream mode cannot be combined with other "
+                     "modes, ignoring them");
+        }
+
+        /* Stream mode collects records in the log buffer of each thread, and
+         * flushes it to the file when it is full */
+        ctx->profile_mode = UCS_BIT(UCS_PROFILE_MODE_STREAM) |
+                            UCS_BIT(UCS_PROFILE_MODE_LOG);
+        if (ucs_profile_stream_open(ctx) != UCS_OK) {
+            ctx->profile_mode = 0;
+        }
+    }
+
     pthread_key_create(&(ctx->tls_key), ucs_profile_thread_key_destr);
     *ctx_p = ctx;
 
@@ -763,6 +962,7 @@ void ucs_profile_cleanup(ucs_profile_context_t *ctx)
 {
     ucs_profile_dump(ctx);
     ucs_profile_check_active_threads(ctx);
+    ucs_profile_stream_close(ctx);
     ucs_profile_reset_locations(ctx);
     pthread_key_delete(ctx->tls_key);
     ucs_free(ctx);
@@ -23,13 +23,20 @@ BEGIN_C_DECLS
 /* Minimum backwards compatible version */
 #define UCS_PROFILE_FILE_MIN_VERSION 3u
 
+#define UCS_PROFILE_STREAM_MAGIC         "UCSPROFS"
+#define UCS_PROFILE_STREAM_VERSION       1u
+#define UCS_PROFILE_STREAM_CHUNK_RECORDS 256
+#define UCS_PROFILE_STREAM_MAX_LOCATIONS 4096
+#define UCS_PROFILE_STREAM_MIN_CHUNKS    2
+
 
 /**
  * Profiling modes
  */
 enum {
-    UCS_PROFILE_MODE_ACCUM, /**< Accumulate elapsed time per location */
-    UCS_PROFILE_MODE_LOG,   /**< Record all events */
+    UCS_PROFILE_MODE_ACCUM,  /**< Accumulate elapsed time per location */
+    UCS_PROFILE_MODE_LOG,    /**< Record all events */
+    UCS_PROFILE_MODE_STREAM, /**< Record all events to a file while running */
     UCS_PROFILE_MODE_LAST
 };
 
@@ -132,6 +139,80 @@ typedef struct ucs_profile_record {
     uint32_t                 location;      /**< Location identifier */
 } UCS_S_PACKED ucs_profile_record_t;
 
+/*
+ * Streaming profile file structure:
+ *
+ * < ucs_profile_stream_header_t >
+ * < ucs_profile_location_t > * ucs_profile_stream_header_t::max_locations
+ * [
+ *    < ucs_profile_stream_chunk_t >
+ *    < ucs_profile_record_t > * ucs_profile_stream_header_t::chunk_records
+ * ] * ucs_profile_stream_header_t::num_chunks
+ *
+ * The file has a fixed size, and is written through a shared memory mapping
+ * while the application is running. Every thread collects records to a chunk,
+ * and when the chunk is full, copies it to the ring slot number
+ * (seq % num_chunks), where seq is taken from the incrementing head counter.
+ * The slot holds (seq + 1) when the chunk is complete, and 0 while it is being
+ * written, so a reader can detect chunks which were overwritten or not
+ * completed while it was copying them.
+ */
+
+
+/**
+ * Streaming profile file header
+ */
+typedef struct ucs_profile_stream_header {
+    char              magic[8];         /**< UCS_PROFILE_STREAM_MAGIC */
+    uint32_t          version;          /**< Stream format version */
+    uint32_t          header_size;      /**< Size of this header */
+    uint32_t          location_size;    /**< Size of a location entry */
+    uint32_t          record_size;      /**< Size of a record */
+    uint32_t          chunk_size;       /**< Size of a ring slot, with header */
+    uint32_t          chunk_records;    /**< Maximal number of records in chunk */
+    uint32_t          max_locations;    /**< Size of locations array */
+    volatile uint32_t num_locations;    /**< Number of valid locations */
+    uint64_t          locations_offset; /**< Offset of locations array */
+    uint64_t          chunks_offset;    /**< Offset of the chunks ring */
+    uint64_t          num_chunks;       /**< Number of slots in the ring */
+    volatile uint64_t head;             /**< Number of chunks written so far */
+    volatile uint32_t closed;           /**< Set when the writer is done */
+    uint32_t          pid;              /**< Process ID */
+    uint64_t          one_second;       /**< How much time is one second */
+    char              hostname[64];     /**< Host name */
+    char              cmdline[1024];    /**< Command line */
+    char              ucs_path[1024];   /**< UCX library path */
+} ucs_profile_stream_header_t;
+
+
+/**
+ * Streaming profile file chunk header
+ */
+typedef struct ucs_profile_stream_chunk {
+    volatile uint64_t seq;              /**< Sequence number + 1, or 0 */
+    uint32_t          tid;              /**< System thread id */
+    uint32_t          num_records;      /**< Number of valid records */
+} ucs_profile_stream_chunk_t;
+
+
+/**
+ * Get the ring slot of a streaming profile chunk.
+ *
+ * @param [in]  header  Mapped streaming profile file.
+ * @param [in]  seq     Chunk sequence number.
+ *
+ * @return Pointer to the chunk header in the slot.
+ */
+static UCS_F_ALWAYS_INLINE ucs_profile_stream_chunk_t *
+ucs_profile_stream_chunk(const ucs_profile_stream_header_t *header,
+                         uint64_t seq)
+{
+    return (ucs_profile_stream_chunk_t*)UCS_PTR_BYTE_OFFSET(
+            header, header->chunks_offset +
+                    ((seq % header->num_chunks) * header->chunk_size));
+}
+
+
 typedef struct ucs_profile_context ucs_profile_context_t;
 typedef short ucs_profile_loc_id_t;
 
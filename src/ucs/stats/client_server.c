@@ -30,6 +30,7 @@
 #include <ucs/debug/memtrack_int.h>
 
 #define UCS_STATS_MAGIC            "UCSSTAT1"
+#define UCS_STATS_DELTA_MAGIC      "UCSSTATD"
 #define UCS_STATS_MSG_FRAG_SIZE    1400
 #define ENTITY_HASH_SIZE           997
 
@@ -44,6 +45,21 @@ typedef struct ucs_stats_packet_hdr {
 } UCS_S_PACKED ucs_stats_packet_hdr_t;
 
 
+/* Delta report header, followed by the regions which changed since the base
+ * report, each one followed by its data */
+typedef struct ucs_stats_delta_hdr {
+    uint64_t            base_timestamp; /* Timestamp of the report to update */
+    uint32_t            size;           /* Size of the report to update */
+} UCS_S_PACKED ucs_stats_delta_hdr_t;
+
+
+/* Changed region of a report */
+typedef struct ucs_stats_delta_region {
+    uint32_t            offset;
+    uint32_t            length;
+} UCS_S_PACKED ucs_stats_delta_region_t;
+
+
 /* Fragment assembly hole free-list */
 typedef struct frag_hole {
     ucs_list_link_t     list;
@@ -56,6 +72,7 @@ typedef struct stats_entity stats_entity_t;
 struct stats_entity {
     struct sockaddr_in  in_addr;        /* Entity address */
     uint64_t            timestamp;      /* Current timestamp */
+    int                 is_delta;       /* Whether current report is a delta */
     size_t              buffer_size;    /* Buffer size */
     void                *inprogress_buffer;    /* Fragment assembly buffer */
     ucs_list_link_t     holes;          /* List of holes in the buffer */
@@ -64,6 +81,8 @@ struct stats_entity {
     pthread_mutex_t     lock;
     volatile unsigned   refcount;
     void                *completed_buffer;  /* Completed buffer */
+    size_t              completed_size;     /* Completed buffer size */
+    uint64_t            completed_timestamp; /* Completed buffer timestamp */
     struct timeval      update_time;
 };
 
@@ -71,6 +90,11 @@ struct stats_entity {
 /* Client context */
 typedef struct ucs_stats_client {
     int              sockfd;
+    unsigned         full_interval;  /* Send a full report every N reports */
+    unsigned         num_deltas;     /* Delta reports since last full report */
+    void             *prev_buffer;   /* Previous report, NULL if not kept */
+    size_t           prev_size;      /* Previous report size */
+    uint64_t         prev_timestamp; /* Previous report timestamp */
 } ucs_stats_client_t;
 
 
@@ -91,7 +115,9 @@ SGLIB_DEFINE_LIST_PROTOTYPES(stats_entity_t, stats_entity_cmp, next)
 SGLIB_DEFINE_HASHED_CONTAINER_PROTOTYPES(stats_entity_t, ENTITY_HASH_SIZE, stats_entity_hash)
 
 
-ucs_status_t ucs_stats_client_init(const char *server_addr, int port, ucs_stats_client_h *p_client)
+ucs_status_t ucs_stats_client_init(const char *server_addr, int port,
+                                   unsigned full_interval,
+                                   ucs_stats_client_h *p_client)
 {
     ucs_stats_client_h client;
     struct sockaddr_in saddr;
@@ -132,6 +158,12 @@ ucs_status_t ucs_stats_client_init(const char *server_addr, int port, ucs_stats_
         goto err_close;
     }
 
+    client->full_interval  = full_interval;
+    client->num_deltas     = 0;
+    client->prev_buffer    = NULL;
+    client->prev_size      = 0;
+    client->prev_timestamp = 0;
+
     *p_client = client;
     return UCS_OK;
 
@@ -145,12 +177,14 @@ err:
 
 void ucs_stats_client_cleanup(ucs_stats_client_h client)
 {
+    free(client->prev_buffer);
     close(client->sockfd);
     ucs_free(client);
 }
 
 static ucs_status_t
-ucs_stats_sock_send_frags(int sockfd, uint64_t timestamp, void *buffer, size_t size)
+ucs_stats_sock_send_frags(int sockfd, const char *magic, uint64_t timestamp,
+                          void *buffer, size_t size)
 {
     struct iovec iov[2];
     ucs_stats_packet_hdr_t hdr;
@@ -160,7 +194,7 @@ ucs_stats_sock_send_frags(int sockfd, uint64_t timestamp, void *buffer, size_t s
 
     offset = 0;
 
-    memcpy(hdr.magic, UCS_STATS_MAGIC, sizeof(hdr.magic));
+    memcpy(hdr.magic, magic, sizeof(hdr.magic));
     hdr.total_size  = size;
     hdr.timestamp   = timestamp;
 
@@ -196,11 +230,68 @@ ucs_stats_sock_send_frags(int sockfd, uint64_t timestamp, void *buffer, size_t s
     return UCS_OK;
 }
 
+/**
+ * Pack the regions of the report which changed since the previous report.
+ *
+ * @return Delta size, or 0 if it would not be smaller than the full report.
+ */
+static size_t
+ucs_stats_client_pack_delta(ucs_stats_client_h client, const uint8_t *buffer,
+                            size_t size, void *delta)
+{
+    const uint8_t *prev = client->prev_buffer;
+    ucs_stats_delta_region_t *region;
+    ucs_stats_delta_hdr_t *hdr;
+    size_t offset, start, last, pos;
+
+    hdr                 = delta;
+    hdr->base_timestamp = client->prev_timestamp;
+    hdr->size           = size;
+    pos                 = sizeof(*hdr);
+
+    offset = 0;
+    while (offset < size) {
+        if (buffer[offset] == prev[offset]) {
+            ++offset;
+            continue;
+        }
+
+        /* Extend the region over unchanged bytes, as long as they are fewer
+         * than the header of a new region */
+        start = offset;
+        last  = offset;
+        for (offset = start + 1;
+             (offset < size) && ((offset - last) <= sizeof(*region));
+             ++offset) {
+            if (buffer[offset] != prev[offset]) {
+                last = offset;
+            }
+        }
+
+        if ((pos + sizeof(*region) + (last + 1 - start)) >= size) {
+            return 0;
+        }
+
+        region         = UCS_PTR_BYTE_OFFSET(delta, pos);
+        region->offset = start;
+        region->length = last + 1 - start;
+        pos           += sizeof(*region);
+        memcpy(UCS_PTR_BYTE_OFFSET(delta, pos), buffer + start,
+               region->length);
+        pos           += region->length;
+        offset         = last + 1;
+    }
+
+    return pos;
+}
+
 ucs_status_t
 ucs_stats_client_send(ucs_stats_client_h client, ucs_stats_node_t *root,
                       uint64_t timestamp)
 {
+    size_t delta_size = 0;
     ucs_status_t status;
+    void *delta = NULL;
     FILE *stream;
     char *buffer;
     size_t size;
@@ -219,8 +310,42 @@ ucs_stats_client_send(ucs_stats_client_h client, ucs_stats_node_t *root,
         goto out_free;
     }
 
-    /* send */
-    status = ucs_stats_sock_send_frags(client->sockfd, timestamp, buffer, size);
+    if (client->full_interval <= 1) {
+        status = ucs_stats_sock_send_frags(client->sockfd, UCS_STATS_MAGIC,
+                                           timestamp, buffer, size);
+        goto out_free;
+    }
+
+    /* Send only the changes since the previous report, if the report layout
+     * did not change and a full report is not due */
+    if ((client->prev_buffer != NULL) && (client->prev_size == size) &&
+        ((client->num_deltas + 1) < client->full_interval)) {
+        delta = malloc(size);
+        if (delta != NULL) {
+            delta_size = ucs_stats_client_pack_delta(client, (uint8_t*)buffer,
+                                                     size, delta);
+        }
+    }
+
+    if (delta_size > 0) {
+        status = ucs_stats_sock_send_frags(client->sockfd,
+                                           UCS_STATS_DELTA_MAGIC, timestamp,
+                                           delta, delta_size);
+        ++client->num_deltas;
+    } else {
+        status = ucs_stats_sock_send_frags(client->sockfd, UCS_STATS_MAGIC,
+                                           timestamp, buffer, size);
+        client->num_deltas = 0;
+    }
+
+    free(delta);
+
+    /* Keep the report as the base of the next delta */
+    free(client->prev_buffer);
+    client->prev_buffer    = buffer;
+    client->prev_size      = size;
+    client->prev_timestamp = timestamp;
+    goto out;
 
 out_free:
     free(buffer);
@@ -234,15 +359,10 @@ static void ucs_stats_server_entity_reset_buffer(stats_entity_t * entity,
     frag_hole_t *hole;
 
     if (new_size != entity->buffer_size) {
-        pthread_mutex_lock(&entity->lock);
         entity->buffer_size = new_size;
         entity->inprogress_buffer = ucs_realloc(entity->inprogress_buffer,
                                                 new_size + sizeof(frag_hole_t),
                                                 "stats_inprogress_buffer");
-        entity->completed_buffer  = ucs_realloc(entity->completed_buffer,
-                                                new_size + sizeof(frag_hole_t),
-                                                "stats_completed_buffer");
-        pthread_mutex_unlock(&entity->lock);
     }
 
     hole = entity->inprogress_buffer;
@@ -261,12 +381,15 @@ static stats_entity_t *ucs_stats_server_entity_alloc(struct sockaddr_in *addr)
     }
 
     entity->in_addr           = *addr;
-    entity->timestamp         = 0;
+    entity->timestamp           = 0;
+    entity->is_delta            = 0;
     /* coverity[missing_lock] */
-    entity->buffer_size       = SIZE_MAX;
-    entity->inprogress_buffer = NULL;
-    entity->completed_buffer  = NULL;
-    entity->refcount          = 1;
+    entity->buffer_size         = SIZE_MAX;
+    entity->inprogress_buffer   = NULL;
+    entity->completed_buffer    = NULL;
+    entity->completed_size      = 0;
+    entity->completed_timestamp = 0;
+    entity->refcount            = 1;
     ucs_list_head_init(&entity->holes);
     pthread_mutex_init(&entity->lock, NULL);
 
@@ -329,13 +452,58 @@ find_frag_hole(stats_entity_t *entity, size_t frag_size, size_t frag_offset)
     return NULL;
 }
 
+/**
+ * Apply a fully assembled delta report to the completed buffer.
+ */
+static void ucs_stats_server_entity_apply_delta(stats_entity_t *entity)
+{
+    const ucs_stats_delta_hdr_t *hdr = entity->inprogress_buffer;
+    const ucs_stats_delta_region_t *region;
+    size_t offset;
+
+    if ((entity->buffer_size < sizeof(*hdr)) ||
+        (hdr->base_timestamp != entity->completed_timestamp) ||
+        (hdr->size != entity->completed_size)) {
+        ucs_debug("Dropping delta of timestamp %"PRIu64" - base report is "
+                  "not available", entity->timestamp);
+        return;
+    }
+
+    /* Validate all regions before modifying the completed buffer */
+    for (offset = sizeof(*hdr); offset < entity->buffer_size;
+         offset += region->length) {
+        region  = UCS_PTR_BYTE_OFFSET(entity->inprogress_buffer, offset);
+        offset += sizeof(*region);
+        if ((offset > entity->buffer_size) ||
+            (region->length > (entity->buffer_size - offset)) ||
+            (region->offset > entity->completed_size) ||
+            (region->length > (entity->completed_size - region->offset))) {
+            ucs_error("Invalid region in delta of timestamp %"PRIu64,
+                      entity->timestamp);
+            return;
+        }
+    }
+
+    for (offset = sizeof(*hdr); offset < entity->buffer_size;
+         offset += region->length) {
+        region  = UCS_PTR_BYTE_OFFSET(entity->inprogress_buffer, offset);
+        offset += sizeof(*region);
+        memcpy(UCS_PTR_BYTE_OFFSET(entity->completed_buffer, region->offset),
+               UCS_PTR_BYTE_OFFSET(entity->inprogress_buffer, offset),
+               region->length);
+    }
+
+    entity->completed_timestamp = entity->timestamp;
+}
+
 /**
  * Update statistics with new arrived fragment.
  */
 static ucs_status_t
 ucs_stats_server_entity_update(ucs_stats_server_h server, stats_entity_t *entity,
-                               uint64_t timestamp, size_t total_size, void *frag,
-                               size_t frag_size, size_t frag_offset)
+                               int is_delta, uint64_t timestamp,
+                               size_t total_size, void *frag, size_t frag_size,
+                               size_t frag_offset)
 {
     frag_hole_t *hole, *new_hole;
     void *frag_start, *frag_end, *hole_end;
@@ -350,6 +518,7 @@ ucs_stats_server_entity_update(ucs_stats_server_h server, stats_entity_t *entity
     } else if (timestamp > entity->timestamp) {
         ucs_debug("New timestamp, resetting buffer with size %zu", total_size);
         entity->timestamp = timestamp;
+        entity->is_delta  = is_delta;
         ucs_stats_server_entity_reset_buffer(entity, total_size);
     } else {
         /* Make sure all packets in this timestamp have the same 'total_size' */
@@ -404,7 +573,19 @@ ucs_stats_server_entity_update(ucs_stats_server_h server, stats_entity_t *entity
     if (ucs_list_is_empty(&entity->holes)) {
         ucs_debug("timestamp %"PRIu64" fully assembled", entity->timestamp);
         pthread_mutex_lock(&entity->lock);
-        memcpy(entity->completed_buffer, entity->inprogress_buffer, entity->buffer_size);
+        if (entity->is_delta) {
+            ucs_stats_server_entity_apply_delta(entity);
+        } else {
+            if (entity->buffer_size != entity->completed_size) {
+                entity->completed_buffer = ucs_realloc(entity->completed_buffer,
+                                                       entity->buffer_size,
+                                                       "stats_completed_buffer");
+                entity->completed_size   = entity->buffer_size;
+            }
+            memcpy(entity->completed_buffer, entity->inprogress_buffer,
+                   entity->buffer_size);
+            entity->completed_timestamp = entity->timestamp;
+        }
         pthread_mutex_unlock(&entity->lock);
     }
 
@@ -420,6 +601,7 @@ ucs_stats_server_update_context(ucs_stats_server_h server, struct sockaddr_in *s
 {
     stats_entity_t *entity;
     ucs_status_t status;
+    int is_delta;
 
     /* Validate fragment size */
     if (pkt_len != pkt->frag_size + sizeof(ucs_stats_packet_hdr_t)) {
@@ -429,7 +611,12 @@ ucs_stats_server_update_context(ucs_stats_server_h server, struct sockaddr_in *s
     }
 
     /* Validate magic */
-    if (memcmp(pkt->magic, UCS_STATS_MAGIC, sizeof(pkt->magic)) != 0) {
+    if (memcmp(pkt->magic, UCS_STATS_MAGIC, sizeof(pkt->magic)) == 0) {
+        is_delta = 0;
+    } else if (memcmp(pkt->magic, UCS_STATS_DELTA_MAGIC,
+                      sizeof(pkt->magic)) == 0) {
+        is_delta = 1;
+    } else {
         ucs_error("Invalid magic in packet header");
         return UCS_ERR_INVALID_PARAM;
     }
@@ -442,9 +629,10 @@ ucs_stats_server_update_context(ucs_stats_server_h server, struct sockaddr_in *s
     pthread_mutex_unlock(&entity->lock);
 
     /* Update the entity */
-    status = ucs_stats_server_entity_update(server, entity, pkt->timestamp,
-                                           pkt->total_size, pkt + 1,
-                                           pkt->frag_size, pkt->frag_offset);
+    status = ucs_stats_server_entity_update(server, entity, is_delta,
+                                            pkt->timestamp, pkt->total_size,
+                                            pkt + 1, pkt->frag_size,
+                                            pkt->frag_offset);
 
     ucs_stats_server_entity_put(entity);
     ++server->rcvd_packets;
@@ -631,7 +819,14 @@ ucs_list_link_t *ucs_stats_server_get_stats(ucs_stats_server_h server)
     {
         /* Parse the statistics data */
         pthread_mutex_lock(&entity->lock);
-        stream = fmemopen(entity->completed_buffer, entity->buffer_size, "rb");
+        if (entity->completed_size == 0) {
+            /* No full report was received yet */
+            pthread_mutex_unlock(&entity->lock);
+            continue;
+        }
+
+        stream = fmemopen(entity->completed_buffer, entity->completed_size,
+                          "rb");
         status = ucs_stats_deserialize(stream, &node);
         fclose(stream);
         pthread_mutex_unlock(&entity->lock);
@@ -64,6 +64,9 @@ ucs_status_t ucs_stats_node_initv(ucs_stats_node_t *node, ucs_stats_class_t *cls
     ucs_list_head_init(&node->children[UCS_STATS_INACTIVE_CHILDREN]);
     ucs_list_head_init(&node->children[UCS_STATS_ACTIVE_CHILDREN]);
     memset(node->counters, 0, cls->num_counters * sizeof(ucs_stats_counter_t));
+    node->shards       = NULL;
+    node->num_shards   = 0;
+    node->shard_stride = 0;
 
     return UCS_OK;
 }
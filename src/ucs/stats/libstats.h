@@ -129,6 +129,11 @@ struct ucs_stats_node {
     ucs_list_link_t          type_list;          /* nodes with same class/es
                                                     hierarchy */
     ucs_stats_filter_node_t  *filter_node;       /* ptr to type list head */
+    ucs_stats_counter_t      *shards;            /* per-thread counter shards,
+                                                    or NULL if not sharded */
+    unsigned                 num_shards;         /* number of shards */
+    unsigned                 shard_stride;       /* counters per shard, rounded
+                                                    up to a cache line */
     ucs_stats_counter_t      counters[1];        /* instance counters */
 };
 
@@ -154,6 +159,26 @@ ucs_status_t ucs_stats_node_initv(ucs_stats_node_t *node, ucs_stats_class_t *cls
                                  const char *name, va_list ap);
 
 
+/**
+ * Get the value of a statistics counter, including all its shards.
+ *
+ * @param node   Statistics node.
+ * @param index  Counter index.
+ */
+static inline ucs_stats_counter_t
+ucs_stats_node_counter_get(const ucs_stats_node_t *node, unsigned index)
+{
+    ucs_stats_counter_t value = node->counters[index];
+    unsigned i;
+
+    for (i = 0; i < node->num_shards; ++i) {
+        value += node->shards[(i * node->shard_stride) + index];
+    }
+
+    return value;
+}
+
+
 /**
  * Serialize statistics.
  *
@@ -185,11 +210,15 @@ void ucs_stats_free(ucs_stats_node_t *root);
 /**
  * Initialize statistics client.
  *
- * @param server_addr  Address of server machine.
- * @param port         Port number on server.
- * @param p_client     Filled with handle to the client.
+ * @param server_addr    Address of server machine.
+ * @param port           Port number on server.
+ * @param full_interval  Send a full snapshot every this number of reports, and
+ *                       only the changes since the previous report otherwise.
+ *                       1 or 0 - always send full snapshots.
+ * @param p_client       Filled with handle to the client.
  */
 ucs_status_t ucs_stats_client_init(const char *server_addr, int port,
+                                   unsigned full_interval,
                                    ucs_stats_client_h *p_client);
 
 
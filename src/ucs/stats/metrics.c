@@ -0,0 +1,539 @@
+/**
+* Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+*
+* See file LICENSE for terms.
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "metrics.h"
+#include "stats.h"
+
+#include <ucs/algorithm/qsort_r.h>
+#include <ucs/async/async.h>
+#include <ucs/config/global_opts.h>
+#include <ucs/config/parser.h>
+#include <ucs/datastruct/array.h>
+#include <ucs/datastruct/list.h>
+#include <ucs/debug/log.h>
+#include <ucs/debug/memtrack_int.h>
+#include <ucs/sys/sock.h>
+#include <ucs/sys/string.h>
+#include <ucs/sys/sys.h>
+#include <ucs/vfs/base/vfs_obj.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define UCS_METRICS_PREFIX_UNIX     "unix:"
+#define UCS_METRICS_PREFIX_TCP      "tcp:"
+#define UCS_METRICS_BACKLOG         16
+#define UCS_METRICS_VFS_MAX_DEPTH   16
+#define UCS_METRICS_NAME_MAX        128
+#define UCS_METRICS_MAX_CONNS       16
+#define UCS_METRICS_CONTENT_TYPE \
+    "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+
+/* Numeric VFS attribute */
+typedef struct {
+    char *name;
+    char *path;
+    char *value;
+} ucs_metrics_vfs_sample_t;
+
+UCS_ARRAY_DECLARE_TYPE(ucs_metrics_vfs_sample_array_t, unsigned,
+                       ucs_metrics_vfs_sample_t);
+
+
+/* Client connection, served without blocking the async thread */
+typedef struct {
+    ucs_list_link_t     list;     /* Entry in the list of connections */
+    int                 fd;       /* Connected socket */
+    ucs_string_buffer_t response; /* Response, empty until the request */
+    size_t              offset;   /* Number of response bytes sent */
+} ucs_metrics_conn_t;
+
+
+static struct {
+    ucs_async_context_t async;     /* Serializes the handlers with cleanup */
+    ucs_list_link_t     conns;     /* Connections being served */
+    unsigned            num_conns; /* Length of the connections list */
+    int                 listen_fd;
+    int                 is_http;
+    char                unix_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+} ucs_metrics_context = {
+    .conns     = UCS_LIST_INITIALIZER(&ucs_metrics_context.conns,
+                                      &ucs_metrics_context.conns),
+    .num_conns = 0,
+    .listen_fd = -1,
+    .is_http   = 0,
+    .unix_path = ""
+};
+
+
+static char ucs_metrics_name_char(char ch)
+{
+    return isalnum(ch) ? ch : '_';
+}
+
+/* Return nonzero if the string is a decimal number, without leading and
+ * trailing whitespace */
+static int ucs_metrics_is_number(const char *str)
+{
+    char *end;
+
+    if (!isdigit(str[0]) && !((str[0] == '-') && isdigit(str[1]))) {
+        return 0;
+    }
+
+    if (strchr(str, 'x') || strchr(str, 'X')) {
+        return 0;
+    }
+
+    strtod(str, &end);
+    return *end == '\0';
+}
+
+static void ucs_metrics_vfs_sample_add(ucs_metrics_vfs_sample_array_t *samples,
+                                       const char *name, const char *path,
+                                       const char *value)
+{
+    ucs_string_buffer_t strb = UCS_STRING_BUFFER_INITIALIZER;
+    ucs_metrics_vfs_sample_t *sample;
+
+    sample = ucs_array_append(samples, return);
+
+    ucs_string_buffer_appendf(&strb, "%s", name);
+    ucs_string_buffer_translate(&strb, ucs_metrics_name_char);
+    sample->name  = ucs_string_buffer_extract_mem(&strb);
+    sample->path  = ucs_strdup(path, "metrics_vfs_path");
+    sample->value = ucs_strdup(value, "metrics_vfs_value");
+    if ((sample->name == NULL) || (sample->path == NULL) ||
+        (sample->value == NULL)) {
+        ucs_free(sample->value);
+        ucs_free(sample->path);
+        ucs_free(sample->name);
+        ucs_array_pop_back(samples);
+    }
+}
+
+static void ucs_metrics_vfs_list_dir_cb(const char *name, void *arg)
+{
+    ucs_string_buffer_t *names = arg;
+
+    /* Called with VFS lock held, so only collect the names */
+    ucs_string_buffer_appendf(names, "%s\n", name);
+}
+
+static void
+ucs_metrics_vfs_collect_recurs(const char *path, unsigned depth,
+                               ucs_metrics_vfs_sample_array_t *samples)
+{
+    ucs_string_buffer_t names      = UCS_STRING_BUFFER_INITIALIZER;
+    ucs_string_buffer_t child_path = UCS_STRING_BUFFER_INITIALIZER;
+    ucs_string_buffer_t content    = UCS_STRING_BUFFER_INITIALIZER;
+    char count_name[UCS_METRICS_NAME_MAX];
+    ucs_vfs_path_info_t info;
+    const char *value;
+    ucs_status_t status;
+    char *name;
+
+    if (depth > UCS_METRICS_VFS_MAX_DEPTH) {
+        return;
+    }
+
+    status = ucs_vfs_path_list_dir(path, ucs_metrics_vfs_list_dir_cb, &names);
+    if (status != UCS_OK) {
+        goto out;
+    }
+
+    ucs_string_buffer_for_each_token(name, &names, "\n") {
+        ucs_string_buffer_reset(&child_path);
+        ucs_string_buffer_appendf(&child_path, "%s/%s",
+                                  strcmp(path, "/") ? path : "", name);
+
+        ucs_string_buffer_reset(&content);
+        status = ucs_vfs_path_read_file(ucs_string_buffer_cstr(&child_path),
+                                        &content);
+        if (status == UCS_OK) {
+            ucs_string_buffer_rtrim(&content, NULL);
+            value = ucs_string_buffer_cstr(&content);
+            while (isspace(*value)) {
+                ++value;
+            }
+
+            if (ucs_metrics_is_number(value)) {
+                ucs_metrics_vfs_sample_add(samples, name, path, value);
+            }
+            continue;
+        }
+
+        status = ucs_vfs_path_get_info(ucs_string_buffer_cstr(&child_path),
+                                       &info);
+        if ((status != UCS_OK) || !S_ISDIR(info.mode)) {
+            /* Symbolic links are skipped to avoid walking objects twice */
+            continue;
+        }
+
+        if (ucs_config_names_search(&ucs_global_opts.metrics_vfs_count,
+                                    name) >= 0) {
+            ucs_snprintf_safe(count_name, sizeof(count_name), "%s_count", name);
+            ucs_string_buffer_reset(&content);
+            ucs_string_buffer_appendf(&content, "%zu", info.size);
+            ucs_metrics_vfs_sample_add(samples, count_name, path,
+                                       ucs_string_buffer_cstr(&content));
+        } else {
+            ucs_metrics_vfs_collect_recurs(ucs_string_buffer_cstr(&child_path),
+                                           depth + 1, samples);
+        }
+    }
+
+out:
+    ucs_string_buffer_cleanup(&content);
+    ucs_string_buffer_cleanup(&child_path);
+    ucs_string_buffer_cleanup(&names);
+}
+
+static int ucs_metrics_vfs_sample_compare(const void *elem1, const void *elem2,
+                                          void *arg)
+{
+    const ucs_metrics_vfs_sample_t *sample1 = elem1;
+    const ucs_metrics_vfs_sample_t *sample2 = elem2;
+    int ret;
+
+    ret = strcmp(sample1->name, sample2->name);
+    return (ret != 0) ? ret : strcmp(sample1->path, sample2->path);
+}
+
+void ucs_metrics_append_label(ucs_string_buffer_t *strb, const char *value)
+{
+    for (; *value != '\0'; ++value) {
+        switch (*value) {
+        case '\\':
+            ucs_string_buffer_appendf(strb, "\\\\");
+            break;
+        case '"':
+            ucs_string_buffer_appendf(strb, "\\\"");
+            break;
+        case '\n':
+            ucs_string_buffer_appendf(strb, "\\n");
+            break;
+        default:
+            ucs_string_buffer_appendc(strb, *value, 1);
+            break;
+        }
+    }
+}
+
+static void ucs_metrics_vfs_show(ucs_string_buffer_t *strb)
+{
+    ucs_metrics_vfs_sample_array_t samples = UCS_ARRAY_DYNAMIC_INITIALIZER;
+    const ucs_metrics_vfs_sample_t *prev   = NULL;
+    ucs_metrics_vfs_sample_t *sample;
+
+    ucs_metrics_vfs_collect_recurs("/", 0, &samples);
+
+    ucs_qsort_r(ucs_array_begin(&samples), ucs_array_length(&samples),
+                sizeof(ucs_metrics_vfs_sample_t),
+                ucs_metrics_vfs_sample_compare, NULL);
+
+    ucs_array_for_each(sample, &samples) {
+        if ((prev == NULL) || strcmp(prev->name, sample->name)) {
+            ucs_string_buffer_appendf(strb, "# TYPE ucx_vfs_%s gauge\n",
+                                      sample->name);
+        }
+
+        ucs_string_buffer_appendf(strb, "ucx_vfs_%s{path=\"", sample->name);
+        ucs_metrics_append_label(strb, sample->path);
+        ucs_string_buffer_appendf(strb, "\"} %s\n", sample->value);
+        prev = sample;
+    }
+
+    ucs_array_for_each(sample, &samples) {
+        ucs_free(sample->value);
+        ucs_free(sample->path);
+        ucs_free(sample->name);
+    }
+    ucs_array_cleanup_dynamic(&samples);
+}
+
+void ucs_metrics_show(ucs_string_buffer_t *strb)
+{
+    ucs_stats_show_metrics(strb);
+    ucs_metrics_vfs_show(strb);
+    ucs_string_buffer_appendf(strb, "# EOF\n");
+}
+
+static void ucs_metrics_conn_close(ucs_metrics_conn_t *conn)
+{
+    ucs_async_remove_handler(conn->fd, 0);
+    ucs_close_fd(&conn->fd);
+    ucs_list_del(&conn->list);
+    --ucs_metrics_context.num_conns;
+    ucs_string_buffer_cleanup(&conn->response);
+    ucs_free(conn);
+}
+
+static void ucs_metrics_conn_respond(ucs_metrics_conn_t *conn)
+{
+    ucs_string_buffer_t body = UCS_STRING_BUFFER_INITIALIZER;
+
+    ucs_metrics_show(&body);
+
+    if (ucs_metrics_context.is_http) {
+        ucs_string_buffer_appendf(&conn->response,
+                                  "HTTP/1.0 200 OK\r\n"
+                                  "Content-Type: " UCS_METRICS_CONTENT_TYPE
+                                  "\r\n"
+                                  "Content-Length: %zu\r\n"
+                                  "Connection: close\r\n\r\n",
+                                  ucs_string_buffer_length(&body));
+    }
+
+    ucs_string_buffer_appendf(&conn->response, "%s",
+                              ucs_string_buffer_cstr(&body));
+    ucs_string_buffer_cleanup(&body);
+}
+
+static void ucs_metrics_conn_handler(int id, ucs_event_set_types_t events,
+                                     void *arg)
+{
+    ucs_metrics_conn_t *conn = arg;
+    char request[1024];
+    ucs_status_t status;
+    size_t length;
+
+    if (ucs_string_buffer_length(&conn->response) == 0) {
+        /* Any request gets the metrics, so just wait for it to arrive */
+        length = sizeof(request);
+        status = ucs_socket_recv_nb(conn->fd, request, &length);
+        if (status == UCS_ERR_NO_PROGRESS) {
+            return;
+        } else if (status != UCS_OK) {
+            goto out_close;
+        }
+
+        ucs_metrics_conn_respond(conn);
+        status = ucs_async_modify_handler(conn->fd, UCS_EVENT_SET_EVWRITE);
+        if (status != UCS_OK) {
+            goto out_close;
+        }
+    }
+
+    length = ucs_string_buffer_length(&conn->response) - conn->offset;
+    status = ucs_socket_send_nb(conn->fd,
+                                ucs_string_buffer_cstr(&conn->response) +
+                                conn->offset, &length);
+    if (status == UCS_ERR_NO_PROGRESS) {
+        return;
+    } else if (status != UCS_OK) {
+        goto out_close;
+    }
+
+    conn->offset += length;
+    if (conn->offset < ucs_string_buffer_length(&conn->response)) {
+        return;
+    }
+
+out_close:
+    ucs_metrics_conn_close(conn);
+}
+
+static void ucs_metrics_conn_open(int fd)
+{
+    ucs_metrics_conn_t *conn;
+    ucs_status_t status;
+
+    if (ucs_metrics_context.num_conns >= UCS_METRICS_MAX_CONNS) {
+        /* Make room by dropping the oldest client, which is likely stuck */
+        ucs_metrics_conn_close(ucs_list_head(&ucs_metrics_context.conns,
+                                             ucs_metrics_conn_t, list));
+    }
+
+    status = ucs_sys_fcntl_modfl(fd, O_NONBLOCK, 0);
+    if (status != UCS_OK) {
+        goto err_close;
+    }
+
+    conn = ucs_malloc(sizeof(*conn), "metrics_conn");
+    if (conn == NULL) {
+        goto err_close;
+    }
+
+    conn->fd     = fd;
+    conn->offset = 0;
+    ucs_string_buffer_init(&conn->response);
+
+    if (!ucs_metrics_context.is_http) {
+        /* Unix socket clients do not send a request */
+        ucs_metrics_conn_respond(conn);
+    }
+
+    status = ucs_async_set_event_handler(UCS_ASYNC_MODE_THREAD_SPINLOCK, fd,
+                                         ucs_metrics_context.is_http ?
+                                         UCS_EVENT_SET_EVREAD :
+                                         UCS_EVENT_SET_EVWRITE,
+                                         ucs_metrics_conn_handler, conn,
+                                         &ucs_metrics_context.async);
+    if (status != UCS_OK) {
+        ucs_string_buffer_cleanup(&conn->response);
+        ucs_free(conn);
+        goto err_close;
+    }
+
+    ucs_list_add_tail(&ucs_metrics_context.conns, &conn->list);
+    ++ucs_metrics_context.num_conns;
+    return;
+
+err_close:
+    ucs_close_fd(&fd);
+}
+
+static void ucs_metrics_accept_handler(int id, ucs_event_set_types_t events,
+                                       void *arg)
+{
+    struct sockaddr_storage addr;
+    ucs_status_t status;
+    socklen_t addrlen;
+    int fd;
+
+    for (;;) {
+        addrlen = sizeof(addr);
+        status  = ucs_socket_accept(ucs_metrics_context.listen_fd,
+                                    (struct sockaddr*)&addr, &addrlen, &fd);
+        if (status != UCS_OK) {
+            return;
+        }
+
+        ucs_metrics_conn_open(fd);
+    }
+}
+
+static ucs_status_t ucs_metrics_listen(const char *dest)
+{
+    struct sockaddr_storage saddr = {};
+    struct sockaddr_un *sun       = (struct sockaddr_un*)&saddr;
+    struct sockaddr_in *sin       = (struct sockaddr_in*)&saddr;
+    socklen_t socklen;
+    ucs_status_t status;
+    char *end;
+    long port;
+
+    if (!strncmp(dest, UCS_METRICS_PREFIX_UNIX,
+                 strlen(UCS_METRICS_PREFIX_UNIX))) {
+        ucs_fill_filename_template(dest + strlen(UCS_METRICS_PREFIX_UNIX),
+                                   ucs_metrics_context.unix_path,
+                                   sizeof(ucs_metrics_context.unix_path));
+        sun->sun_family = AF_UNIX;
+        ucs_strncpy_safe(sun->sun_path, ucs_metrics_context.unix_path,
+                         sizeof(sun->sun_path));
+        socklen                     = sizeof(*sun);
+        ucs_metrics_context.is_http = 0;
+    } else if (!strncmp(dest, UCS_METRICS_PREFIX_TCP,
+                        strlen(UCS_METRICS_PREFIX_TCP))) {
+        port = strtol(dest + strlen(UCS_METRICS_PREFIX_TCP), &end, 10);
+        if ((*end != '\0') || (port <= 0) || (port > UINT16_MAX)) {
+            ucs_error("invalid metrics port in '%s'", dest);
+            return UCS_ERR_INVALID_PARAM;
+        }
+
+        sin->sin_family             = AF_INET;
+        sin->sin_port               = htons(port);
+        sin->sin_addr.s_addr        = htonl(INADDR_LOOPBACK);
+        socklen                     = sizeof(*sin);
+        ucs_metrics_context.is_http = 1;
+    } else {
+        ucs_error("invalid metrics destination '%s'", dest);
+        return UCS_ERR_INVALID_PARAM;
+    }
+
+    status = ucs_socket_server_init((struct sockaddr*)&saddr, socklen,
+                                    UCS_METRICS_BACKLOG, 0,
+                                    ucs_metrics_context.is_http,
+                                    &ucs_metrics_context.listen_fd);
+    if (status != UCS_OK) {
+        ucs_metrics_context.unix_path[0] = '\0';
+    }
+
+    return status;
+}
+
+static void ucs_metrics_close()
+{
+    ucs_close_fd(&ucs_metrics_context.listen_fd);
+    if (ucs_metrics_context.unix_path[0] != '\0') {
+        unlink(ucs_metrics_context.unix_path);
+        ucs_metrics_context.unix_path[0] = '\0';
+    }
+}
+
+void ucs_metrics_init()
+{
+    ucs_status_t status;
+
+    if (!strlen(ucs_global_opts.metrics_dest)) {
+        return;
+    }
+
+    status = ucs_metrics_listen(ucs_global_opts.metrics_dest);
+    if (status != UCS_OK) {
+        return;
+    }
+
+    status = ucs_async_context_init(&ucs_metrics_context.async,
+                                    UCS_ASYNC_MODE_THREAD_SPINLOCK);
+    if (status != UCS_OK) {
+        ucs_error("failed to create metrics exporter async context: %s",
+                  ucs_status_string(status));
+        goto err_close;
+    }
+
+    status = ucs_async_set_event_handler(UCS_ASYNC_MODE_THREAD_SPINLOCK,
+                                         ucs_metrics_context.listen_fd,
+                                         UCS_EVENT_SET_EVREAD,
+                                         ucs_metrics_accept_handler, NULL,
+                                         &ucs_metrics_context.async);
+    if (status != UCS_OK) {
+        ucs_error("failed to set metrics exporter handler: %s",
+                  ucs_status_string(status));
+        goto err_async_cleanup;
+    }
+
+    ucs_debug("serving metrics on %s", ucs_global_opts.metrics_dest);
+    return;
+
+err_async_cleanup:
+    ucs_async_context_cleanup(&ucs_metrics_context.async);
+err_close:
+    ucs_metrics_close();
+}
+
+void ucs_metrics_cleanup()
+{
+    ucs_metrics_conn_t *conn, *tmp_conn;
+
+    if (ucs_metrics_context.listen_fd < 0) {
+        return;
+    }
+
+    ucs_async_remove_handler(ucs_metrics_context.listen_fd, 1);
+
+    UCS_ASYNC_BLOCK(&ucs_metrics_context.async);
+    ucs_list_for_each_safe(conn, tmp_conn, &ucs_metrics_context.conns, list) {
+        ucs_metrics_conn_close(conn);
+    }
+    UCS_ASYNC_UNBLOCK(&ucs_metrics_context.async);
+
+    ucs_async_context_cleanup(&ucs_metrics_context.async);
+    ucs_metrics_close();
+}
@@ -0,0 +1,58 @@
+/**
+* Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+*
+* See file LICENSE for terms.
+*/
+
+#ifndef UCS_METRICS_H_
+#define UCS_METRICS_H_
+
+#include <ucs/datastruct/string_buffer.h>
+#include <ucs/sys/compiler_def.h>
+
+BEGIN_C_DECLS
+
+/*
+ * OpenMetrics exporter
+ *
+ * When UCX_METRICS_DEST is set, the async thread listens on a unix socket or a
+ * loopback TCP port and answers every connection with the current statistics
+ * counters and the numeric VFS attributes, in OpenMetrics text format. The
+ * hierarchy of statistics nodes and VFS directories is expressed by a "path"
+ * label, for example:
+ *
+ *   ucx_stats_ucp_ep_tx_bytes{path="ucp_worker/ucp_ep"} 1024
+ *   ucx_vfs_ep_count{path="/ucp/context/0x.../worker/0x..."} 2
+ *
+ * Statistics nodes with the same class path are summed to a single sample, and
+ * VFS directories listed in UCX_METRICS_VFS_COUNT (endpoints by default) are
+ * reported as their number of entries, so the cost of a scrape does not grow
+ * with the number of endpoints.
+ */
+
+
+/**
+ * Print all metrics in OpenMetrics text format, terminated by "# EOF" line.
+ *
+ * @param [inout] strb  String buffer to append the metrics to.
+ */
+void ucs_metrics_show(ucs_string_buffer_t *strb);
+
+
+/**
+ * Append a label value, escaped as required by OpenMetrics text format.
+ *
+ * @param [inout] strb   String buffer to append the value to.
+ * @param [in]    value  Label value to append.
+ */
+void ucs_metrics_append_label(ucs_string_buffer_t *strb, const char *value);
+
+
+void ucs_metrics_init();
+
+
+void ucs_metrics_cleanup();
+
+END_C_DECLS
+
+#endif
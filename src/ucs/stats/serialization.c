@@ -255,7 +255,8 @@ ucs_stats_serialize_binary_recurs(FILE *stream, ucs_stats_node_t *node,
     /* Filter output */
     ucs_for_each_bit(counter_index, filter_node->counters_bitmask) {
         ucs_list_for_each(temp_node, &filter_node->type_list_head, type_list) {
-            filtered_counters[filtered_counter_index] += temp_node->counters[counter_index];
+            filtered_counters[filtered_counter_index] +=
+                    ucs_stats_node_counter_get(temp_node, counter_index);
         }
         filtered_counter_index++;
     }
@@ -382,7 +383,7 @@ ucs_stats_serialize_text_recurs_filtered(FILE *stream,
         if (filter_node->counters_bitmask & UCS_BIT(i)) {
             ucs_stats_node_t * temp_node;
             ucs_list_for_each(temp_node, &filter_node->type_list_head, type_list) {
-                counters_acc += temp_node->counters[i];
+                counters_acc += ucs_stats_node_counter_get(temp_node, i);
             }
 
             fprintf(stream, "%*s%s:%s%"PRIu64"%s",
@@ -481,6 +482,9 @@ ucs_stats_deserialize_recurs(FILE *stream, ucs_stats_class_t **classes,
     node->name[namelen] = '\0';
     ucs_list_head_init(&node->children[UCS_STATS_INACTIVE_CHILDREN]);
     ucs_list_head_init(&node->children[UCS_STATS_ACTIVE_CHILDREN]);
+    node->shards       = NULL;
+    node->num_shards   = 0;
+    node->shard_stride = 0;
 
     /* Read counters */
     ucs_stats_read_counters(node->counters, cls->num_counters, stream);
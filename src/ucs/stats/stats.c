@@ -12,6 +12,7 @@
 #endif
 
 #include "stats.h"
+#include "metrics.h"
 
 #include <ucs/debug/log.h>
 #include <ucs/time/time.h>
@@ -22,6 +23,10 @@
 #include <ucs/datastruct/array.h>
 #include <ucs/datastruct/khash.h>
 #include <ucs/sys/string.h>
+#include <ucs/arch/atomic.h>
+#include <ucs/debug/memtrack_int.h>
+#include <ucs/sys/ptr_arith.h>
+#include <ucs/algorithm/qsort_r.h>
 
 #include <sys/ioctl.h>
 #ifdef HAVE_LINUX_FUTEX_H
@@ -53,8 +58,22 @@ enum {
     UCS_ROOT_STATS_LAST
 };
 
+/* Maximal length of a path of classes in metrics output */
+#define UCS_STATS_METRICS_PATH_MAX 256
+
 KHASH_MAP_INIT_STR(ucs_stats_cls, ucs_stats_class_t*)
 
+/* Counters summed over all nodes with the same class path */
+typedef struct {
+    ucs_stats_class_t                *cls;
+    char                             *path;
+    ucs_stats_counter_t              *counters;
+} ucs_stats_metric_t;
+
+UCS_ARRAY_DECLARE_TYPE(ucs_stats_metric_array_t, unsigned, ucs_stats_metric_t);
+
+KHASH_MAP_INIT_STR(ucs_stats_metric, unsigned)
+
 typedef struct {
     volatile unsigned                flags;
 
@@ -63,6 +82,9 @@ typedef struct {
     ucs_stats_node_t                 root_node;
     ucs_stats_counter_t              root_counters[UCS_ROOT_STATS_LAST];
 
+    /* Number of counter shards of every node, a power of 2, or 0 */
+    unsigned                         num_shards;
+
     /* Offset of each stats class in the aggregate counters array */
     ucs_array_s(unsigned, size_t)    aggrt_class_offsets;
 
@@ -107,6 +129,12 @@ static ucs_stats_class_t ucs_stats_root_node_class = {
     }
 };
 
+/* Sequence number of the calling thread, used to select its counter shard */
+static __thread int ucs_stats_thread_seq = -1;
+
+/* Next thread sequence number */
+static uint32_t ucs_stats_thread_seq_next = 0;
+
 #ifdef HAVE_LINUX_FUTEX_H
 static inline int
 ucs_sys_futex(volatile void *addr1, int op, int val1, struct timespec *timeout,
@@ -209,6 +237,87 @@ static ucs_stats_class_t *ucs_stats_get_class(ucs_stats_class_t *cls)
     return class_dup;
 }
 
+static ucs_status_t ucs_stats_node_shards_alloc(ucs_stats_node_t *node)
+{
+    size_t shard_size;
+    int ret;
+
+    if ((ucs_stats_context.num_shards == 0) || (node->cls->num_counters == 0)) {
+        return UCS_OK;
+    }
+
+    /* Every shard starts on its own cache line to avoid false sharing */
+    shard_size = ucs_align_up_pow2(node->cls->num_counters *
+                                   sizeof(ucs_stats_counter_t),
+                                   UCS_SYS_CACHE_LINE_SIZE);
+    ret        = ucs_posix_memalign((void**)&node->shards,
+                                    UCS_SYS_CACHE_LINE_SIZE,
+                                    shard_size * ucs_stats_context.num_shards,
+                                    "stats_node_shards");
+    if (ret != 0) {
+        ucs_error("failed to allocate %u counter shards for %s",
+                  ucs_stats_context.num_shards, node->cls->name);
+        return UCS_ERR_NO_MEMORY;
+    }
+
+    memset(node->shards, 0, shard_size * ucs_stats_context.num_shards);
+    node->num_shards   = ucs_stats_context.num_shards;
+    node->shard_stride = shard_size / sizeof(ucs_stats_counter_t);
+    return UCS_OK;
+}
+
+/* Accumulate the shards into the node counters, and release them */
+static void ucs_stats_node_shards_fold(ucs_stats_node_t *node)
+{
+    unsigned i;
+
+    if (node->shards == NULL) {
+        return;
+    }
+
+    for (i = 0; i < node->cls->num_counters; ++i) {
+        node->counters[i] = ucs_stats_node_counter_get(node, i);
+    }
+
+    ucs_free(node->shards);
+    node->shards       = NULL;
+    node->num_shards   = 0;
+    node->shard_stride = 0;
+}
+
+static void ucs_stats_node_release(ucs_stats_node_t *node)
+{
+    ucs_free(node->shards);
+    ucs_free(node);
+}
+
+void ucs_stats_node_shard_add(ucs_stats_node_t *node, unsigned index,
+                              uint64_t delta)
+{
+    unsigned shard;
+
+    if (ucs_unlikely(ucs_stats_thread_seq < 0)) {
+        ucs_stats_thread_seq = ucs_atomic_fadd32(&ucs_stats_thread_seq_next, 1) &
+                               INT_MAX;
+    }
+
+    /* Threads can share a shard if there are more threads than shards */
+    shard = ucs_stats_thread_seq & (node->num_shards - 1);
+    ucs_atomic_add64(&node->shards[(shard * node->shard_stride) + index],
+                     delta);
+}
+
+void ucs_stats_node_counter_set(ucs_stats_node_t *node, unsigned index,
+                                uint64_t value)
+{
+    unsigned i;
+
+    node->counters[index] = value;
+    for (i = 0; i < node->num_shards; ++i) {
+        node->shards[(i * node->shard_stride) + index] = 0;
+    }
+}
+
 static void ucs_stats_node_remove(ucs_stats_node_t *node, int make_inactive)
 {
     ucs_assert(node != &ucs_stats_context.root_node);
@@ -222,6 +331,8 @@ static void ucs_stats_node_remove(ucs_stats_node_t *node, int make_inactive)
 
     ucs_list_del(&node->list);
     if (make_inactive) {
+        /* Inactive node counters are not updated anymore */
+        ucs_stats_node_shards_fold(node);
         node->cls = ucs_stats_get_class(node->cls);
         if (node->cls) {
             ucs_list_add_tail(&node->parent->children[UCS_STATS_INACTIVE_CHILDREN], &node->list);
@@ -240,7 +351,7 @@ static void ucs_stats_node_remove(ucs_stats_node_t *node, int make_inactive)
         if (!node->filter_node->type_list_len) {
             ucs_free(node->filter_node);
         }
-        ucs_free(node);
+        ucs_stats_node_release(node);
     }
 }
 
@@ -430,17 +541,23 @@ ucs_status_t ucs_stats_node_alloc(ucs_stats_node_t** p_node, ucs_stats_class_t *
         return status;
     }
 
-    status = ucs_stats_filter_node_new(node->cls, &filter_node);
+    status = ucs_stats_node_shards_alloc(node);
     if (status != UCS_OK) {
         ucs_free(node);
         return status;
     }
 
+    status = ucs_stats_filter_node_new(node->cls, &filter_node);
+    if (status != UCS_OK) {
+        ucs_stats_node_release(node);
+        return status;
+    }
+
     ucs_trace("allocated stats node '"UCS_STATS_NODE_FMT"'", UCS_STATS_NODE_ARG(node));
 
     status = ucs_stats_node_add(node, parent, filter_node);
     if (status != UCS_OK) {
-        ucs_free(node);
+        ucs_stats_node_release(node);
         ucs_free(filter_node);
         return status;
     }
@@ -557,7 +674,7 @@ static void ucs_stats_aggregate_sum_recurs(ucs_stats_node_t *node,
             }
 
             aggregate_sum[cnt_agrgt_sum_index] +=
-                temp_node->counters[counter_index];
+                ucs_stats_node_counter_get(temp_node, counter_index);
         }
         counter_output_index++;
     }
@@ -594,6 +711,129 @@ void ucs_stats_aggregate_get_counter_names(
     *size_p  = ucs_array_length(&ucs_stats_context.aggrgt_counter_names);
 }
 
+static void
+ucs_stats_metrics_collect_recurs(ucs_stats_node_t *node, const char *parent_path,
+                                 khash_t(ucs_stats_metric) *hash,
+                                 ucs_stats_metric_array_t *metrics)
+{
+    char path[UCS_STATS_METRICS_PATH_MAX];
+    ucs_stats_metric_t *metric;
+    ucs_stats_node_t *child;
+    khiter_t iter;
+    unsigned i;
+    int ret;
+
+    if (parent_path[0] == '\0') {
+        ucs_strncpy_safe(path, node->cls->name, sizeof(path));
+    } else {
+        ucs_snprintf_safe(path, sizeof(path), "%s/%s", parent_path,
+                          node->cls->name);
+    }
+
+    if (node->cls->num_counters > 0) {
+        iter = kh_get(ucs_stats_metric, hash, path);
+        if (iter != kh_end(hash)) {
+            metric = &ucs_array_elem(metrics, kh_val(hash, iter));
+        } else {
+            metric = ucs_array_append(metrics, return);
+            metric->cls      = node->cls;
+            metric->path     = ucs_strdup(path, "stats_metric_path");
+            metric->counters = ucs_calloc(node->cls->num_counters,
+                                          sizeof(*metric->counters),
+                                          "stats_metric_counters");
+            if ((metric->path == NULL) || (metric->counters == NULL)) {
+                ucs_free(metric->counters);
+                ucs_free(metric->path);
+                ucs_array_pop_back(metrics);
+                return;
+            }
+
+            iter = kh_put(ucs_stats_metric, hash, metric->path, &ret);
+            ucs_assert_always(ret != UCS_KH_PUT_FAILED);
+            kh_val(hash, iter) = ucs_array_length(metrics) - 1;
+        }
+
+        for (i = 0; i < node->cls->num_counters; ++i) {
+            metric->counters[i] += ucs_stats_node_counter_get(node, i);
+        }
+    }
+
+    ucs_list_for_each(child, &node->children[UCS_STATS_ACTIVE_CHILDREN], list) {
+        ucs_stats_metrics_collect_recurs(child, path, hash, metrics);
+    }
+}
+
+static int ucs_stats_metric_compare(const void *elem1, const void *elem2,
+                                    void *arg)
+{
+    const ucs_stats_metric_t *metric1 = elem1;
+    const ucs_stats_metric_t *metric2 = elem2;
+    int ret;
+
+    ret = strcmp(metric1->cls->name, metric2->cls->name);
+    return (ret != 0) ? ret : strcmp(metric1->path, metric2->path);
+}
+
+void ucs_stats_show_metrics(ucs_string_buffer_t *strb)
+{
+    ucs_stats_metric_array_t metrics = UCS_ARRAY_DYNAMIC_INITIALIZER;
+    ucs_stats_metric_t *metric, *first, *end;
+    khash_t(ucs_stats_metric) hash;
+    ucs_stats_node_t *child;
+    unsigned i;
+
+    if (!ucs_stats_is_active()) {
+        return;
+    }
+
+    kh_init_inplace(ucs_stats_metric, &hash);
+
+    pthread_mutex_lock(&ucs_stats_context.lock);
+    ucs_list_for_each(child,
+                      &ucs_stats_context.root_node.children[UCS_STATS_ACTIVE_CHILDREN],
+                      list) {
+        ucs_stats_metrics_collect_recurs(child, "", &hash, &metrics);
+    }
+    pthread_mutex_unlock(&ucs_stats_context.lock);
+
+    /* Samples of the same metric family must be adjacent */
+    ucs_qsort_r(ucs_array_begin(&metrics), ucs_array_length(&metrics),
+                sizeof(ucs_stats_metric_t), ucs_stats_metric_compare, NULL);
+
+    end = ucs_array_end(&metrics);
+    for (first = ucs_array_begin(&metrics); first < end; first = metric) {
+        for (i = 0; i < first->cls->num_counters; ++i) {
+            ucs_string_buffer_appendf(strb, "# TYPE ucx_stats_%s_%s unknown\n",
+                                      first->cls->name,
+                                      first->cls->counter_names[i]);
+            for (metric = first;
+                 (metric < end) &&
+                 !strcmp(metric->cls->name, first->cls->name);
+                 ++metric) {
+                ucs_string_buffer_appendf(strb, "ucx_stats_%s_%s{path=\"",
+                                          first->cls->name,
+                                          first->cls->counter_names[i]);
+                ucs_metrics_append_label(strb, metric->path);
+                ucs_string_buffer_appendf(strb, "\"} %" PRIu64 "\n",
+                                          metric->counters[i]);
+            }
+        }
+
+        /* Skip to the next class */
+        for (metric = first;
+             (metric < end) && !strcmp(metric->cls->name, first->cls->name);
+             ++metric) {
+        }
+    }
+
+    ucs_array_for_each(metric, &metrics) {
+        ucs_free(metric->counters);
+        ucs_free(metric->path);
+    }
+    ucs_array_cleanup_dynamic(&metrics);
+    kh_destroy_inplace(ucs_stats_metric, &hash);
+}
+
 static void __ucs_stats_dump(int inactive)
 {
     ucs_status_t status = UCS_OK;
@@ -704,6 +944,7 @@ static void ucs_stats_open_dest()
 
         status = ucs_stats_client_init(hostname,
                                       port_str ? atoi(port_str) : UCS_STATS_DEFAULT_UDP_PORT,
+                                      ucs_global_opts.stats_full_interval,
                                       &ucs_stats_context.client);
         if (status != UCS_OK) {
             goto out_free;
@@ -848,6 +1089,9 @@ void ucs_stats_init()
         return;
     }
 
+    ucs_stats_context.num_shards =
+            ucs_roundup_pow2_or0(ucs_global_opts.stats_shards);
+
     UCS_STATS_START_TIME(ucs_stats_context.start_time);
     ucs_stats_node_init_root("%s:%d", ucs_get_host_name(), getpid());
     ucs_stats_set_trigger();
@@ -930,6 +1174,10 @@ int ucs_stats_is_active()
     return 0;
 }
 
+void ucs_stats_show_metrics(ucs_string_buffer_t *strb)
+{
+}
+
 ucs_stats_node_t *ucs_stats_get_root()
 {
     return NULL;
@@ -16,6 +16,7 @@
 #include <ucs/sys/compiler_def.h>
 #include <ucs/sys/stubs.h>
 #include <ucs/stats/stats_fwd.h>
+#include <ucs/datastruct/string_buffer.h>
 
 #include "stats_fwd.h"
 
@@ -76,6 +77,17 @@ void ucs_stats_aggregate_get_counter_names(
         const ucs_stats_aggrgt_counter_name_t **names_p, size_t *size_p);
 
 
+/**
+ * Print the statistics counters in OpenMetrics text format. The counters of all
+ * nodes which have the same class and the same ancestor classes are summed to
+ * a single sample, labeled by the path of classes from the root, so the output
+ * size does not depend on the number of nodes.
+ *
+ * @param [inout] strb  String buffer to append the metrics to.
+ */
+void ucs_stats_show_metrics(ucs_string_buffer_t *strb);
+
+
 #ifdef ENABLE_STATS
 
 #include "libstats.h"
@@ -92,6 +104,30 @@ ucs_status_t ucs_stats_node_alloc(ucs_stats_node_t** p_node, ucs_stats_class_t *
                                  ucs_stats_node_t *parent, const char *name, ...);
 void ucs_stats_node_free(ucs_stats_node_t *node);
 
+
+/**
+ * Add to a counter of a sharded statistics node, in the shard of the calling
+ * thread. SHOULD NOT be used directly - use UCS_STATS_UPDATE_COUNTER instead.
+ *
+ * @param node   Statistics node, which has counter shards.
+ * @param index  Counter index.
+ * @param delta  Value to add.
+ */
+void ucs_stats_node_shard_add(ucs_stats_node_t *node, unsigned index,
+                              uint64_t delta);
+
+
+/**
+ * Set a counter of a sharded statistics node, and reset its shards.
+ * SHOULD NOT be used directly - use UCS_STATS_SET_COUNTER instead.
+ *
+ * @param node   Statistics node, which has counter shards.
+ * @param index  Counter index.
+ * @param value  New counter value.
+ */
+void ucs_stats_node_counter_set(ucs_stats_node_t *node, unsigned index,
+                                uint64_t value);
+
 #define UCS_STATS_ARG(_arg) , _arg
 
 #define UCS_STATS_RVAL(_rval) _rval
@@ -110,17 +146,25 @@ void ucs_stats_node_free(ucs_stats_node_t *node);
 
 #define UCS_STATS_UPDATE_COUNTER(_node, _index, _delta) \
     if (((_delta) != 0) && ((_node) != NULL)) { \
-        (_node)->counters[(_index)] += (uint64_t)(_delta); \
+        if (ucs_likely((_node)->shards == NULL)) { \
+            (_node)->counters[(_index)] += (uint64_t)(_delta); \
+        } else { \
+            ucs_stats_node_shard_add(_node, _index, (uint64_t)(_delta)); \
+        } \
     }
 
 #define UCS_STATS_SET_COUNTER(_node, _index, _value) \
     if ((_node) != NULL) { \
-        (_node)->counters[(_index)] = (_value); \
+        if (ucs_likely((_node)->shards == NULL)) { \
+            (_node)->counters[(_index)] = (_value); \
+        } else { \
+            ucs_stats_node_counter_set(_node, _index, _value); \
+        } \
     }
 
 #define UCS_STATS_GET_COUNTER(_node, _index) \
     (((_node) != NULL) ?  \
-    (_node)->counters[(_index)] : 0)
+    ucs_stats_node_counter_get(_node, _index) : 0)
 
 #define UCS_STATS_UPDATE_MAX(_node, _index, _value) \
     if ((_node) != NULL) { \
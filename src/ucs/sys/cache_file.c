@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "cache_file.h"
+
+#include <ucs/algorithm/crc.h>
+#include <ucs/debug/log.h>
+#include <ucs/sys/ptr_arith.h>
+#include <ucs/sys/string.h>
+#include <ucs/sys/sys.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+ucs_status_t ucs_cache_file_key(uint32_t config_crc, uint64_t *key_p)
+{
+    uint64_t boot_id_high, boot_id_low;
+    ucs_status_t status;
+    uint32_t host_crc;
+
+    /* The boot id invalidates the file when the host is rebooted */
+    status = ucs_sys_get_boot_id(&boot_id_high, &boot_id_low);
+    if (status != UCS_OK) {
+        return status;
+    }
+
+    host_crc = ucs_crc32(0, &boot_id_high, sizeof(boot_id_high));
+    host_crc = ucs_crc32(host_crc, &boot_id_low, sizeof(boot_id_low));
+    host_crc = ucs_crc32(host_crc, VERSION, strlen(VERSION));
+
+    *key_p = ((uint64_t)host_crc << 32) | config_crc;
+    return UCS_OK;
+}
+
+void ucs_cache_file_path(char *path, size_t max, const char *dir,
+                         const char *name, uint64_t key)
+{
+    ucs_snprintf_safe(path, max, "%s/%s_%d_%016" PRIx64 ".cache", dir, name,
+                      getuid(), key);
+}
+
+static void ucs_cache_file_header_init(ucs_cache_file_header_t *header,
+                                       const char *magic, uint32_t version,
+                                       uint64_t key)
+{
+    memset(header, 0, sizeof(*header));
+    ucs_strncpy_zero(header->magic, magic, sizeof(header->magic));
+    header->version = version;
+    header->key     = key;
+}
+
+const void *ucs_cache_file_map(const char *path, const char *magic,
+                               uint32_t version, uint64_t key,
+                               size_t *length_p)
+{
+    const ucs_cache_file_header_t *header;
+    ucs_cache_file_header_t expected;
+    const void *data = NULL;
+    struct stat st;
+    size_t length;
+    void *ptr;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        ucs_debug("failed to open cache file %s: %m", path);
+        return NULL;
+    }
+
+    if (fstat(fd, &st) < 0) {
+        ucs_debug("failed to stat cache file %s: %m", path);
+        goto out_close;
+    }
+
+    /* Do not trust a file created by a different user */
+    if ((st.st_uid != getuid()) || (st.st_size < sizeof(*header))) {
+        ucs_debug("ignoring cache file %s (uid %d size %zu)", path, st.st_uid,
+                  (size_t)st.st_size);
+        goto out_close;
+    }
+
+    ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        ucs_debug("failed to map cache file %s: %m", path);
+        goto out_close;
+    }
+
+    header = ptr;
+    length = st.st_size - sizeof(*header);
+    ucs_cache_file_header_init(&expected, magic, version, key);
+    if (memcmp(header->magic, expected.magic, sizeof(header->magic)) ||
+        (header->version != version) || (header->key != key) ||
+        (header->size != st.st_size) ||
+        (header->checksum != ucs_crc32(0, header + 1, length))) {
+        ucs_debug("cache file %s is invalid", path);
+        munmap(ptr, st.st_size);
+        goto out_close;
+    }
+
+    data      = header + 1;
+    *length_p = length;
+
+out_close:
+    close(fd);
+    return data;
+}
+
+void ucs_cache_file_unmap(const void *data, size_t length)
+{
+    const ucs_cache_file_header_t *header = data;
+
+    munmap((void*)(header - 1), sizeof(*header) + length);
+}
+
+static ucs_status_t ucs_cache_file_write(int fd, const void *data, size_t size)
+{
+    ssize_t ret;
+
+    while (size > 0) {
+        ret = write(fd, data, size);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return UCS_ERR_IO_ERROR;
+        }
+
+        data  = UCS_PTR_BYTE_OFFSET(data, ret);
+        size -= ret;
+    }
+
+    return UCS_OK;
+}
+
+ucs_status_t ucs_cache_file_save(const char *path, const char *magic,
+                                 uint32_t version, uint64_t key,
+                                 const struct iovec *iov, size_t iovcnt)
+{
+    ucs_cache_file_header_t header;
+    char tmp_path[PATH_MAX];
+    ucs_status_t status;
+    size_t i;
+    int fd;
+
+    ucs_cache_file_header_init(&header, magic, version, key);
+    header.size = sizeof(header);
+    for (i = 0; i < iovcnt; ++i) {
+        header.checksum = ucs_crc32(header.checksum, iov[i].iov_base,
+                                    iov[i].iov_len);
+        header.size    += iov[i].iov_len;
+    }
+
+    /* Write to a temporary file and rename it, so other processes would
+     * either see the previous file or the complete new one */
+    ucs_snprintf_safe(tmp_path, sizeof(tmp_path), "%s.XXXXXX", path);
+    fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        ucs_diag("failed to create cache file %s: %m", tmp_path);
+        return UCS_ERR_IO_ERROR;
+    }
+
+    status = ucs_cache_file_write(fd, &header, sizeof(header));
+    for (i = 0; (i < iovcnt) && (status == UCS_OK); ++i) {
+        status = ucs_cache_file_write(fd, iov[i].iov_base, iov[i].iov_len);
+    }
+
+    if (status != UCS_OK) {
+        ucs_diag("failed to write cache file %s: %m", tmp_path);
+        close(fd);
+        goto err_unlink;
+    }
+
+    close(fd);
+
+    if (rename(tmp_path, path) < 0) {
+        ucs_diag("failed to rename %s to %s: %m", tmp_path, path);
+        status = UCS_ERR_IO_ERROR;
+        goto err_unlink;
+    }
+
+    return UCS_OK;
+
+err_unlink:
+    unlink(tmp_path);
+    return status;
+}
@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifndef UCS_CACHE_FILE_H_
+#define UCS_CACHE_FILE_H_
+
+#include <ucs/sys/compiler_def.h>
+#include <ucs/type/status.h>
+#include <sys/uio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+BEGIN_C_DECLS
+
+/** @file cache_file.h */
+
+
+/*
+ * Host-local cache file
+ *
+ * Results which are expensive to obtain, and are the same for all processes of
+ * a user on the host, can be saved to a cache file and reused by the next
+ * processes. The file starts with @ref ucs_cache_file_header_t, followed by
+ * data whose format is defined by the user of the file. The header contains a
+ * key built from the boot id, the UCX version and a checksum of the
+ * configuration the data depends on, so a file saved before a reboot, by a
+ * different UCX version or with a different configuration is ignored.
+ */
+typedef struct {
+    char     magic[8];   /* Identifies the user of the file */
+    uint32_t version;    /* Data format version */
+    uint32_t checksum;   /* crc32 of the data */
+    uint64_t key;        /* Host and configuration key */
+    uint64_t size;       /* Total file size */
+} ucs_cache_file_header_t;
+
+
+/**
+ * Build the key of a cache file for the current host and UCX version.
+ *
+ * @param [in]  config_crc  Checksum of the configuration the data depends on.
+ * @param [out] key_p       Filled with the key.
+ *
+ * @return UCS_OK, or an error if the boot id is unknown and the cache file
+ *         must not be used.
+ */
+ucs_status_t ucs_cache_file_key(uint32_t config_crc, uint64_t *key_p);
+
+
+/**
+ * Format the path of a per-user cache file, which contains @a key in its name
+ * so that every configuration uses a different file.
+ *
+ * @param [out] path      Filled with the path.
+ * @param [in]  max       Size of @a path.
+ * @param [in]  dir       Cache directory.
+ * @param [in]  name      File name prefix.
+ * @param [in]  key       Cache file key.
+ */
+void ucs_cache_file_path(char *path, size_t max, const char *dir,
+                         const char *name, uint64_t key);
+
+
+/**
+ * Map a cache file read-only, if it was created by the current user and its
+ * header and data checksum match.
+ *
+ * @param [in]  path      Cache file path.
+ * @param [in]  magic     Expected magic string, up to 7 characters.
+ * @param [in]  version   Expected data format version.
+ * @param [in]  key       Expected key.
+ * @param [out] length_p  Filled with the data length.
+ *
+ * @return Pointer to the mapped data, which must be released by
+ *         @ref ucs_cache_file_unmap, or NULL if the file does not exist or is
+ *         invalid.
+ */
+const void *ucs_cache_file_map(const char *path, const char *magic,
+                               uint32_t version, uint64_t key,
+                               size_t *length_p);
+
+
+/**
+ * Unmap a cache file mapped by @ref ucs_cache_file_map.
+ *
+ * @param [in]  data      Mapped data.
+ * @param [in]  length    Data length.
+ */
+void ucs_cache_file_unmap(const void *data, size_t length);
+
+
+/**
+ * Save a cache file atomically, so other processes either see the previous
+ * file or the complete new one.
+ *
+ * @param [in]  path      Cache file path.
+ * @param [in]  magic     Magic string, up to 7 characters.
+ * @param [in]  version   Data format version.
+ * @param [in]  key       Cache file key.
+ * @param [in]  iov       Data to save.
+ * @param [in]  iovcnt    Number of elements in @a iov.
+ *
+ * @return Error code as defined by @ref ucs_status_t.
+ */
+ucs_status_t ucs_cache_file_save(const char *path, const char *magic,
+                                 uint32_t version, uint64_t key,
+                                 const struct iovec *iov, size_t iovcnt);
+
+END_C_DECLS
+
+#endif
@@ -16,9 +16,11 @@
 #include <ucs/debug/debug_int.h>
 #include <ucs/debug/log.h>
 #include <ucs/debug/memtrack_int.h>
+#include <ucs/profile/event_trace.h>
 #include <ucs/profile/profile.h>
 #include <ucs/memory/memtype_cache.h>
 #include <ucs/memory/numa.h>
+#include <ucs/stats/metrics.h>
 #include <ucs/stats/stats.h>
 #include <ucs/async/async.h>
 #include <ucs/sys/lib.h>
@@ -113,7 +115,10 @@ void UCS_F_CTOR ucs_init()
         ucs_fatal("failed to init ucs profile - aborting");
     }
 
+    ucs_event_trace_init();
+
     ucs_async_global_init();
+    ucs_metrics_init();
     ucs_numa_init();
     ucs_topo_init();
     ucs_rand_seed_init();
@@ -127,7 +132,9 @@ static void UCS_F_DTOR ucs_cleanup(void)
 {
     ucs_topo_cleanup();
     ucs_numa_cleanup();
+    ucs_metrics_cleanup();
     ucs_async_global_cleanup();
+    ucs_event_trace_cleanup();
     ucs_profile_cleanup(ucs_profile_default_ctx);
     ucs_debug_cleanup(0);
     ucs_config_parser_cleanup();
@@ -11,6 +11,7 @@
 #include <ucs/memory/numa.h>
 #include <ucs/sys/math.h>
 #include <ucs/sys/topo/base/topo.h>
+#include <ucs/sys/topo/base/topo_calib.h>
 #include <ucs/sys/string.h>
 #include <ucs/sys/sys.h>
 
@@ -40,6 +41,18 @@
 typedef void (*ucs_topo_get_memory_distance_func_t)(
         ucs_sys_device_t device, ucs_sys_dev_distance_t *distance);
 
+/*
+ * Function pointer used to refer to specific implementations of
+ * ucs_topo_get_memcpy_bw function by topology modules.
+ */
+typedef ucs_status_t (*ucs_topo_get_memcpy_bw_func_t)(double *bandwidth_p);
+
+/*
+ * Function pointer used to refer to specific implementations of
+ * ucs_topo_get_cache_latency function by topology modules.
+ */
+typedef ucs_status_t (*ucs_topo_get_cache_latency_func_t)(double *latency_p);
+
 /*
  * Topology API.
  */
@@ -49,6 +62,12 @@ typedef struct {
 
     /* Provider's ucs_topo_get_memory_distance implementation */
     ucs_topo_get_memory_distance_func_t get_memory_distance;
+
+    /* Provider's ucs_topo_get_memcpy_bw implementation */
+    ucs_topo_get_memcpy_bw_func_t       get_memcpy_bw;
+
+    /* Provider's ucs_topo_get_cache_latency implementation */
+    ucs_topo_get_cache_latency_func_t   get_cache_latency;
 } ucs_sys_topo_ops_t;
 
 
@@ -145,11 +164,23 @@ ucs_topo_get_memory_distance_default(ucs_sys_device_t device,
     *distance = ucs_topo_default_distance;
 }
 
+static ucs_status_t ucs_topo_get_memcpy_bw_default(double *bandwidth_p)
+{
+    return UCS_ERR_UNSUPPORTED;
+}
+
+static ucs_status_t ucs_topo_get_cache_latency_default(double *latency_p)
+{
+    return UCS_ERR_UNSUPPORTED;
+}
+
 static ucs_sys_topo_provider_t ucs_sys_topo_provider_default = {
     .name = "default",
     .ops = {
         .get_distance        = ucs_topo_get_distance_default,
         .get_memory_distance = ucs_topo_get_memory_distance_default,
+        .get_memcpy_bw       = ucs_topo_get_memcpy_bw_default,
+        .get_cache_latency   = ucs_topo_get_cache_latency_default
     }
 };
 
@@ -170,6 +201,20 @@ void ucs_topo_get_memory_distance(ucs_sys_device_t device,
     provider->ops.get_memory_distance(device, distance);
 }
 
+ucs_status_t ucs_topo_get_memcpy_bw(double *bandwidth_p)
+{
+    const ucs_sys_topo_provider_t *provider = ucs_sys_topo_get_provider();
+
+    return provider->ops.get_memcpy_bw(bandwidth_p);
+}
+
+ucs_status_t ucs_topo_get_cache_latency(double *latency_p)
+{
+    const ucs_sys_topo_provider_t *provider = ucs_sys_topo_get_provider();
+
+    return provider->ops.get_cache_latency(latency_p);
+}
+
 static ucs_bus_id_bit_rep_t
 ucs_topo_get_bus_id_bit_repr(const ucs_sys_bus_id_t *bus_id)
 {
@@ -649,6 +694,152 @@ static ucs_sys_topo_provider_t ucs_sys_topo_provider_sysfs = {
     .ops = {
         .get_distance        = ucs_topo_get_distance_sysfs,
         .get_memory_distance = ucs_topo_get_memory_distance_sysfs,
+        .get_memcpy_bw       = ucs_topo_get_memcpy_bw_default,
+        .get_cache_latency   = ucs_topo_get_cache_latency_default
+    }
+};
+
+static ucs_numa_node_t ucs_topo_calib_cpu_node(const ucs_topo_calib_t *calib,
+                                               unsigned cpu)
+{
+    ucs_numa_node_t node = ucs_numa_node_of_cpu(cpu);
+
+    return ((node >= 0) && (node < calib->num_nodes)) ?
+           node : UCS_NUMA_NODE_UNDEFINED;
+}
+
+static void
+ucs_topo_get_memory_distance_calibrated(ucs_sys_device_t device,
+                                        ucs_sys_dev_distance_t *distance)
+{
+    const ucs_topo_calib_t *calib = ucs_topo_calib_get();
+    double bandwidth              = DBL_MAX;
+    double total_latency          = 0;
+    unsigned num_cpus             = 0;
+    ucs_sys_cpuset_t thread_cpuset;
+    ucs_numa_node_t dev_node, cpu_node;
+    unsigned cpu;
+
+    if ((calib == NULL) || (device == UCS_SYS_DEVICE_ID_UNKNOWN) ||
+        (ucs_sys_pthread_getaffinity(&thread_cpuset) != UCS_OK)) {
+        goto out_sysfs;
+    }
+
+    dev_node = ucs_topo_sys_device_get_numa_node(device);
+    if (dev_node == UCS_NUMA_NODE_UNDEFINED) {
+        dev_node = UCS_NUMA_NODE_DEFAULT;
+    }
+
+    if (dev_node >= calib->num_nodes) {
+        goto out_sysfs;
+    }
+
+    /* Average the latency and take the minimal bandwidth from the CPUs of the
+     * current thread to the NUMA node of the device */
+    for (cpu = 0; cpu < ucs_numa_num_configured_cpus(); ++cpu) {
+        if (!CPU_ISSET(cpu, &thread_cpuset)) {
+            continue;
+        }
+
+        cpu_node = ucs_topo_calib_cpu_node(calib, cpu);
+        if ((cpu_node == UCS_NUMA_NODE_UNDEFINED) ||
+            (calib->mem_latency[cpu_node][dev_node] == 0)) {
+            goto out_sysfs;
+        }
+
+        if (cpu_node != dev_node) {
+            if (calib->memcpy_bw[cpu_node][dev_node] == 0) {
+                goto out_sysfs;
+            }
+
+            bandwidth = ucs_min(bandwidth, calib->memcpy_bw[cpu_node][dev_node]);
+        }
+
+        total_latency += calib->mem_latency[cpu_node][dev_node];
+        ++num_cpus;
+    }
+
+    if (num_cpus == 0) {
+        goto out_sysfs;
+    }
+
+    distance->latency   = total_latency / num_cpus;
+    distance->bandwidth = bandwidth;
+    return;
+
+out_sysfs:
+    ucs_topo_get_memory_distance_sysfs(device, distance);
+}
+
+static ucs_status_t ucs_topo_get_memcpy_bw_calibrated(double *bandwidth_p)
+{
+    const ucs_topo_calib_t *calib = ucs_topo_calib_get();
+    double total_bandwidth        = 0;
+    unsigned num_cpus             = 0;
+    ucs_sys_cpuset_t thread_cpuset;
+    ucs_numa_node_t cpu_node;
+    unsigned cpu;
+
+    if ((calib == NULL) ||
+        (ucs_sys_pthread_getaffinity(&thread_cpuset) != UCS_OK)) {
+        return UCS_ERR_UNSUPPORTED;
+    }
+
+    /* Average bandwidth of copying local memory by the current thread CPUs */
+    for (cpu = 0; cpu < ucs_numa_num_configured_cpus(); ++cpu) {
+        if (!CPU_ISSET(cpu, &thread_cpuset)) {
+            continue;
+        }
+
+        cpu_node = ucs_topo_calib_cpu_node(calib, cpu);
+        if ((cpu_node != UCS_NUMA_NODE_UNDEFINED) &&
+            (calib->memcpy_bw[cpu_node][cpu_node] != 0)) {
+            total_bandwidth += calib->memcpy_bw[cpu_node][cpu_node];
+            ++num_cpus;
+        }
+    }
+
+    if (num_cpus == 0) {
+        return UCS_ERR_UNSUPPORTED;
+    }
+
+    *bandwidth_p = total_bandwidth / num_cpus;
+    return UCS_OK;
+}
+
+static ucs_status_t ucs_topo_get_cache_latency_calibrated(double *latency_p)
+{
+    const ucs_topo_calib_t *calib = ucs_topo_calib_get();
+    double shared, remote;
+
+    if (calib == NULL) {
+        return UCS_ERR_UNSUPPORTED;
+    }
+
+    /* Peer processes could run on any core of the host, so take the average
+     * of the latency within a last level cache and between them */
+    shared = calib->llc_shared_latency;
+    remote = calib->llc_remote_latency;
+    if ((shared == 0) && (remote == 0)) {
+        return UCS_ERR_UNSUPPORTED;
+    } else if (shared == 0) {
+        *latency_p = remote;
+    } else if (remote == 0) {
+        *latency_p = shared;
+    } else {
+        *latency_p = (shared + remote) / 2;
+    }
+
+    return UCS_OK;
+}
+
+static ucs_sys_topo_provider_t ucs_sys_topo_provider_calibrated = {
+    .name = "calibrated",
+    .ops = {
+        .get_distance        = ucs_topo_get_distance_sysfs,
+        .get_memory_distance = ucs_topo_get_memory_distance_calibrated,
+        .get_memcpy_bw       = ucs_topo_get_memcpy_bw_calibrated,
+        .get_cache_latency   = ucs_topo_get_cache_latency_calibrated
     }
 };
 
@@ -661,12 +852,15 @@ void ucs_topo_init()
                       &ucs_sys_topo_provider_default.list);
     ucs_list_add_tail(&ucs_sys_topo_providers_list,
                       &ucs_sys_topo_provider_sysfs.list);
+    ucs_list_add_tail(&ucs_sys_topo_providers_list,
+                      &ucs_sys_topo_provider_calibrated.list);
 }
 
 void ucs_topo_cleanup()
 {
     ucs_topo_sys_device_info_t *device;
 
+    ucs_list_del(&ucs_sys_topo_provider_calibrated.list);
     ucs_list_del(&ucs_sys_topo_provider_sysfs.list);
     ucs_list_del(&ucs_sys_topo_provider_default.list);
 
@@ -123,6 +123,32 @@ void ucs_topo_get_memory_distance(ucs_sys_device_t device,
                                   ucs_sys_dev_distance_t *distance);
 
 
+/**
+ * Get the memcpy() bandwidth of the current thread, if the topology provider
+ * measures it.
+ *
+ * @param [out] bandwidth_p  Filled with the bandwidth in bytes/second.
+ *
+ * @return UCS_OK if the bandwidth was measured, or UCS_ERR_UNSUPPORTED if the
+ *         topology provider does not measure it.
+ */
+ucs_status_t ucs_topo_get_memcpy_bw(double *bandwidth_p);
+
+
+/**
+ * Get the one-way latency of passing a cache line between a core of the
+ * current thread and a core of another process on the same host, if the
+ * topology provider measures it. This is the base cost of shared memory
+ * communication.
+ *
+ * @param [out] latency_p  Filled with the latency in seconds.
+ *
+ * @return UCS_OK if the latency was measured, or UCS_ERR_UNSUPPORTED if the
+ *         topology provider does not measure it.
+ */
+ucs_status_t ucs_topo_get_cache_latency(double *latency_p);
+
+
 /**
  * Convert the distance to a human-readable string.
  *
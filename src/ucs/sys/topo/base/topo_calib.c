@@ -0,0 +1,597 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "topo_calib.h"
+
+#include <ucs/algorithm/crc.h>
+#include <ucs/arch/cpu.h>
+#include <ucs/config/global_opts.h>
+#include <ucs/debug/log.h>
+#include <ucs/sys/cache_file.h>
+#include <ucs/sys/math.h>
+#include <ucs/sys/string.h>
+#include <ucs/sys/sys.h>
+#include <ucs/time/time.h>
+#include <ucs/type/init_once.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+#define UCS_TOPO_CALIB_MAGIC          "UCSTOPC"
+#define UCS_TOPO_CALIB_VERSION        3u
+#define UCS_TOPO_CALIB_MIN_COPY_SIZE  (16 * UCS_MBYTE)
+#define UCS_TOPO_CALIB_MAX_COPY_SIZE  (256 * UCS_MBYTE)
+#define UCS_TOPO_CALIB_COPY_ITERS     8
+#define UCS_TOPO_CALIB_PINGPONG_ITERS 10000
+#define UCS_TOPO_CALIB_CHASE_ITERS    UCS_BIT(20)
+#define UCS_TOPO_CALIB_LOCK_TIMEOUT   60.0 /* seconds */
+#define UCS_TOPO_CALIB_LOCK_INTERVAL  10000 /* usec */
+#define UCS_TOPO_CALIB_TIMEOUT        1.0 /* seconds */
+#define UCS_TOPO_CALIB_SPIN_COUNT     1024
+#define UCS_TOPO_CALIB_CPU_CACHE_FMT  "/sys/devices/system/cpu/cpu%d/cache/index3/%s"
+
+
+/* CPUs used for measurements */
+typedef struct {
+    /* Up to two CPUs of each NUMA node, or -1 */
+    int node_cpus[UCS_TOPO_CALIB_MAX_NODES][2];
+    /* A CPU, another CPU which shares its last level cache, and a CPU which
+     * does not share it, or -1 */
+    int llc_cpu;
+    int llc_shared_cpu;
+    int llc_remote_cpu;
+} ucs_topo_calib_cpus_t;
+
+
+/* Shared state of two threads which pass a cache line between them */
+typedef struct {
+    volatile uint64_t seq;
+    char              pad[UCS_SYS_CACHE_LINE_SIZE - sizeof(uint64_t)];
+    volatile int      abort;
+    int               cpu;
+} ucs_topo_calib_pingpong_t;
+
+
+static int ucs_topo_calib_bind(int cpu)
+{
+    ucs_sys_cpuset_t cpuset;
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset)) {
+        ucs_debug("failed to bind calibration thread to cpu %d", cpu);
+        return 0;
+    }
+
+    return 1;
+}
+
+static long ucs_topo_calib_llc_id(int cpu)
+{
+    long level, id;
+
+    if ((ucs_read_file_number(&level, 1, UCS_TOPO_CALIB_CPU_CACHE_FMT, cpu,
+                              "level") != UCS_OK) ||
+        (level != 3) ||
+        (ucs_read_file_number(&id, 1, UCS_TOPO_CALIB_CPU_CACHE_FMT, cpu,
+                              "id") != UCS_OK)) {
+        return -1;
+    }
+
+    return id;
+}
+
+static void ucs_topo_calib_get_cpus(const ucs_sys_cpuset_t *cpuset,
+                                    ucs_topo_calib_cpus_t *cpus)
+{
+    long llc_id = -1;
+    ucs_numa_node_t node;
+    long cpu_llc_id;
+    int cpu;
+
+    memset(cpus->node_cpus, -1, sizeof(cpus->node_cpus));
+    cpus->llc_cpu        = -1;
+    cpus->llc_shared_cpu = -1;
+    cpus->llc_remote_cpu = -1;
+
+    for (cpu = 0; cpu < ucs_numa_num_configured_cpus(); ++cpu) {
+        if (!CPU_ISSET(cpu, cpuset)) {
+            continue;
+        }
+
+        node = ucs_numa_node_of_cpu(cpu);
+        if ((node >= 0) && (node < UCS_TOPO_CALIB_MAX_NODES)) {
+            if (cpus->node_cpus[node][0] < 0) {
+                cpus->node_cpus[node][0] = cpu;
+            } else if (cpus->node_cpus[node][1] < 0) {
+                cpus->node_cpus[node][1] = cpu;
+            }
+        }
+
+        cpu_llc_id = ucs_topo_calib_llc_id(cpu);
+        if (cpu_llc_id < 0) {
+            continue;
+        }
+
+        if (cpus->llc_cpu < 0) {
+            cpus->llc_cpu = cpu;
+            llc_id        = cpu_llc_id;
+        } else if (cpu_llc_id == llc_id) {
+            if (cpus->llc_shared_cpu < 0) {
+                cpus->llc_shared_cpu = cpu;
+            }
+        } else if ((cpus->llc_remote_cpu < 0) ||
+                   ((ucs_numa_node_of_cpu(cpus->llc_remote_cpu) !=
+                     ucs_numa_node_of_cpu(cpus->llc_cpu)) &&
+                    (node == ucs_numa_node_of_cpu(cpus->llc_cpu)))) {
+            /* Prefer a CPU on the same NUMA node */
+            cpus->llc_remote_cpu = cpu;
+        }
+    }
+}
+
+static double ucs_topo_calib_copy_bw(void *dst, const void *src, size_t size)
+{
+    ucs_time_t best_time = UCS_TIME_INFINITY;
+    ucs_time_t start_time;
+    int iter;
+
+    /* Warm up */
+    ucs_memcpy_relaxed(dst, src, size);
+
+    for (iter = 0; iter < UCS_TOPO_CALIB_COPY_ITERS; ++iter) {
+        start_time = ucs_get_time();
+        ucs_memcpy_relaxed(dst, src, size);
+        best_time  = ucs_min(best_time, ucs_get_time() - start_time);
+    }
+
+    return size / ucs_time_to_sec(ucs_max(best_time, 1));
+}
+
+/* Link the cache lines of the buffer to a single cycle in random order, so
+ * following it makes dependent loads which the CPU cannot prefetch */
+static void ucs_topo_calib_chase_init(void **buffer, size_t size)
+{
+    size_t stride    = UCS_SYS_CACHE_LINE_SIZE / sizeof(*buffer);
+    size_t num_lines = size / UCS_SYS_CACHE_LINE_SIZE;
+    unsigned seed    = ucs_generate_uuid(0);
+    size_t i, j, tmp;
+
+    /* Sattolo's algorithm generates a random cyclic permutation */
+    for (i = 0; i < num_lines; ++i) {
+        buffer[i * stride] = (void*)i;
+    }
+
+    for (i = num_lines - 1; i > 0; --i) {
+        j                  = rand_r(&seed) % i;
+        tmp                = (size_t)buffer[i * stride];
+        buffer[i * stride] = buffer[j * stride];
+        buffer[j * stride] = (void*)tmp;
+    }
+
+    for (i = 0; i < num_lines; ++i) {
+        buffer[i * stride] = &buffer[(size_t)buffer[i * stride] * stride];
+    }
+}
+
+static double ucs_topo_calib_chase_latency(void **buffer)
+{
+    void * volatile *ptr = buffer;
+    ucs_time_t start_time;
+    unsigned iter;
+
+    start_time = ucs_get_time();
+    for (iter = 0; iter < UCS_TOPO_CALIB_CHASE_ITERS; ++iter) {
+        ptr = *ptr;
+    }
+
+    return ucs_time_to_sec(ucs_get_time() - start_time) /
+           UCS_TOPO_CALIB_CHASE_ITERS;
+}
+
+static int ucs_topo_calib_memory_is_done(const ucs_topo_calib_t *calib,
+                                         const ucs_topo_calib_cpus_t *cpus,
+                                         unsigned mem_node)
+{
+    unsigned cpu_node;
+
+    for (cpu_node = 0; cpu_node < calib->num_nodes; ++cpu_node) {
+        if ((cpus->node_cpus[cpu_node][0] >= 0) &&
+            ((calib->memcpy_bw[cpu_node][mem_node] == 0) ||
+             (calib->mem_latency[cpu_node][mem_node] == 0))) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* Measure memcpy() bandwidth and memory latency for every pair of nodes */
+static void ucs_topo_calib_memory(ucs_topo_calib_t *calib,
+                                  const ucs_topo_calib_cpus_t *cpus)
+{
+    size_t size = ucs_min(ucs_max(2 * ucs_cpu_get_cache_size(UCS_CPU_CACHE_L3),
+                                  UCS_TOPO_CALIB_MIN_COPY_SIZE),
+                          UCS_TOPO_CALIB_MAX_COPY_SIZE);
+    unsigned mem_node, cpu_node;
+    void *src, *dst;
+
+    for (mem_node = 0; mem_node < calib->num_nodes; ++mem_node) {
+        /* Memory is placed on the node of the CPU which touches it first */
+        if (ucs_topo_calib_memory_is_done(calib, cpus, mem_node) ||
+            (cpus->node_cpus[mem_node][0] < 0) ||
+            !ucs_topo_calib_bind(cpus->node_cpus[mem_node][0])) {
+            continue;
+        }
+
+        src = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (src == MAP_FAILED) {
+            continue;
+        }
+
+        dst = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (dst == MAP_FAILED) {
+            munmap(src, size);
+            continue;
+        }
+
+        memset(src, 0, size);
+        memset(dst, 0, size);
+
+        /* The chain is built in the destination buffer, so the latency is
+         * measured before the copies overwrite it */
+        ucs_topo_calib_chase_init(dst, size);
+        for (cpu_node = 0; cpu_node < calib->num_nodes; ++cpu_node) {
+            if ((calib->mem_latency[cpu_node][mem_node] == 0) &&
+                (cpus->node_cpus[cpu_node][0] >= 0) &&
+                ucs_topo_calib_bind(cpus->node_cpus[cpu_node][0])) {
+                calib->mem_latency[cpu_node][mem_node] =
+                        ucs_topo_calib_chase_latency(dst);
+            }
+        }
+
+        for (cpu_node = 0; cpu_node < calib->num_nodes; ++cpu_node) {
+            if ((calib->memcpy_bw[cpu_node][mem_node] == 0) &&
+                (cpus->node_cpus[cpu_node][0] >= 0) &&
+                ucs_topo_calib_bind(cpus->node_cpus[cpu_node][0])) {
+                calib->memcpy_bw[cpu_node][mem_node] =
+                        ucs_topo_calib_copy_bw(dst, src, size);
+            }
+        }
+
+        munmap(dst, size);
+        munmap(src, size);
+    }
+}
+
+static void *ucs_topo_calib_pong(void *arg)
+{
+    ucs_topo_calib_pingpong_t *pp = arg;
+    unsigned spin_count           = 0;
+    uint64_t seq;
+
+    if (!ucs_topo_calib_bind(pp->cpu)) {
+        pp->abort = 1;
+        return NULL;
+    }
+
+    /* Notify the other thread that we are ready */
+    pp->seq = 1;
+
+    for (seq = 2; seq < (2 * UCS_TOPO_CALIB_PINGPONG_ITERS) + 2; seq += 2) {
+        while (pp->seq != seq) {
+            if (((++spin_count % UCS_TOPO_CALIB_SPIN_COUNT) == 0) &&
+                pp->abort) {
+                return NULL;
+            }
+        }
+        pp->seq = seq + 1;
+    }
+
+    return NULL;
+}
+
+static int ucs_topo_calib_pingpong_wait(ucs_topo_calib_pingpong_t *pp,
+                                        uint64_t seq, ucs_time_t deadline)
+{
+    unsigned spin_count = 0;
+
+    while (pp->seq != seq) {
+        if (((++spin_count % UCS_TOPO_CALIB_SPIN_COUNT) == 0) &&
+            (pp->abort || (ucs_get_time() > deadline))) {
+            pp->abort = 1;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* Return one-way latency of passing a cache line between two CPUs */
+static double ucs_topo_calib_latency(int cpu1, int cpu2)
+{
+    ucs_topo_calib_pingpong_t pp UCS_V_ALIGNED(UCS_SYS_CACHE_LINE_SIZE);
+    double latency = 0;
+    ucs_time_t start_time, deadline;
+    ucs_status_t status;
+    pthread_t thread;
+    uint64_t seq;
+
+    if ((cpu1 < 0) || (cpu2 < 0) || (cpu1 == cpu2) ||
+        !ucs_topo_calib_bind(cpu1)) {
+        return 0;
+    }
+
+    pp.seq   = 0;
+    pp.abort = 0;
+    pp.cpu   = cpu2;
+    status   = ucs_pthread_create(&thread, ucs_topo_calib_pong, &pp,
+                                  "topo_calib");
+    if (status != UCS_OK) {
+        return 0;
+    }
+
+    deadline = ucs_get_time() + ucs_time_from_sec(UCS_TOPO_CALIB_TIMEOUT);
+    if (!ucs_topo_calib_pingpong_wait(&pp, 1, deadline)) {
+        goto out_join;
+    }
+
+    start_time = ucs_get_time();
+    for (seq = 2; seq < (2 * UCS_TOPO_CALIB_PINGPONG_ITERS) + 2; seq += 2) {
+        pp.seq = seq;
+        if (!ucs_topo_calib_pingpong_wait(&pp, seq + 1, deadline)) {
+            goto out_join;
+        }
+    }
+
+    latency = ucs_time_to_sec(ucs_get_time() - start_time) /
+              (2.0 * UCS_TOPO_CALIB_PINGPONG_ITERS);
+
+out_join:
+    pthread_join(thread, NULL);
+    return latency;
+}
+
+static void
+ucs_topo_calib_update_latency(double *latency_p, int cpu1, int cpu2)
+{
+    if (*latency_p == 0) {
+        *latency_p = ucs_topo_calib_latency(cpu1, cpu2);
+    }
+}
+
+static void ucs_topo_calib_latencies(ucs_topo_calib_t *calib,
+                                     const ucs_topo_calib_cpus_t *cpus)
+{
+    unsigned node1, node2;
+    int cpu2;
+
+    for (node1 = 0; node1 < calib->num_nodes; ++node1) {
+        for (node2 = node1; node2 < calib->num_nodes; ++node2) {
+            cpu2 = (node1 == node2) ? cpus->node_cpus[node2][1] :
+                                      cpus->node_cpus[node2][0];
+            ucs_topo_calib_update_latency(
+                    &calib->cacheline_latency[node1][node2],
+                    cpus->node_cpus[node1][0], cpu2);
+            calib->cacheline_latency[node2][node1] =
+                    calib->cacheline_latency[node1][node2];
+        }
+    }
+
+    ucs_topo_calib_update_latency(&calib->llc_shared_latency, cpus->llc_cpu,
+                                  cpus->llc_shared_cpu);
+    ucs_topo_calib_update_latency(&calib->llc_remote_latency, cpus->llc_cpu,
+                                  cpus->llc_remote_cpu);
+}
+
+/* Runs in a separate thread, to not change the affinity of the caller */
+static void *ucs_topo_calib_thread(void *arg)
+{
+    ucs_topo_calib_t *calib = arg;
+    ucs_topo_calib_cpus_t cpus;
+    ucs_sys_cpuset_t cpuset;
+
+    if (ucs_sys_pthread_getaffinity(&cpuset) != UCS_OK) {
+        return NULL;
+    }
+
+    ucs_topo_calib_get_cpus(&cpuset, &cpus);
+    ucs_topo_calib_memory(calib, &cpus);
+    ucs_topo_calib_latencies(calib, &cpus);
+    return NULL;
+}
+
+static int ucs_topo_calib_file_key(uint64_t *key_p)
+{
+    unsigned num_cpus = ucs_numa_num_configured_cpus();
+
+    /* Results are valid until the host reboots */
+    return ucs_cache_file_key(ucs_crc32(0, &num_cpus, sizeof(num_cpus)),
+                              key_p) == UCS_OK;
+}
+
+static void ucs_topo_calib_load(const char *path, uint64_t key,
+                                ucs_topo_calib_t *calib)
+{
+    const ucs_topo_calib_t *file_calib;
+    size_t length;
+
+    file_calib = ucs_cache_file_map(path, UCS_TOPO_CALIB_MAGIC,
+                                    UCS_TOPO_CALIB_VERSION, key, &length);
+    if (file_calib == NULL) {
+        return;
+    }
+
+    if ((length != sizeof(*file_calib)) ||
+        (file_calib->num_nodes != calib->num_nodes)) {
+        ucs_debug("topology calibration file %s is invalid", path);
+        goto out_unmap;
+    }
+
+    *calib = *file_calib;
+    ucs_debug("loaded topology calibration from %s", path);
+
+out_unmap:
+    ucs_cache_file_unmap(file_calib, length);
+}
+
+static void ucs_topo_calib_save(const char *path, uint64_t key,
+                                ucs_topo_calib_t *calib)
+{
+    struct iovec iov;
+
+    iov.iov_base = calib;
+    iov.iov_len  = sizeof(*calib);
+    if (ucs_cache_file_save(path, UCS_TOPO_CALIB_MAGIC, UCS_TOPO_CALIB_VERSION,
+                            key, &iov, 1) == UCS_OK) {
+        ucs_debug("saved topology calibration to %s", path);
+    }
+}
+
+static void ucs_topo_calib_log(const ucs_topo_calib_t *calib)
+{
+    unsigned node1, node2;
+
+    if (!ucs_log_is_enabled(UCS_LOG_LEVEL_DEBUG)) {
+        return;
+    }
+
+    for (node1 = 0; node1 < calib->num_nodes; ++node1) {
+        for (node2 = 0; node2 < calib->num_nodes; ++node2) {
+            ucs_debug("node %u to node %u: memcpy %.1f MB/s, memory latency "
+                      "%.1f ns, cache line latency %.1f ns", node1, node2,
+                      calib->memcpy_bw[node1][node2] / UCS_MBYTE,
+                      calib->mem_latency[node1][node2] * UCS_NSEC_PER_SEC,
+                      calib->cacheline_latency[node1][node2] *
+                      UCS_NSEC_PER_SEC);
+        }
+    }
+
+    ucs_debug("last level cache latency: shared %.1f ns, not shared %.1f ns",
+              calib->llc_shared_latency * UCS_NSEC_PER_SEC,
+              calib->llc_remote_latency * UCS_NSEC_PER_SEC);
+}
+
+/*
+ * Lock the calibration file, so only one process on the host measures at a
+ * time and the others wait for its results. Return the locked file descriptor,
+ * or -1 if the lock could not be taken.
+ */
+static int ucs_topo_calib_lock(const char *path)
+{
+    char lock_path[PATH_MAX];
+    ucs_time_t deadline;
+    struct stat st;
+    int fd;
+
+    ucs_snprintf_safe(lock_path, sizeof(lock_path), "%s.lock", path);
+    fd = open(lock_path, O_RDWR | O_CREAT | O_NOFOLLOW, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        ucs_debug("failed to open topology calibration lock %s: %m",
+                  lock_path);
+        return -1;
+    }
+
+    /* A lock file of a different user could be held forever */
+    if ((fstat(fd, &st) < 0) || (st.st_uid != getuid())) {
+        ucs_debug("ignoring topology calibration lock %s", lock_path);
+        goto err_close;
+    }
+
+    deadline = ucs_get_time() +
+               ucs_time_from_sec(UCS_TOPO_CALIB_LOCK_TIMEOUT);
+    while (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        if ((errno != EWOULDBLOCK) || (ucs_get_time() > deadline)) {
+            ucs_diag("failed to lock topology calibration file %s: %m",
+                     lock_path);
+            goto err_close;
+        }
+
+        usleep(UCS_TOPO_CALIB_LOCK_INTERVAL);
+    }
+
+    return fd;
+
+err_close:
+    close(fd);
+    return -1;
+}
+
+static int ucs_topo_calib_init(ucs_topo_calib_t *calib)
+{
+    const char *dir = ucs_global_opts.topo_calib_dir;
+    int lock_fd     = -1;
+    ucs_topo_calib_t measured;
+    char path[PATH_MAX];
+    ucs_status_t status;
+    pthread_t thread;
+    uint64_t key;
+    int use_file;
+
+    memset(calib, 0, sizeof(*calib));
+    calib->num_nodes = ucs_min(ucs_numa_num_configured_nodes(),
+                               UCS_TOPO_CALIB_MAX_NODES);
+
+    use_file = !ucs_string_is_empty(dir) && ucs_topo_calib_file_key(&key);
+    if (use_file) {
+        ucs_snprintf_safe(path, sizeof(path), "%s/ucs_topo_calib_%d.dat", dir,
+                          getuid());
+        lock_fd = ucs_topo_calib_lock(path);
+        ucs_topo_calib_load(path, key, calib);
+        if (lock_fd < 0) {
+            /* Measuring concurrently with another process would skew the
+             * results of both, so use sysfs for the values which are missing */
+            goto out;
+        }
+    }
+
+    /* Measure the values which are missing */
+    measured = *calib;
+    status   = ucs_pthread_create(&thread, ucs_topo_calib_thread, &measured,
+                                  "topo_calib");
+    if (status != UCS_OK) {
+        goto out;
+    }
+
+    pthread_join(thread, NULL);
+
+    if (memcmp(&measured, calib, sizeof(measured))) {
+        *calib = measured;
+        if (use_file) {
+            ucs_topo_calib_save(path, key, calib);
+        }
+    }
+
+out:
+    if (lock_fd >= 0) {
+        close(lock_fd);
+    }
+
+    ucs_topo_calib_log(calib);
+    return 1;
+}
+
+const ucs_topo_calib_t *ucs_topo_calib_get()
+{
+    static ucs_init_once_t init_once = UCS_INIT_ONCE_INITIALIZER;
+    static ucs_topo_calib_t calib;
+    static int valid                 = 0;
+
+    UCS_INIT_ONCE(&init_once) {
+        valid = ucs_topo_calib_init(&calib);
+    }
+
+    return valid ? &calib : NULL;
+}
@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#ifndef UCS_TOPO_CALIB_H_
+#define UCS_TOPO_CALIB_H_
+
+#include <ucs/memory/numa.h>
+#include <ucs/sys/compiler_def.h>
+
+BEGIN_C_DECLS
+
+/* Maximal number of NUMA nodes which are calibrated */
+#define UCS_TOPO_CALIB_MAX_NODES 8
+
+
+/*
+ * Host performance measured by the "calibrated" topology provider. A value of
+ * 0 means it was not measured, for example because the process is not allowed
+ * to run on the relevant CPUs.
+ */
+typedef struct {
+    /* Number of NUMA nodes on the host, up to UCS_TOPO_CALIB_MAX_NODES */
+    unsigned num_nodes;
+
+    /* memcpy() bandwidth in bytes/second, by the NUMA node of the copying
+     * CPU and the NUMA node of the memory */
+    double   memcpy_bw[UCS_TOPO_CALIB_MAX_NODES][UCS_TOPO_CALIB_MAX_NODES];
+
+    /* Latency in seconds of loading a cache line from memory, by the NUMA
+     * node of the loading CPU and the NUMA node of the memory */
+    double   mem_latency[UCS_TOPO_CALIB_MAX_NODES][UCS_TOPO_CALIB_MAX_NODES];
+
+    /* One-way latency in seconds of moving a cache line between cores, by
+     * the NUMA nodes of the cores */
+    double   cacheline_latency[UCS_TOPO_CALIB_MAX_NODES]
+                              [UCS_TOPO_CALIB_MAX_NODES];
+
+    /* One-way cache line latency between cores which share the last level
+     * cache, and between cores which do not share it */
+    double   llc_shared_latency;
+    double   llc_remote_latency;
+} ucs_topo_calib_t;
+
+
+/**
+ * Get the calibration results of the current host. On the first call, the
+ * results are loaded from the host-local cache file, and the values which are
+ * missing are measured and saved back to the file.
+ *
+ * @return Calibration results, or NULL if calibration is not possible.
+ */
+const ucs_topo_calib_t *ucs_topo_calib_get();
+
+END_C_DECLS
+
+#endif
@@ -1101,6 +1101,20 @@ ucs_status_t
 uct_rkey_compare(uct_component_h component, uct_rkey_t rkey1, uct_rkey_t rkey2,
                  const uct_rkey_compare_params_t *params, int *result);
 
+/**
+ * @ingroup UCT_MD
+ * @brief Check whether a memory pool chunk may use an allocation method.
+ *
+ * Huge page allocation methods are allowed for memory pool chunks only if the
+ * UCX_MPOOL_HUGE_PAGES policy allows the respective kind of huge pages. Other
+ * methods are always allowed.
+ *
+ * @param [in] method  Memory allocation method.
+ *
+ * @return Nonzero if memory pool chunks may be allocated with @a method.
+ */
+int uct_mem_mpool_alloc_method_allowed(uct_alloc_method_t method);
+
 END_C_DECLS
 
 #endif
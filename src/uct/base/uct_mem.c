@@ -333,6 +333,18 @@ ucs_status_t uct_mem_free(const uct_allocated_memory_t *mem)
     }
 }
 
+int uct_mem_mpool_alloc_method_allowed(uct_alloc_method_t method)
+{
+    switch (method) {
+    case UCT_ALLOC_METHOD_HUGE:
+        return ucs_mpool_huge_pages_allowed(UCS_MPOOL_HUGE_PAGES_HUGETLB);
+    case UCT_ALLOC_METHOD_THP:
+        return ucs_mpool_huge_pages_allowed(UCS_MPOOL_HUGE_PAGES_MADVISE);
+    default:
+        return 1;
+    }
+}
+
 static int uct_iface_is_allowed_alloc_method(uct_base_iface_t *iface,
                                              uct_alloc_method_t method)
 {
@@ -347,18 +359,19 @@ static int uct_iface_is_allowed_alloc_method(uct_base_iface_t *iface,
     return 0;
 }
 
-ucs_status_t uct_iface_mem_alloc(uct_iface_h tl_iface, size_t length, unsigned flags,
-                                 const char *name, uct_allocated_memory_t *mem)
+static ucs_status_t
+uct_iface_mem_alloc_methods(uct_base_iface_t *iface,
+                            const uct_alloc_method_t *methods,
+                            unsigned num_methods, size_t length, unsigned flags,
+                            const char *name, uct_allocated_memory_t *mem)
 {
     static uct_alloc_method_t method_md = UCT_ALLOC_METHOD_MD;
-    uct_base_iface_t *iface             = ucs_derived_of(tl_iface,
-                                                         uct_base_iface_t);
     void *address                       = NULL;
     uct_md_attr_t md_attr;
     ucs_status_t status;
     uct_mem_alloc_params_t params;
     unsigned num_alloc_methods;
-    uct_alloc_method_t *alloc_methods;
+    const uct_alloc_method_t *alloc_methods;
 
     status = uct_md_query(iface->md, &md_attr);
     if (status != UCS_OK) {
@@ -376,8 +389,8 @@ ucs_status_t uct_iface_mem_alloc(uct_iface_h tl_iface, size_t length, unsigned f
         status = UCS_ERR_NO_MEMORY;
         goto err;
     } else {
-        alloc_methods     = iface->config.alloc_methods;
-        num_alloc_methods = iface->config.num_alloc_methods;
+        alloc_methods     = methods;
+        num_alloc_methods = num_methods;
     }
 
     params.field_mask      = UCT_MEM_ALLOC_PARAM_FIELD_FLAGS    |
@@ -424,6 +437,16 @@ err:
     return status;
 }
 
+ucs_status_t uct_iface_mem_alloc(uct_iface_h tl_iface, size_t length, unsigned flags,
+                                 const char *name, uct_allocated_memory_t *mem)
+{
+    uct_base_iface_t *iface = ucs_derived_of(tl_iface, uct_base_iface_t);
+
+    return uct_iface_mem_alloc_methods(iface, iface->config.alloc_methods,
+                                       iface->config.num_alloc_methods, length,
+                                       flags, name, mem);
+}
+
 void uct_iface_mem_free(const uct_allocated_memory_t *mem)
 {
     if ((mem->method != UCT_ALLOC_METHOD_MD) &&
@@ -444,17 +467,34 @@ UCS_PROFILE_FUNC_ALWAYS(ucs_status_t, uct_iface_mp_chunk_alloc,
                         void **chunk_p)
 {
     uct_base_iface_t *iface = uct_iface_mp_priv(mp)->iface;
+    uct_alloc_method_t methods[UCT_ALLOC_METHOD_LAST];
+    unsigned i, num_methods;
     uct_iface_mp_chunk_hdr_t *hdr;
     uct_allocated_memory_t mem;
     ucs_status_t status;
     size_t length;
 
+    /* Use only the huge pages allowed for memory pools, unless the interface
+     * configuration does not leave any other method */
+    num_methods = 0;
+    for (i = 0; i < iface->config.num_alloc_methods; ++i) {
+        if (uct_mem_mpool_alloc_method_allowed(iface->config.alloc_methods[i])) {
+            methods[num_methods++] = iface->config.alloc_methods[i];
+        }
+    }
+
+    if (num_methods == 0) {
+        memcpy(methods, iface->config.alloc_methods,
+               iface->config.num_alloc_methods * sizeof(*methods));
+        num_methods = iface->config.num_alloc_methods;
+    }
+
     length = sizeof(*hdr) + *size_p;
-    status = uct_iface_mem_alloc(&iface->super, length,
-                                 UCT_MD_MEM_ACCESS_LOCAL_READ  |
-                                 UCT_MD_MEM_ACCESS_LOCAL_WRITE |
-                                 UCT_MD_MEM_FLAG_LOCK,
-                                 ucs_mpool_name(mp), &mem);
+    status = uct_iface_mem_alloc_methods(iface, methods, num_methods, length,
+                                         UCT_MD_MEM_ACCESS_LOCAL_READ  |
+                                         UCT_MD_MEM_ACCESS_LOCAL_WRITE |
+                                         UCT_MD_MEM_FLAG_LOCK,
+                                         ucs_mpool_name(mp), &mem);
     if (status != UCS_OK) {
         return status;
     }
@@ -12,6 +12,7 @@
 
 #include <ucs/async/async.h>
 #include <ucs/sys/string.h>
+#include <ucs/config/global_opts.h>
 #include <ucs/config/types.h>
 #include <sys/socket.h>
 #include <sys/poll.h>
@@ -596,6 +597,14 @@ static ucs_mpool_ops_t uct_tcp_mpool_ops = {
     .obj_str       = NULL
 };
 
+static ucs_mpool_ops_t uct_tcp_mpool_huge_pages_ops = {
+    .chunk_alloc   = ucs_mpool_hugetlb_malloc,
+    .chunk_release = ucs_mpool_hugetlb_free,
+    .obj_init      = NULL,
+    .obj_cleanup   = NULL,
+    .obj_str       = NULL
+};
+
 static uct_iface_internal_ops_t uct_tcp_iface_internal_ops = {
     .iface_estimate_perf   = uct_base_iface_estimate_perf,
     .iface_vfs_refresh     = (uct_iface_vfs_refresh_func_t)ucs_empty_function,
@@ -616,6 +625,7 @@ static UCS_CLASS_INIT_FUNC(uct_tcp_iface_t, uct_md_h md, uct_worker_h worker,
     ucs_status_t status;
     int i;
     ucs_mpool_params_t mp_params;
+    ucs_mpool_ops_t *mp_ops;
 
     UCT_CHECK_PARAM(params->field_mask & UCT_IFACE_PARAM_FIELD_OPEN_MODE,
                     "UCT_IFACE_PARAM_FIELD_OPEN_MODE is not defined");
@@ -716,12 +726,17 @@ static UCS_CLASS_INIT_FUNC(uct_tcp_iface_t, uct_md_h md, uct_worker_h worker,
         goto err;
     }
 
+    /* Descriptors use huge pages only if a huge pages policy is set */
+    mp_ops = (ucs_global_opts.mpool_huge_pages ==
+              UCS_MPOOL_HUGE_PAGES_DEFAULT) ? &uct_tcp_mpool_ops :
+                                              &uct_tcp_mpool_huge_pages_ops;
+
     ucs_mpool_params_reset(&mp_params);
     uct_iface_mpool_config_copy(&mp_params, &config->tx_mpool);
     mp_params.elems_per_chunk = (config->tx_mpool.bufs_grow == 0) ?
                                 32 : config->tx_mpool.bufs_grow;
     mp_params.elem_size       = self->config.tx_seg_size;
-    mp_params.ops             = &uct_tcp_mpool_ops;
+    mp_params.ops             = mp_ops;
     mp_params.name            = "uct_tcp_iface_tx_buf_mp";
     status = ucs_mpool_init(&mp_params, &self->tx_mpool);
     if (status != UCS_OK) {
@@ -733,7 +748,7 @@ static UCS_CLASS_INIT_FUNC(uct_tcp_iface_t, uct_md_h md, uct_worker_h worker,
     mp_params.elems_per_chunk = (config->rx_mpool.bufs_grow == 0) ?
                                 32 : config->rx_mpool.bufs_grow;
     mp_params.elem_size       = self->config.rx_seg_size * 2;
-    mp_params.ops             = &uct_tcp_mpool_ops;
+    mp_params.ops             = mp_ops;
     mp_params.name            = "uct_tcp_iface_rx_buf_mp";
     status = ucs_mpool_init(&mp_params, &self->rx_mpool);
     if (status != UCS_OK) {
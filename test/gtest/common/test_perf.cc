@@ -215,6 +215,7 @@ void test_perf::test_params_init(const test_spec &test,
     params.send_mem_type   = test.send_mem_type;
     params.recv_mem_type   = test.recv_mem_type;
     params.percentile_rank = 50.0;
+    params.send_rate       = test.send_rate;
 
     memset(params.uct.md_name, 0, sizeof(params.uct.md_name));
 
@@ -352,6 +353,11 @@ double test_perf::run_test(const test_spec& test, unsigned flags, bool check_per
 
         ASSERT_UCS_OK(result.status);
 
+        for (unsigned j = 1; j < UCX_PERF_LAT_PERCENTILES_NUM; ++j) {
+            EXPECT_LE(result.result.latency_dist.percentiles[j - 1],
+                      result.result.latency_dist.percentiles[j]);
+        }
+
         double value = *(double*)( ((char*)&result.result) + test.field_offset) *
                         test.norm;
         char result_str[200] = {0};
@@ -45,6 +45,7 @@ protected:
         unsigned               test_flags;
         ucs_memory_type_t      send_mem_type;
         ucs_memory_type_t      recv_mem_type;
+        double                 send_rate;
     };
 
     static std::vector<int> get_affinity();
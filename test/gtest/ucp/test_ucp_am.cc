@@ -4,6 +4,7 @@
  * Copyright (C) Los Alamos National Security, LLC. 2018. ALL RIGHTS RESERVED.
  *
  */
+#include <algorithm>
 #include <list>
 #include <numeric>
 #include <set>
@@ -1158,6 +1159,148 @@ UCS_TEST_P(test_ucp_am_nbx_send_flag, eager, "RNDV_THRESH=128")
 UCP_INSTANTIATE_TEST_CASE(test_ucp_am_nbx_send_flag)
 
 
+class test_ucp_am_nbx_aggregate : public test_ucp_am_nbx {
+public:
+    test_ucp_am_nbx_aggregate()
+    {
+        modify_config("AM_AGGREGATE_THRESH", "4k");
+        modify_config("RNDV_THRESH", "inf");
+    }
+
+protected:
+    static ucs_status_t am_seq_cb(void *arg, const void *header,
+                                  size_t header_length, void *data,
+                                  size_t length,
+                                  const ucp_am_recv_param_t *param)
+    {
+        test_ucp_am_nbx_aggregate *self =
+                reinterpret_cast<test_ucp_am_nbx_aggregate*>(arg);
+        uint32_t seq;
+
+        EXPECT_EQ(sizeof(seq), header_length);
+        EXPECT_GE(length, sizeof(seq));
+        memcpy(&seq, header, sizeof(seq));
+        EXPECT_EQ(seq, *reinterpret_cast<const uint32_t*>(data));
+
+        self->m_rx_seq.push_back(seq);
+        self->m_recv_counter++;
+        return UCS_OK;
+    }
+
+    void test_seq(size_t num_msgs, size_t large_size)
+    {
+        /* Headers and buffers must stay valid until the requests complete */
+        std::vector<uint32_t> hdrs(num_msgs);
+        std::vector<std::vector<uint32_t>> bufs(num_msgs);
+        std::vector<ucs_status_ptr_t> sptrs;
+        ucp_request_param_t param;
+        uint64_t num_small = 0;
+        uint64_t num_batches;
+
+        set_am_data_handler(receiver(), TEST_AM_NBX_ID, am_seq_cb, this);
+        param.op_attr_mask = 0ul;
+
+        for (uint32_t seq = 0; seq < num_msgs; ++seq) {
+            /* Every 8-th message is too large to be coalesced */
+            size_t size = ((seq % 8) == 7) ? large_size : sizeof(seq);
+
+            hdrs[seq] = seq;
+            bufs[seq].assign(size / sizeof(seq), seq);
+            ucs_status_ptr_t sptr = update_counter_and_send_am(&hdrs[seq],
+                                                               sizeof(seq),
+                                                               bufs[seq].data(),
+                                                               size, &param);
+            if (size == sizeof(seq)) {
+                /* Coalesced messages are completed when the batch is sent */
+                EXPECT_TRUE(UCS_PTR_IS_PTR(sptr));
+                ++num_small;
+            }
+            sptrs.push_back(sptr);
+        }
+
+        EXPECT_EQ(UCS_OK, requests_wait(sptrs));
+        flush_worker(sender());
+        wait_receives();
+
+        /* Small messages are sent in fewer wire messages */
+        num_batches = sender().worker()->counters.am_batches;
+        EXPECT_GT(num_batches, 0u);
+        EXPECT_LT(num_batches, num_small);
+
+        /* Large messages may be sent on other lanes, so only the coalesced
+         * messages are expected to arrive in order */
+        std::vector<uint32_t> small_seq;
+        for (uint32_t seq : m_rx_seq) {
+            if ((seq % 8) != 7) {
+                small_seq.push_back(seq);
+            }
+        }
+        EXPECT_TRUE(std::is_sorted(small_seq.begin(), small_seq.end()));
+
+        std::sort(m_rx_seq.begin(), m_rx_seq.end());
+        ASSERT_EQ(num_msgs, m_rx_seq.size());
+        for (uint32_t seq = 0; seq < num_msgs; ++seq) {
+            EXPECT_EQ(seq, m_rx_seq[seq]);
+        }
+    }
+
+    std::vector<uint32_t> m_rx_seq;
+};
+
+UCS_TEST_P(test_ucp_am_nbx_aggregate, small)
+{
+    test_seq(1000, sizeof(uint32_t));
+}
+
+UCS_TEST_P(test_ucp_am_nbx_aggregate, mixed)
+{
+    test_seq(1000, 8 * UCS_KBYTE);
+}
+
+UCS_TEST_P(test_ucp_am_nbx_aggregate, invalid)
+{
+    const uint32_t seq   = 0;
+    const size_t msg_len = sizeof(ucp_am_batch_hdr_t) + (2 * sizeof(seq));
+    std::vector<char> batch(2 * msg_len);
+    ucp_am_batch_hdr_t *batch_hdr;
+
+    set_am_data_handler(receiver(), TEST_AM_NBX_ID, am_seq_cb, this);
+
+    /* A valid message followed by a message which is longer than the rest of
+     * the batch */
+    for (size_t offset = 0; offset < batch.size(); offset += msg_len) {
+        batch_hdr                = (ucp_am_batch_hdr_t*)&batch[offset];
+        batch_hdr->am_id         = TEST_AM_NBX_ID;
+        batch_hdr->header_length = sizeof(seq);
+        batch_hdr->length        = sizeof(seq);
+        memcpy(batch_hdr + 1, &seq, sizeof(seq));
+        memcpy(UCS_PTR_BYTE_OFFSET(batch_hdr + 1, sizeof(seq)), &seq,
+               sizeof(seq));
+    }
+    batch_hdr->length = UINT16_MAX;
+
+    {
+        scoped_log_handler wrap_err(wrap_errors_logger);
+        EXPECT_UCS_OK(ucp_am_handlers[UCP_AM_ID_AM_BATCH]->cb(
+                receiver().worker(), batch.data(), batch.size(), 0));
+        EXPECT_EQ(1u, m_errors.size());
+    }
+
+    /* The truncated message is dropped */
+    EXPECT_EQ(std::vector<uint32_t>(1, seq), m_rx_seq);
+
+    /* A batch shorter than its first header */
+    {
+        scoped_log_handler wrap_err(wrap_errors_logger);
+        EXPECT_UCS_OK(ucp_am_handlers[UCP_AM_ID_AM_BATCH]->cb(
+                receiver().worker(), batch.data(), 1, 0));
+    }
+    EXPECT_EQ(1u, m_rx_seq.size());
+}
+
+UCP_INSTANTIATE_TEST_CASE(test_ucp_am_nbx_aggregate)
+
+
 class test_ucp_am_nbx_reply : public test_ucp_am_nbx {
 public:
     static void get_test_variants(variant_vec_t &variants)
@@ -6,9 +6,15 @@
 
 #include "ucp_test.h"
 extern "C" {
+#include <ucp/core/ucp_context.h>
+#include <ucs/config/parser.h>
 #include <ucs/sys/sys.h>
 }
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
 class test_ucp_lib_query : public ucs::test {
 };
 
@@ -117,3 +123,214 @@ UCS_TEST_P(test_ucp_version, version_string) {
 }
 
 UCP_INSTANTIATE_TEST_CASE_TLS(test_ucp_version, all, "all")
+
+
+class test_ucp_rsc_cache : public test_ucp_context {
+protected:
+    typedef std::vector<std::string> rsc_list_t;
+
+    virtual void init()
+    {
+        char dir_template[] = "/tmp/ucx_test_rsc_cache_XXXXXX";
+
+        ASSERT_NE((char*)NULL, mkdtemp(dir_template)) << strerror(errno);
+        m_dir = dir_template;
+        modify_config("RESOURCE_CACHE_DIR", m_dir);
+        test_ucp_context::init();
+    }
+
+    virtual void cleanup()
+    {
+        test_ucp_context::cleanup();
+
+        std::vector<std::string> files = cache_files();
+        for (auto it = files.begin(); it != files.end(); ++it) {
+            unlink(it->c_str());
+        }
+        rmdir(m_dir.c_str());
+    }
+
+    std::vector<std::string> cache_files() const
+    {
+        std::vector<std::string> files;
+        struct dirent *entry;
+        DIR *dir;
+
+        dir = opendir(m_dir.c_str());
+        if (dir == NULL) {
+            return files;
+        }
+
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] != '.') {
+                files.push_back(m_dir + "/" + entry->d_name);
+            }
+        }
+
+        closedir(dir);
+        return files;
+    }
+
+    std::string cache_file() const
+    {
+        std::vector<std::string> files = cache_files();
+
+        EXPECT_EQ(1ul, files.size());
+        return files.empty() ? "" : files.front();
+    }
+
+    ino_t cache_inode() const
+    {
+        struct stat st;
+
+        EXPECT_EQ(0, stat(cache_file().c_str(), &st)) << strerror(errno);
+        return st.st_ino;
+    }
+
+    static rsc_list_t resources(ucp_context_h context)
+    {
+        rsc_list_t result;
+
+        for (ucp_rsc_index_t i = 0; i < context->num_tls; ++i) {
+            const ucp_tl_resource_desc_t *rsc = &context->tl_rscs[i];
+            result.push_back(
+                    std::string(context->tl_mds[rsc->md_index].rsc.md_name) +
+                    "/" + rsc->tl_rsc.tl_name + "/" + rsc->tl_rsc.dev_name +
+                    "/" + ucs::to_string(rsc->tl_rsc.dev_type) + "/" +
+                    ucs::to_string(int(rsc->tl_rsc.sys_device)));
+        }
+
+        return result;
+    }
+
+    double init_time_usec(unsigned count)
+    {
+        ucs_time_t start_time = ucs_get_time();
+        ucp_context_h context;
+
+        for (unsigned i = 0; i < count; ++i) {
+            ASSERT_UCS_OK(ucp_init(&get_variant_ctx_params(), m_ucp_config,
+                                   &context));
+            ucp_cleanup(context);
+        }
+
+        return ucs_time_to_usec(ucs_get_time() - start_time) / count;
+    }
+
+    std::string m_dir;
+};
+
+UCS_TEST_P(test_ucp_rsc_cache, hit) {
+    rsc_list_t rscs = resources(sender().ucph());
+    ino_t inode     = cache_inode();
+
+    /* The cache file is used as is, without being rewritten */
+    entity *e = create_entity();
+    EXPECT_EQ(rscs, resources(e->ucph()));
+    EXPECT_EQ(inode, cache_inode());
+}
+
+UCS_TEST_P(test_ucp_rsc_cache, invalid) {
+    rsc_list_t rscs  = resources(sender().ucph());
+    std::string path = cache_file();
+    struct stat st;
+    char byte;
+    int fd;
+
+    /* Corrupt the last byte of the file */
+    fd = open(path.c_str(), O_RDWR);
+    ASSERT_GE(fd, 0) << strerror(errno);
+    ASSERT_EQ(0, fstat(fd, &st));
+    ASSERT_EQ(1, pread(fd, &byte, 1, st.st_size - 1));
+    byte = ~byte;
+    ASSERT_EQ(1, pwrite(fd, &byte, 1, st.st_size - 1));
+    close(fd);
+
+    /* The invalid file is ignored and replaced */
+    entity *e = create_entity();
+    EXPECT_EQ(rscs, resources(e->ucph()));
+    EXPECT_NE(st.st_ino, cache_inode());
+}
+
+UCS_TEST_P(test_ucp_rsc_cache, config_change) {
+    std::string path = cache_file();
+
+    /* A different configuration selects a different cache file */
+    modify_config("SELF_SEG_SIZE", "16k", IGNORE_IF_NOT_EXIST);
+    create_entity();
+    EXPECT_EQ(2ul, cache_files().size());
+}
+
+UCS_TEST_SKIP_COND_P(test_ucp_rsc_cache, startup_time,
+                     RUNNING_ON_VALGRIND || !ucs::perf_retry_count) {
+    const unsigned count = 10;
+    double cached, uncached;
+
+    for (int i = 0; i < (ucs::perf_retry_count + 1); ++i) {
+        modify_config("RESOURCE_CACHE_DIR", m_dir);
+        cached = init_time_usec(count);
+        modify_config("RESOURCE_CACHE_DIR", "");
+        uncached = init_time_usec(count);
+
+        UCS_TEST_MESSAGE << "ucp_init time: " << uncached
+                         << " usec, with cache: " << cached << " usec";
+
+        /* Loading the cache must be faster than discovering the resources */
+        if (cached < uncached) {
+            return;
+        }
+
+        ucs::safe_sleep(ucs::perf_retry_interval);
+    }
+
+    ADD_FAILURE() << "resource cache does not reduce ucp_init time";
+}
+
+UCP_INSTANTIATE_TEST_CASE_TLS(test_ucp_rsc_cache, all, "all")
+
+
+class test_ucp_config_env : public test_ucp_context {
+protected:
+    double init_time_usec(unsigned count)
+    {
+        ucs_time_t start_time = ucs_get_time();
+        ucp_context_h context;
+        ucp_config_t *config;
+
+        for (unsigned i = 0; i < count; ++i) {
+            ASSERT_UCS_OK(ucp_config_read(NULL, NULL, &config));
+            ASSERT_UCS_OK(ucp_init(&get_variant_ctx_params(), config,
+                                   &context));
+            ucp_cleanup(context);
+            ucp_config_release(config);
+        }
+
+        return ucs_time_to_usec(ucs_get_time() - start_time) / count;
+    }
+};
+
+UCS_TEST_P(test_ucp_config_env, startup_time) {
+    const unsigned count    = 10;
+    const unsigned num_vars = 2000;
+    ucs::ptr_vector<ucs::scoped_setenv> env;
+    double base, large_env;
+    unsigned builds;
+
+    base = init_time_usec(count);
+
+    for (unsigned i = 0; i < num_vars; ++i) {
+        env.push_back(new ucs::scoped_setenv(
+                ("MTEST_CONFIG_ENV_" + ucs::to_string(i)).c_str(), "value"));
+    }
+
+    /* Configuration lookups should not depend on the environment size: the
+     * changed environment is indexed once, and then looked up by name */
+    builds    = ucs_config_parser_env_index_builds();
+    large_env = init_time_usec(count);
+    EXPECT_EQ(builds + 1, ucs_config_parser_env_index_builds());
+
+    UCS_TEST_MESSAGE << "ucp_init time: " << base << " usec, with " << num_vars
+                     << " environment variables: " << large_env << " usec";
+}
+
+UCP_INSTANTIATE_TEST_CASE_TLS(test_ucp_config_env, all, "all")
@@ -111,6 +111,14 @@ const test_perf::test_spec test_ucp_perf::tests[] =
     ucs_offsetof(ucx_perf_result_t, latency.total_average), 1e6, 0.001, 60.0,
     UCX_PERF_TEST_FLAG_ERR_HANDLING },
 
+  { "tag_lat_open_loop", "usec",
+    UCX_PERF_API_UCP, UCX_PERF_CMD_TAG, UCX_PERF_TEST_TYPE_PINGPONG,
+    UCX_PERF_WAIT_MODE_POLL,
+    UCP_PERF_DATATYPE_CONTIG, 0, 1, { 8 }, 16, 100000lu,
+    ucs_offsetof(ucx_perf_result_t, latency.percentile), 1e6, 0.001, 1000.0,
+    UCX_PERF_TEST_FLAG_POISSON_RATE, UCS_MEMORY_TYPE_HOST, UCS_MEMORY_TYPE_HOST,
+    100000.0 },
+
   { "tag_lat_b", "usec",
     UCX_PERF_API_UCP, UCX_PERF_CMD_TAG, UCX_PERF_TEST_TYPE_PINGPONG,
     UCX_PERF_WAIT_MODE_SLEEP,
@@ -273,6 +281,13 @@ const test_perf::test_spec test_ucp_perf::tests[] =
     ucs_offsetof(ucx_perf_result_t, latency.total_average), 1e6, 0.001, 60.0,
     0 },
 
+  { "am_lat_open_loop", "usec",
+    UCX_PERF_API_UCP, UCX_PERF_CMD_AM, UCX_PERF_TEST_TYPE_PINGPONG,
+    UCX_PERF_WAIT_MODE_POLL,
+    UCP_PERF_DATATYPE_CONTIG, 0, 1, { 8 }, 16, 100000lu,
+    ucs_offsetof(ucx_perf_result_t, latency.percentile), 1e6, 0.001, 1000.0,
+    0, UCS_MEMORY_TYPE_HOST, UCS_MEMORY_TYPE_HOST, 100000.0 },
+
   { "am_lat_memcpy", "usec",
     UCX_PERF_API_UCP, UCX_PERF_CMD_AM, UCX_PERF_TEST_TYPE_PINGPONG,
     UCX_PERF_WAIT_MODE_POLL,
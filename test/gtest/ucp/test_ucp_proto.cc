@@ -9,11 +9,14 @@
 #include <common/test.h>
 #include <common/mem_buffer.h>
 
+#include <dirent.h>
+
 extern "C" {
 #include <ucp/core/ucp_rkey.h>
 #include <ucp/dt/datatype_iter.inl>
 #include <ucp/proto/proto.h>
 #include <ucp/proto/proto_debug.h>
+#include <ucp/proto/proto_tune.h>
 #include <ucs/datastruct/linear_func.h>
 #include <ucp/proto/proto_select.inl>
 #include <ucp/core/ucp_worker.inl>
@@ -48,6 +51,12 @@ protected:
     }
 
     static ucp_rkey_config_key_t create_rkey_config_key(ucp_md_map_t md_map);
+
+    static ucp_proto_select_param_t
+    create_select_param(ucp_operation_id_t op_id, ucp_dt_class_t dt_class);
+
+    static bool is_selected(const ucp_proto_select_t *proto_select,
+                            const ucp_proto_select_param_t &select_param);
 };
 
 ucp_md_map_t test_ucp_proto::get_md_map(ucs_memory_type_t mem_type)
@@ -116,6 +125,29 @@ test_ucp_proto::create_rkey_config_key(ucp_md_map_t md_map)
     return rkey_config_key;
 }
 
+ucp_proto_select_param_t
+test_ucp_proto::create_select_param(ucp_operation_id_t op_id,
+                                    ucp_dt_class_t dt_class)
+{
+    ucp_proto_select_param_t select_param;
+    ucp_memory_info_t mem_info;
+
+    ucp_memory_info_set_host(&mem_info);
+    ucp_proto_select_param_init(&select_param, op_id, 0, 0, dt_class, &mem_info,
+                                (dt_class == UCP_DATATYPE_GENERIC) ? 0 : 1);
+    return select_param;
+}
+
+bool test_ucp_proto::is_selected(const ucp_proto_select_t *proto_select,
+                                 const ucp_proto_select_param_t &select_param)
+{
+    ucp_proto_select_key_t key;
+
+    key.param = select_param;
+    return kh_get(ucp_proto_select_hash, proto_select->hash, key.u64) !=
+           kh_end(proto_select->hash);
+}
+
 UCS_TEST_P(test_ucp_proto, dump_protocols) {
     ucp_proto_select_param_t select_param;
     ucs_string_buffer_t strb;
@@ -204,10 +236,423 @@ UCS_TEST_P(test_ucp_proto, dt_iter_mem_reg)
     }
 }
 
+UCS_TEST_P(test_ucp_proto, warmup,
+           "PROTO_WARMUP=tag_send_sync:iov,tag_send:generic:host,put")
+{
+    const ucp_proto_select_t *ep_proto_select =
+            &ucs_array_elem(&worker()->ep_config,
+                            sender().ep()->cfg_index).proto_select;
+
+    EXPECT_TRUE(is_selected(ep_proto_select,
+                            create_select_param(UCP_OP_ID_TAG_SEND_SYNC,
+                                                UCP_DATATYPE_IOV)));
+    EXPECT_TRUE(is_selected(ep_proto_select,
+                            create_select_param(UCP_OP_ID_TAG_SEND,
+                                                UCP_DATATYPE_GENERIC)));
+    EXPECT_FALSE(is_selected(ep_proto_select,
+                             create_select_param(UCP_OP_ID_TAG_SEND_SYNC,
+                                                 UCP_DATATYPE_GENERIC)));
+
+    ucp_rkey_config_key_t rkey_config_key = create_rkey_config_key(0);
+    rkey_config_key.ep_cfg_index          = sender().ep()->cfg_index;
+
+    ucp_worker_cfg_index_t rkey_cfg_index;
+    ASSERT_UCS_OK(ucp_worker_rkey_config_get(worker(), &rkey_config_key, NULL,
+                                             &rkey_cfg_index));
+
+    const ucp_proto_select_t *rkey_proto_select =
+            &worker()->rkey_config[rkey_cfg_index].proto_select;
+    EXPECT_TRUE(is_selected(rkey_proto_select,
+                            create_select_param(UCP_OP_ID_PUT,
+                                                UCP_DATATYPE_CONTIG)));
+    EXPECT_FALSE(is_selected(rkey_proto_select,
+                             create_select_param(UCP_OP_ID_GET,
+                                                 UCP_DATATYPE_CONTIG)));
+}
+
+UCS_TEST_P(test_ucp_proto, warmup_invalid)
+{
+    static const char *invalid_values[] = {"amo_post", "tag_send:strided",
+                                           "put:contiguous:nomem"};
+    ucs::handle<ucp_config_t*> config;
+
+    UCS_TEST_CREATE_HANDLE(ucp_config_t*, config, ucp_config_release,
+                           ucp_config_read, NULL, NULL);
+
+    for (auto value : invalid_values) {
+        ASSERT_UCS_OK(ucp_config_modify(config, "PROTO_WARMUP", value));
+
+        ucp_params_t params = {};
+        params.field_mask   = UCP_PARAM_FIELD_FEATURES;
+        params.features     = UCP_FEATURE_TAG | UCP_FEATURE_RMA;
+
+        scoped_log_handler wrap_err(wrap_errors_logger);
+        ucp_context_h ucph;
+        EXPECT_EQ(UCS_ERR_INVALID_PARAM, ucp_init(&params, config, &ucph))
+                << value;
+    }
+}
+
+#if ENABLE_REQ_LATENCY
+UCS_TEST_P(test_ucp_proto, request_latency, "RNDV_THRESH=1k")
+{
+    static const size_t sizes[] = {8, 64 * UCS_KBYTE};
+    ucp_request_param_t param;
+
+    param.op_attr_mask = 0;
+    for (size_t size : sizes) {
+        std::vector<char> sbuf(size, 'x'), rbuf(size);
+        void *rreq = ucp_tag_recv_nbx(receiver().worker(), rbuf.data(), size,
+                                      0, 0, &param);
+        void *sreq = ucp_tag_send_nbx(sender().ep(), sbuf.data(), size, 0,
+                                      &param);
+        ASSERT_UCS_OK(requests_wait({sreq, rreq}));
+    }
+
+    ucs_string_buffer_t strb = UCS_STRING_BUFFER_INITIALIZER;
+    ucp_proto_lat_dump(&worker()->proto_lat, &strb);
+    std::string dump = ucs_string_buffer_cstr(&strb);
+    ucs_string_buffer_cleanup(&strb);
+
+    UCS_TEST_MESSAGE << dump;
+    EXPECT_NE(std::string::npos, dump.find("select"));
+    EXPECT_NE(std::string::npos, dump.find("stage0"));
+    EXPECT_NE(std::string::npos, dump.find("total"));
+    EXPECT_NE(std::string::npos, dump.find("rndv_wait"));
+}
+#endif
+
 UCP_INSTANTIATE_TEST_CASE(test_ucp_proto)
 UCP_INSTANTIATE_TEST_CASE_TLS_GPU_AWARE(test_ucp_proto, shm_ipc,
                                         "shm,cuda_ipc,rocm_ipc")
 
+class test_ucp_proto_select_store : public test_ucp_proto {
+protected:
+    typedef std::vector<std::string> proto_list_t;
+
+    virtual void init()
+    {
+        char dir_template[] = "/tmp/ucx_test_proto_select_XXXXXX";
+
+        ASSERT_NE((char*)NULL, mkdtemp(dir_template)) << strerror(errno);
+        m_dir = dir_template;
+        modify_config("PROTO_SELECT_CACHE_DIR", m_dir);
+        test_ucp_proto::init();
+    }
+
+    virtual void cleanup()
+    {
+        struct dirent *entry;
+        DIR *dir;
+
+        test_ucp_proto::cleanup();
+
+        dir = opendir(m_dir.c_str());
+        if (dir != NULL) {
+            while ((entry = readdir(dir)) != NULL) {
+                if (entry->d_name[0] != '.') {
+                    unlink((m_dir + "/" + entry->d_name).c_str());
+                }
+            }
+            closedir(dir);
+        }
+        rmdir(m_dir.c_str());
+    }
+
+    static proto_list_t
+    select_protocols(const entity &e,
+                     const ucp_proto_select_param_t &select_param)
+    {
+        ucp_worker_h worker                 = e.worker();
+        ucp_worker_cfg_index_t ep_cfg_index = e.ep()->cfg_index;
+        proto_list_t result;
+
+        auto select_elem = ucp_proto_select_lookup_slow(
+                worker,
+                &ucs_array_elem(&worker->ep_config, ep_cfg_index).proto_select,
+                0, ep_cfg_index, UCP_WORKER_CFG_INDEX_NULL, &select_param);
+        EXPECT_NE(nullptr, select_elem);
+        if (select_elem == NULL) {
+            return result;
+        }
+
+        auto thresh_elem = select_elem->thresholds;
+        do {
+            result.push_back(thresh_elem->proto_config.proto->name);
+        } while ((thresh_elem++)->max_msg_length < SIZE_MAX);
+
+        return result;
+    }
+
+    std::string m_dir;
+};
+
+UCS_TEST_P(test_ucp_proto_select_store, reuse)
+{
+    ucp_proto_select_param_t select_param =
+            create_select_param(UCP_OP_ID_TAG_SEND_SYNC, UCP_DATATYPE_CONTIG);
+    ucp_proto_select_store_t *store       = &worker()->proto_select_store;
+
+    ASSERT_TRUE(ucp_proto_select_store_is_enabled(store));
+    EXPECT_EQ(0u, store->num_loaded);
+
+    proto_list_t protos = select_protocols(sender(), select_param);
+    EXPECT_GT(store->num_misses, 0u);
+
+    /* Save the selected protocols and restart the store */
+    ucp_proto_select_store_cleanup(store, 1);
+    ucp_proto_select_store_init(store, context());
+
+    /* A new worker with the same configuration loads them */
+    entity *peer = &receiver();
+    entity *e    = create_entity();
+    e->connect(peer, get_ep_params());
+
+    const ucp_proto_select_store_t *new_store = &e->worker()->proto_select_store;
+    EXPECT_GT(new_store->num_loaded, 0u);
+    EXPECT_EQ(protos, select_protocols(*e, select_param));
+    EXPECT_GT(new_store->num_hits, 0u);
+}
+
+UCP_INSTANTIATE_TEST_CASE_TLS(test_ucp_proto_select_store, tcp, "tcp")
+UCP_INSTANTIATE_TEST_CASE_TLS(test_ucp_proto_select_store, shm, "shm")
+
+class test_ucp_proto_tune : public test_ucp_proto {
+protected:
+    virtual void init()
+    {
+#if ENABLE_PROTO_TUNE
+        modify_config("PROTO_TUNE", "y");
+        modify_config("PROTO_TUNE_SAMPLES", "4");
+#endif
+        test_ucp_proto::init();
+    }
+
+    static const ucp_proto_select_elem_t *
+    select_elem(const entity &e, const ucp_proto_select_param_t &select_param)
+    {
+        ucp_worker_h worker                 = e.worker();
+        ucp_worker_cfg_index_t ep_cfg_index = e.ep()->cfg_index;
+
+        return ucp_proto_select_lookup_slow(
+                worker,
+                &ucs_array_elem(&worker->ep_config, ep_cfg_index).proto_select,
+                0, ep_cfg_index, UCP_WORKER_CFG_INDEX_NULL, &select_param);
+    }
+
+    /* Find a tuned threshold which can move down */
+    static ucp_proto_tune_bound_t *
+    find_bound(const ucp_proto_select_elem_t *select_elem)
+    {
+        if ((select_elem == NULL) || (select_elem->tune == NULL)) {
+            return NULL;
+        }
+
+        for (unsigned i = 0; i < select_elem->tune->num_bounds; ++i) {
+            ucp_proto_tune_bound_t *bound = &select_elem->tune->bounds[i];
+            if (bound->min_thresh < bound->orig_thresh) {
+                return bound;
+            }
+        }
+
+        return NULL;
+    }
+
+    static size_t thresh(const ucp_proto_tune_bound_t *bound)
+    {
+        return bound->lower->max_msg_length + 1;
+    }
+
+    std::string dump()
+    {
+        ucs_string_buffer_t strb = UCS_STRING_BUFFER_INITIALIZER;
+
+        ucp_proto_tune_dump(worker(), &strb);
+        std::string result = ucs_string_buffer_cstr(&strb);
+        ucs_string_buffer_cleanup(&strb);
+        UCS_TEST_MESSAGE << result;
+        return result;
+    }
+};
+
+UCS_TEST_P(test_ucp_proto_tune, thresh_config)
+{
+    static const char *other_thresh =
+            "tag_send:cuda:egr/single/bcopy:egr/multi/bcopy:1k";
+    ucp_proto_select_param_t select_param =
+            create_select_param(UCP_OP_ID_TAG_SEND, UCP_DATATYPE_CONTIG);
+    entity *peer = &receiver();
+
+    /* Configured thresholds do not make send requests measured */
+    modify_config("PROTO_TUNE", "n");
+    modify_config("PROTO_TUNE_THRESH", other_thresh);
+    entity *e1 = create_entity();
+    e1->connect(peer, get_ep_params());
+
+    ucp_proto_tune_bound_t *bound = find_bound(select_elem(*e1, select_param));
+    if (bound == NULL) {
+        UCS_TEST_SKIP_R("no tuned threshold");
+    }
+
+    EXPECT_EQ(nullptr, bound->lower->tune);
+    EXPECT_EQ(nullptr, (bound->lower + 1)->tune);
+
+    const ucp_proto_t *lower = bound->lower->proto_config.proto;
+    const ucp_proto_t *upper = (bound->lower + 1)->proto_config.proto;
+    size_t new_thresh        = thresh(bound) - 1;
+    modify_config("PROTO_TUNE_THRESH",
+                  std::string("tag_send:host:") + lower->name + ":" +
+                          upper->name + ":" + ucs::to_string(new_thresh));
+    entity *e2 = create_entity();
+    e2->connect(peer, get_ep_params());
+
+    const ucp_proto_select_elem_t *new_elem = select_elem(*e2, select_param);
+    ASSERT_NE(nullptr, new_elem);
+    ASSERT_NE(nullptr, new_elem->tune);
+
+    bool found = false;
+    for (unsigned i = 0; i < new_elem->tune->num_bounds; ++i) {
+        const ucp_proto_tune_bound_t *new_bound = &new_elem->tune->bounds[i];
+        if ((new_bound->lower->proto_config.proto == lower) &&
+            ((new_bound->lower + 1)->proto_config.proto == upper)) {
+            EXPECT_EQ(new_thresh, thresh(new_bound));
+            found = true;
+        }
+    }
+    EXPECT_TRUE(found);
+}
+
+#if ENABLE_PROTO_TUNE
+UCS_TEST_P(test_ucp_proto_tune, move_and_export)
+{
+    ucp_proto_select_param_t select_param =
+            create_select_param(UCP_OP_ID_TAG_SEND, UCP_DATATYPE_CONTIG);
+    ucp_proto_tune_bound_t *bound = find_bound(select_elem(sender(),
+                                                           select_param));
+    if (bound == NULL) {
+        UCS_TEST_SKIP_R("no tuned threshold");
+    }
+
+    ucp_proto_config_t *lower = &bound->lower->proto_config;
+    ucp_proto_config_t *upper = &(bound->lower + 1)->proto_config;
+    size_t orig_thresh        = thresh(bound);
+    EXPECT_EQ(bound->orig_thresh, orig_thresh);
+
+    /* The upper protocol is faster just below the threshold */
+    for (int i = 0; i < 4; ++i) {
+        ucp_proto_tune_update(worker(), bound, lower, orig_thresh - 1,
+                              ucs_time_from_usec(100));
+        ucp_proto_tune_update(worker(), bound, upper, orig_thresh - 1,
+                              ucs_time_from_usec(1));
+    }
+
+    size_t new_thresh = thresh(bound);
+    EXPECT_LT(new_thresh, orig_thresh);
+    EXPECT_GE(new_thresh, bound->min_thresh);
+    EXPECT_EQ(1u, bound->num_moves);
+
+    /* Same performance does not move it */
+    for (int i = 0; i < 4; ++i) {
+        ucp_proto_tune_update(worker(), bound, lower, new_thresh,
+                              ucs_time_from_usec(1));
+        ucp_proto_tune_update(worker(), bound, upper, new_thresh,
+                              ucs_time_from_usec(1));
+    }
+    EXPECT_EQ(new_thresh, thresh(bound));
+
+    /* Export the learned threshold and apply it to a new worker */
+    std::string result = dump();
+    std::string entry  = std::string("tag_send:host:") + lower->proto->name +
+                        ":" + upper->proto->name + ":" +
+                        ucs::to_string(new_thresh);
+    size_t pos         = result.find("UCX_PROTO_TUNE_THRESH=");
+    ASSERT_NE(std::string::npos, pos);
+    EXPECT_NE(std::string::npos, result.find(entry, pos)) << entry;
+
+    modify_config("PROTO_TUNE", "n");
+    modify_config("PROTO_TUNE_THRESH", entry);
+    entity *peer = &receiver();
+    entity *e    = create_entity();
+    e->connect(peer, get_ep_params());
+
+    const ucp_proto_select_elem_t *new_elem = select_elem(*e, select_param);
+    ASSERT_NE(nullptr, new_elem);
+    ASSERT_NE(nullptr, new_elem->tune);
+
+    bool found = false;
+    for (unsigned i = 0; i < new_elem->tune->num_bounds; ++i) {
+        const ucp_proto_tune_bound_t *new_bound = &new_elem->tune->bounds[i];
+        if ((new_bound->lower->proto_config.proto == lower->proto) &&
+            ((new_bound->lower + 1)->proto_config.proto == upper->proto)) {
+            EXPECT_EQ(orig_thresh, new_bound->orig_thresh);
+            EXPECT_EQ(new_thresh, thresh(new_bound));
+            found = true;
+        }
+    }
+    EXPECT_TRUE(found);
+}
+
+UCS_TEST_P(test_ucp_proto_tune, send)
+{
+    ucp_proto_select_param_t select_param =
+            create_select_param(UCP_OP_ID_TAG_SEND, UCP_DATATYPE_CONTIG);
+    ucp_proto_tune_bound_t *bound = find_bound(select_elem(sender(),
+                                                           select_param));
+    if (bound == NULL) {
+        UCS_TEST_SKIP_R("no tuned threshold");
+    }
+
+    size_t orig_thresh = thresh(bound);
+    size_t sizes[]     = {orig_thresh - 1, orig_thresh};
+    ucp_request_param_t param;
+
+    param.op_attr_mask = 0;
+    for (int i = 0; i < 64; ++i) {
+        for (size_t size : sizes) {
+            std::vector<char> sbuf(size, 'x'), rbuf(size);
+            void *rreq = ucp_tag_recv_nbx(receiver().worker(), rbuf.data(),
+                                          size, 0, 0, &param);
+            void *sreq = ucp_tag_send_nbx(sender().ep(), sbuf.data(), size, 0,
+                                          &param);
+            ASSERT_UCS_OK(requests_wait({sreq, rreq}));
+            EXPECT_EQ(sbuf, rbuf);
+        }
+    }
+
+    EXPECT_GE(bound->num_selected, 2 * 64u);
+    EXPECT_GE(thresh(bound), bound->min_thresh);
+    EXPECT_LE(thresh(bound), bound->max_thresh);
+    EXPECT_NE(std::string::npos, dump().find("UCX_PROTO_TUNE_THRESH="));
+}
+#endif
+
+UCS_TEST_P(test_ucp_proto_tune, invalid_thresh)
+{
+    static const char *invalid_values[] = {"tag_send:host:egr/short",
+                                           "tag_send:host:nop:tag/rndv:1k",
+                                           "tag_send:host:egr/short:tag/rndv:x"};
+    ucs::handle<ucp_config_t*> config;
+
+    UCS_TEST_CREATE_HANDLE(ucp_config_t*, config, ucp_config_release,
+                           ucp_config_read, NULL, NULL);
+
+    for (auto value : invalid_values) {
+        ASSERT_UCS_OK(ucp_config_modify(config, "PROTO_TUNE_THRESH", value));
+
+        ucp_params_t params = {};
+        params.field_mask   = UCP_PARAM_FIELD_FEATURES;
+        params.features     = UCP_FEATURE_TAG;
+
+        scoped_log_handler wrap_err(wrap_errors_logger);
+        ucp_context_h ucph;
+        EXPECT_EQ(UCS_ERR_INVALID_PARAM, ucp_init(&params, config, &ucph))
+                << value;
+    }
+}
+
+UCP_INSTANTIATE_TEST_CASE_TLS(test_ucp_proto_tune, tcp, "tcp")
+UCP_INSTANTIATE_TEST_CASE_TLS(test_ucp_proto_tune, shm, "shm")
+
 class test_perf_node : public test_ucp_proto {
 };
 
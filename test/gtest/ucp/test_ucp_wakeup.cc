@@ -6,6 +6,10 @@
 
 #include "ucp_test.h"
 
+extern "C" {
+#include <ucp/core/ucp_worker.h>
+}
+
 #include <algorithm>
 #include <sys/epoll.h>
 #include <sys/poll.h>
@@ -42,6 +46,43 @@ protected:
         ASSERT_EQ(UCS_OK, status);
     }
 
+    void tx_wait_test() {
+        const ucp_datatype_t DATATYPE = ucp_dt_make_contig(1);
+        const size_t COUNT            = 20000;
+        const uint64_t TAG            = 0xdeadbeef;
+        std::string send_data(COUNT, '2'), recv_data(COUNT, '1');
+        void *sreq, *rreq;
+
+        sender().connect(&receiver(), get_ep_params());
+
+        rreq = ucp_tag_recv_nb(receiver().worker(), &recv_data[0], COUNT,
+                               DATATYPE, TAG, (ucp_tag_t)-1, recv_completion);
+
+        sreq = ucp_tag_send_nb(sender().ep(), &send_data[0], COUNT, DATATYPE,
+                               TAG, send_completion);
+
+        if (UCS_PTR_IS_PTR(sreq)) {
+            /* wait for send completion */
+            while (!ucp_request_is_completed(sreq)) {
+                ucp_worker_wait(sender().worker());
+                while (progress());
+            }
+            ucp_request_release(sreq);
+        } else {
+            ASSERT_UCS_OK(UCS_PTR_STATUS(sreq));
+        }
+
+        wait(rreq);
+
+        EXPECT_EQ(send_data, recv_data);
+    }
+
+    static void *delayed_signal(void *arg) {
+        ucs::safe_sleep(0.1);
+        ucp_worker_signal(reinterpret_cast<ucp_worker_h>(arg));
+        return NULL;
+    }
+
     static size_t comp_cntr;
 };
 
@@ -117,35 +158,66 @@ UCS_TEST_P(test_ucp_wakeup, efd)
  * TODO: add async progress for TCP connections */
 UCS_TEST_SKIP_COND_P(test_ucp_wakeup, tx_wait, has_transport("tcp"),
                      "ZCOPY_THRESH=10000", "RNDV_THRESH=-1")
+{
+    tx_wait_test();
+}
+
+UCS_TEST_SKIP_COND_P(test_ucp_wakeup, tx_wait_spin, has_transport("tcp"),
+                     "ZCOPY_THRESH=10000", "RNDV_THRESH=-1",
+                     "WAKEUP_SPIN_TIME=100us")
+{
+    tx_wait_test();
+}
+
+UCS_TEST_P(test_ucp_wakeup, wait_spin_hit, "WAKEUP_SPIN_TIME=1s")
 {
     const ucp_datatype_t DATATYPE = ucp_dt_make_contig(1);
-    const size_t COUNT            = 20000;
     const uint64_t TAG            = 0xdeadbeef;
-    std::string send_data(COUNT, '2'), recv_data(COUNT, '1');
+    uint64_t send_data            = 0x12121212;
+    uint64_t recv_data            = 0;
+    ucp_worker_h recv_worker;
     void *sreq, *rreq;
 
     sender().connect(&receiver(), get_ep_params());
+    flush_worker(sender());
 
-    rreq = ucp_tag_recv_nb(receiver().worker(), &recv_data[0], COUNT, DATATYPE,
-                           TAG, (ucp_tag_t)-1, recv_completion);
-
-    sreq = ucp_tag_send_nb(sender().ep(), &send_data[0], COUNT, DATATYPE, TAG,
-                           send_completion);
-
+    recv_worker = receiver().worker();
+    rreq        = ucp_tag_recv_nb(recv_worker, &recv_data, sizeof(recv_data),
+                                  DATATYPE, TAG, (ucp_tag_t)-1,
+                                  recv_completion);
+    sreq        = ucp_tag_send_nb(sender().ep(), &send_data, sizeof(send_data),
+                                  DATATYPE, TAG, send_completion);
     if (UCS_PTR_IS_PTR(sreq)) {
-        /* wait for send completion */
-        while (!ucp_request_is_completed(sreq)) {
-            ucp_worker_wait(sender().worker());
-            while (progress());
-        }
-        ucp_request_release(sreq);
+        wait(sreq);
     } else {
         ASSERT_UCS_OK(UCS_PTR_STATUS(sreq));
     }
 
-    wait(rreq);
+    /* The message is already on its way, so it is caught by spinning */
+    while (!ucp_request_is_completed(rreq)) {
+        ASSERT_UCS_OK(ucp_worker_wait(recv_worker));
+    }
+    ucp_request_release(rreq);
 
     EXPECT_EQ(send_data, recv_data);
+    EXPECT_GE(recv_worker->counters.wait_spin_hits, 1ul);
+    EXPECT_EQ(0ul, recv_worker->counters.wait_sleeps);
+}
+
+UCS_TEST_P(test_ucp_wakeup, wait_spin_sleep, "WAKEUP_SPIN_TIME=10us")
+{
+    ucp_worker_h worker = sender().worker();
+    pthread_t thread;
+
+    /* Nothing arrives during the spin, so the worker goes to sleep until the
+     * signal from the other thread */
+    while (progress());
+    pthread_create(&thread, NULL, delayed_signal, worker);
+    ASSERT_UCS_OK(ucp_worker_wait(worker));
+    pthread_join(thread, NULL);
+
+    EXPECT_EQ(0ul, worker->counters.wait_spin_hits);
+    EXPECT_EQ(1ul, worker->counters.wait_sleeps);
 }
 
 UCS_TEST_P(test_ucp_wakeup, signal)
@@ -9,6 +9,7 @@
 #include <uct/api/tl.h>
 
 extern "C" {
+#include <ucp/api/ucpx.h>
 #include <ucp/core/ucp_worker.h>
 #include <ucp/core/ucp_worker.inl>
 #include <ucp/core/ucp_request.h>
@@ -16,6 +17,9 @@ extern "C" {
 #include <uct/base/uct_iface.h>
 }
 
+#include <sys/mman.h>
+#include <fcntl.h>
+
 
 class test_ucp_worker_discard : public ucp_test {
 public:
@@ -803,6 +807,278 @@ UCS_TEST_P(test_ucp_worker_address_query, query)
 
 UCP_INSTANTIATE_TEST_CASE(test_ucp_worker_address_query)
 
+class test_ucp_address_book : public ucp_test {
+public:
+    static void get_test_variants(std::vector<ucp_test_variant> &variants)
+    {
+        add_variant(variants, UCP_FEATURE_TAG);
+    }
+
+protected:
+    typedef ucs::handle<ucp_address_book_h> book_handle_t;
+
+    std::string book_name() const
+    {
+        return "gtest_" + ucs::to_string(getpid());
+    }
+
+    ucs_status_t open_book(book_handle_t &book, const std::string &name,
+                           unsigned flags = 0, unsigned num_addresses = 0,
+                           size_t max_address_length = 0)
+    {
+        ucp_address_book_params_t params;
+        ucp_address_book_h book_h;
+
+        params.field_mask         = UCP_ADDRESS_BOOK_PARAM_FIELD_NAME |
+                                    UCP_ADDRESS_BOOK_PARAM_FIELD_FLAGS |
+                                    UCP_ADDRESS_BOOK_PARAM_FIELD_NUM_ADDRESSES |
+                                    UCP_ADDRESS_BOOK_PARAM_FIELD_MAX_ADDRESS_LENGTH;
+        params.name               = name.c_str();
+        params.flags              = flags;
+        params.num_addresses      = num_addresses;
+        params.max_address_length = max_address_length;
+
+        ucs_status_t status = ucp_address_book_open(&params, &book_h);
+        if (status == UCS_OK) {
+            book.reset(book_h, ucp_address_book_close);
+        }
+
+        return status;
+    }
+
+    void publish_book(book_handle_t &book, unsigned num_addresses)
+    {
+        ucp_address_t *address;
+        size_t address_length;
+
+        ASSERT_UCS_OK(ucp_worker_get_address(receiver().worker(), &address,
+                                             &address_length));
+        ASSERT_UCS_OK(open_book(book, book_name(),
+                                UCP_ADDRESS_BOOK_FLAG_PUBLISH, num_addresses,
+                                address_length));
+        ucs_status_t status = ucp_address_book_publish(book, num_addresses - 1,
+                                                       address, address_length);
+        ucp_worker_release_address(receiver().worker(), address);
+        ASSERT_UCS_OK(status);
+    }
+};
+
+UCS_TEST_P(test_ucp_address_book, send_recv)
+{
+    const unsigned num_addresses = 4;
+    book_handle_t publisher, peer;
+
+    EXPECT_EQ(UCS_ERR_NO_ELEM, open_book(peer, book_name()));
+    publish_book(publisher, num_addresses);
+    ASSERT_UCS_OK(open_book(peer, book_name()));
+
+    const ucp_address_t *address;
+    size_t address_length;
+    EXPECT_EQ(UCS_ERR_NO_ELEM,
+              ucp_address_book_get(peer, 0, &address, &address_length));
+    ASSERT_UCS_OK(ucp_address_book_get(peer, num_addresses - 1, &address,
+                                       &address_length));
+
+    /* Endpoint is created from the read-only mapping of the address */
+    ucp_ep_params_t ep_params = get_ep_params();
+    ep_params.field_mask     |= UCP_EP_PARAM_FIELD_REMOTE_ADDRESS;
+    ep_params.address         = address;
+    ucp_ep_h ep;
+    ASSERT_UCS_OK(ucp_ep_create(sender().worker(), &ep_params, &ep));
+
+    /* The book is removed, but the existing mapping can still be used */
+    publisher.reset();
+    book_handle_t peer2;
+    EXPECT_EQ(UCS_ERR_NO_ELEM, open_book(peer2, book_name()));
+    ASSERT_UCS_OK(ucp_address_book_get(peer, num_addresses - 1, &address,
+                                       NULL));
+
+    uint64_t send_data = ucs::rand();
+    uint64_t recv_data = 0;
+    ucp_request_param_t param;
+    param.op_attr_mask = 0;
+    void *rreq = ucp_tag_recv_nbx(receiver().worker(), &recv_data,
+                                  sizeof(recv_data), 1, UINT64_MAX, &param);
+    void *sreq = ucp_tag_send_nbx(ep, &send_data, sizeof(send_data), 1,
+                                  &param);
+    ASSERT_UCS_OK(request_wait(sreq));
+    ASSERT_UCS_OK(request_wait(rreq));
+    EXPECT_EQ(send_data, recv_data);
+
+    ASSERT_UCS_OK(request_wait(ep_close_nbx(ep, 0)));
+}
+
+UCS_TEST_P(test_ucp_address_book, invalid)
+{
+    const unsigned num_addresses = 2;
+    book_handle_t publisher, peer, book;
+
+    publish_book(publisher, num_addresses);
+    ASSERT_UCS_OK(open_book(peer, book_name()));
+
+    EXPECT_EQ(UCS_ERR_ALREADY_EXISTS,
+              open_book(book, book_name(), UCP_ADDRESS_BOOK_FLAG_PUBLISH,
+                        num_addresses, 1));
+
+    const ucp_address_t *address;
+    size_t address_length;
+    ASSERT_UCS_OK(ucp_address_book_get(peer, num_addresses - 1, &address,
+                                       &address_length));
+    EXPECT_EQ(UCS_ERR_ALREADY_EXISTS,
+              ucp_address_book_publish(publisher, num_addresses - 1, address,
+                                       address_length));
+
+    scoped_log_handler wrap_err(wrap_errors_logger);
+    EXPECT_EQ(UCS_ERR_INVALID_PARAM,
+              ucp_address_book_publish(peer, 0, address, address_length));
+    EXPECT_EQ(UCS_ERR_INVALID_PARAM,
+              ucp_address_book_publish(publisher, 0, address,
+                                       address_length + 1));
+    EXPECT_EQ(UCS_ERR_INVALID_PARAM,
+              ucp_address_book_publish(publisher, num_addresses, address,
+                                       address_length));
+    EXPECT_EQ(UCS_ERR_INVALID_PARAM,
+              ucp_address_book_get(peer, num_addresses, &address, NULL));
+
+    /* Corrupt the length of the first slot, which follows the header */
+    std::string shm_name = "/ucx_address_book_" + book_name();
+    int fd               = shm_open(shm_name.c_str(), O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+    void *ptr = mmap(NULL, 2 * UCS_SYS_CACHE_LINE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT_NE(MAP_FAILED, ptr);
+    *(volatile uint64_t*)UCS_PTR_BYTE_OFFSET(ptr, UCS_SYS_CACHE_LINE_SIZE) =
+            UINT64_MAX;
+    munmap(ptr, 2 * UCS_SYS_CACHE_LINE_SIZE);
+    EXPECT_EQ(UCS_ERR_INVALID_PARAM,
+              ucp_address_book_get(peer, 0, &address, NULL));
+
+    EXPECT_EQ(UCS_ERR_INVALID_PARAM, open_book(book, "a/b"));
+    EXPECT_EQ(UCS_ERR_INVALID_PARAM, open_book(book, ""));
+    EXPECT_EQ(UCS_ERR_INVALID_PARAM,
+              open_book(book, book_name() + "_empty",
+                        UCP_ADDRESS_BOOK_FLAG_PUBLISH, num_addresses, 0));
+}
+
+UCP_INSTANTIATE_TEST_CASE_TLS(test_ucp_address_book, shm, "shm")
+UCP_INSTANTIATE_TEST_CASE_TLS(test_ucp_address_book, tcp, "tcp")
+
+
+class test_ucp_worker_memory : public ucp_test {
+public:
+    static void get_test_variants(std::vector<ucp_test_variant> &variants)
+    {
+        add_variant(variants, UCP_FEATURE_TAG);
+    }
+
+protected:
+    static size_t memory_usage(ucp_worker_h worker)
+    {
+        ucp_worker_attr_t attr;
+
+        attr.field_mask = UCP_WORKER_ATTR_FIELD_MEMORY_USAGE;
+        EXPECT_UCS_OK(ucp_worker_query(worker, &attr));
+        return attr.memory_usage;
+    }
+};
+
+UCS_TEST_P(test_ucp_worker_memory, query) {
+    ucp_worker_h worker = sender().worker();
+    size_t usage        = memory_usage(worker);
+    void *req;
+
+    EXPECT_EQ(worker->mem.acct.total, usage);
+    EXPECT_FALSE(ucs_list_is_empty(&worker->mem.acct.mpools));
+
+    req = ucs_mpool_get(&worker->req_mp);
+    ASSERT_TRUE(req != NULL);
+    EXPECT_GE(memory_usage(worker), usage);
+    EXPECT_GT(memory_usage(worker), 0ul);
+    ucs_mpool_put(req);
+}
+
+UCS_TEST_P(test_ucp_worker_memory, budget) {
+    ucp_worker_h worker    = sender().worker();
+    ucs_mpool_acct_t *acct = &worker->mem.acct;
+    std::vector<void*> reqs;
+    size_t usage;
+    void *req;
+
+    req = ucs_mpool_get(&worker->req_mp);
+    ASSERT_TRUE(req != NULL);
+    reqs.push_back(req);
+
+    /* Do not allow the worker memory pools to grow anymore */
+    acct->limit = acct->total;
+    while ((req = ucs_mpool_get(&worker->req_mp)) != NULL) {
+        reqs.push_back(req);
+    }
+
+    EXPECT_GE(acct->num_denied, 1ul);
+    EXPECT_TRUE(worker->mem.reclaim_pending);
+    EXPECT_LE(acct->total, acct->limit);
+
+    for (size_t i = 0; i < reqs.size(); ++i) {
+        ucs_mpool_put(reqs[i]);
+    }
+
+    /* The unused chunks are released on progress */
+    usage = memory_usage(worker);
+    ucp_worker_progress(worker);
+    EXPECT_FALSE(worker->mem.reclaim_pending);
+    EXPECT_GT(worker->mem.reclaimed, 0ul);
+    EXPECT_LT(memory_usage(worker), usage);
+
+    acct->limit = UCS_MEMUNITS_INF;
+    req         = ucs_mpool_get(&worker->req_mp);
+    ASSERT_TRUE(req != NULL);
+    ucs_mpool_put(req);
+}
+
+UCP_INSTANTIATE_TEST_CASE_TLS(test_ucp_worker_memory, all, "all")
+UCP_INSTANTIATE_TEST_CASE_TLS(test_ucp_worker_memory, shm, "shm")
+UCP_INSTANTIATE_TEST_CASE_TLS(test_ucp_worker_memory, tcp, "tcp")
+
+
+class test_ucp_worker_memory_idle : public test_ucp_worker_memory {
+public:
+    test_ucp_worker_memory_idle()
+    {
+        modify_config("WORKER_MEMORY_IDLE_TIME", "50ms");
+    }
+};
+
+UCS_TEST_P(test_ucp_worker_memory_idle, reclaim) {
+    ucp_worker_h worker = sender().worker();
+    std::vector<void*> reqs;
+    ucs_time_t deadline;
+    size_t usage;
+
+    /* Grow the requests pool by a burst of allocations */
+    for (unsigned i = 0; i < 1000; ++i) {
+        void *req = ucs_mpool_get(&worker->req_mp);
+        ASSERT_TRUE(req != NULL);
+        reqs.push_back(req);
+    }
+
+    for (size_t i = 0; i < reqs.size(); ++i) {
+        ucs_mpool_put(reqs[i]);
+    }
+
+    usage    = memory_usage(worker);
+    deadline = ucs_get_time() + ucs_time_from_sec(10.0 *
+                                                  ucs::test_time_multiplier());
+    while ((worker->mem.reclaimed == 0) && (ucs_get_time() < deadline)) {
+        progress();
+    }
+
+    EXPECT_GT(worker->mem.reclaimed, 0ul);
+    EXPECT_LT(memory_usage(worker), usage);
+}
+
+UCP_INSTANTIATE_TEST_CASE_TLS(test_ucp_worker_memory_idle, shm, "shm")
+
 class test_ucp_modify_uct_cfg : public test_ucp_context {
 public:
     test_ucp_modify_uct_cfg() : m_seg_size((ucs::rand() & 0x3ff) + 1024) {
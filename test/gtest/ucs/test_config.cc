@@ -619,6 +619,53 @@ UCS_TEST_F(test_config, performance) {
     }
 }
 
+UCS_TEST_F(test_config, env_change) {
+    {
+        /* coverity[tainted_string_argument] */
+        ucs::scoped_setenv env1("UCX_COLOR", "white");
+
+        car_opts opts(UCS_DEFAULT_ENV_PREFIX, NULL);
+        EXPECT_EQ(COLOR_WHITE, opts->color);
+        EXPECT_EQ(20, opts->temp_front);
+    }
+
+    /* Changes of the environment are visible to the next read */
+    {
+        /* coverity[tainted_string_argument] */
+        ucs::scoped_setenv env1("UCX_COLOR", "blue");
+        /* coverity[tainted_string_argument] */
+        ucs::scoped_setenv env2("UCX_TEMP", "30");
+
+        car_opts opts(UCS_DEFAULT_ENV_PREFIX, NULL);
+        EXPECT_EQ(COLOR_BLUE, opts->color);
+        EXPECT_EQ(30, opts->temp_front);
+    }
+
+    car_opts opts(UCS_DEFAULT_ENV_PREFIX, NULL);
+    EXPECT_EQ(COLOR_RED, opts->color);
+    EXPECT_EQ(20, opts->temp_front);
+}
+
+UCS_TEST_F(test_config, cleared_env) {
+    char **saved_environ = environ;
+    uint32_t checksum;
+
+    {
+        ucs::ucx_env_cleanup env_cleanup;
+        checksum = ucs_config_parser_checksum(UCS_DEFAULT_ENV_PREFIX, NULL);
+    }
+
+    /* Like after clearenv() */
+    environ = NULL;
+    EXPECT_EQ(checksum,
+              ucs_config_parser_checksum(UCS_DEFAULT_ENV_PREFIX, NULL));
+    {
+        car_opts opts(UCS_DEFAULT_ENV_PREFIX, NULL);
+        EXPECT_EQ(COLOR_RED, opts->color);
+    }
+    environ = saved_environ;
+}
+
 UCS_TEST_F(test_config, unused) {
     ucs::ucx_env_cleanup env_cleanup;
 
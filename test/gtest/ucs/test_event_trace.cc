@@ -0,0 +1,197 @@
+/**
+* Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+*
+* See file LICENSE for terms.
+*/
+
+#include <common/test.h>
+extern "C" {
+#include <ucs/profile/event_trace.h>
+#include <ucs/sys/sys.h>
+}
+
+#include <pthread.h>
+#include <fstream>
+
+
+class test_event_trace : public ucs::test {
+protected:
+    static const char *TRACE_FILENAME;
+
+    struct thread_param {
+        int           num_events;
+        int           tid;
+        pthread_key_t *key;
+    };
+
+    virtual void cleanup()
+    {
+        ucs_event_trace_enable(0);
+        unlink(TRACE_FILENAME);
+        ucs::test::cleanup();
+    }
+
+    static void *trace_thread_func(void *arg)
+    {
+        thread_param *param = (thread_param*)arg;
+
+        param->tid = ucs_get_tid();
+        for (int i = 0; i < param->num_events; ++i) {
+            UCS_EVENT_TRACE("test_event", i, 1000 + i);
+        }
+
+        if (param->key != NULL) {
+            pthread_setspecific(*param->key, param);
+        }
+
+        return NULL;
+    }
+
+    static void trace_key_destr(void *arg)
+    {
+        for (int i = 0; i < 100; ++i) {
+            UCS_EVENT_TRACE("test_destr_event", i, 0);
+        }
+    }
+
+    /* Record events on a new thread, which creates a new ring with the current
+     * configured size */
+    int run_traced_thread(int num_events, pthread_key_t *key = NULL)
+    {
+        thread_param param;
+        pthread_t thread;
+
+        param.num_events = num_events;
+        param.tid        = 0;
+        param.key        = key;
+        EXPECT_EQ(0, pthread_create(&thread, NULL, trace_thread_func, &param));
+        pthread_join(thread, NULL);
+        return param.tid;
+    }
+
+    /* Parse the snapshot file and return the records of the given thread */
+    void read_snapshot(int tid, std::vector<ucs_profile_record_t> &records,
+                       std::string &loc_name)
+    {
+        size_t num_events;
+
+        ASSERT_UCS_OK(ucs_event_trace_snapshot(TRACE_FILENAME, &num_events));
+
+        std::ifstream f(TRACE_FILENAME);
+        std::string data((std::istreambuf_iterator<char>(f)),
+                         std::istreambuf_iterator<char>());
+        ASSERT_GE(data.size(), sizeof(ucs_profile_header_t));
+
+        const ucs_profile_header_t *hdr = (const ucs_profile_header_t*)
+                                                  data.c_str();
+        EXPECT_EQ(UCS_PROFILE_FILE_VERSION, uint32_t(hdr->version));
+        EXPECT_EQ(UCS_BIT(UCS_PROFILE_MODE_LOG), uint32_t(hdr->mode));
+        EXPECT_EQ(data.size(),
+                  size_t(hdr->threads.offset + hdr->threads.size));
+
+        const ucs_profile_location_t *locations =
+                (const ucs_profile_location_t*)(data.c_str() +
+                                                hdr->locations.offset);
+        size_t num_locations = hdr->locations.size / sizeof(*locations);
+        const char *ptr      = data.c_str() + hdr->threads.offset;
+        const char *end      = ptr + hdr->threads.size;
+        size_t total_events  = 0;
+
+        while (ptr < end) {
+            const ucs_profile_thread_header_t *thread_hdr =
+                    (const ucs_profile_thread_header_t*)ptr;
+            const ucs_profile_record_t *rec =
+                    (const ucs_profile_record_t*)(ptr + sizeof(*thread_hdr) +
+                    num_locations * sizeof(ucs_profile_thread_location_t));
+
+            total_events += thread_hdr->num_records;
+            if (thread_hdr->tid == (uint32_t)tid) {
+                records.assign(rec, rec + thread_hdr->num_records);
+                if (!records.empty()) {
+                    EXPECT_LT(size_t(records[0].location), num_locations);
+                    loc_name = locations[records[0].location].name;
+                }
+            }
+
+            ptr = (const char*)(rec + thread_hdr->num_records);
+        }
+
+        EXPECT_EQ(end, ptr);
+        EXPECT_EQ(num_events, total_events);
+    }
+};
+
+const char *test_event_trace::TRACE_FILENAME = "test.evtrace";
+
+
+UCS_TEST_F(test_event_trace, record) {
+    const int num_events = 100;
+    std::string loc_name;
+
+    ucs_event_trace_enable(1);
+    int tid = run_traced_thread(num_events);
+
+    std::vector<ucs_profile_record_t> records;
+    read_snapshot(tid, records, loc_name);
+    ASSERT_EQ(size_t(num_events), records.size());
+    EXPECT_EQ("test_event", loc_name);
+    for (int i = 0; i < num_events; ++i) {
+        EXPECT_EQ(i, int(records[i].param32));
+        EXPECT_EQ(1000 + i, int(records[i].param64));
+        EXPECT_EQ(int(records[0].location), int(records[i].location));
+        if (i > 0) {
+            EXPECT_GE(uint64_t(records[i].timestamp),
+                      uint64_t(records[i - 1].timestamp));
+        }
+    }
+}
+
+UCS_TEST_F(test_event_trace, wraparound, "EVENT_TRACE_SIZE=10") {
+    const int num_events = 100;
+    const int ring_size  = 16; /* Rounded up to a power of 2 */
+    std::string loc_name;
+
+    ucs_event_trace_enable(1);
+    int tid = run_traced_thread(num_events);
+
+    /* Only the newest events are kept */
+    std::vector<ucs_profile_record_t> records;
+    read_snapshot(tid, records, loc_name);
+    ASSERT_EQ(size_t(ring_size), records.size());
+    for (int i = 0; i < ring_size; ++i) {
+        EXPECT_EQ(num_events - ring_size + i, int(records[i].param32));
+    }
+}
+
+UCS_TEST_F(test_event_trace, disabled) {
+    std::string loc_name;
+
+    ucs_event_trace_enable(0);
+    int tid = run_traced_thread(100);
+
+    std::vector<ucs_profile_record_t> records;
+    read_snapshot(tid, records, loc_name);
+    EXPECT_TRUE(records.empty());
+}
+
+UCS_TEST_F(test_event_trace, record_after_thread_exit) {
+    std::string loc_name;
+    pthread_key_t key;
+
+    /* Destructor of a key created after the event trace key runs after the
+     * ring was completed, so its events must not be written to the ring */
+    ASSERT_EQ(0, pthread_key_create(&key, trace_key_destr));
+    ucs_event_trace_enable(1);
+    int tid = run_traced_thread(10, &key);
+
+    std::vector<ucs_profile_record_t> records;
+    read_snapshot(tid, records, loc_name);
+    EXPECT_EQ(10ul, records.size());
+
+    /* The ring of the exited thread was released by the previous snapshot */
+    records.clear();
+    read_snapshot(tid, records, loc_name);
+    EXPECT_TRUE(records.empty());
+
+    pthread_key_delete(key);
+}
@@ -0,0 +1,257 @@
+/**
+ * Copyright (c) NVIDIA CORPORATION & AFFILIATES, 2024. ALL RIGHTS RESERVED.
+ *
+ * See file LICENSE for terms.
+ */
+
+#include <common/test.h>
+extern "C" {
+#include <ucs/stats/metrics.h>
+#include <ucs/sys/string.h>
+#include <ucs/time/time.h>
+#include <ucs/vfs/base/vfs_obj.h>
+}
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+
+class test_metrics : public ucs::test {
+public:
+    static void num_items_show_cb(void *obj, ucs_string_buffer_t *strb,
+                                  void *arg_ptr, uint64_t arg_u64)
+    {
+        ucs_string_buffer_appendf(strb, "%" PRIu64 "\n", arg_u64);
+    }
+
+    static void text_show_cb(void *obj, ucs_string_buffer_t *strb,
+                             void *arg_ptr, uint64_t arg_u64)
+    {
+        ucs_string_buffer_appendf(strb, "memory\n");
+    }
+
+protected:
+    static const unsigned NUM_EPS = 5;
+
+    virtual void init()
+    {
+        ucs::test::init();
+
+        ASSERT_UCS_OK(ucs_vfs_obj_add_dir(NULL, &m_obj, "metrics_test"));
+        ASSERT_UCS_OK(ucs_vfs_obj_add_ro_file(&m_obj, num_items_show_cb, NULL,
+                                              42, "num_items"));
+        ASSERT_UCS_OK(ucs_vfs_obj_add_ro_file(&m_obj, text_show_cb, NULL, 0,
+                                              "mem_type"));
+        for (unsigned i = 0; i < NUM_EPS; ++i) {
+            ASSERT_UCS_OK(ucs_vfs_obj_add_dir(&m_obj, &m_eps[i], "ep/%u", i));
+            ASSERT_UCS_OK(ucs_vfs_obj_add_ro_file(&m_eps[i], num_items_show_cb,
+                                                  NULL, i, "ep_items"));
+        }
+    }
+
+    virtual void cleanup()
+    {
+        ucs_vfs_obj_remove(&m_obj);
+        ucs::test::cleanup();
+    }
+
+    std::string show()
+    {
+        ucs_string_buffer_t strb = UCS_STRING_BUFFER_INITIALIZER;
+
+        ucs_metrics_show(&strb);
+        std::string metrics = ucs_string_buffer_cstr(&strb);
+        ucs_string_buffer_cleanup(&strb);
+        return metrics;
+    }
+
+    void check_metrics(const std::string &metrics)
+    {
+        UCS_TEST_MESSAGE << metrics;
+
+        EXPECT_NE(std::string::npos,
+                  metrics.find("# TYPE ucx_vfs_num_items gauge\n"
+                               "ucx_vfs_num_items{path=\"/metrics_test\"} 42\n"));
+        EXPECT_NE(std::string::npos,
+                  metrics.find("ucx_vfs_ep_count{path=\"/metrics_test\"} " +
+                               ucs::to_string((unsigned)NUM_EPS) + "\n"));
+
+        /* Non-numeric files and contents of counted directories are skipped */
+        EXPECT_EQ(std::string::npos, metrics.find("mem_type"));
+        EXPECT_EQ(std::string::npos, metrics.find("ep_items"));
+
+        ASSERT_GE(metrics.size(), 6ul);
+        EXPECT_EQ("# EOF\n", metrics.substr(metrics.size() - 6));
+    }
+
+    std::string read_all(int fd)
+    {
+        std::string result;
+        char buffer[1024];
+        ssize_t ret;
+
+        while ((ret = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            result.append(buffer, ret);
+        }
+
+        EXPECT_EQ(0, ret) << strerror(errno);
+        return result;
+    }
+
+    void start_exporter(const std::string &dest)
+    {
+        push_config();
+        modify_config("METRICS_DEST", dest);
+        ucs_metrics_init();
+    }
+
+    void start_http_exporter(struct sockaddr_in *addr)
+    {
+        socklen_t addrlen = sizeof(*addr);
+        int fd;
+
+        /* Find an available port */
+        memset(addr, 0, sizeof(*addr));
+        addr->sin_family      = AF_INET;
+        addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd                    = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(0, bind(fd, (struct sockaddr*)addr, sizeof(*addr)));
+        ASSERT_EQ(0, getsockname(fd, (struct sockaddr*)addr, &addrlen));
+        close(fd);
+
+        start_exporter("tcp:" + ucs::to_string(ntohs(addr->sin_port)));
+    }
+
+    int http_connect(const struct sockaddr_in *addr)
+    {
+        int fd;
+
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            ADD_FAILURE() << "socket() failed: " << strerror(errno);
+            return -1;
+        }
+
+        if (connect(fd, (const struct sockaddr*)addr, sizeof(*addr)) != 0) {
+            ADD_FAILURE() << "connect() failed: " << strerror(errno);
+            close(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+    void stop_exporter()
+    {
+        ucs_metrics_cleanup();
+        pop_config();
+    }
+
+    char m_obj;
+    char m_eps[NUM_EPS];
+};
+
+UCS_TEST_F(test_metrics, show) {
+    check_metrics(show());
+}
+
+UCS_TEST_F(test_metrics, show_all_entries) {
+    push_config();
+    modify_config("METRICS_VFS_COUNT", "");
+
+    std::string metrics = show();
+    for (unsigned i = 0; i < NUM_EPS; ++i) {
+        EXPECT_NE(std::string::npos,
+                  metrics.find("ucx_vfs_ep_items{path=\"/metrics_test/ep/" +
+                               ucs::to_string(i) + "\"} " + ucs::to_string(i) +
+                               "\n"));
+    }
+    EXPECT_EQ(std::string::npos, metrics.find("ucx_vfs_ep_count"));
+
+    pop_config();
+}
+
+UCS_TEST_F(test_metrics, unix_socket) {
+    std::string path = "/tmp/ucx_test_metrics_" + ucs::to_string(getpid()) +
+                       ".sock";
+    struct sockaddr_un addr = {};
+
+    start_exporter("unix:" + path);
+
+    addr.sun_family = AF_UNIX;
+    ucs_strncpy_safe(addr.sun_path, path.c_str(), sizeof(addr.sun_path));
+
+    for (int i = 0; i < 2; ++i) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(0, connect(fd, (struct sockaddr*)&addr, sizeof(addr)))
+                << strerror(errno);
+        check_metrics(read_all(fd));
+        close(fd);
+    }
+
+    stop_exporter();
+    EXPECT_NE(0, access(path.c_str(), F_OK));
+}
+
+UCS_TEST_F(test_metrics, http) {
+    struct sockaddr_in addr;
+    int fd;
+
+    start_http_exporter(&addr);
+
+    fd = http_connect(&addr);
+    ASSERT_GE(fd, 0);
+
+    std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    ASSERT_EQ((ssize_t)request.size(),
+              send(fd, request.c_str(), request.size(), 0));
+
+    std::string response = read_all(fd);
+    close(fd);
+    stop_exporter();
+
+    size_t body_offset = response.find("\r\n\r\n");
+    ASSERT_NE(std::string::npos, body_offset);
+    std::string headers = response.substr(0, body_offset);
+    std::string body    = response.substr(body_offset + 4);
+
+    EXPECT_EQ(0ul, headers.find("HTTP/1.0 200 OK\r\n"));
+    EXPECT_NE(std::string::npos,
+              headers.find("Content-Type: application/openmetrics-text"));
+    EXPECT_NE(std::string::npos,
+              headers.find("Content-Length: " + ucs::to_string(body.size())));
+    check_metrics(body);
+}
+
+UCS_TEST_F(test_metrics, http_idle_client) {
+    struct sockaddr_in addr;
+    int idle_fd, fd;
+
+    start_http_exporter(&addr);
+
+    /* A client which does not send its request must not delay the others */
+    idle_fd = http_connect(&addr);
+    ASSERT_GE(idle_fd, 0);
+
+    fd = http_connect(&addr);
+    ASSERT_GE(fd, 0);
+
+    std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    ASSERT_EQ((ssize_t)request.size(),
+              send(fd, request.c_str(), request.size(), 0));
+
+    ucs_time_t start_time = ucs_get_time();
+    std::string response  = read_all(fd);
+    EXPECT_LT(ucs_time_to_sec(ucs_get_time() - start_time), 1.0);
+    close(fd);
+
+    stop_exporter();
+    close(idle_fd);
+
+    EXPECT_NE(std::string::npos, response.find("# EOF\n"));
+}
@@ -7,6 +7,7 @@
 #include <common/test.h>
 extern "C" {
 #include <ucs/datastruct/mpool.h>
+#include <ucs/sys/sys.h>
 }
 
 #include <limits.h>
@@ -257,6 +258,74 @@ UCS_TEST_F(test_mpool, custom_alloc) {
     ucs_mpool_cleanup(&mp, 1);
 }
 
+UCS_TEST_F(test_mpool, huge_pages) {
+    const size_t elem_size         = 64 * UCS_KBYTE;
+    const unsigned elems_per_chunk = 64;
+    ssize_t huge_page_size         = ucs_get_huge_page_size();
+    int thp_enabled                = ucs_is_thp_enabled();
+    ucs_mpool_params_t mp_params;
+    ucs_status_t status;
+    ucs_mpool_t mp;
+
+    ucs_mpool_ops_t ops = {
+       ucs_mpool_hugetlb_malloc,
+       ucs_mpool_hugetlb_free,
+       NULL,
+       NULL,
+       NULL
+    };
+
+    ucs_mpool_params_reset(&mp_params);
+    mp_params.elem_size       = elem_size;
+    mp_params.elems_per_chunk = elems_per_chunk;
+    mp_params.max_elems       = 2 * elems_per_chunk;
+    mp_params.ops             = &ops;
+    mp_params.name            = "tests";
+    push_config();
+
+    for (int policy = 0; policy < UCS_MPOOL_HUGE_PAGES_LAST; ++policy) {
+        modify_config("MPOOL_HUGE_PAGES", ucs_mpool_huge_pages_names[policy]);
+        UCS_TEST_MESSAGE << "policy " << ucs_mpool_huge_pages_names[policy];
+
+        /* The default policy does not restrict any kind of huge pages */
+        bool is_default = (policy == UCS_MPOOL_HUGE_PAGES_DEFAULT);
+        EXPECT_TRUE(ucs_mpool_huge_pages_allowed(UCS_MPOOL_HUGE_PAGES_NONE));
+        EXPECT_EQ(is_default || (policy >= UCS_MPOOL_HUGE_PAGES_MADVISE),
+                  ucs_mpool_huge_pages_allowed(UCS_MPOOL_HUGE_PAGES_MADVISE));
+        EXPECT_EQ(is_default || (policy >= UCS_MPOOL_HUGE_PAGES_HUGETLB),
+                  ucs_mpool_huge_pages_allowed(UCS_MPOOL_HUGE_PAGES_HUGETLB));
+
+        status = ucs_mpool_init(&mp_params, &mp);
+        ASSERT_UCS_OK(status);
+
+        std::vector<void*> objs;
+        for (unsigned i = 0; i < 2 * elems_per_chunk; ++i) {
+            void *obj = ucs_mpool_get(&mp);
+            ASSERT_TRUE(obj != NULL);
+            memset(obj, 0xAA, elem_size);
+            objs.push_back(obj);
+        }
+
+        /* Huge page chunks start right after their header */
+        if ((policy >= UCS_MPOOL_HUGE_PAGES_MADVISE) && thp_enabled &&
+            (huge_page_size > 0) && !RUNNING_ON_VALGRIND) {
+            for (ucs_mpool_chunk_t *chunk = mp.data->chunks; chunk != NULL;
+                 chunk = chunk->next) {
+                EXPECT_LT((uintptr_t)chunk % huge_page_size, 64ul) << chunk;
+            }
+        }
+
+        for (std::vector<void*>::iterator iter = objs.begin();
+             iter != objs.end(); ++iter) {
+            ucs_mpool_put(*iter);
+        }
+
+        ucs_mpool_cleanup(&mp, 1);
+    }
+
+    pop_config();
+}
+
 UCS_TEST_F(test_mpool, grow) {
     ucs_status_t status;
     ucs_mpool_t mp;
@@ -330,6 +399,232 @@ UCS_TEST_F(test_mpool, infinite) {
     ucs_mpool_cleanup(&mp, 1);
 }
 
+UCS_TEST_F(test_mpool, shrink) {
+    const unsigned elems_per_chunk = 10;
+    std::vector<void*> objs;
+    ucs_status_t status;
+    size_t chunk_size;
+    ucs_mpool_t mp;
+
+    status = setup_mpool(&mp, data_size, elems_per_chunk,
+                         elems_per_chunk * 3);
+    ASSERT_UCS_OK(status);
+
+    /* Nothing to release before any chunk was allocated */
+    EXPECT_EQ(0ul, ucs_mpool_shrink(&mp));
+
+    for (unsigned i = 0; i < elems_per_chunk * 3; ++i) {
+        void *obj = ucs_mpool_get(&mp);
+        ASSERT_TRUE(obj != NULL);
+        objs.push_back(obj);
+    }
+
+    EXPECT_TRUE(ucs_mpool_is_empty(&mp));
+    chunk_size = mp.data->chunks_size / 3;
+
+    /* All chunks are in use */
+    EXPECT_EQ(0ul, ucs_mpool_shrink(&mp));
+
+    /* Keep one object from the first chunk, so only 2 chunks are released */
+    for (unsigned i = 1; i < objs.size(); ++i) {
+        ucs_mpool_put(objs[i]);
+    }
+
+    EXPECT_EQ(2 * chunk_size, ucs_mpool_shrink(&mp));
+    EXPECT_EQ(chunk_size, mp.data->chunks_size);
+
+    /* The quota of the released chunks can be allocated again */
+    for (unsigned i = 1; i < objs.size(); ++i) {
+        objs[i] = ucs_mpool_get(&mp);
+        ASSERT_TRUE(objs[i] != NULL);
+    }
+
+    EXPECT_TRUE(ucs_mpool_is_empty(&mp));
+
+    for (unsigned i = 0; i < objs.size(); ++i) {
+        ucs_mpool_put(objs[i]);
+    }
+
+    EXPECT_EQ(3 * chunk_size, ucs_mpool_shrink(&mp));
+    EXPECT_EQ(0ul, mp.data->chunks_size);
+
+    ucs_mpool_cleanup(&mp, 1);
+}
+
+UCS_TEST_F(test_mpool, shrink_alloc_free_cycles) {
+    const unsigned elems_per_chunk = 8;
+    const unsigned num_cycles      = 100;
+    std::vector<void*> objs;
+    ucs_status_t status;
+    ucs_mpool_t mp;
+
+    status = setup_mpool(&mp, data_size, elems_per_chunk, UINT_MAX);
+    ASSERT_UCS_OK(status);
+
+    for (unsigned cycle = 0; cycle < num_cycles; ++cycle) {
+        /* Allocate a random burst, and fill the objects with a pattern */
+        unsigned count = ucs::rand() % (elems_per_chunk * 8);
+        for (unsigned i = 0; i < count; ++i) {
+            void *obj = ucs_mpool_get(&mp);
+            ASSERT_TRUE(obj != NULL);
+            memset(obj, cycle, data_size);
+            objs.push_back(obj);
+        }
+
+        /* Release a random part of the objects, and the unused chunks */
+        count = ucs::rand() % (objs.size() + 1);
+        for (unsigned i = 0; i < count; ++i) {
+            unsigned index = ucs::rand() % objs.size();
+            ucs_mpool_put(objs[index]);
+            objs[index] = objs.back();
+            objs.pop_back();
+        }
+
+        ucs_mpool_shrink(&mp);
+
+        /* The remaining objects are still valid */
+        for (unsigned i = 0; i < objs.size(); ++i) {
+            uint8_t *ptr = (uint8_t*)objs[i];
+            ASSERT_EQ(ptr[0], ptr[data_size - 1]);
+        }
+
+        unsigned num_chunks = 0;
+        for (ucs_mpool_chunk_t *chunk = mp.data->chunks; chunk != NULL;
+             chunk = chunk->next) {
+            ++num_chunks;
+        }
+        EXPECT_LE(num_chunks, objs.size());
+    }
+
+    for (unsigned i = 0; i < objs.size(); ++i) {
+        ucs_mpool_put(objs[i]);
+    }
+
+    ucs_mpool_shrink(&mp);
+    EXPECT_EQ(0ul, mp.data->chunks_size);
+    ucs_mpool_cleanup(&mp, 1);
+}
+
+UCS_TEST_F(test_mpool, reclaim_idle) {
+    const double idle_sec          = 0.1 * ucs::test_time_multiplier();
+    const ucs_time_t idle_time     = ucs_time_from_sec(idle_sec);
+    const unsigned elems_per_chunk = 10;
+    const unsigned num_chunks      = 5;
+    std::vector<void*> objs;
+    ucs_status_t status;
+    size_t chunk_size;
+    ucs_mpool_t mp;
+
+    status = setup_mpool(&mp, data_size, elems_per_chunk, UINT_MAX);
+    ASSERT_UCS_OK(status);
+
+    for (unsigned i = 0; i < elems_per_chunk * num_chunks; ++i) {
+        void *obj = ucs_mpool_get(&mp);
+        ASSERT_TRUE(obj != NULL);
+        objs.push_back(obj);
+    }
+
+    chunk_size = mp.data->chunks_size / num_chunks;
+
+    /* Keep one object from the first chunk */
+    for (unsigned i = 1; i < objs.size(); ++i) {
+        ucs_mpool_put(objs[i]);
+    }
+
+    /* The pool grew recently */
+    EXPECT_EQ(0ul, ucs_mpool_reclaim(&mp, idle_time));
+
+    /* The first sample finds the chunks unused, the next one releases them */
+    ucs::safe_sleep(idle_sec);
+    EXPECT_EQ(0ul, ucs_mpool_reclaim(&mp, idle_time));
+    ucs::safe_sleep(idle_sec);
+    EXPECT_EQ((num_chunks - 1) * chunk_size, ucs_mpool_reclaim(&mp, idle_time));
+    EXPECT_EQ(chunk_size, mp.data->chunks_size);
+
+    /* A chunk in use is released only after it is found unused for the whole
+     * idle time */
+    ucs::safe_sleep(idle_sec);
+    EXPECT_EQ(0ul, ucs_mpool_reclaim(&mp, idle_time));
+    ucs_mpool_put(objs[0]);
+    ucs::safe_sleep(idle_sec);
+    EXPECT_EQ(0ul, ucs_mpool_reclaim(&mp, idle_time));
+    ucs::safe_sleep(idle_sec);
+    EXPECT_EQ(chunk_size, ucs_mpool_reclaim(&mp, idle_time));
+    EXPECT_EQ(0ul, mp.data->chunks_size);
+
+    /* Allocation after release does not thrash: a pool which grew again keeps
+     * its chunks until it is idle */
+    objs[0] = ucs_mpool_get(&mp);
+    ASSERT_TRUE(objs[0] != NULL);
+    ucs_mpool_put(objs[0]);
+    EXPECT_EQ(0ul, ucs_mpool_reclaim(&mp, idle_time));
+    EXPECT_EQ(chunk_size, mp.data->chunks_size);
+
+    ucs_mpool_cleanup(&mp, 1);
+}
+
+static void test_mpool_acct_limit_cb(ucs_mpool_acct_t *acct, void *arg)
+{
+    ++(*(unsigned*)arg);
+}
+
+UCS_TEST_F(test_mpool, acct_limit) {
+    const unsigned elems_per_chunk = 16;
+    unsigned num_limit_cb          = 0;
+    std::vector<void*> objs;
+    ucs_mpool_acct_t acct, *prev_acct;
+    ucs_status_t status;
+    size_t chunk_size;
+    ucs_mpool_t mp;
+    void *obj;
+
+    /* Find the chunk size */
+    status = setup_mpool(&mp, data_size, elems_per_chunk);
+    ASSERT_UCS_OK(status);
+    ucs_mpool_grow(&mp, elems_per_chunk);
+    chunk_size = mp.data->chunks_size;
+    ucs_mpool_cleanup(&mp, 1);
+
+    /* Allow 2.5 chunks */
+    ucs_mpool_acct_init(&acct, (chunk_size * 5) / 2, test_mpool_acct_limit_cb,
+                        &num_limit_cb);
+
+    prev_acct = ucs_mpool_acct_set_current(&acct);
+    status    = setup_mpool(&mp, data_size, elems_per_chunk, UINT_MAX);
+    ucs_mpool_acct_set_current(prev_acct);
+    ASSERT_UCS_OK(status);
+
+    while ((obj = ucs_mpool_get(&mp)) != NULL) {
+        objs.push_back(obj);
+        ASSERT_LE(objs.size(), elems_per_chunk * 3);
+    }
+
+    EXPECT_EQ(elems_per_chunk * 2, objs.size());
+    EXPECT_EQ(2 * chunk_size, acct.total);
+    EXPECT_EQ(2 * chunk_size, acct.peak);
+    EXPECT_EQ(1ul, acct.num_denied);
+    EXPECT_EQ(1u, num_limit_cb);
+
+    for (unsigned i = 0; i < objs.size(); ++i) {
+        ucs_mpool_put(objs[i]);
+    }
+
+    EXPECT_EQ(2 * chunk_size, ucs_mpool_acct_shrink(&acct));
+    EXPECT_EQ(0ul, acct.total);
+    EXPECT_EQ(2 * chunk_size, acct.peak);
+
+    /* The pool can grow again after its chunks were released */
+    obj = ucs_mpool_get(&mp);
+    ASSERT_TRUE(obj != NULL);
+    EXPECT_EQ(chunk_size, acct.total);
+    ucs_mpool_put(obj);
+
+    ucs_mpool_cleanup(&mp, 1);
+    EXPECT_EQ(0ul, acct.total);
+    EXPECT_TRUE(ucs_list_is_empty(&acct.mpools));
+    ucs_mpool_acct_cleanup(&acct);
+}
+
 UCS_TEST_F(test_mpool, leak_check) {
     ucs_mpool_t mp;
     ucs_status_t status;
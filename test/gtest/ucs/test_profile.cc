@@ -15,6 +15,7 @@ extern "C" {
 
 #include <pthread.h>
 #include <fstream>
+#include <map>
 
 class scoped_profile {
 public:
@@ -110,6 +111,8 @@ protected:
     void test_env(const void **ptr, const ucs_profile_block_header_t &env_vars);
 
     void do_test(unsigned int_mode, const std::string &str_mode);
+
+    void do_stream_test(int num_iters, const std::string &log_size);
 };
 
 static int sum(int a, int b)
@@ -407,6 +410,67 @@ void test_profile::do_test(unsigned int_mode, const std::string& str_mode)
     EXPECT_EQ(&data[data.size()], ptr) << data.size();
 }
 
+void test_profile::do_stream_test(int num_iters, const std::string &log_size)
+{
+    modify_config("PROFILE_LOG_SIZE", log_size);
+
+    scoped_profile p(*this, PROFILE_FILENAME, "stream");
+    run_profiled_code(num_iters);
+
+    std::string data = p.read();
+    ASSERT_GE(data.size(), sizeof(ucs_profile_stream_header_t));
+
+    /* coverity[tainted_data_downcast] */
+    const ucs_profile_stream_header_t *hdr =
+            reinterpret_cast<const ucs_profile_stream_header_t*>(&data[0]);
+    EXPECT_EQ(0, memcmp(UCS_PROFILE_STREAM_MAGIC, hdr->magic,
+                        sizeof(hdr->magic)));
+    EXPECT_EQ(UCS_PROFILE_STREAM_VERSION, hdr->version);
+    EXPECT_EQ(getpid(), (pid_t)hdr->pid);
+    EXPECT_EQ(NUM_LOCAITONS, hdr->num_locations);
+    EXPECT_EQ(data.size(),
+              hdr->chunks_offset + (hdr->num_chunks * hdr->chunk_size));
+
+    const ucs_profile_location_t *locations =
+            reinterpret_cast<const ucs_profile_location_t*>(
+                    &data[hdr->locations_offset]);
+    test_locations(locations, hdr->num_locations, (const void**)&locations);
+
+    /* Collect the records of every thread from the chunks ring */
+    std::map<uint32_t, std::vector<ucs_profile_record_t>> records;
+    uint64_t first_seq = (hdr->head > hdr->num_chunks) ?
+                         (hdr->head - hdr->num_chunks) : 0;
+    for (uint64_t seq = first_seq; seq < hdr->head; ++seq) {
+        const ucs_profile_stream_chunk_t *chunk =
+                ucs_profile_stream_chunk(hdr, seq);
+        ASSERT_EQ(seq + 1, chunk->seq);
+        EXPECT_NE(m_tids.end(), m_tids.find(chunk->tid));
+        EXPECT_LE(chunk->num_records, hdr->chunk_records);
+
+        const ucs_profile_record_t *chunk_records =
+                reinterpret_cast<const ucs_profile_record_t*>(chunk + 1);
+        records[chunk->tid].insert(records[chunk->tid].end(), chunk_records,
+                                   chunk_records + chunk->num_records);
+    }
+
+    for (const auto &thread_records : records) {
+        uint64_t prev_ts = 0;
+        for (const ucs_profile_record_t &rec : thread_records.second) {
+            EXPECT_LT(rec.location, NUM_LOCAITONS);
+            EXPECT_GE(rec.timestamp, prev_ts);
+            prev_ts = rec.timestamp;
+        }
+    }
+
+    if (hdr->head <= hdr->num_chunks) {
+        /* Nothing was overwritten */
+        EXPECT_EQ(size_t(num_threads()), records.size());
+        for (const auto &thread_records : records) {
+            EXPECT_EQ(NUM_LOCAITONS * num_iters, thread_records.second.size());
+        }
+    }
+}
+
 UCS_TEST_P(test_profile, accum) {
     do_test(UCS_BIT(UCS_PROFILE_MODE_ACCUM), "accum");
 }
@@ -420,6 +484,15 @@ UCS_TEST_P(test_profile, log_accum) {
             "log,accum");
 }
 
+UCS_TEST_P(test_profile, stream) {
+    do_stream_test(5, "4m");
+}
+
+UCS_TEST_P(test_profile, stream_wrap) {
+    /* Use the minimal ring, which is overwritten many times */
+    do_stream_test(200, "1");
+}
+
 INSTANTIATE_TEST_SUITE_P(st, test_profile, ::testing::Values(1));
 INSTANTIATE_TEST_SUITE_P(mt, test_profile, ::testing::Values(2, 4, 8));
 
@@ -8,6 +8,7 @@
 #include <common/test.h>
 extern "C" {
 #include <ucs/stats/stats.h>
+#include <ucs/time/time.h>
 }
 
 #include <sys/socket.h>
@@ -45,6 +46,7 @@ public:
         push_config();
         modify_config("STATS_DEST",    stats_dest_config().c_str());
         modify_config("STATS_TRIGGER", stats_trigger_config().c_str());
+        modify_stats_config();
         ucs_stats_init();
         ASSERT_TRUE(ucs_stats_is_active());
     }
@@ -59,6 +61,9 @@ public:
     virtual std::string stats_dest_config()    = 0;
     virtual std::string stats_trigger_config() = 0;
 
+    virtual void modify_stats_config() {
+    }
+
     void prepare_nodes(ucs_stats_node_t **cat_node,
                        ucs_stats_node_t *data_nodes[NUM_DATA_NODES]) {
         static ucs_stats_class_t category_stats_class = {
@@ -110,10 +115,10 @@ public:
             EXPECT_EQ(unsigned(NUM_COUNTERS),  data_node->cls->num_counters);
             EXPECT_EQ(std::string("counter0"), std::string(data_node->cls->counter_names[0]));
 
-            EXPECT_EQ((unsigned)10, data_node->counters[0]);
-            EXPECT_EQ((unsigned)20, data_node->counters[1]);
-            EXPECT_EQ((unsigned)30, data_node->counters[2]);
-            EXPECT_EQ((unsigned)40, data_node->counters[3]);
+            EXPECT_EQ((unsigned)10, ucs_stats_node_counter_get(data_node, 0));
+            EXPECT_EQ((unsigned)20, ucs_stats_node_counter_get(data_node, 1));
+            EXPECT_EQ((unsigned)30, ucs_stats_node_counter_get(data_node, 2));
+            EXPECT_EQ((unsigned)40, ucs_stats_node_counter_get(data_node, 3));
         }
     }
 
@@ -258,6 +263,68 @@ public:
     }
 };
 
+class stats_udp_delta_test : public stats_udp_test {
+public:
+    virtual void modify_stats_config() {
+        modify_config("STATS_FULL_INTERVAL", "4");
+    }
+
+    /* Wait until the server reports counter0 multiplied by the given factor,
+     * and the initial values of other counters */
+    void wait_for_counters(ucs_stats_counter_t factor) {
+        ucs_time_t deadline = ucs_get_time() +
+                              ucs_time_from_sec(10.0 *
+                                                ucs::test_time_multiplier());
+        bool match;
+
+        do {
+            usleep(10000);
+            match = check_server_counters(factor);
+        } while (!match && (ucs_get_time() < deadline));
+
+        EXPECT_TRUE(match) << "counters were not updated by delta reports";
+    }
+
+private:
+    bool check_server_counters(ucs_stats_counter_t factor) {
+        ucs_list_link_t *list = ucs_stats_server_get_stats(m_server);
+        ucs_stats_node_t *root, *cat_node, *data_node;
+        unsigned num_nodes = 0;
+        bool match         = true;
+
+        if (ucs_list_length(list) != 1) {
+            return false;
+        }
+
+        root     = ucs_list_head(list, ucs_stats_node_t, list);
+        cat_node = ucs_list_head(&root->children[UCS_STATS_ACTIVE_CHILDREN],
+                                 ucs_stats_node_t, list);
+        ucs_list_for_each(data_node,
+                          &cat_node->children[UCS_STATS_ACTIVE_CHILDREN],
+                          list) {
+            match = match && (data_node->counters[0] == 10 * factor);
+            for (unsigned i = 1; i < NUM_COUNTERS; ++i) {
+                match = match && (data_node->counters[i] == (i + 1) * 10);
+            }
+            ++num_nodes;
+        }
+
+        ucs_stats_server_purge_stats(m_server);
+        return match && (num_nodes == NUM_DATA_NODES);
+    }
+};
+
+class stats_sharded_test : public stats_file_test {
+public:
+    virtual void modify_stats_config() {
+        modify_config("STATS_SHARDS", "3");
+    }
+
+protected:
+    ucs_stats_node_t *m_cat_node;
+    ucs_stats_node_t *m_data_nodes[NUM_DATA_NODES];
+};
+
 class stats_aggregate_sum_test : public stats_udp_test {
 public:
     void
@@ -341,6 +408,32 @@ UCS_TEST_F(stats_on_demand_test, report) {
     free_nodes(cat_node, data_nodes);
 }
 
+UCS_TEST_F(stats_on_demand_test, show_metrics) {
+    ucs_string_buffer_t strb = UCS_STRING_BUFFER_INITIALIZER;
+    ucs_stats_node_t *cat_node;
+    ucs_stats_node_t *data_nodes[NUM_DATA_NODES] = {NULL};
+
+    prepare_nodes(&cat_node, data_nodes);
+    ucs_stats_show_metrics(&strb);
+    std::string metrics = ucs_string_buffer_cstr(&strb);
+    ucs_string_buffer_cleanup(&strb);
+    free_nodes(cat_node, data_nodes);
+
+    UCS_TEST_MESSAGE << metrics;
+
+    /* All data nodes are aggregated to a single sample per counter */
+    for (unsigned i = 0; i < NUM_COUNTERS; ++i) {
+        std::string name = "ucx_stats_data_counter" + ucs::to_string(i);
+        std::string type = "# TYPE " + name + " unknown\n";
+        std::string sample = name + "{path=\"category/data\"} " +
+                             ucs::to_string((i + 1) * 10 * NUM_DATA_NODES) +
+                             "\n";
+        EXPECT_NE(std::string::npos, metrics.find(type)) << type;
+        EXPECT_NE(std::string::npos, metrics.find(sample)) << sample;
+        EXPECT_EQ(metrics.find(sample), metrics.rfind(name + "{"));
+    }
+}
+
 UCS_TEST_F(stats_on_signal_test, report) {
     ucs_stats_node_t       *cat_node;
     ucs_stats_node_t       *data_nodes[NUM_DATA_NODES] = {NULL};
@@ -371,6 +464,83 @@ UCS_MT_TEST_F(stats_file_test, mt_add_remove, 10) {
     }
 }
 
+UCS_TEST_F(stats_udp_delta_test, report) {
+    ucs_stats_node_t *cat_node;
+    ucs_stats_node_t *data_nodes[NUM_DATA_NODES] = {NULL};
+
+    prepare_nodes(&cat_node, data_nodes);
+    wait_for_counters(1);
+
+    /* Following reports carry only the updated counters */
+    for (ucs_stats_counter_t factor = 2; factor <= 8; ++factor) {
+        for (unsigned i = 0; i < NUM_DATA_NODES; ++i) {
+            UCS_STATS_UPDATE_COUNTER(data_nodes[i], 0, 10);
+        }
+        wait_for_counters(factor);
+    }
+
+    free_nodes(cat_node, data_nodes);
+}
+
+UCS_MT_TEST_F(stats_sharded_test, mt_update, 8) {
+    static const unsigned count = 1000;
+
+    if (barrier()) {
+        prepare_nodes(&m_cat_node, m_data_nodes);
+        /* Rounded up to a power of 2 */
+        EXPECT_EQ(4u, m_data_nodes[0]->num_shards);
+        EXPECT_TRUE(m_data_nodes[0]->shards != NULL);
+        for (unsigned i = 0; i < NUM_DATA_NODES; ++i) {
+            for (unsigned j = 0; j < NUM_COUNTERS; ++j) {
+                UCS_STATS_SET_COUNTER(m_data_nodes[i], j, 0);
+            }
+        }
+    }
+    barrier();
+
+    for (unsigned n = 0; n < count; ++n) {
+        for (unsigned i = 0; i < NUM_DATA_NODES; ++i) {
+            for (unsigned j = 0; j < NUM_COUNTERS; ++j) {
+                UCS_STATS_UPDATE_COUNTER(m_data_nodes[i], j, j + 1);
+            }
+        }
+    }
+
+    if (barrier()) {
+        for (unsigned i = 0; i < NUM_DATA_NODES; ++i) {
+            for (unsigned j = 0; j < NUM_COUNTERS; ++j) {
+                EXPECT_EQ((j + 1) * count * num_threads(),
+                          UCS_STATS_GET_COUNTER(m_data_nodes[i], j));
+            }
+        }
+
+        /* Shards are summed when the statistics are reported */
+        ucs_stats_dump();
+        std::string data = get_data();
+        FILE *f          = fmemopen(&data[0], data.size(), "rb");
+        ucs_stats_node_t *root;
+        ucs_status_t status = ucs_stats_deserialize(f, &root);
+        ASSERT_UCS_OK(status);
+        fclose(f);
+
+        ucs_stats_node_t *cat_node = ucs_list_head(
+                &root->children[UCS_STATS_ACTIVE_CHILDREN], ucs_stats_node_t,
+                list);
+        ucs_stats_node_t *data_node;
+        ucs_list_for_each(data_node,
+                          &cat_node->children[UCS_STATS_ACTIVE_CHILDREN],
+                          list) {
+            for (unsigned j = 0; j < NUM_COUNTERS; ++j) {
+                EXPECT_EQ((j + 1) * count * num_threads(),
+                          data_node->counters[j]);
+            }
+        }
+        ucs_stats_free(root);
+
+        free_nodes(m_cat_node, m_data_nodes);
+    }
+}
+
 UCS_TEST_F(stats_aggregate_sum_test, report) {
     ucs_stats_node_t *cat_node;
     ucs_stats_node_t *data_nodes[NUM_DATA_NODES] = {NULL};
@@ -6,6 +6,7 @@
 
 #include <common/test.h>
 extern "C" {
+#include <ucs/sys/cache_file.h>
 #include <ucs/sys/module.h>
 #include <ucs/sys/sys.h>
 #include <ucs/sys/sock.h>
@@ -166,3 +167,51 @@ UCS_TEST_F(test_sys, cpu_cache) {
     check_cache_type(UCS_CPU_CACHE_L2, "L2");
     check_cache_type(UCS_CPU_CACHE_L3, "L3");
 }
+
+UCS_TEST_F(test_sys, cache_file) {
+    static const char *magic = "UCSTEST";
+    char dir_template[]      = "/tmp/ucx_test_cache_file_XXXXXX";
+    const std::string data   = "cached data";
+    char path[PATH_MAX];
+    struct iovec iov[2];
+    const void *mapped;
+    uint64_t key;
+    size_t length;
+    char byte;
+    int fd;
+
+    if (ucs_cache_file_key(0, &key) != UCS_OK) {
+        UCS_TEST_SKIP_R("boot id is not available");
+    }
+
+    ASSERT_NE((char*)NULL, mkdtemp(dir_template)) << strerror(errno);
+    ucs_cache_file_path(path, sizeof(path), dir_template, "test", key);
+
+    iov[0].iov_base = (void*)data.c_str();
+    iov[0].iov_len  = 6;
+    iov[1].iov_base = (void*)(data.c_str() + 6);
+    iov[1].iov_len  = data.length() - 6;
+    ASSERT_UCS_OK(ucs_cache_file_save(path, magic, 1, key, iov, 2));
+
+    mapped = ucs_cache_file_map(path, magic, 1, key, &length);
+    ASSERT_TRUE(mapped != NULL);
+    EXPECT_EQ(data, std::string((const char*)mapped, length));
+    ucs_cache_file_unmap(mapped, length);
+
+    /* Files of another component, format or configuration are ignored */
+    EXPECT_TRUE(ucs_cache_file_map(path, "UCSOTHR", 1, key, &length) == NULL);
+    EXPECT_TRUE(ucs_cache_file_map(path, magic, 2, key, &length) == NULL);
+    EXPECT_TRUE(ucs_cache_file_map(path, magic, 1, key + 1, &length) == NULL);
+
+    /* Corrupted data is ignored */
+    fd = open(path, O_RDWR);
+    ASSERT_GE(fd, 0) << strerror(errno);
+    byte = ~data.back();
+    EXPECT_EQ(1, pwrite(fd, &byte, 1,
+                        sizeof(ucs_cache_file_header_t) + data.length() - 1));
+    close(fd);
+    EXPECT_TRUE(ucs_cache_file_map(path, magic, 1, key, &length) == NULL);
+
+    unlink(path);
+    rmdir(dir_template);
+}
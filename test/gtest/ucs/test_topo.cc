@@ -9,6 +9,8 @@ extern "C" {
 #include <ucs/memory/numa.h>
 #include <ucs/sys/sys.h>
 #include <ucs/sys/topo/base/topo.h>
+#include <ucs/sys/topo/base/topo_calib.h>
+#include <ucs/config/global_opts.h>
 }
 
 class test_topo : public ucs::test {
@@ -151,3 +153,55 @@ UCS_TEST_F(test_topo, numa_distance) {
         }
     }
 }
+
+UCS_TEST_F(test_topo, calibration) {
+    const ucs_topo_calib_t *calib = ucs_topo_calib_get();
+    ucs_sys_cpuset_t cpuset;
+    ucs_numa_node_t node;
+
+    ASSERT_TRUE(calib != NULL);
+    EXPECT_GE(calib->num_nodes, 1u);
+    EXPECT_EQ(calib, ucs_topo_calib_get());
+
+    /* Copy bandwidth is measured for the nodes of the allowed CPUs */
+    ASSERT_EQ(0, ucs_sys_getaffinity(&cpuset));
+    for (unsigned cpu = 0; cpu < ucs_numa_num_configured_cpus(); ++cpu) {
+        node = ucs_numa_node_of_cpu(cpu);
+        if (!CPU_ISSET(cpu, &cpuset) || (node >= calib->num_nodes)) {
+            continue;
+        }
+
+        EXPECT_GT(calib->memcpy_bw[node][node], 0) << "node " << node;
+        EXPECT_GT(calib->mem_latency[node][node], 0) << "node " << node;
+    }
+
+    for (unsigned node1 = 0; node1 < calib->num_nodes; ++node1) {
+        for (unsigned node2 = 0; node2 < calib->num_nodes; ++node2) {
+            UCS_TEST_MESSAGE << "node" << node1 << " to node" << node2
+                             << ": memcpy "
+                             << calib->memcpy_bw[node1][node2] / UCS_MBYTE
+                             << " MB/s, memory latency "
+                             << calib->mem_latency[node1][node2] *
+                                UCS_NSEC_PER_SEC
+                             << " ns, cache line latency "
+                             << calib->cacheline_latency[node1][node2] *
+                                UCS_NSEC_PER_SEC
+                             << " ns";
+            EXPECT_EQ(calib->cacheline_latency[node1][node2],
+                      calib->cacheline_latency[node2][node1]);
+        }
+    }
+
+    UCS_TEST_MESSAGE << "last level cache latency: shared "
+                     << calib->llc_shared_latency * UCS_NSEC_PER_SEC
+                     << " ns, not shared "
+                     << calib->llc_remote_latency * UCS_NSEC_PER_SEC << " ns";
+
+    /* Results are kept in the calibration file */
+    if (!ucs_string_is_empty(ucs_global_opts.topo_calib_dir)) {
+        std::string path = std::string(ucs_global_opts.topo_calib_dir) +
+                           "/ucs_topo_calib_" + ucs::to_string(getuid()) +
+                           ".dat";
+        EXPECT_EQ(0, access(path.c_str(), R_OK)) << path;
+    }
+}
@@ -269,6 +269,29 @@ UCS_TEST_P(test_mem, mmap_fixed) {
     }
 }
 
+UCS_TEST_P(test_mem, mpool_alloc_method_allowed) {
+    push_config();
+
+    for (int policy = 0; policy < UCS_MPOOL_HUGE_PAGES_LAST; ++policy) {
+        modify_config("MPOOL_HUGE_PAGES", ucs_mpool_huge_pages_names[policy]);
+
+        /* The default policy does not restrict any method */
+        int expected = 1;
+        if (policy != UCS_MPOOL_HUGE_PAGES_DEFAULT) {
+            if (GetParam() == UCT_ALLOC_METHOD_HUGE) {
+                expected = (policy >= UCS_MPOOL_HUGE_PAGES_HUGETLB);
+            } else if (GetParam() == UCT_ALLOC_METHOD_THP) {
+                expected = (policy >= UCS_MPOOL_HUGE_PAGES_MADVISE);
+            }
+        }
+
+        EXPECT_EQ(expected, !!uct_mem_mpool_alloc_method_allowed(GetParam()))
+                << "policy " << ucs_mpool_huge_pages_names[policy];
+    }
+
+    pop_config();
+}
+
 INSTANTIATE_TEST_SUITE_P(alloc_methods, test_mem,
                         ::testing::Values(UCT_ALLOC_METHOD_THP,
                                           UCT_ALLOC_METHOD_HEAP,